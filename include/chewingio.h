@@ -233,6 +233,50 @@ CHEWING_API int chewing_Configure( ChewingContext *ctx, ChewingConfigData *pcd )
 
 /*@}*/
 
+/*! \name Dictionary layers
+ */
+
+/*@{*/
+/**
+ * @brief Search phrases in one more dictionary
+ * @see chewing_dict_Remove()
+ *
+ * The dictionary is built by the same tools as the system dictionary, and is
+ * shared with other contexts using it. Candidates of all dictionaries are
+ * merged in descending order of frequency.
+ *
+ * @param ctx Chewing IM context
+ * @param path data directory of the dictionary
+ * @return 0 if succeed, or -1 if the dictionary cannot be loaded, is already
+ * added, or there are too many dictionaries
+ */
+CHEWING_API int chewing_dict_Add( ChewingContext *ctx, const char *path );
+
+/**
+ * @brief Stop searching phrases in a dictionary added by chewing_dict_Add
+ *
+ * @param ctx Chewing IM context
+ * @param path data directory passed to chewing_dict_Add
+ * @return 0 if succeed, or -1 if there is no such dictionary
+ */
+CHEWING_API int chewing_dict_Remove( ChewingContext *ctx, const char *path );
+
+/**
+ * @brief Load the system dictionary again, such as after it is updated
+ *
+ * The new dictionary is loaded alongside the one in use, which keeps
+ * working. Every context using the same data directory switches to the new
+ * one at its next key starting input, and the old one is unloaded once no
+ * context uses it. Predictions and readings being enumerated end when the
+ * context switches.
+ *
+ * @param ctx Chewing IM context
+ * @return 0 if succeed, or -1 if the dictionary cannot be loaded, in which
+ * case the one in use is kept
+ */
+CHEWING_API int chewing_dict_Reload( ChewingContext *ctx );
+/*@}*/
+
 /*! \name Keyboard mapping
  */
 
@@ -528,6 +572,27 @@ CHEWING_API int chewing_get_phraseChoiceRearward( ChewingContext *ctx );
 /*@}*/
 
 
+/*! \name Continuous input of pinyin keyboard layouts
+ */
+
+/*@{*/
+/**
+ * @brief Set whether pinyin syllables are typed without end keys
+ *
+ * @param ctx
+ * @param mode
+ */
+CHEWING_API void chewing_set_continuousPinyin( ChewingContext *ctx, int mode );
+
+/**
+ * @brief Get whether pinyin syllables are typed without end keys
+ *
+ * @param ctx
+ */
+CHEWING_API int chewing_get_continuousPinyin( ChewingContext *ctx );
+/*@}*/
+
+
 /*! \name Phonetic sequence in Chewing internal state machine
  */
 
@@ -81,6 +81,23 @@ typedef struct {
 	/*@}*/
 } IntervalType;
 
+/**
+ * @brief changes of output reported by chewing_output_Delta()
+ *
+ * Bytes [preeditFrom, preeditTo) of the previously reported preedit string
+ * are replaced by the preeditTextLen bytes at preeditText.
+ */
+typedef struct {
+	int preeditFrom;	/**< first replaced byte of the preedit string */
+	int preeditTo;		/**< end of replaced bytes in the previous string */
+	const char *preeditText;	/**< replacement, not null-terminated */
+	int preeditTextLen;	/**< length of preeditText in bytes */
+	int cursor;		/**< current cursor position */
+	int bCursorChanged;	/**< cursor position is changed */
+	int bIntervalChanged;	/**< intervals shall be fetched again */
+	int bCandidateChanged;	/**< candidate window shall be fetched again */
+} ChewingOutputDelta;
+
 /** @brief context handle used for Chewing IM APIs
  */
 typedef struct _ChewingContext ChewingContext;
@@ -22,9 +22,20 @@ typedef struct {
 	char word[ 7 ];
 } Word;
 
-int GetCharFirst( ChewingData *, Word *, uint16_t );
-int GetCharNext ( ChewingData *, Word * );
-int InitChar( ChewingData *pgdata, const char * prefix );
-void TerminateChar( ChewingData *pgdata );
+/** @brief cursor of GetCharFirst/GetCharNext, owned by the caller. */
+typedef struct {
+#ifdef USE_BINARY_DATA
+	const unsigned char *cur_pos;
+	const unsigned char *end_pos;
+#else
+	long cur_pos;
+	long end_pos;
+#endif
+} CharIterator;
+
+int GetCharFirst( ChewingData *, CharIterator *, Word *, uint16_t );
+int GetCharNext ( ChewingData *, CharIterator *, Word * );
+int InitChar( SystemDictData *sys_dict, const char * prefix );
+void TerminateChar( SystemDictData *sys_dict );
 
 #endif
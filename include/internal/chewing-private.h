@@ -40,6 +40,8 @@
 #define N_HASH_BIT (14)
 #define HASH_TABLE_SIZE (1<<N_HASH_BIT)
 #define EASY_SYMBOL_KEY_TAB_LEN (36)
+/* the system dictionary, and the ones added by chewing_dict_Add */
+#define MAX_DICT_LAYER (8)
 
 #ifndef _MSC_VER
 #undef max
@@ -66,16 +68,103 @@ typedef struct {
 	int child_begin, child_end;
 } TreeType;
 
+/** @brief initial of a phone, which is stored from bit shift[ 0 ] in key2pho.c. */
+#define INITIAL_FROM_PHONE( phone ) ( (uint16_t) ( ( phone ) >> 9 ) )
+
+/**
+ * @brief node of the abbreviation tree, which is keyed on initials only.
+ *
+ * Phrases whose initials are the path to this node are
+ * abbr_posting[ posting_begin .. posting_end ), as phrase id of the phrase
+ * index file.
+ */
+typedef struct {
+	uint16_t initial;
+	int posting_begin, posting_end;
+	int child_begin, child_end;
+} AbbrTreeType;
+
+/** @brief number of phrases predicted for each node of the phone tree. */
+#define PREDICT_TOP_K (10)
+
+/**
+ * @brief entry of the reverse index, which is sorted by phrase, then by phone.
+ *
+ * The phrase and its frequency are at dict_offset in the phrase file.
+ */
+typedef struct {
+	int dict_offset;
+	int phrase_id;
+	/* terminated by 0 if shorter than MAX_PHRASE_LEN */
+	uint16_t phone[ MAX_PHRASE_LEN ];
+} ReverseIndexType;
+
 typedef struct {
 	char chiBuf[ MAX_PHONE_SEQ_LEN * MAX_UTF8_SIZE + 1 ];
+	/**
+	 * @brief byte offset of each character in chiBuf, built once per
+	 * phrasing. chiOffset[ nPhoneSeq ] is the end of chiBuf.
+	 */
+	int chiOffset[ MAX_PHONE_SEQ_LEN + 1 ];
 	IntervalType dispInterval[ MAX_INTERVAL ];
 	int nDispInterval;
 	int nNumCut;
 } PhrasingOutput;
 
+#define PINYIN_CONTINUOUS_SIZE ( ZUIN_SIZE * MAX_UTF8_SIZE )
+#define PINYIN_MAX_WALK 32
+
+/**
+ * @brief a path in the phrase tree, whose last syllable ends at the lattice
+ * node holding it.
+ */
+typedef struct {
+	/** @brief node in the phrase tree. */
+	int tree_p;
+	/** @brief phone of the last syllable, with tone. */
+	uint16_t phone;
+	/** @brief lattice node where the last syllable begins. */
+	signed char from;
+	/** @brief walk at `from' for the previous syllable, -1 if none. */
+	signed char prev;
+	/** @brief lattice node where the phrase begins. */
+	signed char begin;
+	/** @brief number of syllables. */
+	signed char len;
+} PinYinWalk;
+
+typedef struct {
+	int nWalk;
+	PinYinWalk walk[ PINYIN_MAX_WALK ];
+	/** @brief cost of the best segmentation up to here, -1 if none. */
+	int cost;
+	/** @brief frequency sum of the best segmentation up to here. */
+	int freq;
+	/** @brief walk ending the best segmentation, -1 for a separator. */
+	int best;
+} PinYinLatticeNode;
+
+/**
+ * @brief syllable lattice of continuous pinyin input.
+ *
+ * node[ i ] describes keySeq[ 0 .. i ), so appending or removing a key only
+ * touches the last node.
+ */
+typedef struct {
+	char keySeq[ PINYIN_CONTINUOUS_SIZE + 1 ];
+	int len;
+	PinYinLatticeNode node[ PINYIN_CONTINUOUS_SIZE + 1 ];
+} PinYinLattice;
+
 typedef struct {
     int type;
     char keySeq[ PINYIN_SIZE ];
+    PinYinLattice lattice;
+    /** @brief syllables segmented from lattice, to be added by AddChi. */
+    uint16_t phoneSeq[ PINYIN_CONTINUOUS_SIZE ];
+    /** @brief whether phoneSeq[ i ] is in the same phrase as phoneSeq[ i - 1 ]. */
+    int bCnnct[ PINYIN_CONTINUOUS_SIZE ];
+    int nPhoneSeq;
 } PinYinData;
 
 typedef struct {
@@ -119,75 +208,147 @@ typedef struct {
 	int isSymbol;
 } ChoiceInfo;
 
-/** @brief entry of symbol table */
-typedef struct _SymbolEntry {
-	/** @brief  nSymnols is total number of symbols in this category.
-	 * If nSymbols = 0, category is treat as a symbol, 
-	 * which is a zero-terminated utf-8 string. 
-	 * In that case, symbols[] is unused and isn't allocated at all.
-	 */
-	int nSymbols;
+/**
+ * @brief read-only system dictionary
+ *
+ * The tables are never written after they are loaded, so one instance is
+ * shared by all contexts using the same data directory. Iteration state lives
+ * in the caller-owned CharIterator and PhraseIterator.
+ */
+typedef struct tag_SystemDictData {
+	TreeType *tree;
+	size_t tree_size;
 
-	/** @brief  Category name of these symbols */
-	char category[ MAX_PHRASE_LEN * MAX_UTF8_SIZE + 1 ];
+	/* NULL if the data directory has no abbreviation tree. */
+	AbbrTreeType *abbr_tree;
+	size_t abbr_tree_size;
+	int *abbr_posting;
+	size_t abbr_posting_size;
 
-	/** @brief  Symbols in this category.
-	 * This is an char[] array of variable length.
-	 * When nSymbols = 0, this array is not allocated.
+	/*
+	 * Offsets in the phrase file of the most frequent phrases below node n
+	 * of tree are predict[ predict_begin[ n ] .. predict_begin[ n + 1 ] ).
+	 * NULL if the data directory has no prediction table.
 	 */
-	char symbols[][ MAX_UTF8_SIZE + 1 ];
-} SymbolEntry;
+	int *predict_begin;
+	int *predict;
+	size_t predict_size;
 
-typedef struct {
-	TreeType *tree;
-	size_t tree_size;
-#ifdef USE_BINARY_DATA
-	plat_mmap tree_mmap;
-#endif
+	/* NULL if the data directory has no reverse index. */
+	ReverseIndexType *reverse_index;
+	size_t reverse_index_size;
 
 	uint16_t *arrPhone;
 	int *char_begin;
 	size_t phone_num;
 	void *char_;
-	void *char_cur_pos;
-	int char_end_pos;
-#ifdef USE_BINARY_DATA
-	plat_mmap char_mmap;
-	plat_mmap char_begin_mmap;
-	plat_mmap char_phone_mmap;
-#else
+#ifndef USE_BINARY_DATA
 	FILE *charfile;
 #endif
 
 	int *dict_begin;
-	void *dict_cur_pos;
-	int dict_end_pos;
-
 	void *dict;
-
 #ifdef USE_BINARY_DATA
-	plat_mmap dict_mmap;
-	plat_mmap index_mmap;
+	/*
+	 * All tables above point into DICTIONARY_FILE, which is mapped once.
+	 * On a big-endian host, they point into container_copy instead, which
+	 * is converted from the little-endian file. container is either of them.
+	 */
+	plat_mmap container_mmap;
+	const char *container;
+	void *container_copy;
+	const struct tag_ContainerSection *section;
+	int section_num;
+
+	/* number of dict_begin, which is a bucket more than phrase ids */
+	size_t dict_begin_size;
+	/* bytes of dict */
+	size_t dict_size;
+	/* NULL unless dict is front-coded, see SECTION_DICT_FRONT_CODED. */
+	const char *dict_charset;
+	size_t dict_charset_size;
+	/*
+	 * A bit for each byte of dict, which is set if a record starts there.
+	 * It is only kept while the dictionary is loaded, to validate offsets.
+	 */
+	unsigned char *dict_record;
 #else
 	FILE *dictfile;
 #endif
 
+	char prefix[ PATH_MAX ];
+	int ref_count;
+	/*
+	 * 1 once ReloadSystemDict loads a newer generation of prefix. It is
+	 * accessed with PLAT_ATOMIC_LOAD and PLAT_ATOMIC_STORE.
+	 */
+	int stale;
+	struct tag_SystemDictData *next;
+} SystemDictData;
+
+#define KEY_TABLE_KEY_NUM 128
+#define KEY_TABLE_SEARCH_TIMES 4
+
+/**
+ * @brief keyboard layout compiled for lookup
+ *
+ * entry[ key ][ n ] is the phone of the (n + 1)-th occurrence of key in the
+ * layout, encoded as ( type << 5 ) | inx. Zero means no such phone.
+ */
+typedef struct {
+	unsigned char entry[ KEY_TABLE_KEY_NUM ][ KEY_TABLE_SEARCH_TIMES ];
+} KeyTable;
+
+typedef struct {
+	SystemDictData *sys_dict;
+	/*
+	 * Dictionaries searched for phrases, in order. dict_layer[ 0 ] is
+	 * sys_dict, which is also the only one for prediction, abbreviation,
+	 * reverse lookup and pinyin.
+	 */
+	SystemDictData *dict_layer[ MAX_DICT_LAYER ];
+	int dict_layer_num;
+	/*
+	 * Newer generation of sys_dict, which replaces it at the first key
+	 * starting input, so that no input refers to both. NULL if none is
+	 * loaded yet.
+	 */
+	SystemDictData *sys_dict_next;
 
 	int chewing_lifetime;
 
+	KeyTable key_table[ MAX_KBTYPE ];
+	/**
+	 * @brief transitions of zhuyin layouts, compiled from key_table on
+	 * first use, and shared by all contexts.
+	 */
+	struct tag_ZuinTable *zuin_table[ MAX_KBTYPE ];
+
 	char hashfilename[ 200 ];
 	struct tag_HASH_ITEM *hashtable[ HASH_TABLE_SIZE ];
 
-	unsigned int n_symbol_entry;
-	SymbolEntry ** symbol_table;
+	/*
+	 * The tables below are optional for most sessions, so they are loaded
+	 * on first use from the directory in *_prefix. The prefix is freed
+	 * and set to NULL once the table is loaded.
+	 */
+	char *symbol_table_prefix;
+	struct tag_SymbolTable *symbol_table;
+
+	char *easy_symbol_prefix;
+	struct tag_SymbolTable *easy_symbol_table;
 
-	char *g_easy_symbol_value[ EASY_SYMBOL_KEY_TAB_LEN ];
-	int g_easy_symbol_num[ EASY_SYMBOL_KEY_TAB_LEN ];
+	/** @brief built-in symbols of OpenSymbolChoice, compiled on first use. */
+	struct tag_SymbolTable *open_symbol_table;
 
+	char *pinyin_prefix;
 	struct keymap *hanyuInitialsMap;
 	struct keymap *hanyuFinalsMap;
 	int HANYU_INITIALS;
 	int HANYU_FINALS;
+	/** @brief hash table of all spellings, compiled from the maps above. */
+	struct tag_PinyinEntry *pinyin_table;
+	unsigned int pinyin_table_size;
 } ChewingStaticData;
 
 struct tag_HASH_ITEM;
@@ -221,18 +382,46 @@ typedef struct tag_ChewingData {
 	int bSymbolArrBrkpt[ MAX_PHONE_SEQ_LEN + 1 ];
 	/* "bArrBrkpt[10]=True" means "it breaks between 9 and 10" */
 	int bChiSym, bSelect, bFirstKey, bFullShape;
+	/** @brief whether pinyin syllables are typed without end keys. */
+	int bContinuousPinyin;
 	/* Symbol Key buffer */
 	char symbolKeyBuf[ MAX_PHONE_SEQ_LEN ];
 
-	struct tag_HASH_ITEM *prev_userphrase;
 	ChewingStaticData static_data;
 } ChewingData;
 
+typedef struct {
+	/**
+	 * @brief number of bytes at the beginning and at the end of preeditBuf
+	 * which are not changed since the last chewing_output_Delta call.
+	 */
+	int preeditPrefix;
+	int preeditSuffix;
+	/** @brief length of preeditBuf reported by the last call. */
+	int preeditLen;
+	int bCursorChanged;
+	int bIntervalChanged;
+	int bCandidateChanged;
+	/** @brief candidate page shown by the previous MakeOutput. */
+	int candTotal;
+	int candPageNo;
+	int candPerPage;
+	char candPage[ MAX_SELKEY ][ MAX_PHRASE_LEN * MAX_UTF8_SIZE + 1 ];
+} OutputDelta;
+/**
+ * @struct OutputDelta
+ * @brief changes of ChewingOutput accumulated by MakeOutput
+ */
+
 typedef struct {
 	/** @brief the content of Edit buffer. */
 	wch_t chiSymbolBuf[ MAX_PHONE_SEQ_LEN ];
 	/** @brief the length of Edit buffer. */
 	int chiSymbolBufLen;
+	/** @brief UTF-8 string of Edit buffer, filled by MakeOutput. */
+	char preeditBuf[ MAX_PHONE_SEQ_LEN * MAX_UTF8_SIZE + 1 ];
+	/** @brief the length of preeditBuf in bytes. */
+	int preeditBufLen;
 	/** @brief current position of the cursor. */
 	long chiSymbolCursor;
 	long PointStart;
@@ -247,6 +436,8 @@ typedef struct {
 	/** @brief the string going to commit. */
 	wch_t commitStr[ MAX_PHONE_SEQ_LEN ];
 	int nCommitStr;
+	/** @brief UTF-8 string of commitStr, filled by MakeOutput. */
+	char commitBuf[ MAX_PHONE_SEQ_LEN * MAX_UTF8_SIZE + 1 ];
 	/** @brief information of character selections. */
 	ChoiceInfo* pci;
 	/** @brief indicate English mode or Chinese mode. */
@@ -258,6 +449,8 @@ typedef struct {
 	/** @brief user message. */
 	wch_t showMsg[ MAX_PHONE_SEQ_LEN ];
 	int showMsgLen;
+	/** @brief changes since the last chewing_output_Delta call. */
+	OutputDelta delta;
 } ChewingOutput;
 /**
  *   @struct ChewingOutput
@@ -270,6 +463,12 @@ struct _ChewingContext {
 	int cand_no;
 	int it_no;
 	int kb_no;
+	const int *predict;
+	int predict_num;
+	int predict_no;
+	const ReverseIndexType *reading;
+	int reading_num;
+	int reading_no;
 };
 /**
  * @struct ChewingContext
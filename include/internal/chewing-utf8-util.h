@@ -22,6 +22,25 @@ int ueBytesFromChar( unsigned char b );
 /* Return byets of a UTF-8 string until len position */
 int ueStrNBytes( const char *, int );
 
+/* Return 1 if the first len bytes of str have an ASCII byte */
+int ueStrHasAscii( const char *str, size_t len );
+
+/*
+ * Return number of characters in the first len bytes of str, or -1 if they are
+ * not well-formed UTF-8.
+ */
+int ueStrCheck( const char *str, size_t len );
+
+/*!
+ * Fill byte offset of each character, and return number of characters
+ * @param[in] str 	The UTF-8 string.
+ * @param[out] offset 	Byte offset of each character. offset[ return value ]
+ * 			is the end of the last character, so offset shall have
+ * 			n + 1 elements.
+ * @param[in] n 	The maximum number of characters.
+ */
+int ueStrOffset( const char *str, int offset[], int n );
+
 #define STRNCPY_CLOSE 1
 #define STRNCPY_NOT_CLOSE 0
 
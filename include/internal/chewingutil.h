@@ -34,8 +34,10 @@ int SymbolInput( int key, ChewingData *pgdata );
 int SymbolChoice( ChewingData *pgdata, int sel_i );
 int HaninSymbolInput( ChewingData *pgdata );
 int WriteChiSymbolToBuf( wch_t csBuf[], int csBufLen, ChewingData *pgdata );
+int CopyChiBuf( ChewingData *pgdata, char *buf, int from, int len );
 int ReleaseChiSymbolBuf( ChewingData *pgdata, ChewingOutput *);
 int AddChi( uint16_t phone, uint16_t phoneAlt, ChewingData *pgdata );
+void AddPinYinPhoneSeq( ChewingData *pgdata );
 int CallPhrasing( ChewingData *pgdata );
 int MakeOutputWithRtn( ChewingOutput *pgo, ChewingData *pgdata, int keystrokeRtn );
 void MakeOutputAddMsgAndCleanInterval( ChewingOutput *pgo, ChewingData *pgdata );
@@ -53,9 +55,11 @@ int IsPreferIntervalConnted( int cursor, ChewingData *pgdata );
 int OpenSymbolChoice( ChewingData *pgdata );
 
 int InitSymbolTable( ChewingData *pgdata, const char *prefix );
+void LoadSymbolTable( ChewingData *pgdata );
 void TerminateSymbolTable( ChewingData *pgdata );
 
 int InitEasySymbolInput( ChewingData *pgdata, const char *prefix );
+void LoadEasySymbolInput( ChewingData *pgdata );
 void TerminateEasySymbolTable( ChewingData *pgdata );
 
 #endif
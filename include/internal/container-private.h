@@ -0,0 +1,142 @@
+/**
+ * container-private.h
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifndef _CHEWING_CONTAINER_PRIVATE_H
+#define _CHEWING_CONTAINER_PRIVATE_H
+
+#include <stddef.h>
+
+#include "chewing-private.h"
+
+/*
+ * The binary system dictionary is one file, DICTIONARY_FILE. It starts with a
+ * ContainerHeader, followed by section_num ContainerSection from
+ * section_offset. Each section starts at a multiple of CONTAINER_ALIGN bytes.
+ *
+ * Every field of the file, including the data of sections, is little-endian,
+ * so the same file works on every host. A big-endian host converts sections
+ * when it loads them.
+ *
+ * Each section has the ContainerChecksum of its data, and the header has the
+ * ContainerChecksum of the section table, which are verified once when the
+ * file is loaded.
+ */
+#define CONTAINER_MAGIC "CHEWDICT"
+#define CONTAINER_MAGIC_SIZE (8)
+/** @brief bumped whenever the layout of the file or of any section changes. */
+#define CONTAINER_VERSION (2)
+#define CONTAINER_ALIGN (64)
+
+/** @brief id of a section, which is never reused for another content. */
+enum {
+	SECTION_CHAR = 1,
+	SECTION_CHAR_BEGIN,
+	SECTION_CHAR_PHONE,
+	SECTION_DICT,
+	SECTION_DICT_BEGIN,
+	SECTION_TREE,
+	SECTION_ABBR_TREE,
+	SECTION_ABBR_POSTING,
+	SECTION_PREDICT_BEGIN,
+	SECTION_PREDICT,
+	SECTION_REVERSE_INDEX,
+	SECTION_DICT_CHARSET,
+	SECTION_DICT_FRONT_CODED,
+	SECTION_ID_END,
+};
+
+/*
+ * packdata -c replaces SECTION_DICT with SECTION_DICT_FRONT_CODED, which
+ * has the same buckets of SECTION_DICT_BEGIN. A record is:
+ *
+ * - a byte, with the number of leading characters shared with the first
+ *   record of the bucket in the high 4 bits, and the number of following
+ *   characters in the low 4 bits. Sharing with the first record rather than
+ *   the previous one keeps GetPhraseByOffset from walking the bucket.
+ * - a little-endian uint16_t for each following character, which is its
+ *   index in SECTION_DICT_CHARSET.
+ * - the frequency, as an unsigned LEB128 number.
+ *
+ * SECTION_DICT_CHARSET has the UTF-8 bytes of each character, padded with 0
+ * to DICT_CHAR_SIZE.
+ */
+#define DICT_CHAR_SIZE (4)
+#define DICT_CHARSET_MAX (65536)
+
+typedef struct {
+	char magic[ CONTAINER_MAGIC_SIZE ];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t section_num;
+	uint32_t section_offset;
+	/** @brief checksum of the section table. */
+	uint32_t checksum;
+	uint32_t reserved[ 11 ];
+} ContainerHeader;
+
+typedef struct tag_ContainerSection {
+	uint32_t id;
+	/** @brief size of an element, which shall match the struct of the reader. */
+	uint32_t element_size;
+	uint64_t offset;
+	uint64_t size;
+	/** @brief checksum of the data of the section. */
+	uint32_t checksum;
+	uint32_t reserved;
+} ContainerSection;
+
+/** @brief what a section is made of, and where the tools write it. */
+typedef struct {
+	int id;
+	/**
+	 * @brief file written by sort, packed as this section, or
+	 * NULL if packdata makes it.
+	 */
+	const char *file;
+	/** @brief 0 if the dictionary cannot be loaded without this section. */
+	int optional;
+	size_t element_size;
+	/*
+	 * Bytes of each field of an element, as digits. The last field repeats
+	 * to the end of the element, which covers padding and arrays. NULL for
+	 * phrase records: a length byte, the phrase, and an int frequency.
+	 */
+	const char *fields;
+} ContainerLayout;
+
+extern const ContainerLayout CONTAINER_LAYOUT[];
+
+const ContainerLayout *GetContainerLayout( int id );
+
+/* Convert between little-endian and the host, in either direction. */
+uint32_t ContainerUint32( uint32_t value );
+uint64_t ContainerUint64( uint64_t value );
+void ContainerSwapSection( const ContainerLayout *layout, void *data, size_t size );
+
+/*
+ * Return the section table of the container in data, or NULL if data is not
+ * a container of CONTAINER_VERSION, or any section is out of data. The table
+ * is still little-endian.
+ */
+const ContainerSection *ContainerSections( const void *data, size_t size, int *section_num );
+
+/*
+ * Return a checksum of size bytes, which is a Fletcher sum of little-endian
+ * 32-bit words in each of several lanes, so that compilers vectorize it.
+ */
+uint32_t ContainerChecksum( const void *data, size_t size );
+
+/*
+ * Return 0 if the section table and every section of the container in data
+ * match their checksums, or -1. section is from ContainerSections.
+ */
+int ContainerVerify( const void *data, const ContainerSection *section, int section_num );
+
+#endif
@@ -19,9 +19,109 @@
 
 #define PHONE_PHRASE_NUM (162244)
 
-int GetPhraseFirst( ChewingData *pgdata, Phrase *phr_ptr, int phone_phr_id );
-int GetPhraseNext ( ChewingData *pgdata, Phrase *phr_ptr );
-int InitDict( ChewingData *pgdata, const char * prefix );
-void TerminateDict( ChewingData *pgdata );
+/** @brief position in the phrases of one dictionary. */
+typedef struct {
+	const SystemDictData *sys_dict;
+#ifdef USE_BINARY_DATA
+	const unsigned char *cur_pos;
+	const unsigned char *end_pos;
+	/* the first phrase of the bucket, which front-coded records share */
+	char phrase[ MAX_PHRASE_LEN * MAX_UTF8_SIZE + 1 ];
+#else
+	long cur_pos;
+	long end_pos;
+#endif
+	/* the phrase before cur_pos, read ahead to merge dictionaries */
+	Phrase next;
+	int has_next;
+} DictCursor;
+
+/** @brief cursor of GetPhraseFirst/GetPhraseNext, owned by the caller. */
+typedef struct {
+	DictCursor cursor[ MAX_DICT_LAYER ];
+	int cursor_num;
+} PhraseIterator;
+
+/**
+ * @brief Get the first phrase of phoneSeq in all dictionary layers.
+ *
+ * Phrases of all layers are merged in descending order of frequency. Equal
+ * frequencies keep the order of layers.
+ *
+ * @param phoneSeq phones, terminated by 0
+ *
+ * @return 1 if there is such a phrase, otherwise 0.
+ */
+int GetPhraseFirst( ChewingData *pgdata, PhraseIterator *iter, Phrase *phr_ptr, const uint16_t phoneSeq[] );
+/**
+ * @brief Get the first phrase of phone_phr_id, such as a phrase_id of the
+ * tree, in sys_dict only.
+ */
+int GetDictPhraseFirst( const SystemDictData *sys_dict, PhraseIterator *iter, Phrase *phr_ptr, int phone_phr_id );
+int GetPhraseNext ( ChewingData *pgdata, PhraseIterator *iter, Phrase *phr_ptr );
+void GetPhraseByOffset( ChewingData *pgdata, int offset, Phrase *phr_ptr );
+int InitDict( SystemDictData *sys_dict, const char * prefix );
+void TerminateDict( SystemDictData *sys_dict );
+#ifdef USE_BINARY_DATA
+void *GetDictSection( const SystemDictData *sys_dict, int id, size_t element_size, size_t *num );
+
+/*
+ * Tables of the dictionary are validated once when they are loaded, so that
+ * lookups can follow them without checking bounds.
+ *
+ * Return 1 if index[ 0 .. num ) ascends from 0 up to limit, such as the
+ * offsets of buckets in a table of limit bytes.
+ */
+int IsDictIndexValid( const int *index, size_t num, size_t limit );
+
+/* Return 1 if every value[ 0 .. num ) is in [ 0, limit ). */
+int IsDictValueValid( const int *value, size_t num, size_t limit );
+
+/*
+ * Return 1 if each of num offsets, stride bytes apart from offset, is the
+ * start of a record of the phrase section. It is only called while the
+ * dictionary is loaded, after InitDict.
+ */
+int IsDictOffsetValid( const SystemDictData *sys_dict, const int *offset, size_t num, size_t stride );
+#endif
+
+#ifdef ENABLE_BUILTIN_DICT
+/** @brief prefix of the dictionary linked into the library, which is no directory. */
+#define BUILTIN_DICT_PREFIX ""
+
+/* DICTIONARY_FILE written as BUILTIN_DICT_SOURCE by packdata -b */
+extern const void * const BUILTIN_DICT;
+extern const size_t BUILTIN_DICT_SIZE;
+#endif
+
+/**
+ * @brief Get the system dictionary in prefix, loading it if no context uses
+ * it yet.
+ *
+ * @return the shared dictionary, or NULL if it cannot be loaded.
+ */
+SystemDictData *AcquireSystemDict( const char *prefix );
+
+/**
+ * @brief Drop one reference to sys_dict, and unload it after the last one.
+ */
+void ReleaseSystemDict( SystemDictData *sys_dict );
+
+/**
+ * @brief Load the system dictionary in prefix again, as a new generation
+ * which AcquireSystemDict returns from now on.
+ *
+ * Dictionaries of older generations stay loaded until they are released.
+ *
+ * @return the new dictionary, acquired once, or NULL if it cannot be loaded.
+ */
+SystemDictData *ReloadSystemDict( const char *prefix );
+
+/**
+ * @brief Return whether a newer generation of sys_dict has been loaded.
+ *
+ * It takes no lock, so that it can be checked at every key.
+ */
+int IsSystemDictStale( SystemDictData *sys_dict );
 
 #endif
@@ -13,9 +13,16 @@
 #ifndef _CHEWING_GLOBAL_PRIVATE_H
 #define _CHEWING_GLOBAL_PRIVATE_H
 
+#define DICTIONARY_FILE		"dictionary.dat"
+#define BUILTIN_DICT_SOURCE	"builtin-dict.c"
 #define PHONE_TREE_FILE		"fonetree.dat"
 #define DICT_FILE		"dict.dat"
 #define PH_INDEX_FILE		"ph_index.dat"
+#define ABBR_TREE_FILE		"abbrtree.dat"
+#define ABBR_POSTING_FILE	"abbrpost.dat"
+#define PREDICT_INDEX_FILE	"predidx.dat"
+#define PREDICT_FILE		"predict.dat"
+#define REVERSE_INDEX_FILE	"revindex.dat"
 #define CHAR_FILE		"us_freq.dat"
 #define CHAR_INDEX_FILE		"ch_index.dat"
 #define CHAR_INDEX_BEGIN_FILE	"ch_index_begin.dat"
@@ -21,10 +21,16 @@
 #  include <stdint.h>
 #endif
 
+#include "chewing-private.h"
+
 uint16_t UintFromPhone( const char *phone );
 uint16_t UintFromPhoneInx( const int ph_inx[] );
+void PhoneInxFromUint( int ph_inx[], uint16_t phone );
 int PhoneFromKey( char *pho, const char *inputkey, int kbtype, int searchTimes );
 int PhoneFromUint( char *phone, size_t phone_len, uint16_t phone_num );
-int PhoneInxFromKey( int key, int type, int kbtype, int searchTimes );
+void InitKeyTableFromString( KeyTable *table, const char *keys );
+void InitKeyTable( KeyTable *table, int kbtype );
+int PhoneInxFromKeyTable( const KeyTable *table, int key, int type, int searchTimes );
+int PhoneFromKeyTable( const KeyTable *table, int key, int searchTimes, int *type );
 
 #endif
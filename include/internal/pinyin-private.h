@@ -27,8 +27,27 @@ struct keymap {
 };
 typedef struct keymap keymap;
 
+#define PINYIN_KBTYPE_NUM 3
+
+/*
+  Compiled pinyin spelling, with its phone and alternative phone for
+  KB_HANYU_PINYIN, KB_THL_PINYIN and KB_MPS2_PINYIN.
+ */
+typedef struct tag_PinyinEntry {
+	char pinyin[ PINYIN_SIZE ];
+	uint16_t phone[ PINYIN_KBTYPE_NUM ];
+	uint16_t phoneAlt[ PINYIN_KBTYPE_NUM ];
+} PinyinEntry;
+
 int PinyinToZuin( ChewingData *pgdata, char *pinyinKeySeq, char *zuinKeySeq, char *zuinKeySeqAlt);
+int PinyinToPhone( ChewingData *pgdata, const char *pinyin, uint16_t *phone, uint16_t *phoneAlt );
 int InitPinyin( ChewingData *pgdata, const char * );
+void LoadPinyin( ChewingData *pgdata );
 void TerminatePinyin( ChewingData *pgdata );
 
+int PinyinLatticeAppend( ChewingData *pgdata, PinYinLattice *lattice, int key );
+void PinyinLatticeRemoveLast( PinYinLattice *lattice );
+int PinyinLatticeSegment( const PinYinLattice *lattice, int end,
+                          uint16_t phoneSeq[], int bCnnct[], int *lastPhraseBegin );
+
 #endif
@@ -0,0 +1,79 @@
+/**
+ * symbol-private.h
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifndef _CHEWING_SYMBOL_PRIVATE_H
+#define _CHEWING_SYMBOL_PRIVATE_H
+
+#include <stddef.h>
+
+/** @brief number of keys in SymbolTable.key_index, which are ASCII. */
+#define SYMBOL_KEY_NUM (128)
+
+/** @brief entry of symbol table */
+typedef struct {
+	/** @brief offset of the category name in the string pool. */
+	int category;
+	/**
+	 * @brief symbols of this category are symbol[ symbol_begin .. symbol_end ).
+	 * If there is no symbol, category is treat as a symbol.
+	 */
+	int symbol_begin, symbol_end;
+} SymbolEntry;
+
+/** @brief slot of the hash table from symbol to entry. */
+typedef struct {
+	/** @brief offset of the symbol in the string pool, or -1 if empty. */
+	int symbol;
+	int entry;
+} SymbolSlot;
+
+/**
+ * @brief symbol table in a single allocation.
+ *
+ * The header is followed by the entries, the offsets of symbols, the hash
+ * table and the string pool, at the byte offsets below. Nothing in the table
+ * is a pointer, so it can be stored or mapped as is.
+ */
+typedef struct tag_SymbolTable {
+	int n_entry;
+	int n_symbol;
+	/** @brief number of slots of the hash table, a power of 2. */
+	int hash_size;
+	int entry_offset;
+	int symbol_offset;
+	int hash_offset;
+	int pool_offset;
+	int size;
+	/**
+	 * @brief entry whose category is the key, or -1. Only a category of
+	 * one ASCII character with symbols, but not more than max_key_symbols,
+	 * is a key; the last one wins.
+	 */
+	int key_index[ SYMBOL_KEY_NUM ];
+} SymbolTable;
+
+/*
+ * Each line of text is "category<separator>symbols", or "category" alone,
+ * which is a symbol by itself. Each UTF-8 character of symbols is a symbol.
+ * A line with more than max_key_symbols symbols is not a key, unless
+ * max_key_symbols is 0.
+ */
+SymbolTable *SymbolTableFromText( const char *text, size_t len, char separator,
+	int max_key_symbols );
+SymbolTable *SymbolTableFromFile( const char *filename, char separator,
+	int max_key_symbols );
+
+const char *SymbolCategory( const SymbolTable *table, int entry );
+int SymbolNum( const SymbolTable *table, int entry );
+const char *SymbolString( const SymbolTable *table, int entry, int i );
+int SymbolFindKey( const SymbolTable *table, int key );
+int SymbolFindEntry( const SymbolTable *table, const char *symbol );
+
+#endif
@@ -14,12 +14,17 @@
 #define IS_USER_PHRASE 1
 #define IS_DICT_PHRASE 0
 
-int InitTree( ChewingData *pgdata, const char *prefix );
-void TerminateTree( ChewingData *pgdata );
+int InitTree( SystemDictData *sys_dict, const char *prefix );
+void TerminateTree( SystemDictData *sys_dict );
 
 int Phrasing( ChewingData *pgdata );
 int IsIntersect( IntervalType in1, IntervalType in2 );
 
+int TreeFindDictPhrase( const SystemDictData *sys_dict, int begin, int end, const uint16_t *phoneSeq );
 int TreeFindPhrase( ChewingData *pgdata, int begin, int end, const uint16_t *phoneSeq );
+int AbbrFindPhrase( ChewingData *pgdata, const uint16_t initial[], int len, const int **posting );
+int TreePredictPhrase( ChewingData *pgdata, const uint16_t phoneSeq[], int len, const int **offset );
+int ReverseFindPhrase( ChewingData *pgdata, const char *phrase, const ReverseIndexType **entry );
+int AnnotatePhone( ChewingData *pgdata, const char *text, uint16_t phoneSeq[], int len );
 
 #endif
@@ -44,6 +44,11 @@ typedef struct tag_UserPhraseData {
 	int maxfreq;	/* the maximum frequency of the phrase of the same pid */
 } UserPhraseData ;
 
+/** @brief cursor of UserGetPhraseFirst/UserGetPhraseNext, owned by the caller. */
+typedef struct {
+	struct tag_HASH_ITEM *item;
+} UserPhraseIterator;
+
 /**
  * @brief Update or add a new UserPhrase.
  *
@@ -60,19 +65,21 @@ int UserUpdatePhrase( struct tag_ChewingData *pgdata, const uint16_t phoneSeq[],
 /**
  * @brief Read the first phrase of the phone in user phrase database.
  *
+ * @param iter Iterator to be passed to UserGetPhraseNext
  * @param phoneSeq[] Phone sequence
  * 
  * @return UserPhraseData, if it's not existing then return NULL.
  */
-UserPhraseData *UserGetPhraseFirst( struct tag_ChewingData *pgdata, const uint16_t phoneSeq[] );
+UserPhraseData *UserGetPhraseFirst( struct tag_ChewingData *pgdata, UserPhraseIterator *iter, const uint16_t phoneSeq[] );
 
 /**
  * @brief Read the next phrase of the phone in user phrase database.
  * 
+ * @param iter Iterator set up by UserGetPhraseFirst
  * @param phoneSeq[] Phone sequence
  *
  * @return UserPhraseData, if it's not existing then return NULL.
  */
-UserPhraseData *UserGetPhraseNext( struct tag_ChewingData *pgdata, const uint16_t phoneSeq[] );
+UserPhraseData *UserGetPhraseNext( struct tag_ChewingData *pgdata, UserPhraseIterator *iter, const uint16_t phoneSeq[] );
 
 #endif
@@ -38,6 +38,25 @@ enum {
 	KB_TYPE_NUM
 };
 
+/** action of a transition of zhuyin layouts */
+enum {
+	ZUIN_ACTION_ABSORB,
+	/** the key is a tone, the phone shall be committed */
+	ZUIN_ACTION_END,
+	ZUIN_ACTION_KEY_ERROR,
+	ZUIN_ACTION_NO_WORD,
+};
+
+typedef struct tag_ZuinTable ZuinTable;
+
+int ZuinTransition( const KeyTable *table, int kbtype, const int pho_inx[], int key,
+	int new_inx[], int *tone );
+ZuinTable *ZuinTableNew( const KeyTable *table, int kbtype );
+void ZuinTableDelete( ZuinTable *zuin_table );
+int ZuinTableLookup( const ZuinTable *zuin_table, const KeyTable *table, const int pho_inx[],
+	int key, int new_inx[], int *tone );
+void TerminateZuin( ChewingData *pgdata );
+
 int ZuinPhoInput( ChewingData *, ZuinData *,int key );  /* assume `key' is "ascii" code. */
 int ZuinRemoveLast( ZuinData * );
 int ZuinRemoveAll( ZuinData * );
@@ -33,12 +33,22 @@ CHEWING_API int chewing_commit_Check( ChewingContext *ctx );
  */
 CHEWING_API char *chewing_commit_String( ChewingContext *ctx );
 
+/**
+ * @brief Get current commit string without allocation
+ * @param ctx handle to Chewing IM context
+ *
+ * The returned string is owned by ctx and is valid until the next keystroke
+ * handled by ctx. Caller must not free it.
+ */
+CHEWING_API const char *chewing_commit_String_static( ChewingContext *ctx );
+
 
 /*! \name Preedit string buffer
  */
 
 /*@{*/
 CHEWING_API char *chewing_buffer_String( ChewingContext *ctx );
+CHEWING_API const char *chewing_buffer_String_static( ChewingContext *ctx );
 CHEWING_API int chewing_buffer_Check( ChewingContext *ctx );
 CHEWING_API int chewing_buffer_Len( ChewingContext *ctx );
 /*@}*/
@@ -58,6 +68,20 @@ CHEWING_API int chewing_zuin_Check( ChewingContext *ctx );
 
 CHEWING_API int chewing_cursor_Current( ChewingContext *ctx );
 
+/**
+ * @brief Get changes of output since the previous call
+ * @param ctx handle to Chewing IM context
+ * @param[out] delta changes of preedit string, cursor, intervals and
+ * candidate window
+ *
+ * preeditText points into a buffer owned by ctx, and is valid until the next
+ * keystroke handled by ctx.
+ *
+ * @retval 1 if anything is changed
+ * @retval 0 if nothing is changed
+ */
+CHEWING_API int chewing_output_Delta( ChewingContext *ctx, ChewingOutputDelta *delta );
+
 /*@{*/
 CHEWING_API int chewing_cand_CheckDone( ChewingContext *ctx );
 CHEWING_API int chewing_cand_TotalPage( ChewingContext *ctx );
@@ -96,4 +120,65 @@ CHEWING_API int chewing_kbtype_hasNext( ChewingContext *ctx );
 CHEWING_API char *chewing_kbtype_String( ChewingContext *ctx );
 /*@}*/
 
+
+/*! \name Phrase prediction
+ */
+
+/*@{*/
+/**
+ * @brief Start the enumeration of phrases which extend a phone sequence
+ * @param ctx handle to Chewing IM context
+ * @param phoneSeq phones, such as the ones from chewing_get_phoneSeq
+ * @param len length of phoneSeq
+ *
+ * The phrases are longer than phoneSeq, and are enumerated in descending
+ * order of frequency.
+ *
+ * @return number of phrases to enumerate
+ */
+CHEWING_API int chewing_predict_Enumerate( ChewingContext *ctx, const unsigned short *phoneSeq, int len );
+CHEWING_API int chewing_predict_hasNext( ChewingContext *ctx );
+CHEWING_API char *chewing_predict_String( ChewingContext *ctx );
+/*@}*/
+
+
+/*! \name Phrase reading lookup
+ */
+
+/*@{*/
+/**
+ * @brief Start the enumeration of readings of a phrase in the system dictionary
+ * @param ctx handle to Chewing IM context
+ * @param phrase UTF-8 phrase
+ *
+ * @return number of readings to enumerate
+ */
+CHEWING_API int chewing_reading_Enumerate( ChewingContext *ctx, const char *phrase );
+CHEWING_API int chewing_reading_hasNext( ChewingContext *ctx );
+/**
+ * @brief Get the current enumerated reading
+ * @param ctx handle to Chewing IM context
+ * @param[out] phoneSeq phones of the reading, with room for one phone per
+ * character of the phrase
+ * @param[out] freq frequency of the phrase with this reading, can be NULL
+ *
+ * @return number of phones, or 0 if there is no more reading
+ */
+CHEWING_API int chewing_reading_Get( ChewingContext *ctx, unsigned short *phoneSeq, int *freq );
+/*@}*/
+
+/**
+ * @brief Annotate text with phones of the system dictionary
+ * @param ctx handle to Chewing IM context
+ * @param text UTF-8 text
+ * @param[out] phoneSeq one phone per character of text, 0 for a character
+ * without reading
+ * @param len size of phoneSeq, characters after it are not annotated
+ *
+ * A polyphonic character gets the reading of the phrase it is in.
+ *
+ * @return number of characters annotated, or -1 when no memory
+ */
+CHEWING_API int chewing_annotate_Phone( ChewingContext *ctx, const char *text, unsigned short *phoneSeq, int len );
+
 #endif /* CHEWING_MOD_AUX_H */
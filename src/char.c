@@ -24,8 +24,9 @@
 #include "global-private.h"
 #include "chewing-definition.h"
 #include "char-private.h"
+#include "dict-private.h"
+#include "container-private.h"
 #include "private.h"
-#include "plat_mmap.h"
 
 #if ! defined(USE_BINARY_DATA)
 static char *fgettab( char *buf, int maxlen, FILE *fp )
@@ -51,85 +52,74 @@ static int CompUint16( const uint16_t *pa, const uint16_t *pb )
 	return ( (*pa) - (*pb) );
 }
 
-void TerminateChar( ChewingData *pgdata )
+void TerminateChar( SystemDictData *sys_dict )
 {
 #ifdef USE_BINARY_DATA
-	pgdata->static_data.arrPhone = NULL;
-	plat_mmap_close( &pgdata->static_data.char_phone_mmap );
-
-	pgdata->static_data.char_begin = NULL;
-	plat_mmap_close( &pgdata->static_data.char_begin_mmap );
-
-	pgdata->static_data.char_ = NULL;
-	plat_mmap_close( &pgdata->static_data.char_mmap );
-
-	pgdata->static_data.phone_num = 0;
+	sys_dict->arrPhone = NULL;
+	sys_dict->char_begin = NULL;
+	sys_dict->char_ = NULL;
+	sys_dict->phone_num = 0;
 #else
-	if ( pgdata->static_data.charfile )
-		fclose( pgdata->static_data.charfile );
-	free( pgdata->static_data.char_begin );
-	free( pgdata->static_data.arrPhone );
-	pgdata->static_data.phone_num = 0;
+	if ( sys_dict->charfile )
+		fclose( sys_dict->charfile );
+	free( sys_dict->char_begin );
+	free( sys_dict->arrPhone );
+	sys_dict->phone_num = 0;
 #endif
 }
 
-int InitChar( ChewingData *pgdata , const char * prefix )
-{
 #ifdef USE_BINARY_DATA
-	char filename[ PATH_MAX ];
-	size_t len;
-	size_t offset;
-	size_t file_size;
-	size_t csize;
-
-	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, CHAR_FILE );
-	if ( len + 1 > sizeof( filename ) )
-		return -1;
-
-	plat_mmap_set_invalid( &pgdata->static_data.char_mmap );
-	file_size = plat_mmap_create( &pgdata->static_data.char_mmap, filename, FLAG_ATTRIBUTE_READ );
-	if ( file_size <= 0 )
-		return -1;
-
-	csize = file_size;
-	offset = 0;
-	pgdata->static_data.char_ = plat_mmap_set_view( &pgdata->static_data.char_mmap, &offset, &csize );
-	if ( !pgdata->static_data.char_ )
-		return -1;
-
-	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, CHAR_INDEX_BEGIN_FILE );
-	if ( len + 1 > sizeof( filename ) )
-		return -1;
-
-	plat_mmap_set_invalid( &pgdata->static_data.char_begin_mmap );
-	file_size = plat_mmap_create( &pgdata->static_data.char_begin_mmap, filename, FLAG_ATTRIBUTE_READ );
-	if ( file_size <= 0 )
-		return -1;
-
-	pgdata->static_data.phone_num = file_size / sizeof( int );
-
-	offset = 0;
-	csize = file_size;
-	pgdata->static_data.char_begin = plat_mmap_set_view( &pgdata->static_data.char_begin_mmap, &offset, &csize );
-	if ( !pgdata->static_data.char_begin )
-		return -1;
-
-	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, CHAR_INDEX_PHONE_FILE );
-	if ( len + 1 > sizeof( filename ) )
-		return -1;
+/*
+ * Return 1 if phones of the index ascend, followed by 0 which ends the last
+ * bucket, and each bucket is words which end at the next bucket and fit in
+ * a Word. A bucket is not empty, as GetCharFirst reads its first word.
+ */
+static int IsCharValid( const SystemDictData *sys_dict, size_t size )
+{
+	const unsigned char *char_ = (const unsigned char *) sys_dict->char_;
+	const uint16_t *phone = sys_dict->arrPhone;
+	const unsigned char *p, *end;
+	size_t num = sys_dict->phone_num;
+	int bad;
+	size_t i;
+
+	if ( num == 0 || phone[ num - 1 ] != 0 ||
+		! IsDictIndexValid( sys_dict->char_begin, num, size ) )
+		return 0;
 
-	plat_mmap_set_invalid( &pgdata->static_data.char_phone_mmap );
-	file_size = plat_mmap_create( &pgdata->static_data.char_phone_mmap, filename, FLAG_ATTRIBUTE_READ );
-	if ( file_size <= 0 )
-		return -1;
+	bad = num > 1 && phone[ 0 ] == 0;
+	for ( i = 1; i + 1 < num; i++ )
+		bad |= phone[ i - 1 ] >= phone[ i ];
+	if ( bad )
+		return 0;
 
-	if ( pgdata->static_data.phone_num != file_size / sizeof( uint16_t ))
-		return -1;
+	for ( i = 0; i + 1 < num; i++ ) {
+		p = char_ + sys_dict->char_begin[ i ];
+		end = char_ + sys_dict->char_begin[ i + 1 ];
+		do {
+			if ( p >= end || *p > MAX_UTF8_SIZE || end - p < 1 + *p )
+				return 0;
+			p += 1 + *p;
+		} while ( p < end );
+	}
+	return 1;
+}
+#endif
 
-	offset = 0;
-	csize = file_size;
-	pgdata->static_data.arrPhone = plat_mmap_set_view( &pgdata->static_data.char_phone_mmap, &offset, &csize );
-	if ( !pgdata->static_data.arrPhone )
+int InitChar( SystemDictData *sys_dict, const char * prefix )
+{
+#ifdef USE_BINARY_DATA
+	size_t size;
+	size_t num;
+
+	sys_dict->char_ = GetDictSection( sys_dict, SECTION_CHAR, 1, &size );
+	sys_dict->char_begin = (int *) GetDictSection( sys_dict,
+		SECTION_CHAR_BEGIN, sizeof( int ), &sys_dict->phone_num );
+	sys_dict->arrPhone = (uint16_t *) GetDictSection( sys_dict,
+		SECTION_CHAR_PHONE, sizeof( uint16_t ), &num );
+	if ( !sys_dict->char_ || !sys_dict->char_begin || !sys_dict->arrPhone ||
+		sys_dict->phone_num != num ||
+		! IsCharValid( sys_dict, size ) )
 		return -1;
 
 	return 0;
@@ -139,22 +129,22 @@ int InitChar( ChewingData *pgdata , const char * prefix )
 	int i;
 	FILE *indexfile = NULL;
 
-	pgdata->static_data.phone_num = PHONE_NUM;
+	sys_dict->phone_num = PHONE_NUM;
 
-	pgdata->static_data.arrPhone = ALC( uint16_t, pgdata->static_data.phone_num );
-	if ( !pgdata->static_data.arrPhone )
+	sys_dict->arrPhone = ALC( uint16_t, sys_dict->phone_num );
+	if ( !sys_dict->arrPhone )
 	    return -1;
 
-	pgdata->static_data.char_begin = ALC( int, pgdata->static_data.phone_num );
-	if ( !pgdata->static_data.char_begin )
+	sys_dict->char_begin = ALC( int, sys_dict->phone_num );
+	if ( !sys_dict->char_begin )
 	    return -1;
 
 	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, CHAR_FILE );
 	if ( len + 1 > sizeof( filename ) )
 		return -1;
 
-	pgdata->static_data.charfile = fopen( filename, "r" );
-	if ( !pgdata->static_data.charfile )
+	sys_dict->charfile = fopen( filename, "r" );
+	if ( !sys_dict->charfile )
 		return -1;
 
 	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, CHAR_INDEX_FILE );
@@ -165,63 +155,62 @@ int InitChar( ChewingData *pgdata , const char * prefix )
 	if ( !indexfile )
 		return -1;
 
-	for ( i = 0; i < pgdata->static_data.phone_num; ++i )
-		fscanf( indexfile, "%hu %d", &pgdata->static_data.arrPhone[i], &pgdata->static_data.char_begin[i] );
+	for ( i = 0; i < sys_dict->phone_num; ++i )
+		fscanf( indexfile, "%hu %d", &sys_dict->arrPhone[i], &sys_dict->char_begin[i] );
 
 	fclose( indexfile );
 	return 0;
 #endif
 }
 
-static void Str2Word( ChewingData *pgdata, Word *wrd_ptr )
+static void Str2Word( ChewingData *pgdata, CharIterator *iter, Word *wrd_ptr )
 {
 #ifndef USE_BINARY_DATA
 	char buf[ 1000 ];
 	uint16_t sh;
 
-	fgettab( buf, 1000, pgdata->static_data.charfile );
+	fseek( pgdata->static_data.sys_dict->charfile, iter->cur_pos, SEEK_SET );
+	fgettab( buf, 1000, pgdata->static_data.sys_dict->charfile );
+	iter->cur_pos = ftell( pgdata->static_data.sys_dict->charfile );
 	/* only read 6 bytes to wrd_ptr->word avoid buffer overflow */
 	sscanf( buf, "%hu %6[^ ]", &sh, wrd_ptr->word );
 	assert( wrd_ptr->word != '\0' );
 #else
 	unsigned char size;
-	size = *(unsigned char *) pgdata->static_data.char_cur_pos;
-	pgdata->static_data.char_cur_pos = (unsigned char*) pgdata->static_data.char_cur_pos + sizeof(unsigned char);
-	memcpy( wrd_ptr->word, pgdata->static_data.char_cur_pos, size );
-	pgdata->static_data.char_cur_pos = (unsigned char*) pgdata->static_data.char_cur_pos + size;
+	size = *iter->cur_pos;
+	iter->cur_pos += sizeof(unsigned char);
+	memcpy( wrd_ptr->word, iter->cur_pos, size );
+	iter->cur_pos += size;
 	wrd_ptr->word[ size ] = '\0';
 #endif
 }
 
-int GetCharFirst( ChewingData *pgdata, Word *wrd_ptr, uint16_t phoneid )
+int GetCharFirst( ChewingData *pgdata, CharIterator *iter, Word *wrd_ptr, uint16_t phoneid )
 {
+	const SystemDictData *sys_dict = pgdata->static_data.sys_dict;
 	uint16_t *pinx;
 
 	pinx = (uint16_t *) bsearch(
-		&phoneid, pgdata->static_data.arrPhone, pgdata->static_data.phone_num,
+		&phoneid, sys_dict->arrPhone, sys_dict->phone_num,
 		sizeof( uint16_t ), (CompFuncType) CompUint16 );
 	if ( ! pinx )
 		return 0;
 
 #ifndef USE_BINARY_DATA
-	fseek( pgdata->static_data.charfile, pgdata->static_data.char_begin[ pinx - pgdata->static_data.arrPhone ], SEEK_SET );
+	iter->cur_pos = sys_dict->char_begin[ pinx - sys_dict->arrPhone ];
+	iter->end_pos = sys_dict->char_begin[ pinx - sys_dict->arrPhone + 1 ];
 #else
-	pgdata->static_data.char_cur_pos = (unsigned char*)pgdata->static_data.char_ + pgdata->static_data.char_begin[ pinx - pgdata->static_data.arrPhone ];
+	iter->cur_pos = (const unsigned char *) sys_dict->char_ + sys_dict->char_begin[ pinx - sys_dict->arrPhone ];
+	iter->end_pos = (const unsigned char *) sys_dict->char_ + sys_dict->char_begin[ pinx - sys_dict->arrPhone + 1 ];
 #endif
-	pgdata->static_data.char_end_pos = pgdata->static_data.char_begin[ pinx - pgdata->static_data.arrPhone + 1 ];
-	Str2Word( pgdata, wrd_ptr );
+	Str2Word( pgdata, iter, wrd_ptr );
 	return 1;
 }
 
-int GetCharNext( ChewingData *pgdata, Word *wrd_ptr )
+int GetCharNext( ChewingData *pgdata, CharIterator *iter, Word *wrd_ptr )
 {
-#ifndef USE_BINARY_DATA
-	if ( ftell( pgdata->static_data.charfile ) >= pgdata->static_data.char_end_pos )
+	if ( iter->cur_pos >= iter->end_pos )
 		return 0;
-#else
-	if ( (unsigned char*)pgdata->static_data.char_cur_pos >= (unsigned char*)pgdata->static_data.char_ + pgdata->static_data.char_end_pos )
-		return 0;
-#endif
-	Str2Word( pgdata, wrd_ptr );
+	Str2Word( pgdata, iter, wrd_ptr );
 	return 1;
 }
@@ -34,6 +34,7 @@
 #include "hash-private.h"
 #include "tree-private.h"
 #include "pinyin-private.h"
+#include "key2pho-private.h"
 #include "private.h"
 #include "chewingio.h"
 #include "mod_aux.h"
@@ -63,21 +64,16 @@ char *kb_type_str[] = {
 	"KB_MPS2_PINYIN"
 };
 
-const char * const CHAR_FILES[] = {
-	CHAR_FILE,
+const char * const SYSTEM_DICT_FILES[] = {
 #ifdef USE_BINARY_DATA
-	CHAR_INDEX_BEGIN_FILE,
-	CHAR_INDEX_PHONE_FILE,
+	DICTIONARY_FILE,
 #else
+	CHAR_FILE,
 	CHAR_INDEX_FILE,
-#endif
-	NULL,
-};
-
-const char * const DICT_FILES[] = {
 	DICT_FILE,
 	PH_INDEX_FILE,
 	PHONE_TREE_FILE,
+#endif
 	NULL,
 };
 
@@ -96,6 +92,107 @@ const char * const PINYIN_FILES[] = {
 	NULL,
 };
 
+enum {
+	DATA_SYSTEM_DICT,
+	DATA_SYMBOL_TABLE,
+	DATA_EASY_SYMBOL,
+	DATA_PINYIN,
+	DATA_GROUP_NUM,
+};
+
+/* Files found together in one directory, or NULL if none is needed. */
+static const char * const * const DATA_GROUP_FILES[ DATA_GROUP_NUM ] = {
+#ifdef ENABLE_BUILTIN_DICT
+	NULL,
+#else
+	SYSTEM_DICT_FILES,
+#endif
+	SYMBOL_TABLE_FILES,
+	EASY_SYMBOL_FILES,
+	PINYIN_FILES,
+};
+
+#define MAX_SEARCH_DIR (16)
+
+/*
+ * Directories of the data groups found by chewing_new, shared by the
+ * process. Finding them probes every file of every group in the search
+ * path, but the result only changes if the search path does, or an entry
+ * of one of its directories is added, removed or renamed. A cached result
+ * is used as long as the stamps of the directories are unchanged.
+ */
+static struct {
+	int valid;
+	char search_path[ PATH_MAX ];
+	int dir_num;
+	plat_dir_stamp stamp[ MAX_SEARCH_DIR ];
+	char prefix[ DATA_GROUP_NUM ][ PATH_MAX ];
+} data_path_cache;
+static plat_mutex data_path_lock = PLAT_MUTEX_INITIALIZER;
+
+/* Return -1 if the search path has more than MAX_SEARCH_DIR directories. */
+static int StampSearchPath( const char *search_path, plat_dir_stamp stamp[], int *dir_num )
+{
+	char buffer[ PATH_MAX ];
+	char *path;
+	char *saveptr;
+
+	snprintf( buffer, sizeof( buffer ), "%s", search_path );
+	*dir_num = 0;
+	for ( path = strtok_r( buffer, SEARCH_PATH_SEP, &saveptr );
+		path; path = strtok_r( NULL, SEARCH_PATH_SEP, &saveptr ) ) {
+		if ( *dir_num == MAX_SEARCH_DIR )
+			return -1;
+		get_dir_stamp( path, &stamp[ ( *dir_num )++ ] );
+	}
+	return 0;
+}
+
+/* Find the directory of each data group, which is "" for a group not needed. */
+static int FindDataPath( const char *search_path, char prefix[][ PATH_MAX ] )
+{
+	plat_dir_stamp stamp[ MAX_SEARCH_DIR ];
+	int dir_num;
+	int cacheable;
+	int ret = 0;
+	int i;
+
+	PLAT_MUTEX_LOCK( &data_path_lock );
+
+	/* Stamp first, so that a change while finding is seen next time. */
+	cacheable = ! StampSearchPath( search_path, stamp, &dir_num );
+	if ( cacheable && data_path_cache.valid &&
+		! strcmp( data_path_cache.search_path, search_path ) &&
+		data_path_cache.dir_num == dir_num &&
+		! memcmp( data_path_cache.stamp, stamp, sizeof( stamp[ 0 ] ) * dir_num ) ) {
+		memcpy( prefix, data_path_cache.prefix, sizeof( data_path_cache.prefix ) );
+		goto end;
+	}
+
+	for ( i = 0; i < DATA_GROUP_NUM; i++ ) {
+		prefix[ i ][ 0 ] = '\0';
+		if ( !DATA_GROUP_FILES[ i ] )
+			continue;
+		ret = find_path_by_files(
+			search_path, DATA_GROUP_FILES[ i ], prefix[ i ], PATH_MAX );
+		if ( ret )
+			goto end;
+	}
+
+	data_path_cache.valid = cacheable;
+	if ( cacheable ) {
+		snprintf( data_path_cache.search_path, sizeof( data_path_cache.search_path ),
+			"%s", search_path );
+		data_path_cache.dir_num = dir_num;
+		memcpy( data_path_cache.stamp, stamp, sizeof( stamp[ 0 ] ) * dir_num );
+		memcpy( data_path_cache.prefix, prefix, sizeof( data_path_cache.prefix ) );
+	}
+
+end:
+	PLAT_MUTEX_UNLOCK( &data_path_lock );
+	return ret;
+}
+
 CHEWING_API int chewing_KBStr2Num( char str[] )
 {
 	int i;
@@ -162,8 +259,9 @@ CHEWING_API ChewingContext *chewing_new()
 {
 	ChewingContext *ctx;
 	int ret;
+	int i;
 	char search_path[PATH_MAX];
-	char path[PATH_MAX];
+	char prefix[ DATA_GROUP_NUM ][ PATH_MAX ];
 
 	ctx = ALC( ChewingContext, 1 );
 	if ( !ctx )
@@ -177,58 +275,45 @@ CHEWING_API ChewingContext *chewing_new()
 	if ( !ctx->data )
 		goto error;
 
+	for ( i = 0; i < MAX_KBTYPE; i++ )
+		InitKeyTable( &ctx->data->static_data.key_table[ i ], i );
+
 	chewing_Reset( ctx );
 
 	ret = get_search_path( search_path, sizeof( search_path ) );
 	if ( ret )
 		goto error;
 
-	ret = find_path_by_files(
-		search_path, CHAR_FILES, path, sizeof( path ) );
-	if ( ret )
-		goto error;
-	ret = InitChar( ctx->data, path );
+	ret = FindDataPath( search_path, prefix );
 	if ( ret )
 		goto error;
 
-	ret = find_path_by_files(
-		search_path, DICT_FILES, path, sizeof( path ) );
-	if ( ret )
-		goto error;
-	ret = InitDict( ctx->data, path );
-	if ( ret )
-		goto error;
-	ret = InitTree( ctx->data, path );
-	if ( ret )
+#ifdef ENABLE_BUILTIN_DICT
+	ctx->data->static_data.sys_dict = AcquireSystemDict( BUILTIN_DICT_PREFIX );
+#else
+	ctx->data->static_data.sys_dict = AcquireSystemDict( prefix[ DATA_SYSTEM_DICT ] );
+#endif
+	if ( !ctx->data->static_data.sys_dict )
 		goto error;
+	ctx->data->static_data.dict_layer[ 0 ] = ctx->data->static_data.sys_dict;
+	ctx->data->static_data.dict_layer_num = 1;
 
 	// FIXME: Which return code indicate error?
 	ret = InitHash( ctx->data );
 
 	ctx->cand_no = 0;
 
-	ret = find_path_by_files(
-		search_path, SYMBOL_TABLE_FILES, path, sizeof( path ) );
-	if ( ret )
-		goto error;
-	ret = InitSymbolTable( ctx->data, path );
-	if ( ret )
+	/* Symbol, easy symbol and pinyin tables are loaded on first use. */
+	ctx->data->static_data.symbol_table_prefix = strdup( prefix[ DATA_SYMBOL_TABLE ] );
+	if ( !ctx->data->static_data.symbol_table_prefix )
 		goto error;
 
-	ret = find_path_by_files(
-		search_path, EASY_SYMBOL_FILES, path, sizeof( path ) );
-	if ( ret )
-		goto error;
-	ret = InitEasySymbolInput( ctx->data, path );
-	if ( ret )
+	ctx->data->static_data.easy_symbol_prefix = strdup( prefix[ DATA_EASY_SYMBOL ] );
+	if ( !ctx->data->static_data.easy_symbol_prefix )
 		goto error;
 
-	ret = find_path_by_files(
-		search_path, PINYIN_FILES, path, sizeof( path ) );
-	if ( ret )
-		goto error;
-	ret = InitPinyin( ctx->data, path );
-	if ( !ret )
+	ctx->data->static_data.pinyin_prefix = strdup( prefix[ DATA_PINYIN ] );
+	if ( !ctx->data->static_data.pinyin_prefix )
 		goto error;
 
 	return ctx;
@@ -333,12 +418,17 @@ CHEWING_API void chewing_delete( ChewingContext *ctx )
 	if ( ctx ) {
 		if ( ctx->data ) {
 			TerminatePinyin( ctx->data );
+			TerminateZuin( ctx->data );
 			TerminateEasySymbolTable( ctx->data );
 			TerminateSymbolTable( ctx->data );
 			TerminateHash( ctx->data );
-			TerminateTree( ctx->data );
-			TerminateDict( ctx->data );
-			TerminateChar( ctx->data );
+			while ( ctx->data->static_data.dict_layer_num > 1 )
+				ReleaseSystemDict( ctx->data->static_data.dict_layer[
+					--ctx->data->static_data.dict_layer_num ] );
+			if ( ctx->data->static_data.sys_dict )
+				ReleaseSystemDict( ctx->data->static_data.sys_dict );
+			if ( ctx->data->static_data.sys_dict_next )
+				ReleaseSystemDict( ctx->data->static_data.sys_dict_next );
 			free( ctx->data );
 		}
 
@@ -349,6 +439,100 @@ CHEWING_API void chewing_delete( ChewingContext *ctx )
 	return;
 }
 
+CHEWING_API int chewing_dict_Add( ChewingContext *ctx, const char *path )
+{
+	ChewingStaticData *static_data = &ctx->data->static_data;
+	SystemDictData *sys_dict;
+	int i;
+
+	if ( static_data->dict_layer_num >= MAX_DICT_LAYER )
+		return -1;
+	for ( i = 0; i < static_data->dict_layer_num; i++ ) {
+		if ( ! strcmp( static_data->dict_layer[ i ]->prefix, path ) )
+			return -1;
+	}
+
+	sys_dict = AcquireSystemDict( path );
+	if ( !sys_dict )
+		return -1;
+	static_data->dict_layer[ static_data->dict_layer_num++ ] = sys_dict;
+	return 0;
+}
+
+CHEWING_API int chewing_dict_Remove( ChewingContext *ctx, const char *path )
+{
+	ChewingStaticData *static_data = &ctx->data->static_data;
+	int i;
+
+	/* The system dictionary cannot be removed. */
+	for ( i = 1; i < static_data->dict_layer_num; i++ ) {
+		if ( ! strcmp( static_data->dict_layer[ i ]->prefix, path ) ) {
+			ReleaseSystemDict( static_data->dict_layer[ i ] );
+			memmove( &static_data->dict_layer[ i ], &static_data->dict_layer[ i + 1 ],
+				sizeof( static_data->dict_layer[ 0 ] ) * ( static_data->dict_layer_num - i - 1 ) );
+			--static_data->dict_layer_num;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Switch to the newest generation of the system dictionary, unless there is
+ * input, which may refer to the tree of the current one. Predictions and
+ * readings being enumerated point into the current one, so they are ended.
+ */
+static void SwitchSystemDict( ChewingContext *ctx )
+{
+	ChewingStaticData *static_data = &ctx->data->static_data;
+
+	if ( ChewingIsEntering( ctx->data ) )
+		return;
+
+	if ( !static_data->sys_dict_next ) {
+		if ( ! IsSystemDictStale( static_data->sys_dict ) )
+			return;
+		/* Keep the current generation if the newest one is gone. */
+		static_data->sys_dict_next = AcquireSystemDict( static_data->sys_dict->prefix );
+		if ( !static_data->sys_dict_next )
+			return;
+	}
+
+	ctx->predict = NULL;
+	ctx->predict_num = 0;
+	ctx->predict_no = 0;
+	ctx->reading = NULL;
+	ctx->reading_num = 0;
+	ctx->reading_no = 0;
+
+	ReleaseSystemDict( static_data->sys_dict );
+	static_data->sys_dict = static_data->sys_dict_next;
+	static_data->dict_layer[ 0 ] = static_data->sys_dict;
+	static_data->sys_dict_next = NULL;
+}
+
+CHEWING_API int chewing_dict_Reload( ChewingContext *ctx )
+{
+	ChewingStaticData *static_data = &ctx->data->static_data;
+	SystemDictData *sys_dict;
+
+#ifdef ENABLE_BUILTIN_DICT
+	/* The dictionary linked into the library never changes. */
+	if ( ! strcmp( static_data->sys_dict->prefix, BUILTIN_DICT_PREFIX ) )
+		return -1;
+#endif
+
+	sys_dict = ReloadSystemDict( static_data->sys_dict->prefix );
+	if ( !sys_dict )
+		return -1;
+	if ( static_data->sys_dict_next )
+		ReleaseSystemDict( static_data->sys_dict_next );
+	static_data->sys_dict_next = sys_dict;
+
+	SwitchSystemDict( ctx );
+	return 0;
+}
+
 CHEWING_API void chewing_free( void *p )
 {
 	if ( p )
@@ -490,6 +674,19 @@ CHEWING_API int chewing_get_phraseChoiceRearward( ChewingContext *ctx )
 	return ctx->data->config.bPhraseChoiceRearward;
 }
 
+CHEWING_API void chewing_set_continuousPinyin( ChewingContext *ctx, int mode )
+{
+	if ( mode == 0 || mode == 1 ) {
+		ZuinRemoveAll( &ctx->data->zuinData );
+		ctx->data->bContinuousPinyin = mode;
+	}
+}
+
+CHEWING_API int chewing_get_continuousPinyin( ChewingContext *ctx )
+{
+	return ctx->data->bContinuousPinyin;
+}
+
 CHEWING_API void chewing_set_ChiEngMode( ChewingContext *ctx, int mode )
 {
 	if ( mode == CHINESE_MODE || mode == SYMBOL_MODE )
@@ -1075,6 +1272,8 @@ CHEWING_API int chewing_handle_Default( ChewingContext *ctx, int key )
 	/* Update lifetime */
 	ctx->data->static_data.chewing_lifetime++;
 
+	SwitchSystemDict( ctx );
+
 	/* Skip the special key */
 	if ( key & 0xFF00 ) {
 		keystrokeRtn = KEYSTROKE_IGNORE;
@@ -1175,7 +1374,10 @@ CHEWING_API int chewing_handle_Default( ChewingContext *ctx, int key )
 					keystrokeRtn = KEYSTROKE_ABSORB;
 					break;
 				case ZUIN_COMMIT:
-					AddChi( pgdata->zuinData.phone, pgdata->zuinData.phoneAlt, pgdata );
+					if ( pgdata->zuinData.pinYinData.nPhoneSeq )
+						AddPinYinPhoneSeq( pgdata );
+					else
+						AddChi( pgdata->zuinData.phone, pgdata->zuinData.phoneAlt, pgdata );
 					break;
 				case ZUIN_NO_WORD:
 					keystrokeRtn = KEYSTROKE_BELL | KEYSTROKE_ABSORB;
@@ -1318,10 +1520,7 @@ CHEWING_API int chewing_handle_CtrlNum( ChewingContext *ctx, int key )
 				        &pgdata->phoneSeq[ cursor ],
 				        sizeof( uint16_t ) * newPhraseLen );
 				addPhoneSeq[ newPhraseLen ] = 0;
-				ueStrNCpy( addWordSeq,
-				           ueStrSeek( (char *) &pgdata->phrOut.chiBuf,
-				                      cursor ),
-				           newPhraseLen, 1);
+				CopyChiBuf( pgdata, addWordSeq, cursor, newPhraseLen );
 
 
 				phraseState = UserUpdatePhrase( pgdata, addPhoneSeq, addWordSeq );
@@ -1349,10 +1548,8 @@ CHEWING_API int chewing_handle_CtrlNum( ChewingContext *ctx, int key )
 				        &pgdata->phoneSeq[ cursor - newPhraseLen ],
 				        sizeof( uint16_t ) * newPhraseLen );
 				addPhoneSeq[ newPhraseLen ] = 0;
-				ueStrNCpy( addWordSeq,
-				           ueStrSeek( (char *) &pgdata->phrOut.chiBuf,
-				           cursor - newPhraseLen ),
-				           newPhraseLen, 1);
+				CopyChiBuf( pgdata, addWordSeq, cursor - newPhraseLen,
+				            newPhraseLen );
 
 				phraseState = UserUpdatePhrase( pgdata, addPhoneSeq, addWordSeq );
 				SetUpdatePhraseMsg( 
@@ -31,6 +31,7 @@
 #include "choice-private.h"
 #include "tree-private.h"
 #include "userphrase-private.h"
+#include "symbol-private.h"
 #include "private.h"
 
 #ifdef HAVE_ASPRINTF
@@ -44,7 +45,10 @@ static void MakePreferInterval( ChewingData *pgdata );
 static void ShiftInterval( ChewingOutput *pgo, ChewingData *pgdata );
 static int ChewingKillSelectIntervalAcross( int cursor, ChewingData *pgdata );
 
-static int FindSymbolKey( const char *symbol );
+static int FindSymbolKey( ChewingData *pgdata, const char *symbol );
+
+/* Easy symbols longer than this are ignored. */
+#define MAX_EASY_SYMBOL_LEN (10)
 
 static const char G_EASY_SYMBOL_KEY[EASY_SYMBOL_KEY_TAB_LEN] = {
 	'0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
@@ -141,20 +145,22 @@ int ChewingIsEntering( ChewingData *pgdata )
 
 int HaninSymbolInput( ChewingData *pgdata )
 {
-	unsigned int i;
+	int i;
 
 	ChoiceInfo *pci = &( pgdata->choiceInfo );
 	AvailInfo *pai = &( pgdata->availInfo );
 	int candPerPage = pgdata->config.candPerPage;
 
+	LoadSymbolTable( pgdata );
+
 	/* No available symbol table */
 	if ( ! pgdata->static_data.symbol_table )
 		return ZUIN_ABSORB;
 
 	pci->nTotalChoice = 0;
-	for ( i = 0; i < pgdata->static_data.n_symbol_entry; i++ ) {
+	for ( i = 0; i < pgdata->static_data.symbol_table->n_entry && i < MAX_CHOICE; i++ ) {
 		strcpy( pci->totalChoiceStr[ pci->nTotalChoice ], 
-			pgdata->static_data.symbol_table[ i ]->category );
+			SymbolCategory( pgdata->static_data.symbol_table, i ) );
 		pci->nTotalChoice++; 
 	}
 	pai->avail[ 0 ].len = 1;
@@ -171,7 +177,7 @@ int HaninSymbolInput( ChewingData *pgdata )
 
 static int _Inner_InternalSpecialSymbol(
 		int key, ChewingData *pgdata, 
-		char symkey, char *chibuf )
+		char symkey, const char *chibuf )
 {
 	int kbtype;
 
@@ -314,29 +320,25 @@ int FullShapeSymbolInput( int key, ChewingData *pgdata )
 
 int EasySymbolInput( int key, ChewingData *pgdata )
 {
-	int rtn, loop, _index;
-	char wordbuf[ 8 ];
-
-	int nSpecial = EASY_SYMBOL_KEY_TAB_LEN / sizeof( char );
-
-	_index = FindEasySymbolIndex( key );
-	if ( -1 != _index ) {
-		for ( loop = 0; loop < pgdata->static_data.g_easy_symbol_num[ _index ]; ++loop ) {
-			ueStrNCpy( wordbuf, 
-				ueStrSeek( pgdata->static_data.g_easy_symbol_value[ _index ],
-					loop),
-				1, 1 );
-			rtn = _Inner_InternalSpecialSymbol(
-					key, pgdata, key, wordbuf );
+	const SymbolTable *table;
+	int rtn, loop, entry = -1;
+
+	LoadEasySymbolInput( pgdata );
+
+	if ( -1 != FindEasySymbolIndex( key ) ) {
+		table = pgdata->static_data.easy_symbol_table;
+		if ( table )
+			entry = SymbolFindKey( table, key );
+		if ( entry != -1 ) {
+			for ( loop = 0; loop < SymbolNum( table, entry ); ++loop ) {
+				_Inner_InternalSpecialSymbol(
+						key, pgdata, key, SymbolString( table, entry, loop ) );
+			}
 		}
 		return SYMBOL_KEY_OK;
 	}
 
-	rtn = InternalSpecialSymbol( 
-			key, pgdata, nSpecial, 
-			G_EASY_SYMBOL_KEY, pgdata->static_data.g_easy_symbol_value );
-	if ( rtn == ZUIN_IGNORE )
-		rtn = SpecialSymbolInput( key, pgdata );
+	rtn = SpecialSymbolInput( key, pgdata );
 	return ( rtn == ZUIN_IGNORE ? SYMBOL_KEY_ERROR : SYMBOL_KEY_OK );
 }
 
@@ -370,11 +372,13 @@ int SymbolChoice( ChewingData *pgdata, int sel_i )
 	int symbol_type;
 	int key;
 
+	LoadSymbolTable( pgdata );
+
 	if ( ! pgdata->static_data.symbol_table && pgdata->choiceInfo.isSymbol != 3 )
 		return ZUIN_ABSORB;
 
 	if ( pgdata->choiceInfo.isSymbol == 1 && 
-			0 == pgdata->static_data.symbol_table[sel_i]->nSymbols )
+			0 == SymbolNum( pgdata->static_data.symbol_table, sel_i ) )
 		symbol_type = 2;
 	else
 		symbol_type = pgdata->choiceInfo.isSymbol;
@@ -386,9 +390,9 @@ int SymbolChoice( ChewingData *pgdata, int sel_i )
 
 		/* Display all symbols in this category */
 		pci->nTotalChoice = 0;
-		for ( i = 0; i < pgdata->static_data.symbol_table[ sel_i ]->nSymbols; i++ ) {
-			ueStrNCpy( pci->totalChoiceStr[ pci->nTotalChoice ],
-					pgdata->static_data.symbol_table[ sel_i ]->symbols[ i ], 1, 1 );
+		for ( i = 0; i < SymbolNum( pgdata->static_data.symbol_table, sel_i ) && i < MAX_CHOICE; i++ ) {
+			strcpy( pci->totalChoiceStr[ pci->nTotalChoice ],
+					SymbolString( pgdata->static_data.symbol_table, sel_i, i ) );
 			pci->nTotalChoice++;
 		}
 		pai->avail[ 0 ].len = 1;
@@ -415,7 +419,7 @@ int SymbolChoice( ChewingData *pgdata, int sel_i )
 				pgdata->choiceInfo.totalChoiceStr[ sel_i ], 1, 1);
 
 		/* This is very strange */
-		key = FindSymbolKey( pgdata->choiceInfo.totalChoiceStr[ sel_i ] );
+		key = FindSymbolKey( pgdata, pgdata->choiceInfo.totalChoiceStr[ sel_i ] );
 		pgdata->symbolKeyBuf[ pgdata->chiSymbolCursor ] = key ? key : '0';
 
 		pgdata->bUserArrCnnct[ PhoneSeqCursor( pgdata ) ] = 0;
@@ -497,10 +501,8 @@ int WriteChiSymbolToBuf( wch_t csBuf[], int csBufLen, ChewingData *pgdata )
 			 * among Win32 and Unix-like OSs.
 			 */
 			memset( &( csBuf[ i ].s ), 0, MAX_UTF8_SIZE + 1 );
-			ueStrNCpy( (char *) csBuf[ i ].s,
-			           &( pgdata->phrOut.chiBuf[ phoneseq_i ] ), 
-				   1, 1);
-			phoneseq_i += ueBytesFromChar( pgdata->phrOut.chiBuf[ phoneseq_i ] );
+			CopyChiBuf( pgdata, (char *) csBuf[ i ].s, phoneseq_i, 1 );
+			phoneseq_i++;
 		}
 		else 
 			csBuf[ i ] = pgdata->chiSymbolBuf[ i ];
@@ -508,6 +510,20 @@ int WriteChiSymbolToBuf( wch_t csBuf[], int csBufLen, ChewingData *pgdata )
 	return 0;
 }
 
+/*
+ * Copy len characters of phrOut.chiBuf from the from-th character, and
+ * return how many bytes was copied.
+ */
+int CopyChiBuf( ChewingData *pgdata, char *buf, int from, int len )
+{
+	const int *offset = pgdata->phrOut.chiOffset;
+	int bytes = offset[ from + len ] - offset[ from ];
+
+	memcpy( buf, pgdata->phrOut.chiBuf + offset[ from ], bytes );
+	buf[ bytes ] = '\0';
+	return bytes;
+}
+
 static int CountReleaseNum( ChewingData *pgdata )
 {
 	int remain, i;
@@ -591,7 +607,7 @@ int ReleaseChiSymbolBuf( ChewingData *pgdata, ChewingOutput *pgo )
 		/* Add to userphrase */
 		memcpy( bufPhoneSeq, pgdata->phoneSeq, sizeof( uint16_t ) * throwEnd );
 		bufPhoneSeq[ throwEnd ] = (uint16_t) 0;
-		ueStrNCpy( bufWordSeq, pgdata->phrOut.chiBuf, throwEnd, 1 );
+		CopyChiBuf( pgdata, bufWordSeq, 0, throwEnd );
 		UserUpdatePhrase( pgdata, bufPhoneSeq, bufWordSeq );
 
 		KillFromLeft( pgdata, throwEnd );
@@ -633,9 +649,7 @@ static int ChewingIsBreakPoint( int cursor, ChewingData *pgdata )
 	if ( ! ChewingIsChiAt( i + symbols, pgdata ) )
 		return 1;
 	else {
-		ueStrNCpy( buf,
-				ueStrSeek( (char *) &pgdata->phrOut.chiBuf, cursor ),
-				1, 1 );
+		CopyChiBuf( pgdata, buf, cursor, 1 );
 		for ( i = 0; (size_t) i < ARRAY_SIZE( break_word ); i++ ) {
 			if ( ! strcmp ( buf, break_word[ i ] ) )
 				return 1;
@@ -650,6 +664,7 @@ void AutoLearnPhrase( ChewingData *pgdata )
 	char bufWordSeq[ MAX_PHONE_SEQ_LEN * MAX_UTF8_SIZE + 1 ];
 	int i, from, len;
 	int prev_pos = 0;
+	int prev_bytes = 0;
 	int pending = 0;
 
 	for ( i = 0; i < pgdata->nPrefer; i++ ) {
@@ -658,9 +673,7 @@ void AutoLearnPhrase( ChewingData *pgdata )
 		if ( len == 1 && ! ChewingIsBreakPoint( from, pgdata ) ) {
 			memcpy( bufPhoneSeq + prev_pos, &pgdata->phoneSeq[ from ], sizeof( uint16_t ) * len );
 			bufPhoneSeq[ prev_pos + len ] = (uint16_t) 0;
-			ueStrNCpy( ueStrSeek( bufWordSeq, prev_pos ),
-					ueStrSeek( (char *) &pgdata->phrOut.chiBuf, from ),
-					len, 1);
+			prev_bytes += CopyChiBuf( pgdata, bufWordSeq + prev_bytes, from, len );
 			prev_pos += len;
 			pending = 1;
 		}
@@ -668,19 +681,19 @@ void AutoLearnPhrase( ChewingData *pgdata )
 			if ( pending ) {
 				UserUpdatePhrase( pgdata, bufPhoneSeq, bufWordSeq );
 				prev_pos = 0;
+				prev_bytes = 0;
 				pending = 0;
 			}
 			memcpy( bufPhoneSeq, &pgdata->phoneSeq[ from ], sizeof( uint16_t ) * len );
 			bufPhoneSeq[ len ] = (uint16_t) 0;
-			ueStrNCpy( bufWordSeq,
-					ueStrSeek( (char *) &pgdata->phrOut.chiBuf, from ),
-					len, 1);
+			CopyChiBuf( pgdata, bufWordSeq, from, len );
 			UserUpdatePhrase( pgdata, bufPhoneSeq, bufWordSeq );
 		}
 	}
 	if ( pending ) {
 		UserUpdatePhrase( pgdata, bufPhoneSeq, bufWordSeq );
 		prev_pos = 0;
+		prev_bytes = 0;
 		pending = 0;
 	}
 }
@@ -734,6 +747,24 @@ int AddChi( uint16_t phone, uint16_t phoneAlt, ChewingData *pgdata )
 	return 0;
 }
 
+/**
+ * Add syllables segmented from continuous pinyin input, and connect the
+ * syllables of the same phrase so that phrasing keeps the segmentation.
+ */
+void AddPinYinPhoneSeq( ChewingData *pgdata )
+{
+	PinYinData *pinYinData = &pgdata->zuinData.pinYinData;
+	int cursor;
+	int i;
+
+	for ( i = 0; i < pinYinData->nPhoneSeq; i++ ) {
+		cursor = PhoneSeqCursor( pgdata );
+		AddChi( pinYinData->phoneSeq[ i ], pinYinData->phoneSeq[ i ], pgdata );
+		pgdata->bUserArrCnnct[ cursor ] = pinYinData->bCnnct[ i ];
+	}
+	pinYinData->nPhoneSeq = 0;
+}
+
 #ifdef ENABLE_DEBUG
 static void ShowChewingData( ChewingData *pgdata )
 {
@@ -908,14 +939,87 @@ static void ShiftInterval( ChewingOutput *pgo, ChewingData *pgdata )
 	}
 }
 
+/*
+ * Append the UTF-8 character in wch to buf, and return the position after it.
+ * The caller shall make sure buf is large enough.
+ */
+static char *AppendWch( char *buf, const wch_t *wch )
+{
+	int len = strlen( (const char *) wch->s );
+
+	memcpy( buf, wch->s, len );
+	return buf + len;
+}
+
+/*
+ * Narrow the unchanged prefix and suffix of preeditBuf with the change made
+ * by this keystroke, so that they stay relative to the last reported string.
+ */
+static void TrackPreeditDelta( ChewingOutput *pgo, const char *old, int old_len )
+{
+	int len = pgo->preeditBufLen;
+	int max = ( len < old_len ) ? len : old_len;
+	int prefix, suffix;
+
+	for ( prefix = 0; prefix < max; prefix++ ) {
+		if ( old[ prefix ] != pgo->preeditBuf[ prefix ] )
+			break;
+	}
+	for ( suffix = 0; suffix < max - prefix; suffix++ ) {
+		if ( old[ old_len - 1 - suffix ] != pgo->preeditBuf[ len - 1 - suffix ] )
+			break;
+	}
+
+	if ( prefix < pgo->delta.preeditPrefix )
+		pgo->delta.preeditPrefix = prefix;
+	if ( suffix < pgo->delta.preeditSuffix )
+		pgo->delta.preeditSuffix = suffix;
+}
+
+static void TrackCandidateDelta( ChewingOutput *pgo )
+{
+	ChoiceInfo *pci = pgo->pci;
+	OutputDelta *delta = &pgo->delta;
+	int begin = pci->pageNo * pci->nChoicePerPage;
+	int i;
+
+	if ( pci->nTotalChoice != delta->candTotal ||
+		pci->pageNo != delta->candPageNo ||
+		pci->nChoicePerPage != delta->candPerPage ) {
+		delta->candTotal = pci->nTotalChoice;
+		delta->candPageNo = pci->pageNo;
+		delta->candPerPage = pci->nChoicePerPage;
+		delta->bCandidateChanged = 1;
+	}
+
+	for ( i = 0; i < pci->nChoicePerPage && i < MAX_SELKEY &&
+		begin + i < pci->nTotalChoice; i++ ) {
+		if ( strcmp( delta->candPage[ i ], pci->totalChoiceStr[ begin + i ] ) ) {
+			strcpy( delta->candPage[ i ], pci->totalChoiceStr[ begin + i ] );
+			delta->bCandidateChanged = 1;
+		}
+	}
+}
+
 static int MakeOutput( ChewingOutput *pgo, ChewingData *pgdata )
 {
 	int chi_i, chiSymbol_i, i ;
+	char *preedit = pgo->preeditBuf;
+	char *commit = pgo->commitBuf;
+	char old_preedit[ sizeof( pgo->preeditBuf ) ];
+	int old_preedit_len = pgo->preeditBufLen;
+	IntervalType old_interval[ MAX_INTERVAL ];
+	int old_nInterval = pgo->nDispInterval;
+
+	memcpy( old_preedit, pgo->preeditBuf, old_preedit_len );
+	memcpy( old_interval, pgo->dispInterval, sizeof( IntervalType ) * old_nInterval );
+	if ( pgo->chiSymbolCursor != pgdata->chiSymbolCursor )
+		pgo->delta.bCursorChanged = 1;
 
 	/* fill zero to chiSymbolBuf first */
 	memset( pgo->chiSymbolBuf, 0, sizeof( wch_t ) * MAX_PHONE_SEQ_LEN );
 
-	/* fill chiSymbolBuf */
+	/* fill chiSymbolBuf and preeditBuf */
 	for ( 
 		chi_i = chiSymbol_i = 0; 
 		chiSymbol_i < pgdata->chiSymbolBufLen; 
@@ -923,16 +1027,23 @@ static int MakeOutput( ChewingOutput *pgo, ChewingData *pgdata )
 		if ( pgdata->chiSymbolBuf[ chiSymbol_i ].wch == 0 ) {
 			/* is Chinese, then copy from the PhrasingOutput "phrOut" */
 			pgo->chiSymbolBuf[ chiSymbol_i ].wch = 0;
-			ueStrNCpy( (char *) pgo->chiSymbolBuf[ chiSymbol_i ].s,
-			           &( pgdata->phrOut.chiBuf[ chi_i ] ),
-			           1, 1 );
-			chi_i += ueBytesFromChar( pgo->chiSymbolBuf[ chiSymbol_i ].s[0] );
+			CopyChiBuf( pgdata, (char *) pgo->chiSymbolBuf[ chiSymbol_i ].s, chi_i, 1 );
+			chi_i++;
 		}
 		else {
 			/* is Symbol */
 			pgo->chiSymbolBuf[ chiSymbol_i ] = pgdata->chiSymbolBuf[ chiSymbol_i ];
 		}
+		preedit = AppendWch( preedit, &pgo->chiSymbolBuf[ chiSymbol_i ] );
 	}
+	*preedit = '\0';
+	pgo->preeditBufLen = preedit - pgo->preeditBuf;
+	TrackPreeditDelta( pgo, old_preedit, old_preedit_len );
+
+	/* fill commitBuf */
+	for ( i = 0; i < pgo->nCommitStr; i++ )
+		commit = AppendWch( commit, &pgo->commitStr[ i ] );
+	*commit = '\0';
 
 	/* fill point */
 	pgo->PointStart = pgdata->PointStart;
@@ -945,13 +1056,15 @@ static int MakeOutput( ChewingOutput *pgo, ChewingData *pgdata )
 	/* fill zuinBuf */
 	if ( pgdata->zuinData.kbtype >= KB_HANYU_PINYIN ) {
 		char *p = pgdata->zuinData.pinYinData.keySeq;
+		if ( pgdata->zuinData.pinYinData.lattice.len )
+			p = pgdata->zuinData.pinYinData.lattice.keySeq;
 		/* 
 		 * Copy from old content in zuinBuf
 		 * NOTE: No Unicode transformation here.
 		 */
 		for ( i = 0; i< ZUIN_SIZE; i++) {
 			int j;
-			for ( j = 0; j < 2; j++ ) {
+			for ( j = 0; j < MAX_UTF8_SIZE; j++ ) {
 				if ( p[ 0 ] ) {
 					pgo->zuinBuf[ i ].s[ j ] = p[ 0 ];
 					p++;
@@ -960,7 +1073,7 @@ static int MakeOutput( ChewingOutput *pgo, ChewingData *pgdata )
 					pgo->zuinBuf[ i ].s[ j ] = '\0';
 				}
 			}
-			pgo->zuinBuf[ i ].s[ 2 ] = '\0';
+			pgo->zuinBuf[ i ].s[ MAX_UTF8_SIZE ] = '\0';
 		}
 	} else {
 		for ( i = 0; i < ZUIN_SIZE; i++ ) { 
@@ -979,10 +1092,14 @@ static int MakeOutput( ChewingOutput *pgo, ChewingData *pgdata )
 	}
 
 	ShiftInterval( pgo, pgdata );
+	if ( pgo->nDispInterval != old_nInterval ||
+		memcmp( old_interval, pgo->dispInterval, sizeof( IntervalType ) * old_nInterval ) )
+		pgo->delta.bIntervalChanged = 1;
 	memcpy( 
 		pgo->dispBrkpt, pgdata->bUserArrBrkpt, 
 		sizeof( pgo->dispBrkpt[ 0 ] ) * ( MAX_PHONE_SEQ_LEN + 1 ) );
 	pgo->pci = &( pgdata->choiceInfo );
+	TrackCandidateDelta( pgo );
 	pgo->bChiSym = pgdata->bChiSym;
 	memcpy( pgo->selKey, pgdata->config.selKey, sizeof( pgdata->config.selKey ) );
 	pgo->bShowMsg = 0;
@@ -1000,6 +1117,8 @@ void MakeOutputAddMsgAndCleanInterval( ChewingOutput *pgo, ChewingData *pgdata )
 	pgo->bShowMsg = 1;
 	memcpy( pgo->showMsg, pgdata->showMsg, sizeof( wch_t ) * ( pgdata->showMsgLen ) );
 	pgo->showMsgLen = pgdata->showMsgLen;
+	if ( pgo->nDispInterval )
+		pgo->delta.bIntervalChanged = 1;
 	pgo->nDispInterval = 0;
 }
 
@@ -1150,175 +1269,181 @@ int IsPreferIntervalConnted( int cursor, ChewingData *pgdata )
 	return 0;
 }
 
-static char *symbol_buf[][ 50 ] = {
-	{ "0", "\xC3\xB8", 0 },
+static const char OPEN_SYMBOL[] =
+	"0 " "\xC3\xB8" "\n"
 		/* "ø" */
-	{ "[", "\xE3\x80\x8C", "\xE3\x80\x8E", "\xE3\x80\x8A", "\xE3\x80\x88",
-		  "\xE3\x80\x90", "\xE3\x80\x94", 0 },
+	"[ " "\xE3\x80\x8C" "\xE3\x80\x8E" "\xE3\x80\x8A" "\xE3\x80\x88"
+		"\xE3\x80\x90" "\xE3\x80\x94" "\n"
 		/* "「", "『", "《", "〈", "【", "〔" */
-	{ "]", "\xE3\x80\x8D", "\xE3\x80\x8F", "\xE3\x80\x8B", "\xE3\x80\x89",
-		  "\xE3\x80\x91", "\xE3\x80\x95", 0 },
+	"] " "\xE3\x80\x8D" "\xE3\x80\x8F" "\xE3\x80\x8B" "\xE3\x80\x89"
+		"\xE3\x80\x91" "\xE3\x80\x95" "\n"
 		/* "」", "』", "》", "〉", "】", "〕" */
-	{ "{", "\xEF\xBD\x9B", 0 },
+	"{ " "\xEF\xBD\x9B" "\n"
 		/* "｛" */
-	{ "}", "\xEF\xBD\x9D", 0 },
+	"} " "\xEF\xBD\x9D" "\n"
 		/* "｝" */
-	{ "<", "\xEF\xBC\x8C", "\xE2\x86\x90", 0 },
+	"< " "\xEF\xBC\x8C" "\xE2\x86\x90" "\n"
 		/* "，", "←" */
-	{ ">", "\xE3\x80\x82", "\xE2\x86\x92", "\xEF\xBC\x8E", 0 },
+	"> " "\xE3\x80\x82" "\xE2\x86\x92" "\xEF\xBC\x8E" "\n"
 		/* "。", "→", "．" */
-	{ "?", "\xEF\xBC\x9F", "\xC2\xBF", 0 },
+	"? " "\xEF\xBC\x9F" "\xC2\xBF" "\n"
 		/* "？", "¿" */
-	{ "!", "\xEF\xBC\x81", "\xE2\x85\xA0","\xC2\xA1", 0 },
+	"! " "\xEF\xBC\x81" "\xE2\x85\xA0" "\xC2\xA1" "\n"
 		/* "！", "Ⅰ","¡" */
-	{ "@", "\xEF\xBC\xA0", "\xE2\x85\xA1", "\xE2\x8A\x95", "\xE2\x8A\x99",
-		  "\xE3\x8A\xA3", "\xEF\xB9\xAB", 0 },
+	"@ " "\xEF\xBC\xA0" "\xE2\x85\xA1" "\xE2\x8A\x95" "\xE2\x8A\x99"
+		"\xE3\x8A\xA3" "\xEF\xB9\xAB" "\n"
 		/* "＠", "Ⅱ", "⊕", "⊙", "㊣", "﹫" */
-	{ "#", "\xEF\xBC\x83", "\xE2\x85\xA2", "\xEF\xB9\x9F", 0 },
+	"# " "\xEF\xBC\x83" "\xE2\x85\xA2" "\xEF\xB9\x9F" "\n"
 		/* "＃", "Ⅲ", "﹟" */
-	{ "$", "\xEF\xBC\x84", "\xE2\x85\xA3", "\xE2\x82\xAC", "\xEF\xB9\xA9",
-		  "\xEF\xBF\xA0", "\xE2\x88\xAE","\xEF\xBF\xA1", "\xEF\xBF\xA5", 0 },
+	"$ " "\xEF\xBC\x84" "\xE2\x85\xA3" "\xE2\x82\xAC" "\xEF\xB9\xA9"
+		"\xEF\xBF\xA0" "\xE2\x88\xAE" "\xEF\xBF\xA1" "\xEF\xBF\xA5" "\n"
 		/* "＄", "Ⅳ", "€", "﹩", "￠", "∮","￡", "￥" */
-	{ "%", "\xEF\xBC\x85", "\xE2\x85\xA4", 0 },
+	"% " "\xEF\xBC\x85" "\xE2\x85\xA4" "\n"
 		/* "％", "Ⅴ" */
-	{ "^", "\xEF\xB8\xBF", "\xE2\x85\xA5", "\xEF\xB9\x80", "\xEF\xB8\xBD",
-		  "\xEF\xB8\xBE", 0 },
+	"^ " "\xEF\xB8\xBF" "\xE2\x85\xA5" "\xEF\xB9\x80" "\xEF\xB8\xBD"
+		"\xEF\xB8\xBE" "\n"
 		/* "︿", "Ⅵ", "﹀", "︽", "︾" */
-	{ "&", "\xEF\xBC\x86", "\xE2\x85\xA6", "\xEF\xB9\xA0", 0 },
+	"& " "\xEF\xBC\x86" "\xE2\x85\xA6" "\xEF\xB9\xA0" "\n"
 		/* "＆", "Ⅶ", "﹠" */
-	{ "*", "\xEF\xBC\x8A", "\xE2\x85\xA7", "\xC3\x97", "\xE2\x80\xBB",
-		  "\xE2\x95\xB3", "\xEF\xB9\xA1", "\xE2\x98\xAF", "\xE2\x98\x86",
-		  "\xE2\x98\x85", 0 },
+	"* " "\xEF\xBC\x8A" "\xE2\x85\xA7" "\xC3\x97" "\xE2\x80\xBB"
+		"\xE2\x95\xB3" "\xEF\xB9\xA1" "\xE2\x98\xAF" "\xE2\x98\x86"
+		"\xE2\x98\x85" "\n"
 		/* "＊", "Ⅷ", "×", "※", "╳", "﹡", "☯", "☆", "★" */
-	{ "(", "\xEF\xBC\x88", "\xE2\x85\xA8", 0 },
+	"( " "\xEF\xBC\x88" "\xE2\x85\xA8" "\n"
 		/* "（", "Ⅸ" */
-	{ ")", "\xEF\xBC\x89", "\xE2\x85\xA9", 0 },
+	") " "\xEF\xBC\x89" "\xE2\x85\xA9" "\n"
 		/* "）", "Ⅹ" */
-	{ "_", "\xEF\xBC\xBF", "\xE2\x80\xA6", "\xE2\x80\xA5", "\xE2\x86\x90",
-		  "\xE2\x86\x92", "\xEF\xB9\x8D", "\xEF\xB9\x89", "\xCB\x8D",
-		  "\xEF\xBF\xA3", "\xE2\x80\x93", "\xE2\x80\x94", "\xC2\xAF",
-		  "\xEF\xB9\x8A", "\xEF\xB9\x8E", "\xEF\xB9\x8F", "\xEF\xB9\xA3",
-		  "\xEF\xBC\x8D", 0 },
+	"_ " "\xEF\xBC\xBF" "\xE2\x80\xA6" "\xE2\x80\xA5" "\xE2\x86\x90"
+		"\xE2\x86\x92" "\xEF\xB9\x8D" "\xEF\xB9\x89" "\xCB\x8D"
+		"\xEF\xBF\xA3" "\xE2\x80\x93" "\xE2\x80\x94" "\xC2\xAF"
+		"\xEF\xB9\x8A" "\xEF\xB9\x8E" "\xEF\xB9\x8F" "\xEF\xB9\xA3"
+		"\xEF\xBC\x8D" "\n"
 		/* "＿", "…", "‥", "←", "→", "﹍", "﹉", "ˍ", "￣"
 		 * "–", "—", "¯", "﹊", "﹎", "﹏", "﹣", "－" */
-	{ "+", "\xEF\xBC\x8B", "\xC2\xB1", "\xEF\xB9\xA2", 0 },
+	"+ " "\xEF\xBC\x8B" "\xC2\xB1" "\xEF\xB9\xA2" "\n"
 		/* "＋", "±", "﹢" */
-	{ "=", "\xEF\xBC\x9D", "\xE2\x89\x92", "\xE2\x89\xA0", "\xE2\x89\xA1",
-		  "\xE2\x89\xA6", "\xE2\x89\xA7", "\xEF\xB9\xA6", 0 },
+	"= " "\xEF\xBC\x9D" "\xE2\x89\x92" "\xE2\x89\xA0" "\xE2\x89\xA1"
+		"\xE2\x89\xA6" "\xE2\x89\xA7" "\xEF\xB9\xA6" "\n"
 		/* "＝", "≒", "≠", "≡", "≦", "≧", "﹦" */
-	{ "`", "\xE3\x80\x8F", "\xE3\x80\x8E", "\xE2\x80\xB2", "\xE2\x80\xB5", 0 },
+	"` " "\xE3\x80\x8F" "\xE3\x80\x8E" "\xE2\x80\xB2" "\xE2\x80\xB5" "\n"
 		/* "』", "『", "′", "‵" */
-	{ "~", "\xEF\xBD\x9E", 0 },
+	"~ " "\xEF\xBD\x9E" "\n"
 		/* "～" */
-	{ ":", "\xEF\xBC\x9A", "\xEF\xBC\x9B", "\xEF\xB8\xB0", "\xEF\xB9\x95", 0 },
+	": " "\xEF\xBC\x9A" "\xEF\xBC\x9B" "\xEF\xB8\xB0" "\xEF\xB9\x95" "\n"
 		/* "：", "；", "︰", "﹕" */
-	{ "\"", "\xEF\xBC\x9B", 0 },
+	"\" " "\xEF\xBC\x9B" "\n"
 		/* "；" */
-	{ "\'", "\xE3\x80\x81", "\xE2\x80\xA6", "\xE2\x80\xA5", 0 },
+	"\' " "\xE3\x80\x81" "\xE2\x80\xA6" "\xE2\x80\xA5" "\n"
 		/* "、", "…", "‥" */
-	{ "\\", "\xEF\xBC\xBC", "\xE2\x86\x96", "\xE2\x86\x98", "\xEF\xB9\xA8", 0 },
+	"\\ " "\xEF\xBC\xBC" "\xE2\x86\x96" "\xE2\x86\x98" "\xEF\xB9\xA8" "\n"
 		/* "＼", "↖", "↘", "﹨" */
-	{ "-", "\xEF\xBC\x8D", "\xEF\xBC\xBF", "\xEF\xBF\xA3", "\xC2\xAF",
-		  "\xCB\x8D", "\xE2\x80\x93", "\xE2\x80\x94", "\xE2\x80\xA5",
-		  "\xE2\x80\xA6", "\xE2\x86\x90", "\xE2\x86\x92", "\xE2\x95\xB4",
-		  "\xEF\xB9\x89", "\xEF\xB9\x8A", "\xEF\xB9\x8D", "\xEF\xB9\x8E",
-		  "\xEF\xB9\x8F", "\xEF\xB9\xA3", 0 },
+	"- " "\xEF\xBC\x8D" "\xEF\xBC\xBF" "\xEF\xBF\xA3" "\xC2\xAF"
+		"\xCB\x8D" "\xE2\x80\x93" "\xE2\x80\x94" "\xE2\x80\xA5"
+		"\xE2\x80\xA6" "\xE2\x86\x90" "\xE2\x86\x92" "\xE2\x95\xB4"
+		"\xEF\xB9\x89" "\xEF\xB9\x8A" "\xEF\xB9\x8D" "\xEF\xB9\x8E"
+		"\xEF\xB9\x8F" "\xEF\xB9\xA3" "\n"
 		/* "－", "＿", "￣", "¯", "ˍ", "–", "—", "‥", "…"
 		 * "←", "→", "╴", "﹉", "﹊", "﹍", "﹎", "﹏", "﹣" */
-	{ "/", "\xEF\xBC\x8F", "\xC3\xB7", "\xE2\x86\x97", "\xE2\x86\x99",
-		  "\xE2\x88\x95", 0 },
+	"/ " "\xEF\xBC\x8F" "\xC3\xB7" "\xE2\x86\x97" "\xE2\x86\x99"
+		"\xE2\x88\x95" "\n"
 		/* "／","÷","↗","↙","∕" */
-	{ "|", "\xE2\x86\x91", "\xE2\x86\x93", "\xE2\x88\xA3", "\xE2\x88\xA5",
-		  "\xEF\xB8\xB1", "\xEF\xB8\xB3", "\xEF\xB8\xB4" ,0 },
+	"| " "\xE2\x86\x91" "\xE2\x86\x93" "\xE2\x88\xA3" "\xE2\x88\xA5"
+		"\xEF\xB8\xB1" "\xEF\xB8\xB3" "\xEF\xB8\xB4" "\n"
 		/* "↑", "↓", "∣", "∥", "︱", "︳", "︴" */
-	{ "A", "\xC3\x85","\xCE\x91", "\xCE\xB1", "\xE2\x94\x9C", "\xE2\x95\xA0",
-		  "\xE2\x95\x9F", "\xE2\x95\x9E", 0 },
+	"A " "\xC3\x85" "\xCE\x91" "\xCE\xB1" "\xE2\x94\x9C" "\xE2\x95\xA0"
+		"\xE2\x95\x9F" "\xE2\x95\x9E" "\n"
 		/* "Å","Α", "α", "├", "╠", "╟", "╞" */
-	{ "B", "\xCE\x92", "\xCE\xB2","\xE2\x88\xB5", 0 },
+	"B " "\xCE\x92" "\xCE\xB2" "\xE2\x88\xB5" "\n"
 		/* "Β", "β","∵" */
-	{ "C", "\xCE\xA7", "\xCF\x87", "\xE2\x94\x98", "\xE2\x95\xAF",
-		  "\xE2\x95\x9D", "\xE2\x95\x9C", "\xE2\x95\x9B", "\xE3\x8F\x84",
-		  "\xE2\x84\x83", "\xE3\x8E\x9D", "\xE2\x99\xA3", "\xC2\xA9", 0 },
+	"C " "\xCE\xA7" "\xCF\x87" "\xE2\x94\x98" "\xE2\x95\xAF"
+		"\xE2\x95\x9D" "\xE2\x95\x9C" "\xE2\x95\x9B" "\xE3\x8F\x84"
+		"\xE2\x84\x83" "\xE3\x8E\x9D" "\xE2\x99\xA3" "\xC2\xA9" "\n"
 		/* "Χ", "χ", "┘", "╯", "╝", "╜", "╛"
 		 * "㏄", "℃", "㎝", "♣", "©" */
-	{ "D", "\xCE\x94", "\xCE\xB4", "\xE2\x97\x87", "\xE2\x97\x86",
-		  "\xE2\x94\xA4", "\xE2\x95\xA3", "\xE2\x95\xA2", "\xE2\x95\xA1",
-		  "\xE2\x99\xA6", 0 },
+	"D " "\xCE\x94" "\xCE\xB4" "\xE2\x97\x87" "\xE2\x97\x86"
+		"\xE2\x94\xA4" "\xE2\x95\xA3" "\xE2\x95\xA2" "\xE2\x95\xA1"
+		"\xE2\x99\xA6" "\n"
 		/* "Δ", "δ", "◇", "◆", "┤", "╣", "╢", "╡","♦" */
-	{ "E", "\xCE\x95", "\xCE\xB5", "\xE2\x94\x90", "\xE2\x95\xAE",
-		  "\xE2\x95\x97", "\xE2\x95\x93", "\xE2\x95\x95", 0 },
+	"E " "\xCE\x95" "\xCE\xB5" "\xE2\x94\x90" "\xE2\x95\xAE"
+		"\xE2\x95\x97" "\xE2\x95\x93" "\xE2\x95\x95" "\n"
 		/* "Ε", "ε", "┐", "╮", "╗", "╓", "╕" */
-	{ "F", "\xCE\xA6", "\xCF\x88", "\xE2\x94\x82", "\xE2\x95\x91",
-		  "\xE2\x99\x80", 0 },
+	"F " "\xCE\xA6" "\xCF\x88" "\xE2\x94\x82" "\xE2\x95\x91"
+		"\xE2\x99\x80" "\n"
 		/* "Φ", "ψ", "│", "║", "♀" */
-	{ "G", "\xCE\x93", "\xCE\xB3", 0 },
+	"G " "\xCE\x93" "\xCE\xB3" "\n"
 		/* "Γ", "γ" */
-	{ "H", "\xCE\x97", "\xCE\xB7","\xE2\x99\xA5", 0 },
+	"H " "\xCE\x97" "\xCE\xB7" "\xE2\x99\xA5" "\n"
 		/* "Η", "η","♥" */
-	{ "I", "\xCE\x99", "\xCE\xB9", 0 },
+	"I " "\xCE\x99" "\xCE\xB9" "\n"
 		/* "Ι", "ι" */
-	{ "J", "\xCF\x86", 0 },
+	"J " "\xCF\x86" "\n"
 		/* "φ" */
-	{ "K", "\xCE\x9A", "\xCE\xBA","\xE3\x8E\x9E", "\xE3\x8F\x8E", 0 },
+	"K " "\xCE\x9A" "\xCE\xBA" "\xE3\x8E\x9E" "\xE3\x8F\x8E" "\n"
 		/* "Κ", "κ","㎞", "㏎" */
-	{ "L", "\xCE\x9B", "\xCE\xBB","\xE3\x8F\x92", "\xE3\x8F\x91", 0 },
+	"L " "\xCE\x9B" "\xCE\xBB" "\xE3\x8F\x92" "\xE3\x8F\x91" "\n"
 		/* "Λ", "λ","㏒", "㏑" */
-	{ "M", "\xCE\x9C", "\xCE\xBC", "\xE2\x99\x82", "\xE2\x84\x93",
-		  "\xE3\x8E\x8E", "\xE3\x8F\x95", "\xE3\x8E\x9C","\xE3\x8E\xA1", 0 },
+	"M " "\xCE\x9C" "\xCE\xBC" "\xE2\x99\x82" "\xE2\x84\x93"
+		"\xE3\x8E\x8E" "\xE3\x8F\x95" "\xE3\x8E\x9C" "\xE3\x8E\xA1" "\n"
 		/* "Μ", "μ", "♂", "ℓ", "㎎", "㏕", "㎜","㎡" */
-	{ "N", "\xCE\x9D", "\xCE\xBD","\xE2\x84\x96", 0 },
+	"N " "\xCE\x9D" "\xCE\xBD" "\xE2\x84\x96" "\n"
 		/* "Ν", "ν","№" */
-	{ "O", "\xCE\x9F", "\xCE\xBF", 0 },
+	"O " "\xCE\x9F" "\xCE\xBF" "\n"
 		/* "Ο", "ο" */
-	{ "P", "\xCE\xA0", "\xCF\x80", 0 },
+	"P " "\xCE\xA0" "\xCF\x80" "\n"
 		/* "Π", "π" */
-	{ "Q", "\xCE\x98", "\xCE\xB8","\xD0\x94","\xE2\x94\x8C", "\xE2\x95\xAD",
-		  "\xE2\x95\x94", "\xE2\x95\x93", "\xE2\x95\x92", 0 },
+	"Q " "\xCE\x98" "\xCE\xB8" "\xD0\x94" "\xE2\x94\x8C" "\xE2\x95\xAD"
+		"\xE2\x95\x94" "\xE2\x95\x93" "\xE2\x95\x92" "\n"
 		/* "Θ", "θ","Д","┌", "╭", "╔", "╓", "╒" */
-	{ "R", "\xCE\xA1", "\xCF\x81", "\xE2\x94\x80", "\xE2\x95\x90" ,"\xC2\xAE" , 0 },
+	"R " "\xCE\xA1" "\xCF\x81" "\xE2\x94\x80" "\xE2\x95\x90" "\xC2\xAE" "\n"
 		/* "Ρ", "ρ", "─", "═" ,"®" */
-	{ "S", "\xCE\xA3", "\xCF\x83", "\xE2\x88\xB4", "\xE2\x96\xA1",
-		  "\xE2\x96\xA0", "\xE2\x94\xBC", "\xE2\x95\xAC", "\xE2\x95\xAA",
-		  "\xE2\x95\xAB", "\xE2\x88\xAB", "\xC2\xA7", "\xE2\x99\xA0", 0 },
+	"S " "\xCE\xA3" "\xCF\x83" "\xE2\x88\xB4" "\xE2\x96\xA1"
+		"\xE2\x96\xA0" "\xE2\x94\xBC" "\xE2\x95\xAC" "\xE2\x95\xAA"
+		"\xE2\x95\xAB" "\xE2\x88\xAB" "\xC2\xA7" "\xE2\x99\xA0" "\n"
 		/* "Σ", "σ", "∴", "□", "■", "┼", "╬", "╪", "╫"
 		 * "∫", "§", "♠" */
-	{ "T", "\xCE\xA4", "\xCF\x84", "\xCE\xB8", "\xE2\x96\xB3", "\xE2\x96\xB2",
-		  "\xE2\x96\xBD", "\xE2\x96\xBC", "\xE2\x84\xA2", "\xE2\x8A\xBF",
-		  "\xE2\x84\xA2", 0 },
+	"T " "\xCE\xA4" "\xCF\x84" "\xCE\xB8" "\xE2\x96\xB3" "\xE2\x96\xB2"
+		"\xE2\x96\xBD" "\xE2\x96\xBC" "\xE2\x84\xA2" "\xE2\x8A\xBF"
+		"\xE2\x84\xA2" "\n"
 		/* "Τ", "τ","θ","△","▲","▽","▼","™","⊿", "™" */
-	{ "U", "\xCE\xA5", "\xCF\x85","\xCE\xBC","\xE2\x88\xAA", "\xE2\x88\xA9", 0 },
+	"U " "\xCE\xA5" "\xCF\x85" "\xCE\xBC" "\xE2\x88\xAA" "\xE2\x88\xA9" "\n"
 		/* "Υ", "υ","μ","∪", "∩" */
-	{ "V", "\xCE\xBD", 0 },
-	{ "W", "\xE2\x84\xA6", "\xCF\x89", "\xE2\x94\xAC", "\xE2\x95\xA6",
-		  "\xE2\x95\xA4", "\xE2\x95\xA5", 0 },
+	"V " "\xCE\xBD" "\n"
+	"W " "\xE2\x84\xA6" "\xCF\x89" "\xE2\x94\xAC" "\xE2\x95\xA6"
+		"\xE2\x95\xA4" "\xE2\x95\xA5" "\n"
 		/* "Ω", "ω", "┬", "╦", "╤", "╥" */
-	{ "X", "\xCE\x9E", "\xCE\xBE", "\xE2\x94\xB4", "\xE2\x95\xA9",
-		  "\xE2\x95\xA7", "\xE2\x95\xA8", 0 },
+	"X " "\xCE\x9E" "\xCE\xBE" "\xE2\x94\xB4" "\xE2\x95\xA9"
+		"\xE2\x95\xA7" "\xE2\x95\xA8" "\n"
 		/* "Ξ", "ξ", "┴", "╩", "╧", "╨" */
-	{ "Y", "\xCE\xA8", 0 },
+	"Y " "\xCE\xA8" "\n"
 		/* "Ψ" */
-	{ "Z", "\xCE\x96", "\xCE\xB6", "\xE2\x94\x94", "\xE2\x95\xB0",
-		  "\xE2\x95\x9A", "\xE2\x95\x99", "\xE2\x95\x98", 0 },
+	"Z " "\xCE\x96" "\xCE\xB6" "\xE2\x94\x94" "\xE2\x95\xB0"
+		"\xE2\x95\x9A" "\xE2\x95\x99" "\xE2\x95\x98" "\n";
 		/* "Ζ", "ζ", "└", "╰", "╚", "╙", "╘" */
-};
 
-static int FindSymbolKey( const char *symbol )
+/* Table of OPEN_SYMBOL, compiled on first use. */
+static const SymbolTable *GetOpenSymbolTable( ChewingData *pgdata )
 {
-	unsigned int i;
-	char **buf;
-	for ( i = 0; i < sizeof( symbol_buf ) / sizeof( symbol_buf[ 0 ] ); ++i ) {
-		for ( buf = symbol_buf[ i ]; *buf; ++buf )	{
-			if (  0 == strcmp( *buf, symbol ) )
-				return *symbol_buf[ i ][ 0 ];
-		}
-	}
-	return 0;
+	if ( ! pgdata->static_data.open_symbol_table )
+		pgdata->static_data.open_symbol_table = SymbolTableFromText(
+			OPEN_SYMBOL, sizeof( OPEN_SYMBOL ) - 1, ' ', 0 );
+	return pgdata->static_data.open_symbol_table;
+}
+
+static int FindSymbolKey( ChewingData *pgdata, const char *symbol )
+{
+	const SymbolTable *table = GetOpenSymbolTable( pgdata );
+	int entry;
+
+	if ( ! table )
+		return 0;
+	entry = SymbolFindEntry( table, symbol );
+	return entry == -1 ? 0 : *SymbolCategory( table, entry );
 }
 
 int OpenSymbolChoice( ChewingData *pgdata )
 {
-	int i, symbol_buf_len = ARRAY_SIZE( symbol_buf );
-	char **pBuf;
+	const SymbolTable *table;
+	int i, entry = -1;
 	ChoiceInfo *pci = &( pgdata->choiceInfo );
 	pci->oldChiSymbolCursor = pgdata->chiSymbolCursor;
 
@@ -1330,21 +1455,17 @@ int OpenSymbolChoice( ChewingData *pgdata )
 		HaninSymbolInput( pgdata );
 		return 0;
 	}
-	for ( i = 0; i < symbol_buf_len; i++ ) {
-		if ( symbol_buf[ i ][ 0 ][ 0 ] == 
-				pgdata->symbolKeyBuf[ pgdata->chiSymbolCursor ] ) {
-			pBuf = symbol_buf[i];
-			break;
-		}
-	}
-	if ( i == symbol_buf_len ) {
+	table = GetOpenSymbolTable( pgdata );
+	if ( table )
+		entry = SymbolFindKey( table, pgdata->symbolKeyBuf[ pgdata->chiSymbolCursor ] );
+	if ( entry == -1 ) {
 		ChoiceEndChoice( pgdata );
 		return 0;
 	}
 	pci->nTotalChoice = 0;
-	for ( i = 1; pBuf[ i ]; i++ ) {
-		ueStrNCpy( pci->totalChoiceStr[ pci->nTotalChoice ], 
-				pBuf[ i ], ueStrLen( pBuf[i] ), 1 );
+	for ( i = 0; i < SymbolNum( table, entry ); i++ ) {
+		strcpy( pci->totalChoiceStr[ pci->nTotalChoice ],
+				SymbolString( table, entry, i ) );
 		pci->nTotalChoice++; 
 	}
 
@@ -1364,195 +1485,74 @@ int OpenSymbolChoice( ChewingData *pgdata )
 
 int InitSymbolTable( ChewingData *pgdata, const char *prefix )
 {
-	static const unsigned int MAX_SYMBOL_ENTRY = 100;
-	static const size_t LINE_LEN = 512; // shall be long enough?
-
 	char *filename = NULL;
-	FILE *file = NULL;
-	char *line = NULL;
-	SymbolEntry **entry = NULL;
-	char *category_end;
-	char *symbols;
-	char *symbols_end;
-	char *symbol;
-	int i;
-	int len;
-	size_t size;
-	int ret = -1;
+	int ret;
 
-	pgdata->static_data.n_symbol_entry = 0;
 	pgdata->static_data.symbol_table = NULL;
 
 	ret = asprintf( &filename, "%s" PLAT_SEPARATOR "%s",
 		prefix, SYMBOL_TABLE_FILE );
 	if ( ret == -1 )
-		goto error;
-
-	file = fopen( filename, "r" );
-	if ( !file )
-		goto error;
-
-	line = ALC( char, LINE_LEN );
-	if ( !line )
-		goto error;
-
-	entry = ALC( SymbolEntry* , MAX_SYMBOL_ENTRY );
-	if ( !entry )
-		goto error;
-
-	while ( fgets( line, LINE_LEN, file ) &&
-		pgdata->static_data.n_symbol_entry < MAX_SYMBOL_ENTRY ) {
-
-		category_end = strpbrk( line, "=\r\n" );
-		if ( !category_end )
-			goto error;
-
-		symbols = category_end + 1;
-		symbols_end = strpbrk( symbols, "\r\n" );
-		if ( symbols_end ) {
-			len = ueStrLen( symbols );
-
-			entry[ pgdata->static_data.n_symbol_entry ] =
-				( SymbolEntry* ) malloc( sizeof ( entry[0][0] ) +
-					sizeof( entry[0][0].symbols[0] ) * len);
-			if ( !entry[ pgdata->static_data.n_symbol_entry ] )
-				goto error;
-			entry[ pgdata->static_data.n_symbol_entry ]
-				->nSymbols = len;
-
-			symbol = symbols;
-
-			for ( i = 0; i < len; ++i ) {
-				ueStrNCpy(
-					entry[ pgdata->static_data.n_symbol_entry ]->symbols[ i ],
-					symbol, 1, 1 );
-				// FIXME: What if symbol is combining sequences.
-				symbol += ueBytesFromChar( symbol[0] );
-			}
-
-
-		} else {
-			entry[ pgdata->static_data.n_symbol_entry ] =
-				( SymbolEntry* ) malloc( sizeof ( entry[0][0] ) );
-			if ( !entry[ pgdata->static_data.n_symbol_entry ] )
-				goto error;
+		return -1;
 
-			entry[ pgdata->static_data.n_symbol_entry ]
-				->nSymbols = 0;
-		}
-
-		*category_end = 0;
-		ueStrNCpy(
-			entry[pgdata->static_data.n_symbol_entry]->category,
-			line, MAX_PHRASE_LEN, 1);
-
-		++pgdata->static_data.n_symbol_entry;
-	}
+	pgdata->static_data.symbol_table = SymbolTableFromFile( filename, '=', 0 );
+	free( filename );
+	return pgdata->static_data.symbol_table ? 0 : -1;
+}
 
-	size = sizeof( *pgdata->static_data.symbol_table ) *
-		pgdata->static_data.n_symbol_entry;
-	pgdata->static_data.symbol_table = ( SymbolEntry ** ) malloc( size );
-	if ( !pgdata->static_data.symbol_table )
-		goto error;
-	memcpy( pgdata->static_data.symbol_table, entry, size );
-
-	ret = 0;
-end:
-	free( entry );
-	free( line );
-	fclose( file );
-	free ( filename );
-	return ret;
-
-error:
-	for ( i = 0; i < pgdata->static_data.n_symbol_entry; ++i ) {
-		free( entry[ i ] );
+void LoadSymbolTable( ChewingData *pgdata )
+{
+	if ( pgdata->static_data.symbol_table_prefix ) {
+		InitSymbolTable( pgdata, pgdata->static_data.symbol_table_prefix );
+		free( pgdata->static_data.symbol_table_prefix );
+		pgdata->static_data.symbol_table_prefix = NULL;
 	}
-	goto end;
 }
 
 void TerminateSymbolTable( ChewingData *pgdata )
 {
-	unsigned int i;
-	if ( pgdata->static_data.symbol_table ) {
-		for ( i = 0; i < pgdata->static_data.n_symbol_entry; ++i )
-			free( pgdata->static_data.symbol_table[ i ] );
-		free( pgdata->static_data.symbol_table );
-		pgdata->static_data.n_symbol_entry = 0;
-		pgdata->static_data.symbol_table = NULL;
-	}
+	free( pgdata->static_data.symbol_table_prefix );
+	pgdata->static_data.symbol_table_prefix = NULL;
+
+	free( pgdata->static_data.symbol_table );
+	pgdata->static_data.symbol_table = NULL;
+	free( pgdata->static_data.open_symbol_table );
+	pgdata->static_data.open_symbol_table = NULL;
 }
 
 int InitEasySymbolInput( ChewingData *pgdata, const char *prefix )
 {
-	static const int MAX_EASY_SYMBOL_LEN = 10;
-	static const size_t LINE_LEN = 512; // shall be long enough?
-
-	FILE *file = NULL;
 	char *filename = NULL;
-	char *line = NULL;
-	int len;
-	int _index;
-	char *symbol;
-	int ret = -1;
+	int ret;
+
+	pgdata->static_data.easy_symbol_table = NULL;
 
 	ret = asprintf( &filename, "%s" PLAT_SEPARATOR "%s",
 			prefix, SOFTKBD_TABLE_FILE );
 	if ( ret == -1 )
-		goto end;
-
-	file = fopen( filename, "r" );
-	if ( !file )
-		goto end;
-
-	line = ALC( char, LINE_LEN );
-	if ( !line )
-		goto end;
-
-	while ( fgets( line, LINE_LEN, file ) ) {
-		if ( ' ' != line[ 1 ] )
-			continue;
-
-		// Remove tailing \n
-		len = strcspn( line, "\r\n" );
+		return -1;
 
-		line[ len ] = '\0';
-
-		_index = FindEasySymbolIndex( line[ 0 ] );
-		if ( -1 == _index )
-			continue;
-
-		len = ueStrLen( &line[ 2 ] );
-		if ( 0 == len || len > MAX_EASY_SYMBOL_LEN )
-			continue;
-
-		symbol = ALC( char, strlen( &line[2] ) + 1 );
-		if ( !symbol )
-			goto end;
-
-		ueStrNCpy( symbol, &line[ 2 ], len, 1 );
+	pgdata->static_data.easy_symbol_table = SymbolTableFromFile( filename, ' ',
+		MAX_EASY_SYMBOL_LEN );
+	free( filename );
+	return pgdata->static_data.easy_symbol_table ? 0 : -1;
+}
 
-		free( pgdata->static_data.g_easy_symbol_value[ _index ] );
-		pgdata->static_data.g_easy_symbol_value[ _index ] = symbol;
-		pgdata->static_data.g_easy_symbol_num[ _index ] = len;
+void LoadEasySymbolInput( ChewingData *pgdata )
+{
+	if ( pgdata->static_data.easy_symbol_prefix ) {
+		InitEasySymbolInput( pgdata, pgdata->static_data.easy_symbol_prefix );
+		free( pgdata->static_data.easy_symbol_prefix );
+		pgdata->static_data.easy_symbol_prefix = NULL;
 	}
-	ret = 0;
-end:
-	free( line );
-	fclose( file );
-	free ( filename );
-	return ret;
 }
 
 void TerminateEasySymbolTable( ChewingData *pgdata )
 {
-	unsigned int i;
-	for ( i = 0; i < EASY_SYMBOL_KEY_TAB_LEN / sizeof( char ); ++i ) {
-		if ( NULL != pgdata->static_data.g_easy_symbol_value[ i ] ) {
-			free( pgdata->static_data.g_easy_symbol_value[ i ] );
-			pgdata->static_data.g_easy_symbol_value[ i ] = NULL;
-		}
-		pgdata->static_data.g_easy_symbol_num[ i ] = 0;
-	}
+	free( pgdata->static_data.easy_symbol_prefix );
+	pgdata->static_data.easy_symbol_prefix = NULL;
+
+	free( pgdata->static_data.easy_symbol_table );
+	pgdata->static_data.easy_symbol_table = NULL;
 }
 
@@ -83,6 +83,7 @@ static void SetAvailInfo( ChewingData *pgdata, int begin, int end)
 	int pho_id;
 	int diff;
 	uint16_t userPhoneSeq[ MAX_PHONE_SEQ_LEN ];
+	UserPhraseIterator user_iter;
 
 	int i, head, head_tmp;
 	int tail, tail_tmp;
@@ -129,7 +130,7 @@ static void SetAvailInfo( ChewingData *pgdata, int begin, int end)
 				&phoneSeq[ head_tmp ],
 				sizeof( uint16_t ) * ( diff + 1 ) ) ;
 			userPhoneSeq[ diff + 1 ] = 0;
-			if ( UserGetPhraseFirst( pgdata, userPhoneSeq ) ) {
+			if ( UserGetPhraseFirst( pgdata, &user_iter, userPhoneSeq ) ) {
 				/* save it! */
 				pai->avail[ pai->nAvail ].len = diff + 1;
 				pai->avail[ pai->nAvail ].id = -1;
@@ -162,7 +163,9 @@ static int ChoiceTheSame( ChoiceInfo *pci, char *str, int len )
 static void ChoiceInfoAppendChi( ChewingData *pgdata,  ChoiceInfo *pci, uint16_t phone )
 {
 	Word tempWord;
-	if ( GetCharFirst( pgdata, &tempWord, phone ) ) {
+	CharIterator iter;
+
+	if ( GetCharFirst( pgdata, &iter, &tempWord, phone ) ) {
 		do {
 			if ( ChoiceTheSame( pci, tempWord.word,
 					    ueBytesFromChar( tempWord.word[ 0 ] ) * sizeof( char ) ) )
@@ -174,7 +177,7 @@ static void ChoiceInfoAppendChi( ChewingData *pgdata,  ChoiceInfo *pci, uint16_t
 			pci->totalChoiceStr[ pci->nTotalChoice ]
 					   [ ueBytesFromChar( tempWord.word[ 0 ] ) ] = '\0';
 			pci->nTotalChoice++;
-		} while ( GetCharNext( pgdata, &tempWord ) );
+		} while ( GetCharNext( pgdata, &iter, &tempWord ) );
 	}
 }
 
@@ -188,6 +191,8 @@ static void SetChoiceInfo( ChewingData *pgdata )
 {
 	Phrase tempPhrase;
 	int len;
+	PhraseIterator iter;
+	UserPhraseIterator user_iter;
 	UserPhraseData *pUserPhraseData;
 	uint16_t userPhoneSeq[ MAX_PHONE_SEQ_LEN ];
 
@@ -284,8 +289,11 @@ static void SetChoiceInfo( ChewingData *pgdata )
 	}
 	/* phrase */
 	else {
-		if ( pai->avail[ pai->currentAvail ].id != -1 ) {
-			GetPhraseFirst( pgdata, &tempPhrase, pai->avail[ pai->currentAvail ].id );
+		memcpy( userPhoneSeq, &phoneSeq[ cursor ], sizeof( uint16_t ) * len );
+		userPhoneSeq[ len ] = 0;
+
+		if ( pai->avail[ pai->currentAvail ].id != -1 &&
+			GetPhraseFirst( pgdata, &iter, &tempPhrase, userPhoneSeq ) ) {
 			do {
 				if ( ChoiceTheSame( 
 					pci, 
@@ -296,12 +304,10 @@ static void SetChoiceInfo( ChewingData *pgdata )
 				ueStrNCpy( pci->totalChoiceStr[ pci->nTotalChoice ],
 						tempPhrase.phrase, len, 1);
 				pci->nTotalChoice++;
-			} while( GetPhraseNext( pgdata, &tempPhrase ) );
+			} while( GetPhraseNext( pgdata, &iter, &tempPhrase ) );
 		}
 
-		memcpy( userPhoneSeq, &phoneSeq[ cursor ], sizeof( uint16_t ) * len );
-		userPhoneSeq[ len ] = 0;
-		pUserPhraseData = UserGetPhraseFirst( pgdata, userPhoneSeq );
+		pUserPhraseData = UserGetPhraseFirst( pgdata, &user_iter, userPhoneSeq );
 		if ( pUserPhraseData ) {
 			do {
 				/* check if the phrase is already in the choice list */
@@ -317,7 +323,7 @@ static void SetChoiceInfo( ChewingData *pgdata )
 						len, 1);
 				pci->nTotalChoice++;
 			} while ( ( pUserPhraseData = 
-				    UserGetPhraseNext( pgdata, userPhoneSeq ) ) != NULL );
+				    UserGetPhraseNext( pgdata, &user_iter, userPhoneSeq ) ) != NULL );
 		}
 
 	}
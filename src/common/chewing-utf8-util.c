@@ -8,10 +8,14 @@
  * of this file.
  */
 
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "chewing-utf8-util.h"
 
+#define WORD_SIZE sizeof( uint64_t )
+#define HIGH_BITS UINT64_C( 0x8080808080808080 )
+
 /* Table of UTF-8 length */
 static char utf8len_tab[256] =
 {
@@ -25,19 +29,105 @@ static char utf8len_tab[256] =
 	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,4,4,4,4,4,4,4,4,5,5,5,5,6,6,1,1,
 };
 
+/*
+ * Return bytes of the ASCII prefix of str[ 0 .. len ), a word at a time. Words
+ * are loaded by memcpy so that nothing after str[ len - 1 ] is read.
+ */
+static size_t AsciiSpan( const char *str, size_t len )
+{
+	uint64_t word;
+	size_t i = 0;
+
+	while ( i + WORD_SIZE <= len ) {
+		memcpy( &word, str + i, WORD_SIZE );
+		if ( word & HIGH_BITS )
+			break;
+		i += WORD_SIZE;
+	}
+	while ( i < len && ! ( str[ i ] & 0x80 ) )
+		++i;
+	return i;
+}
+
 /* Return length of UTF-8 string */
 int ueStrLen( const char *str )
 {
+	size_t len = strlen( str );
+	size_t i = 0, span;
+	int length = 0;
+
+	while ( i < len ) {
+		span = AsciiSpan( str + i, len - i );
+		length += span;
+		i += span;
+		if ( i < len ) {
+			i += ueBytesFromChar( str[ i ] );
+			++length;
+		}
+	}
+	return length;
+}
+
+/* Return 1 if str[ 0 .. len ) has an ASCII byte */
+int ueStrHasAscii( const char *str, size_t len )
+{
+	uint64_t word;
+	size_t i = 0;
+
+	/* A word without ASCII has the high bit set in every byte. */
+	for ( ; i + WORD_SIZE <= len; i += WORD_SIZE ) {
+		memcpy( &word, str + i, WORD_SIZE );
+		if ( ( word & HIGH_BITS ) != HIGH_BITS )
+			return 1;
+	}
+	for ( ; i < len; i++ ) {
+		if ( ! ( str[ i ] & 0x80 ) )
+			return 1;
+	}
+	return 0;
+}
+
+/* Return number of characters in str[ 0 .. len ), or -1 if it is broken */
+int ueStrCheck( const char *str, size_t len )
+{
+	size_t i = 0, span;
+	int bytes, j;
 	int length = 0;
-	const char *strptr = str;
 
-	while ( strptr[ 0 ] != '\0' ) {
-		strptr += ueBytesFromChar( strptr[0] );
+	while ( i < len ) {
+		span = AsciiSpan( str + i, len - i );
+		length += span;
+		i += span;
+		if ( i == len )
+			break;
+
+		bytes = ueBytesFromChar( str[ i ] );
+		/* bogus lead byte, or a character cut by len */
+		if ( bytes == 1 || i + bytes > len )
+			return -1;
+		for ( j = 1; j < bytes; j++ ) {
+			if ( ( str[ i + j ] & 0xC0 ) != 0x80 )
+				return -1;
+		}
+		i += bytes;
 		++length;
 	}
 	return length;
 }
 
+/* Fill byte offset of each character, and return number of characters */
+int ueStrOffset( const char *str, int offset[], int n )
+{
+	int i, len = 0;
+
+	for ( i = 0; i < n && str[ len ] != '\0'; i++ ) {
+		offset[ i ] = len;
+		len += ueBytesFromChar( str[ len ] );
+	}
+	offset[ i ] = len;
+	return i;
+}
+
 /* Return bytes of a UTF-8 character */
 int ueBytesFromChar( unsigned char b )
 {
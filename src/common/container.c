@@ -0,0 +1,215 @@
+/**
+ * container.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+/*
+ * Layout of the dictionary container, shared by packdata, which writes it,
+ * and the library, which reads it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "global-private.h"
+#include "container-private.h"
+
+const ContainerLayout CONTAINER_LAYOUT[] = {
+	{ SECTION_CHAR, CHAR_FILE, 0, 1, "1" },
+	{ SECTION_CHAR_BEGIN, CHAR_INDEX_BEGIN_FILE, 0, sizeof( int ), "4" },
+	{ SECTION_CHAR_PHONE, CHAR_INDEX_PHONE_FILE, 0, sizeof( uint16_t ), "2" },
+	{ SECTION_DICT, DICT_FILE, 0, 1, NULL },
+	{ SECTION_DICT_BEGIN, PH_INDEX_FILE, 0, sizeof( int ), "4" },
+	/* phone_id, padding, phrase_id, child_begin, child_end */
+	{ SECTION_TREE, PHONE_TREE_FILE, 0, sizeof( TreeType ), "22444" },
+	/* initial, padding, posting_begin, posting_end, child_begin, child_end */
+	{ SECTION_ABBR_TREE, ABBR_TREE_FILE, 1, sizeof( AbbrTreeType ), "224444" },
+	{ SECTION_ABBR_POSTING, ABBR_POSTING_FILE, 1, sizeof( int ), "4" },
+	{ SECTION_PREDICT_BEGIN, PREDICT_INDEX_FILE, 1, sizeof( int ), "4" },
+	{ SECTION_PREDICT, PREDICT_FILE, 1, sizeof( int ), "4" },
+	/* dict_offset, phrase_id, phone[], padding */
+	{ SECTION_REVERSE_INDEX, REVERSE_INDEX_FILE, 1, sizeof( ReverseIndexType ), "442" },
+	{ SECTION_DICT_CHARSET, NULL, 1, DICT_CHAR_SIZE, "1" },
+	{ SECTION_DICT_FRONT_CODED, NULL, 1, 1, "1" },
+	{ 0, NULL, 0, 0, NULL },
+};
+
+const ContainerLayout *GetContainerLayout( int id )
+{
+	const ContainerLayout *layout;
+
+	for ( layout = CONTAINER_LAYOUT; layout->id; layout++ ) {
+		if ( layout->id == id )
+			return layout;
+	}
+	return NULL;
+}
+
+static int IsBigEndian()
+{
+	const uint16_t one = 1;
+
+	return *(const unsigned char *) &one == 0;
+}
+
+static void SwapBytes( unsigned char *p, int len )
+{
+	unsigned char c;
+	int i;
+
+	for ( i = 0; i < len / 2; i++ ) {
+		c = p[ i ];
+		p[ i ] = p[ len - 1 - i ];
+		p[ len - 1 - i ] = c;
+	}
+}
+
+uint32_t ContainerUint32( uint32_t value )
+{
+	if ( IsBigEndian() )
+		SwapBytes( (unsigned char *) &value, sizeof( value ) );
+	return value;
+}
+
+uint64_t ContainerUint64( uint64_t value )
+{
+	if ( IsBigEndian() )
+		SwapBytes( (unsigned char *) &value, sizeof( value ) );
+	return value;
+}
+
+void ContainerSwapSection( const ContainerLayout *layout, void *data, size_t size )
+{
+	unsigned char *p = (unsigned char *) data;
+	unsigned char *end = p + size;
+	unsigned char *element_end;
+	const char *field;
+	int width = 0;
+
+	if ( ! IsBigEndian() )
+		return;
+
+	if ( ! layout->fields ) {
+		/* phrase records */
+		while ( p < end ) {
+			p += 1 + *p;
+			if ( p + sizeof( int ) > end )
+				break;
+			SwapBytes( p, sizeof( int ) );
+			p += sizeof( int );
+		}
+		return;
+	}
+
+	for ( ; p + layout->element_size <= end; p = element_end ) {
+		element_end = p + layout->element_size;
+		for ( field = layout->fields; p < element_end; p += width ) {
+			if ( *field )
+				width = *field++ - '0';
+			if ( p + width > element_end )
+				break;
+			SwapBytes( p, width );
+		}
+	}
+}
+
+const ContainerSection *ContainerSections( const void *data, size_t size, int *section_num )
+{
+	const ContainerHeader *header = (const ContainerHeader *) data;
+	const ContainerSection *section;
+	uint64_t offset, section_size;
+	size_t section_offset;
+	uint32_t element_size;
+	int num, i;
+
+	if ( size < sizeof( ContainerHeader ) ||
+		memcmp( header->magic, CONTAINER_MAGIC, CONTAINER_MAGIC_SIZE ) ||
+		ContainerUint32( header->version ) != CONTAINER_VERSION ||
+		ContainerUint32( header->header_size ) < sizeof( ContainerHeader ) )
+		return NULL;
+
+	num = ContainerUint32( header->section_num );
+	section_offset = ContainerUint32( header->section_offset );
+	if ( num < 0 || section_offset % sizeof( uint64_t ) ||
+		section_offset > size ||
+		( size - section_offset ) / sizeof( ContainerSection ) < (size_t) num )
+		return NULL;
+
+	section = (const ContainerSection *) ( (const char *) data + section_offset );
+	for ( i = 0; i < num; i++ ) {
+		offset = ContainerUint64( section[ i ].offset );
+		section_size = ContainerUint64( section[ i ].size );
+		element_size = ContainerUint32( section[ i ].element_size );
+		if ( offset % CONTAINER_ALIGN || offset > size || section_size > size - offset ||
+			element_size == 0 || section_size % element_size )
+			return NULL;
+	}
+
+	*section_num = num;
+	return section;
+}
+
+#define CHECKSUM_LANE_NUM (8)
+#define CHECKSUM_BLOCK_SIZE ( CHECKSUM_LANE_NUM * sizeof( uint32_t ) )
+
+/* Add a block to the sums of each lane. */
+static void ChecksumBlock( const unsigned char *p, uint32_t sum1[], uint32_t sum2[] )
+{
+	uint32_t word[ CHECKSUM_LANE_NUM ];
+	int i;
+
+	memcpy( word, p, sizeof( word ) );
+	if ( IsBigEndian() ) {
+		for ( i = 0; i < CHECKSUM_LANE_NUM; i++ )
+			SwapBytes( (unsigned char *) &word[ i ], sizeof( word[ i ] ) );
+	}
+	for ( i = 0; i < CHECKSUM_LANE_NUM; i++ ) {
+		sum1[ i ] += word[ i ];
+		sum2[ i ] += sum1[ i ];
+	}
+}
+
+uint32_t ContainerChecksum( const void *data, size_t size )
+{
+	const unsigned char *p = (const unsigned char *) data;
+	unsigned char tail[ CHECKSUM_BLOCK_SIZE ];
+	uint32_t sum1[ CHECKSUM_LANE_NUM ] = { 0 };
+	uint32_t sum2[ CHECKSUM_LANE_NUM ] = { 0 };
+	uint32_t checksum = (uint32_t) size;
+	int i;
+
+	for ( ; size >= CHECKSUM_BLOCK_SIZE; size -= CHECKSUM_BLOCK_SIZE, p += CHECKSUM_BLOCK_SIZE )
+		ChecksumBlock( p, sum1, sum2 );
+	/* The last block is padded with 0. */
+	if ( size ) {
+		memset( tail, 0, sizeof( tail ) );
+		memcpy( tail, p, size );
+		ChecksumBlock( tail, sum1, sum2 );
+	}
+
+	for ( i = 0; i < CHECKSUM_LANE_NUM; i++ )
+		checksum = ( checksum ^ sum1[ i ] ) * 0x9E3779B1u + sum2[ i ];
+	return checksum;
+}
+
+int ContainerVerify( const void *data, const ContainerSection *section, int section_num )
+{
+	const ContainerHeader *header = (const ContainerHeader *) data;
+	int i;
+
+	if ( ContainerChecksum( section, sizeof( ContainerSection ) * section_num ) !=
+		ContainerUint32( header->checksum ) )
+		return -1;
+
+	for ( i = 0; i < section_num; i++ ) {
+		if ( ContainerChecksum( (const char *) data + ContainerUint64( section[ i ].offset ),
+			ContainerUint64( section[ i ].size ) ) != ContainerUint32( section[ i ].checksum ) )
+			return -1;
+	}
+	return 0;
+}
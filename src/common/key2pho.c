@@ -176,18 +176,81 @@ int PhoneFromUint( char *phone, size_t phone_len, uint16_t phone_num )
 	return 0;
 }
 
-int PhoneInxFromKey( int key, int type, int kbtype, int searchTimes )
+/*
+ * Compile a layout into table. keys is in the same order as ph_str, that is,
+ * keys[ i ] is the key of the i-th phone in ph_str.
+ */
+void InitKeyTableFromString( KeyTable *table, const char *keys )
+{
+	int count[ KEY_TABLE_KEY_NUM ] = { 0 };
+	int i, type, inx, key;
+
+	memset( table, 0, sizeof( *table ) );
+
+	type = 0;
+	inx = 1;
+	for ( i = 0; keys[ i ] && type < ZUIN_SIZE; i++ ) {
+		key = (unsigned char) keys[ i ];
+		if ( key < KEY_TABLE_KEY_NUM && count[ key ] < KEY_TABLE_SEARCH_TIMES ) {
+			table->entry[ key ][ count[ key ] ] = ( type << 5 ) | inx;
+			++count[ key ];
+		}
+
+		/* zhuin_tab_num[ type ] includes the leading space. */
+		if ( ++inx >= zhuin_tab_num[ type ] ) {
+			++type;
+			inx = 1;
+		}
+	}
+}
+
+void InitKeyTable( KeyTable *table, int kbtype )
+{
+	if ( 0 <= kbtype && kbtype < MAX_KBTYPE && key_str[ kbtype ] )
+		InitKeyTableFromString( table, key_str[ kbtype ] );
+	else
+		memset( table, 0, sizeof( *table ) );
+}
+
+/*
+ * Return inx of the searchTimes-th phone of key if it is of type, otherwise
+ * return 0.
+ */
+int PhoneInxFromKeyTable( const KeyTable *table, int key, int type, int searchTimes )
 {
-	char keyStr[ 2 ], rtStr[ 10 ], *p;
+	int entry;
 
-	keyStr[ 0 ] = key;
-	keyStr[ 1 ] = '\0';
-	if ( ! PhoneFromKey( rtStr, keyStr, kbtype, searchTimes ) )
+	if ( key < 0 || key >= KEY_TABLE_KEY_NUM ||
+		searchTimes < 1 || searchTimes > KEY_TABLE_SEARCH_TIMES )
+		return 0;
+	entry = table->entry[ key ][ searchTimes - 1 ];
+	if ( ( entry >> 5 ) != type )
 		return 0;
-	p = strstr( zhuin_tab[ type ], rtStr );
-	if ( ! p )
+	return entry & 0x1F;
+}
+
+/*
+ * Return inx of the searchTimes-th phone of key, and store its type in type.
+ * Return 0 if key is not a phone.
+ */
+int PhoneFromKeyTable( const KeyTable *table, int key, int searchTimes, int *type )
+{
+	int entry;
+
+	if ( key < 0 || key >= KEY_TABLE_KEY_NUM ||
+		searchTimes < 1 || searchTimes > KEY_TABLE_SEARCH_TIMES )
 		return 0;
-	return zhuin_tab_num[type] - ueStrLen(p);
+	entry = table->entry[ key ][ searchTimes - 1 ];
+	*type = entry >> 5;
+	return entry & 0x1F;
+}
+
+void PhoneInxFromUint( int ph_inx[], uint16_t phone )
+{
+	int i;
+
+	for ( i = 0; i < ZUIN_SIZE; i++ )
+		ph_inx[ i ] = ( phone >> shift[ i ] ) & sb[ i ];
 }
 
 uint16_t UintFromPhoneInx( const int ph_inx[] )
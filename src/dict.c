@@ -17,10 +17,14 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "chewing-utf8-util.h"
 #include "global-private.h"
 #include "private.h"
 #include "plat_mmap.h"
+#include "container-private.h"
 #include "dict-private.h"
+#include "char-private.h"
+#include "tree-private.h"
 
 #if ! defined(USE_BINARY_DATA)
 static char *fgettab( char *buf, int maxlen, FILE *fp )
@@ -41,60 +45,354 @@ static char *fgettab( char *buf, int maxlen, FILE *fp )
 }
 #endif
 
-void TerminateDict( ChewingData *pgdata )
-{
 #ifdef USE_BINARY_DATA
-	plat_mmap_close( &pgdata->static_data.index_mmap );
-	plat_mmap_close( &pgdata->static_data.dict_mmap );
-#else
-	if ( pgdata->static_data.dictfile ) {
-		fclose( pgdata->static_data.dictfile );
-		pgdata->static_data.dictfile = NULL;
+/* Sections are read as arrays of these, so their layout is part of the file. */
+STATIC_ASSERT( sizeof( int ) == 4, int_in_dictionary );
+STATIC_ASSERT( sizeof( TreeType ) == 16, tree_type_in_dictionary );
+STATIC_ASSERT( sizeof( AbbrTreeType ) == 20, abbr_tree_type_in_dictionary );
+STATIC_ASSERT( sizeof( ReverseIndexType ) == 32, reverse_index_type_in_dictionary );
+/* A front-coded record keeps numbers of characters in 4 bits. */
+STATIC_ASSERT( MAX_PHRASE_LEN < 16, front_coded_phrase_len );
+
+static void CloseContainer( SystemDictData *sys_dict )
+{
+	sys_dict->container = NULL;
+	sys_dict->section = NULL;
+	sys_dict->section_num = 0;
+	free( sys_dict->container_copy );
+	sys_dict->container_copy = NULL;
+	plat_mmap_close( &sys_dict->container_mmap );
+}
+
+/*
+ * Return how to keep the mapped dictionary warm. CHEWING_DICT_PRELOAD is
+ * "populate" to fault in the whole file when it is mapped, or "lock" to also
+ * lock it in memory. Either way the first keystroke does not wait for disk.
+ */
+static int GetPreloadFlag( void )
+{
+	const char *preload = getenv( "CHEWING_DICT_PRELOAD" );
+
+	if ( !preload )
+		return 0;
+	if ( ! strcmp( preload, "populate" ) )
+		return FLAG_ATTRIBUTE_POPULATE;
+	if ( ! strcmp( preload, "lock" ) )
+		return FLAG_ATTRIBUTE_LOCK;
+	return 0;
+}
+
+/*
+ * Read ahead the sections which converting the first phrase walks, and
+ * leave the others, which are looked up a record at a time, to be read on
+ * demand.
+ */
+static void AdviseSections( SystemDictData *sys_dict )
+{
+	const ContainerSection *section;
+	int advice;
+	int i;
+
+	for ( i = 0; i < sys_dict->section_num; i++ ) {
+		section = &sys_dict->section[ i ];
+		switch ( ContainerUint32( section->id ) ) {
+			case SECTION_ABBR_TREE:
+			case SECTION_ABBR_POSTING:
+			case SECTION_PREDICT_BEGIN:
+			case SECTION_PREDICT:
+			case SECTION_REVERSE_INDEX:
+				advice = ADVICE_RANDOM;
+				break;
+			default:
+				advice = ADVICE_WILLNEED;
+				break;
+		}
+		plat_mmap_advise( &sys_dict->container_mmap,
+			ContainerUint64( section->offset ),
+			ContainerUint64( section->size ), advice );
 	}
-	free( pgdata->static_data.dict_begin );
-	pgdata->static_data.dict_begin = NULL;
-#endif
 }
 
-int InitDict( ChewingData *pgdata, const char *prefix )
+/*
+ * Map DICTIONARY_FILE in prefix, which all tables are read from. The
+ * dictionary linked into the library is used in place, with no file.
+ */
+static int OpenContainer( SystemDictData *sys_dict, const char *prefix )
 {
-#ifdef USE_BINARY_DATA
 	char filename[ PATH_MAX ];
+	const ContainerLayout *layout;
 	size_t len;
-	size_t offset;
-	size_t file_size;
-	size_t csize;
+	size_t offset = 0;
+	size_t size;
+	const void *data;
+	int i;
 
-	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, DICT_FILE );
-	if ( len + 1 > sizeof( filename ) )
-		return -1;
+#ifdef ENABLE_BUILTIN_DICT
+	if ( ! strcmp( prefix, BUILTIN_DICT_PREFIX ) ) {
+		data = BUILTIN_DICT;
+		size = BUILTIN_DICT_SIZE;
+	} else
+#endif
+	{
+		len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, DICTIONARY_FILE );
+		if ( len + 1 > sizeof( filename ) )
+			return -1;
 
-	plat_mmap_set_invalid( &pgdata->static_data.dict_mmap );
-	file_size = plat_mmap_create( &pgdata->static_data.dict_mmap, filename, FLAG_ATTRIBUTE_READ );
-	if ( file_size <= 0 )
-		return -1;
+		size = plat_mmap_create( &sys_dict->container_mmap, filename,
+			FLAG_ATTRIBUTE_READ | FLAG_ATTRIBUTE_HUGEPAGE | GetPreloadFlag() );
+		if ( size <= 0 )
+			return -1;
+		data = plat_mmap_set_view( &sys_dict->container_mmap, &offset, &size );
+		if ( !data )
+			goto error;
+	}
 
-	offset = 0;
-	csize = file_size;
-	pgdata->static_data.dict = plat_mmap_set_view( &pgdata->static_data.dict_mmap, &offset, &csize );
-	if ( !pgdata->static_data.dict )
-		return -1;
+	sys_dict->container = data;
+	sys_dict->section = ContainerSections( data, size, &sys_dict->section_num );
+	if ( !sys_dict->section )
+		goto error;
+	/* A file may be truncated or damaged, unlike the linked dictionary. */
+	if ( plat_mmap_is_valid( &sys_dict->container_mmap ) &&
+		ContainerVerify( data, sys_dict->section, sys_dict->section_num ) )
+		goto error;
 
-	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, PH_INDEX_FILE );
-	if ( len + 1 > sizeof( filename ) )
-		return -1;
+	/* A big-endian host converts sections in a copy of the file. */
+	if ( ContainerUint32( 1 ) != 1 ) {
+		plat_mmap_advise( &sys_dict->container_mmap, 0, size, ADVICE_SEQUENTIAL );
+		sys_dict->container_copy = malloc( size );
+		if ( !sys_dict->container_copy )
+			goto error;
+		memcpy( sys_dict->container_copy, data, size );
+		sys_dict->container = sys_dict->container_copy;
+		sys_dict->section = ContainerSections(
+			sys_dict->container_copy, size, &sys_dict->section_num );
+		for ( i = 0; i < sys_dict->section_num; i++ ) {
+			layout = GetContainerLayout( ContainerUint32( sys_dict->section[ i ].id ) );
+			if ( layout )
+				ContainerSwapSection( layout,
+					(char *) sys_dict->container_copy +
+						ContainerUint64( sys_dict->section[ i ].offset ),
+					ContainerUint64( sys_dict->section[ i ].size ) );
+		}
+		plat_mmap_close( &sys_dict->container_mmap );
+	} else {
+		AdviseSections( sys_dict );
+	}
+	return 0;
 
-	plat_mmap_set_invalid( &pgdata->static_data.index_mmap );
-	file_size = plat_mmap_create( &pgdata->static_data.index_mmap, filename, FLAG_ATTRIBUTE_READ );
-	if ( file_size <= 0 )
-		return -1;
+error:
+	CloseContainer( sys_dict );
+	return -1;
+}
 
-	offset = 0;
-	csize = file_size;
-	pgdata->static_data.dict_begin = plat_mmap_set_view( &pgdata->static_data.index_mmap, &offset, &csize );
-	if ( !pgdata->static_data.dict_begin )
-		return -1;
+/*
+ * The checks below accumulate into bad, rather than return at the first bad
+ * value, so that compilers vectorize them.
+ */
+int IsDictIndexValid( const int *index, size_t num, size_t limit )
+{
+	int bad;
+	size_t i;
+
+	if ( num == 0 )
+		return 1;
+
+	bad = index[ 0 ] < 0;
+	for ( i = 1; i < num; i++ )
+		bad |= index[ i - 1 ] > index[ i ];
+	return !bad && (size_t) index[ num - 1 ] <= limit;
+}
+
+int IsDictValueValid( const int *value, size_t num, size_t limit )
+{
+	int bad = 0;
+	size_t i;
+
+	for ( i = 0; i < num; i++ )
+		bad |= ( value[ i ] < 0 ) | ( (size_t) value[ i ] >= limit );
+	return !bad;
+}
+
+/*
+ * Return the end of the phrase record at p, or NULL if it passes end or does
+ * not fit in a Phrase. first_chars is the number of characters of the first
+ * front-coded record of the bucket, or 0 before it.
+ */
+static const unsigned char *SkipPhraseRecord( const SystemDictData *sys_dict,
+	const unsigned char *p, const unsigned char *end, int *first_chars )
+{
+	int shared, chars;
+	int bad;
+	int i;
+
+	if ( p >= end )
+		return NULL;
 
+	if ( !sys_dict->dict_charset ) {
+		/* a length byte, the phrase, and an int frequency */
+		if ( *p > MAX_PHRASE_LEN * MAX_UTF8_SIZE ||
+			(size_t) ( end - p ) < 1 + *p + sizeof( int ) )
+			return NULL;
+		return p + 1 + *p + sizeof( int );
+	}
+
+	shared = *p >> 4;
+	chars = *p & 0x0f;
+	if ( shared > *first_chars || shared + chars == 0 || shared + chars > MAX_PHRASE_LEN ||
+		end - p < 1 + 2 * chars )
+		return NULL;
+	if ( *first_chars == 0 )
+		*first_chars = chars;
+
+	/* without a branch for each character, as records have a few of them */
+	++p;
+	bad = 0;
+	for ( i = 0; i < chars; i++ )
+		bad |= ( (size_t) ( p[ 2 * i ] | ( p[ 2 * i + 1 ] << 8 ) ) >= sys_dict->dict_charset_size );
+	p += 2 * chars;
+	if ( bad )
+		return NULL;
+
+	/* at most 5 bytes of frequency, which is a non-negative int */
+	for ( i = 0; i < 5 && p < end; i++ ) {
+		if ( !( *p & 0x80 ) )
+			return ( i < 4 || *p < 0x08 ) ? p + 1 : NULL;
+		++p;
+	}
+	return NULL;
+}
+
+/*
+ * Return 1 if every character of SECTION_DICT_CHARSET fits in its
+ * DICT_CHAR_SIZE bytes, and is not empty.
+ */
+static int IsDictCharsetValid( const SystemDictData *sys_dict )
+{
+	const unsigned char *ch = (const unsigned char *) sys_dict->dict_charset;
+	int bad = 0;
+	size_t i;
+
+	for ( i = 0; i < sys_dict->dict_charset_size; i++, ch += DICT_CHAR_SIZE )
+		bad |= ( ch[ 0 ] == 0 ) | ( ueBytesFromChar( ch[ 0 ] ) > DICT_CHAR_SIZE );
+	return !bad;
+}
+
+/*
+ * Return 1 if each bucket of the phrase section is records which end at the
+ * next bucket, and mark the start of each record in dict_record. A bucket is
+ * not empty, as OpenCursor reads its first record.
+ */
+static int IsDictRecordValid( SystemDictData *sys_dict )
+{
+	const unsigned char *dict = (const unsigned char *) sys_dict->dict;
+	const unsigned char *p, *end;
+	unsigned char *record;
+	int first_chars;
+	size_t i;
+
+	if ( sys_dict->dict_charset && ! IsDictCharsetValid( sys_dict ) )
+		return 0;
+
+	record = ALC( unsigned char, sys_dict->dict_size / 8 + 1 );
+	if ( !record )
+		return 0;
+	sys_dict->dict_record = record;
+
+	for ( i = 0; i + 1 < sys_dict->dict_begin_size; i++ ) {
+		p = dict + sys_dict->dict_begin[ i ];
+		end = dict + sys_dict->dict_begin[ i + 1 ];
+		first_chars = 0;
+		do {
+			record[ ( p - dict ) / 8 ] |= 1 << ( ( p - dict ) % 8 );
+			p = SkipPhraseRecord( sys_dict, p, end, &first_chars );
+			if ( !p )
+				return 0;
+		} while ( p < end );
+	}
+	return 1;
+}
+
+int IsDictOffsetValid( const SystemDictData *sys_dict, const int *offset, size_t num, size_t stride )
+{
+	const unsigned char *record = sys_dict->dict_record;
+	int bad = 0;
+	int value;
+	size_t i;
+
+	if ( !record )
+		return 0;
+	for ( i = 0; i < num && !bad; i++ ) {
+		value = *(const int *) ( (const char *) offset + i * stride );
+		bad = value < 0 || (size_t) value >= sys_dict->dict_size ||
+			!( record[ value / 8 ] & ( 1 << ( value % 8 ) ) );
+	}
+	return !bad;
+}
+
+/*
+ * Return section id of the dictionary, and store its number of elements in
+ * num. Return NULL if there is no such section, it is empty, or its
+ * elements are not element_size.
+ */
+void *GetDictSection( const SystemDictData *sys_dict, int id, size_t element_size, size_t *num )
+{
+	const ContainerSection *section;
+	int i;
+
+	for ( i = 0; i < sys_dict->section_num; i++ ) {
+		section = &sys_dict->section[ i ];
+		if ( (int) ContainerUint32( section->id ) != id )
+			continue;
+		if ( ContainerUint32( section->element_size ) != element_size ||
+			ContainerUint64( section->size ) == 0 )
+			return NULL;
+		*num = ContainerUint64( section->size ) / element_size;
+		return (char *) sys_dict->container + ContainerUint64( section->offset );
+	}
+	return NULL;
+}
+#endif
+
+void TerminateDict( SystemDictData *sys_dict )
+{
+#ifdef USE_BINARY_DATA
+	sys_dict->dict = NULL;
+	sys_dict->dict_begin = NULL;
+	sys_dict->dict_begin_size = 0;
+	sys_dict->dict_size = 0;
+	sys_dict->dict_charset = NULL;
+	sys_dict->dict_charset_size = 0;
+	free( sys_dict->dict_record );
+	sys_dict->dict_record = NULL;
+#else
+	if ( sys_dict->dictfile ) {
+		fclose( sys_dict->dictfile );
+		sys_dict->dictfile = NULL;
+	}
+	free( sys_dict->dict_begin );
+	sys_dict->dict_begin = NULL;
+#endif
+}
+
+int InitDict( SystemDictData *sys_dict, const char *prefix )
+{
+#ifdef USE_BINARY_DATA
+	sys_dict->dict_begin = (int *) GetDictSection( sys_dict,
+		SECTION_DICT_BEGIN, sizeof( int ), &sys_dict->dict_begin_size );
+	sys_dict->dict = GetDictSection( sys_dict, SECTION_DICT, 1, &sys_dict->dict_size );
+	if ( !sys_dict->dict ) {
+		sys_dict->dict = GetDictSection( sys_dict, SECTION_DICT_FRONT_CODED, 1,
+			&sys_dict->dict_size );
+		sys_dict->dict_charset = GetDictSection( sys_dict,
+			SECTION_DICT_CHARSET, DICT_CHAR_SIZE, &sys_dict->dict_charset_size );
+		if ( !sys_dict->dict_charset )
+			return -1;
+	}
+	if ( !sys_dict->dict || !sys_dict->dict_begin ||
+		! IsDictIndexValid( sys_dict->dict_begin, sys_dict->dict_begin_size,
+			sys_dict->dict_size ) ||
+		! IsDictRecordValid( sys_dict ) )
+		return -1;
 	return 0;
 #else
 	char filename[ PATH_MAX ];
@@ -102,16 +400,16 @@ int InitDict( ChewingData *pgdata, const char *prefix )
 	int len;
 	int i;
 
-	pgdata->static_data.dict_begin = ALC( int, PHONE_PHRASE_NUM + 1 );
-	if ( !pgdata->static_data.dict_begin )
+	sys_dict->dict_begin = ALC( int, PHONE_PHRASE_NUM + 1 );
+	if ( !sys_dict->dict_begin )
 		return -1;
 
 	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, DICT_FILE );
 	if ( len + 1 > sizeof( filename ) )
 		return -1;
 
-	pgdata->static_data.dictfile = fopen( filename, "r" );
-	if ( !pgdata->static_data.dictfile )
+	sys_dict->dictfile = fopen( filename, "r" );
+	if ( !sys_dict->dictfile )
 		return -1;
 
 	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, PH_INDEX_FILE );
@@ -125,55 +423,334 @@ int InitDict( ChewingData *pgdata, const char *prefix )
 	i = 0;
 	/* FIXME: check if begin is big enough to store all data. */
 	while ( !feof( indexfile ) )
-		fscanf( indexfile, "%d", &pgdata->static_data.dict_begin[ i++ ] );
+		fscanf( indexfile, "%d", &sys_dict->dict_begin[ i++ ] );
 	fclose( indexfile );
 
 	return 0;
 #endif
 }
 
-static void Str2Phrase( ChewingData *pgdata, Phrase *phr_ptr )
+#ifdef USE_BINARY_DATA
+/*
+ * Decode the record of SECTION_DICT_FRONT_CODED at cursor->cur_pos. The first
+ * record of a bucket is kept in cursor->phrase, which is empty before it.
+ */
+static void FrontCoded2Phrase( DictCursor *cursor, Phrase *phr_ptr )
+{
+	const SystemDictData *sys_dict = cursor->sys_dict;
+	const unsigned char *p = cursor->cur_pos;
+	const char *ch;
+	int shared = *p >> 4;
+	int chars = *p & 0x0f;
+	unsigned int freq = 0;
+	int shift = 0;
+	size_t len = 0;
+	size_t code;
+	int i;
+
+	++p;
+	for ( i = 0; i < shared; i++ )
+		len += ueBytesFromChar( cursor->phrase[ len ] );
+	memcpy( phr_ptr->phrase, cursor->phrase, len );
+	for ( i = 0; i < chars; i++ ) {
+		code = p[ 0 ] | ( p[ 1 ] << 8 );
+		p += 2;
+		assert( code < sys_dict->dict_charset_size );
+		ch = sys_dict->dict_charset + code * DICT_CHAR_SIZE;
+		memcpy( phr_ptr->phrase + len, ch, DICT_CHAR_SIZE );
+		len += ueBytesFromChar( *ch );
+	}
+	phr_ptr->phrase[ len ] = '\0';
+	if ( !cursor->phrase[ 0 ] )
+		memcpy( cursor->phrase, phr_ptr->phrase, len + 1 );
+
+	do {
+		freq |= ( *p & 0x7f ) << shift;
+		shift += 7;
+	} while ( *p++ & 0x80 );
+
+	phr_ptr->freq = (int) freq;
+	cursor->cur_pos = p;
+}
+#endif
+
+static void Str2Phrase( DictCursor *cursor, Phrase *phr_ptr )
 {
 #ifndef USE_BINARY_DATA
 	char buf[ 1000 ];
 
-	fgettab( buf, 1000, pgdata->static_data.dictfile );
+	fseek( cursor->sys_dict->dictfile, cursor->cur_pos, SEEK_SET );
+	fgettab( buf, 1000, cursor->sys_dict->dictfile );
+	cursor->cur_pos = ftell( cursor->sys_dict->dictfile );
 	sscanf( buf, "%[^ ] %d", phr_ptr->phrase, &( phr_ptr->freq ) );
 #else
 	unsigned char size;
-	size = *(unsigned char *) pgdata->static_data.dict_cur_pos;
-	pgdata->static_data.dict_cur_pos = (unsigned char *)pgdata->static_data.dict_cur_pos + sizeof(unsigned char);
-	memcpy( phr_ptr->phrase, pgdata->static_data.dict_cur_pos, size );
-	pgdata->static_data.dict_cur_pos = (unsigned char *)pgdata->static_data.dict_cur_pos + size;
-	phr_ptr->freq = *(int *) pgdata->static_data.dict_cur_pos;
-	pgdata->static_data.dict_cur_pos = (unsigned char *)pgdata->static_data.dict_cur_pos + sizeof(int);
+
+	if ( cursor->sys_dict->dict_charset ) {
+		FrontCoded2Phrase( cursor, phr_ptr );
+		return;
+	}
+	size = *cursor->cur_pos;
+	cursor->cur_pos += sizeof(unsigned char);
+	memcpy( phr_ptr->phrase, cursor->cur_pos, size );
+	cursor->cur_pos += size;
+	phr_ptr->freq = *(const int *) cursor->cur_pos;
+	cursor->cur_pos += sizeof(int);
 	phr_ptr->phrase[ size ] = '\0';
 #endif
 }
 
-int GetPhraseFirst( ChewingData *pgdata, Phrase *phr_ptr, int phone_phr_id )
+/* Point cursor at the phrases of phone_phr_id in sys_dict, and read the first one. */
+static void OpenCursor( DictCursor *cursor, const SystemDictData *sys_dict, int phone_phr_id )
 {
-	assert( ( 0 <= phone_phr_id ) && ( phone_phr_id < PHONE_PHRASE_NUM ) );
-
+	cursor->sys_dict = sys_dict;
 #ifndef USE_BINARY_DATA
-	fseek( pgdata->static_data.dictfile, pgdata->static_data.dict_begin[ phone_phr_id ], SEEK_SET );
+	assert( ( 0 <= phone_phr_id ) && ( phone_phr_id < PHONE_PHRASE_NUM ) );
+	cursor->cur_pos = sys_dict->dict_begin[ phone_phr_id ];
+	cursor->end_pos = sys_dict->dict_begin[ phone_phr_id + 1 ];
 #else
-	pgdata->static_data.dict_cur_pos = (unsigned char *)pgdata->static_data.dict + pgdata->static_data.dict_begin[ phone_phr_id ];
+	assert( ( 0 <= phone_phr_id ) && ( (size_t) phone_phr_id + 1 < sys_dict->dict_begin_size ) );
+	cursor->cur_pos = (const unsigned char *) sys_dict->dict + sys_dict->dict_begin[ phone_phr_id ];
+	cursor->end_pos = (const unsigned char *) sys_dict->dict + sys_dict->dict_begin[ phone_phr_id + 1 ];
+	cursor->phrase[ 0 ] = '\0';
 #endif
-	pgdata->static_data.dict_end_pos = pgdata->static_data.dict_begin[ phone_phr_id + 1 ];
-	Str2Phrase( pgdata, phr_ptr );
+	Str2Phrase( cursor, &cursor->next );
+	cursor->has_next = 1;
+}
+
+/* Return the most frequent phrase read ahead by the cursors of iter. */
+static int NextPhrase( PhraseIterator *iter, Phrase *phr_ptr )
+{
+	DictCursor *best = NULL;
+	DictCursor *cursor;
+	int i;
+
+	for ( i = 0; i < iter->cursor_num; i++ ) {
+		cursor = &iter->cursor[ i ];
+		if ( cursor->has_next && ( !best || cursor->next.freq > best->next.freq ) )
+			best = cursor;
+	}
+	if ( !best )
+		return 0;
+
+	*phr_ptr = best->next;
+	if ( best->cur_pos < best->end_pos )
+		Str2Phrase( best, &best->next );
+	else
+		best->has_next = 0;
 	return 1;
 }
 
-int GetPhraseNext( ChewingData *pgdata, Phrase *phr_ptr )
+int GetPhraseFirst( ChewingData *pgdata, PhraseIterator *iter, Phrase *phr_ptr, const uint16_t phoneSeq[] )
 {
-#ifndef USE_BINARY_DATA
-	if ( ftell( pgdata->static_data.dictfile ) >= pgdata->static_data.dict_end_pos )
+	const ChewingStaticData *static_data = &pgdata->static_data;
+	int len = 0;
+	int phone_phr_id;
+	int i;
+
+	iter->cursor_num = 0;
+	while ( phoneSeq[ len ] )
+		len++;
+	if ( len == 0 )
 		return 0;
+
+	for ( i = 0; i < static_data->dict_layer_num; i++ ) {
+		phone_phr_id = TreeFindDictPhrase( static_data->dict_layer[ i ], 0, len - 1, phoneSeq );
+		if ( phone_phr_id != -1 )
+			OpenCursor( &iter->cursor[ iter->cursor_num++ ],
+				static_data->dict_layer[ i ], phone_phr_id );
+	}
+	return NextPhrase( iter, phr_ptr );
+}
+
+int GetDictPhraseFirst( const SystemDictData *sys_dict, PhraseIterator *iter, Phrase *phr_ptr, int phone_phr_id )
+{
+	OpenCursor( &iter->cursor[ 0 ], sys_dict, phone_phr_id );
+	iter->cursor_num = 1;
+	return NextPhrase( iter, phr_ptr );
+}
+
+int GetPhraseNext( ChewingData *pgdata UNUSED, PhraseIterator *iter, Phrase *phr_ptr )
+{
+	return NextPhrase( iter, phr_ptr );
+}
+
+/* Read the phrase at offset of the phrase file, such as one from TreePredictPhrase. */
+void GetPhraseByOffset( ChewingData *pgdata, int offset, Phrase *phr_ptr )
+{
+	DictCursor cursor;
+	const SystemDictData *sys_dict = pgdata->static_data.sys_dict;
+#ifdef USE_BINARY_DATA
+	const unsigned char *dict = (const unsigned char *) sys_dict->dict;
+	int low, high, mid;
+#endif
+
+	cursor.sys_dict = sys_dict;
+#ifdef USE_BINARY_DATA
+	if ( sys_dict->dict_charset ) {
+		/* A front-coded record needs the first one of its bucket. */
+		low = 0;
+		high = sys_dict->dict_begin_size - 1;
+		while ( low < high ) {
+			mid = ( low + high + 1 ) / 2;
+			if ( sys_dict->dict_begin[ mid ] <= offset )
+				low = mid;
+			else
+				high = mid - 1;
+		}
+		cursor.cur_pos = dict + sys_dict->dict_begin[ low ];
+		cursor.phrase[ 0 ] = '\0';
+		Str2Phrase( &cursor, phr_ptr );
+		if ( sys_dict->dict_begin[ low ] == offset )
+			return;
+	}
+#endif
+
+#ifndef USE_BINARY_DATA
+	cursor.cur_pos = offset;
 #else
-	if ( (unsigned char *)pgdata->static_data.dict_cur_pos >= (unsigned char *)pgdata->static_data.dict + pgdata->static_data.dict_end_pos )
-		return 0;
+	cursor.cur_pos = dict + offset;
 #endif
-	Str2Phrase( pgdata, phr_ptr );
-	return 1;
+	cursor.end_pos = cursor.cur_pos;
+	Str2Phrase( &cursor, phr_ptr );
+}
+
+/* System dictionaries loaded by this process, shared by all contexts. */
+static SystemDictData *sys_dict_list = NULL;
+static plat_mutex sys_dict_lock = PLAT_MUTEX_INITIALIZER;
+
+static void UnloadSystemDict( SystemDictData *sys_dict )
+{
+	TerminateTree( sys_dict );
+	TerminateDict( sys_dict );
+	TerminateChar( sys_dict );
+#ifdef USE_BINARY_DATA
+	CloseContainer( sys_dict );
+#endif
+	free( sys_dict );
+}
+
+static SystemDictData *LoadSystemDict( const char *prefix )
+{
+	SystemDictData *sys_dict;
+	size_t len;
+
+	sys_dict = ALC( SystemDictData, 1 );
+	if ( !sys_dict )
+		return NULL;
+
+#ifdef USE_BINARY_DATA
+	plat_mmap_set_invalid( &sys_dict->container_mmap );
+#endif
+
+	len = snprintf( sys_dict->prefix, sizeof( sys_dict->prefix ), "%s", prefix );
+	if ( len + 1 > sizeof( sys_dict->prefix ) )
+		goto error;
+
+#ifdef USE_BINARY_DATA
+	if ( OpenContainer( sys_dict, prefix ) )
+		goto error;
+#endif
+
+	if ( InitChar( sys_dict, prefix ) )
+		goto error;
+	if ( InitDict( sys_dict, prefix ) )
+		goto error;
+	if ( InitTree( sys_dict, prefix ) )
+		goto error;
+#ifdef USE_BINARY_DATA
+	free( sys_dict->dict_record );
+	sys_dict->dict_record = NULL;
+#endif
+
+	sys_dict->ref_count = 1;
+	return sys_dict;
+
+error:
+	UnloadSystemDict( sys_dict );
+	return NULL;
+}
+
+SystemDictData *AcquireSystemDict( const char *prefix )
+{
+	SystemDictData *sys_dict;
+
+	PLAT_MUTEX_LOCK( &sys_dict_lock );
+
+#ifdef USE_BINARY_DATA
+	/*
+	 * Text data is read through one FILE per dictionary, which cannot be
+	 * shared by contexts running on different threads.
+	 */
+	for ( sys_dict = sys_dict_list; sys_dict; sys_dict = sys_dict->next ) {
+		if ( ! strcmp( sys_dict->prefix, prefix ) ) {
+			++sys_dict->ref_count;
+			goto end;
+		}
+	}
+#endif
+
+	sys_dict = LoadSystemDict( prefix );
+	if ( sys_dict ) {
+		sys_dict->next = sys_dict_list;
+		sys_dict_list = sys_dict;
+	}
+
+#ifdef USE_BINARY_DATA
+end:
+#endif
+	PLAT_MUTEX_UNLOCK( &sys_dict_lock );
+	return sys_dict;
+}
+
+SystemDictData *ReloadSystemDict( const char *prefix )
+{
+	SystemDictData *sys_dict;
+	SystemDictData **p;
+
+	/* Load without the lock, so that contexts switching are not held up. */
+	sys_dict = LoadSystemDict( prefix );
+	if ( !sys_dict )
+		return NULL;
+
+	PLAT_MUTEX_LOCK( &sys_dict_lock );
+
+	/* Older generations are no longer found, and go with their last user. */
+	for ( p = &sys_dict_list; *p; ) {
+		if ( ! strcmp( ( *p )->prefix, prefix ) ) {
+			PLAT_ATOMIC_STORE( &( *p )->stale, 1 );
+			*p = ( *p )->next;
+		} else {
+			p = &( *p )->next;
+		}
+	}
+	sys_dict->next = sys_dict_list;
+	sys_dict_list = sys_dict;
+
+	PLAT_MUTEX_UNLOCK( &sys_dict_lock );
+	return sys_dict;
+}
+
+int IsSystemDictStale( SystemDictData *sys_dict )
+{
+	return PLAT_ATOMIC_LOAD( &sys_dict->stale );
+}
+
+void ReleaseSystemDict( SystemDictData *sys_dict )
+{
+	SystemDictData **p;
+
+	PLAT_MUTEX_LOCK( &sys_dict_lock );
+
+	if ( --sys_dict->ref_count == 0 ) {
+		for ( p = &sys_dict_list; *p; p = &( *p )->next ) {
+			if ( *p == sys_dict ) {
+				*p = sys_dict->next;
+				break;
+			}
+		}
+		UnloadSystemDict( sys_dict );
+	}
+
+	PLAT_MUTEX_UNLOCK( &sys_dict_lock );
 }
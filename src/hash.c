@@ -220,17 +220,13 @@ void HashModify( ChewingData *pgdata, HASH_ITEM *pItem )
 
 static int isValidChineseString( char *str )
 {
+	size_t len;
+
 	if ( str == NULL || *str == '\0' ) {
 		return 0;
 	}
-	while ( *str != '\0' )  {
-		int len = ueBytesFromChar( (unsigned char) *str );
-		if ( len <= 1 ) {
-			return 0;
-		}
-		str += len;
-	};
-	return 1;
+	len = strlen( str );
+	return ! ueStrHasAscii( str, len ) && ueStrCheck( str, len ) > 0;
 }
 
 static int ReadInt(unsigned char *addr)
@@ -19,6 +19,8 @@
 #include "global.h"
 #include "chewing-private.h"
 #include "zuin-private.h"
+#include "dict-private.h"
+#include "tree-private.h"
 #include "chewingio.h"
 #include "private.h"
 
@@ -39,16 +41,18 @@ CHEWING_API int chewing_commit_Check( ChewingContext *ctx )
  */
 CHEWING_API char *chewing_commit_String( ChewingContext *ctx )
 {
-	int i;
-	char *s = (char *) calloc(
-		1 + ctx->output->nCommitStr,
-		sizeof(char) * MAX_UTF8_SIZE );
-	if ( s ) {
-		for ( i = 0; i < ctx->output->nCommitStr; i++ ) {
-			strcat( s, (char *) (ctx->output->commitStr[ i ].s) );
-		}
-	}
-	return s;
+	return strdup( ctx->output->commitBuf );
+}
+
+/**
+ * @param ctx handle to Chewing IM context
+ *
+ * Same as chewing_commit_String, but the returned string is owned by ctx and
+ * is valid until the next keystroke handled by ctx.
+ */
+CHEWING_API const char *chewing_commit_String_static( ChewingContext *ctx )
+{
+	return ctx->output->commitBuf;
 }
 
 CHEWING_API int chewing_buffer_Check( ChewingContext *ctx )
@@ -63,16 +67,12 @@ CHEWING_API int chewing_buffer_Len( ChewingContext *ctx )
 
 CHEWING_API char *chewing_buffer_String( ChewingContext *ctx )
 {
-	int i;
-	char *s = (char *) calloc(
-		1 + ctx->output->chiSymbolBufLen,
-		sizeof(char) * MAX_UTF8_SIZE );
-	if ( s ) {
-		for ( i = 0; i < ctx->output->chiSymbolBufLen; i++ ) {
-			strcat( s, (char *) (ctx->output->chiSymbolBuf[ i ].s) );
-		}
-	}
-	return s;
+	return strdup( ctx->output->preeditBuf );
+}
+
+CHEWING_API const char *chewing_buffer_String_static( ChewingContext *ctx )
+{
+	return ctx->output->preeditBuf;
 }
 
 /**
@@ -116,6 +116,50 @@ CHEWING_API int chewing_cursor_Current( ChewingContext *ctx )
 	return (ctx->output->chiSymbolCursor);
 }
 
+CHEWING_API int chewing_output_Delta( ChewingContext *ctx, ChewingOutputDelta *delta )
+{
+	ChewingOutput *pgo = ctx->output;
+	const char *buf = pgo->preeditBuf;
+	int len = pgo->preeditBufLen;
+	int prefix = pgo->delta.preeditPrefix;
+	int suffix = pgo->delta.preeditSuffix;
+	int max = ( len < pgo->delta.preeditLen ) ? len : pgo->delta.preeditLen;
+
+	/* The prefix and the suffix shall not overlap in either string. */
+	if ( prefix > max )
+		prefix = max;
+	if ( suffix > max - prefix )
+		suffix = max - prefix;
+
+	/* Do not split a UTF-8 character at either end of the change. */
+	while ( prefix > 0 && ( buf[ prefix ] & 0xC0 ) == 0x80 )
+		prefix--;
+	while ( suffix > 0 && ( buf[ len - suffix ] & 0xC0 ) == 0x80 )
+		suffix--;
+
+	delta->preeditFrom = prefix;
+	delta->preeditTo = pgo->delta.preeditLen - suffix;
+	delta->preeditText = buf + prefix;
+	delta->preeditTextLen = len - suffix - prefix;
+	delta->cursor = pgo->chiSymbolCursor;
+	delta->bCursorChanged = pgo->delta.bCursorChanged;
+	delta->bIntervalChanged = pgo->delta.bIntervalChanged;
+	delta->bCandidateChanged = pgo->delta.bCandidateChanged;
+
+	pgo->delta.preeditPrefix = len;
+	pgo->delta.preeditSuffix = len;
+	pgo->delta.preeditLen = len;
+	pgo->delta.bCursorChanged = 0;
+	pgo->delta.bIntervalChanged = 0;
+	pgo->delta.bCandidateChanged = 0;
+
+	return delta->preeditTo > delta->preeditFrom ||
+		delta->preeditTextLen > 0 ||
+		delta->bCursorChanged ||
+		delta->bIntervalChanged ||
+		delta->bCandidateChanged;
+}
+
 CHEWING_API int chewing_cand_CheckDone( ChewingContext *ctx )
 {
 	return (! ctx->output->pci);
@@ -247,3 +291,73 @@ CHEWING_API char *chewing_kbtype_String( ChewingContext *ctx )
 	}
 	return s;
 }
+
+CHEWING_API int chewing_predict_Enumerate( ChewingContext *ctx, const unsigned short *phoneSeq, int len )
+{
+	ctx->predict_no = 0;
+	ctx->predict_num = 0;
+	if ( phoneSeq || len == 0 )
+		ctx->predict_num = TreePredictPhrase( ctx->data, phoneSeq, len, &ctx->predict );
+	return ctx->predict_num;
+}
+
+CHEWING_API int chewing_predict_hasNext( ChewingContext *ctx )
+{
+	return ctx->predict_no < ctx->predict_num;
+}
+
+CHEWING_API char *chewing_predict_String( ChewingContext *ctx )
+{
+	Phrase phrase;
+	char *s;
+	if ( chewing_predict_hasNext( ctx ) ) {
+		GetPhraseByOffset( ctx->data, ctx->predict[ ctx->predict_no ], &phrase );
+		s = strdup( phrase.phrase );
+		ctx->predict_no++;
+	}
+	else {
+		s = strdup( "" );
+	}
+	return s;
+}
+
+CHEWING_API int chewing_reading_Enumerate( ChewingContext *ctx, const char *phrase )
+{
+	ctx->reading_no = 0;
+	ctx->reading_num = ReverseFindPhrase( ctx->data, phrase, &ctx->reading );
+	return ctx->reading_num;
+}
+
+CHEWING_API int chewing_reading_hasNext( ChewingContext *ctx )
+{
+	return ctx->reading_no < ctx->reading_num;
+}
+
+CHEWING_API int chewing_reading_Get( ChewingContext *ctx, unsigned short *phoneSeq, int *freq )
+{
+	const ReverseIndexType *entry;
+	Phrase phrase;
+	int len;
+
+	if ( !chewing_reading_hasNext( ctx ) )
+		return 0;
+
+	entry = &ctx->reading[ ctx->reading_no ];
+	for ( len = 0; len < MAX_PHRASE_LEN && entry->phone[ len ]; len++ ) {
+		if ( phoneSeq )
+			phoneSeq[ len ] = entry->phone[ len ];
+	}
+	if ( freq ) {
+		GetPhraseByOffset( ctx->data, entry->dict_offset, &phrase );
+		*freq = phrase.freq;
+	}
+	ctx->reading_no++;
+	return len;
+}
+
+CHEWING_API int chewing_annotate_Phone( ChewingContext *ctx, const char *text, unsigned short *phoneSeq, int len )
+{
+	if ( !text || !phoneSeq || len < 0 )
+		return -1;
+	return AnnotatePhone( ctx->data, text, phoneSeq, len );
+}
@@ -17,15 +17,22 @@
 #include <stdlib.h>
 
 #include "global-private.h"
+#include "dict-private.h"
 #include "pinyin-private.h"
 #include "zuin-private.h"
 #include "hash-private.h"
+#include "key2pho-private.h"
 #include "private.h"
 
+static int CompilePinyinTable( ChewingData *pgdata );
+
 void TerminatePinyin( ChewingData *pgdata )
 { 
+	free( pgdata->static_data.pinyin_prefix );
+	pgdata->static_data.pinyin_prefix = NULL;
 	free( pgdata->static_data.hanyuInitialsMap );
 	free( pgdata->static_data.hanyuFinalsMap );
+	free( pgdata->static_data.pinyin_table );
 }
 
 #if 0
@@ -85,9 +92,82 @@ int InitPinyin( ChewingData *pgdata, const char *prefix )
 
 	fclose( fd );
 
+	if ( CompilePinyinTable( pgdata ) )
+		return 0;
+
 	return 1;
 }
 
+void LoadPinyin( ChewingData *pgdata )
+{
+	if ( pgdata->static_data.pinyin_prefix ) {
+		InitPinyin( pgdata, pgdata->static_data.pinyin_prefix );
+		free( pgdata->static_data.pinyin_prefix );
+		pgdata->static_data.pinyin_prefix = NULL;
+	}
+}
+
+/*
+ * Spellings which are not mapped by initials and finals. kbtype -1 means all
+ * pinyin layouts. When more than one entry matches, the last one is used.
+ */
+static const struct {
+	const char *pinyin;
+	int kbtype;
+	const char *seq;
+} SPECIAL_PINYIN[] = {
+	/* special cases for WG */
+	{ "tzu", -1, "y yj" },		/* ㄗ|ㄗㄨ */
+	{ "ssu", -1, "n n" },		/* ㄙ|ㄙㄨ */
+	{ "szu", -1, "n n" },		/* ㄙ|ㄙㄨ */
+
+	/* common multiple mapping */
+	{ "e", -1, "k ," },		/* ㄜ|ㄝ */
+	{ "ch", -1, "t f" },		/* ㄔ|ㄑ */
+	{ "sh", -1, "g v" },		/* ㄕ|ㄒ */
+	{ "c", -1, "h f" },		/* ㄘ|ㄑ */
+	{ "s", -1, "n v" },		/* ㄙ|ㄒ */
+	{ "nu", -1, "sj sm" },		/* ㄋㄨ|ㄋㄩ */
+	{ "lu", -1, "xj xm" },		/* ㄌㄨ|ㄌㄩ */
+	{ "luan", -1, "xj0 xm0" },	/* ㄌㄨㄢ|ㄌㄩㄢ */
+	{ "niu", -1, "su. sm" },	/* ㄋㄧㄡ|ㄋㄩ */
+	{ "liu", -1, "xu. xm" },	/* ㄌㄧㄡ|ㄌㄩ */
+	{ "jiu", -1, "ru. rm" },	/* ㄐㄧㄡ|ㄐㄩ */
+	{ "chiu", -1, "fu. fm" },	/* ㄑㄧㄡ|ㄑㄩ */
+	{ "shiu", -1, "vu. vm" },	/* ㄒㄧㄡ|ㄒㄩ */
+	{ "ju", -1, "rm 5j" },		/* ㄐㄩ|ㄓㄨ */
+	{ "juan", -1, "rm0 5j0" },	/* ㄐㄩㄢ|ㄓㄨㄢ */
+
+	/* multiple mapping for each kbtype */
+	{ "chi", KB_HANYU_PINYIN, "t fu" },	/* ㄔ|ㄑㄧ */
+	{ "shi", KB_HANYU_PINYIN, "g vu" },	/* ㄕ|ㄒㄧ */
+	{ "ci", KB_HANYU_PINYIN, "h fu" },	/* ㄘ|ㄑㄧ */
+	{ "si", KB_HANYU_PINYIN, "n vu" },	/* ㄙ|ㄒㄧ */
+
+	{ "chi", KB_THL_PINYIN, "fu t" },	/* ㄑㄧ|ㄔ */
+	{ "shi", KB_THL_PINYIN, "vu g" },	/* ㄒㄧ|ㄕ */
+	{ "ci", KB_THL_PINYIN, "fu h" },	/* ㄑㄧ|ㄘ */
+	{ "si", KB_THL_PINYIN, "vu n" },	/* ㄒㄧ|ㄙ */
+
+	{ "chi", KB_MPS2_PINYIN, "fu t" },	/* ㄑㄧ|ㄔ */
+	{ "shi", KB_MPS2_PINYIN, "vu g" },	/* ㄒㄧ|ㄕ */
+	{ "ci", KB_MPS2_PINYIN, "fu h" },	/* ㄑㄧ|ㄘ */
+	{ "si", KB_MPS2_PINYIN, "vu n" },	/* ㄒㄧ|ㄙ */
+	{ "niu", KB_MPS2_PINYIN, "sm su." },	/* ㄋㄩ|ㄋㄧㄡ */
+	{ "liu", KB_MPS2_PINYIN, "xm xu." },	/* ㄌㄩ|ㄌㄧㄡ */
+	{ "jiu", KB_MPS2_PINYIN, "rm ru." },	/* ㄐㄩ|ㄐㄧㄡ */
+	{ "chiu", KB_MPS2_PINYIN, "fm fu." },	/* ㄑㄩ|ㄑㄧㄡ */
+	{ "shiu", KB_MPS2_PINYIN, "vm vu." },	/* ㄒㄩ|ㄒㄧㄡ */
+	{ "ju", KB_MPS2_PINYIN, "5j rm" },	/* ㄓㄨ|ㄐㄩ */
+	{ "juan", KB_MPS2_PINYIN, "5j0 rm0" },	/* ㄓㄨㄢ|ㄐㄩㄢ */
+	{ "juen", KB_MPS2_PINYIN, "5jp 5jp" },	/* ㄓㄨㄣ|ㄓㄨㄣ */
+	{ "tzu", KB_MPS2_PINYIN, "yj y" },	/* ㄗㄨ|ㄗ */
+};
+
+static int PinyinToZuinByKbType( ChewingData *pgdata, int kbtype,
+                                 const char *pinyinKeySeq,
+                                 char *zuinKeySeq, char *zuinKeySeqAlt );
+
 /**
  * Map pinyin key-sequence to Zuin key-sequence.
  * Caller should allocate char zuin[4].
@@ -99,139 +179,27 @@ int InitPinyin( ChewingData *pgdata, const char *prefix )
 int PinyinToZuin( ChewingData *pgdata, char *pinyinKeySeq,
                   char *zuinKeySeq, char *zuinKeySeqAlt )
 {
-	char *p, *cursor = NULL;
+	LoadPinyin( pgdata );
+	return PinyinToZuinByKbType( pgdata, pgdata->zuinData.kbtype,
+		pinyinKeySeq, zuinKeySeq, zuinKeySeqAlt );
+}
+
+static int PinyinToZuinByKbType( ChewingData *pgdata, int kbtype,
+                                 const char *pinyinKeySeq,
+                                 char *zuinKeySeq, char *zuinKeySeqAlt )
+{
+	const char *p, *cursor = NULL;
 	char *initial = 0;
 	char *final = 0;
-	char *seq = 0;
+	const char *seq = 0;
 	int i;
 
-	/* special cases for WG */
-	if ( ! strcmp( pinyinKeySeq, "tzu" ) ) {
-		seq = "y yj";   /* ㄗ|ㄗㄨ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "ssu" ) ||
-	          ! strcmp( pinyinKeySeq, "szu" ) ) {
-		seq = "n n";    /* ㄙ|ㄙㄨ */
-	}
-
-	/* common multiple mapping */
-	if ( ! strcmp( pinyinKeySeq, "e" ) ) {
-		seq = "k ,";    /* ㄜ|ㄝ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "ch" ) ) {
-		seq = "t f";    /* ㄔ|ㄑ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "sh" ) ) {
-		seq = "g v";    /* ㄕ|ㄒ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "c" ) ) {
-		seq = "h f";    /* ㄘ|ㄑ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "s" ) ) {
-		seq = "n v";    /* ㄙ|ㄒ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "nu" ) ) {
-		seq = "sj sm";  /* ㄋㄨ|ㄋㄩ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "lu" ) ) {
-		seq = "xj xm";  /* ㄌㄨ|ㄌㄩ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "luan" ) ) {
-		seq = "xj0 xm0";  /* ㄌㄨㄢ|ㄌㄩㄢ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "niu" ) ) {
-		seq = "su. sm"; /* ㄋㄧㄡ|ㄋㄩ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "liu" ) ) {
-		seq = "xu. xm"; /* ㄌㄧㄡ|ㄌㄩ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "jiu" ) ) {
-		seq = "ru. rm"; /* ㄐㄧㄡ|ㄐㄩ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "chiu" ) ) {
-		seq = "fu. fm"; /* ㄑㄧㄡ|ㄑㄩ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "shiu" ) ) {
-		seq = "vu. vm"; /* ㄒㄧㄡ|ㄒㄩ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "ju" ) ) {
-		seq = "rm 5j";  /* ㄐㄩ|ㄓㄨ */
-	}
-	else if ( ! strcmp( pinyinKeySeq, "juan" ) ) {
-		seq = "rm0 5j0";  /* ㄐㄩㄢ|ㄓㄨㄢ */
-	}
-
-	/* multiple mapping for each kbtype */
-	switch ( pgdata->zuinData.kbtype ) {
-		case KB_HANYU_PINYIN:
-			if ( ! strcmp( pinyinKeySeq, "chi" ) ) {
-				seq = "t fu";	/* ㄔ|ㄑㄧ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "shi" ) ) {
-				seq = "g vu";	/* ㄕ|ㄒㄧ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "ci" ) ) {
-				seq = "h fu";	/* ㄘ|ㄑㄧ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "si" ) ) {
-				seq = "n vu";	/* ㄙ|ㄒㄧ */
-			}
-			break;
-                case KB_THL_PINYIN:
-			if ( ! strcmp( pinyinKeySeq, "chi" ) ) {
-				seq = "fu t";   /* ㄑㄧ|ㄔ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "shi" ) ) {
-				seq = "vu g";   /* ㄒㄧ|ㄕ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "ci" ) ) {
-				seq = "fu h";   /* ㄑㄧ|ㄘ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "si" ) ) {
-				seq = "vu n";   /* ㄒㄧ|ㄙ */
-			}
-			break;
-		case KB_MPS2_PINYIN:
-			if ( ! strcmp( pinyinKeySeq, "chi" ) ) {
-				seq = "fu t";   /* ㄑㄧ|ㄔ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "shi" ) ) {
-				seq = "vu g";   /* ㄒㄧ|ㄕ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "ci" ) ) {
-				seq = "fu h";   /* ㄑㄧ|ㄘ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "si" ) ) {
-				seq = "vu n";   /* ㄒㄧ|ㄙ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "niu" ) ) {
-				seq = "sm su."; /* ㄋㄩ|ㄋㄧㄡ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "liu" ) ) {
-				seq = "xm xu."; /* ㄌㄩ|ㄌㄧㄡ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "jiu" ) ) {
-				seq = "rm ru."; /* ㄐㄩ|ㄐㄧㄡ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "chiu" ) ) {
-                                seq = "fm fu."; /* ㄑㄩ|ㄑㄧㄡ */
-                        }
-			else if ( ! strcmp( pinyinKeySeq, "shiu" ) ) {
-                                seq = "vm vu."; /* ㄒㄩ|ㄒㄧㄡ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "ju" ) ) {
-				seq = "5j rm";  /* ㄓㄨ|ㄐㄩ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "juan" ) ) {
-				seq = "5j0 rm0";  /* ㄓㄨㄢ|ㄐㄩㄢ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "juen" ) ) {
-				seq = "5jp 5jp";  /* ㄓㄨㄣ|ㄓㄨㄣ */
-			}
-			else if ( ! strcmp( pinyinKeySeq, "tzu" ) ) {
-				seq = "yj y";    /* ㄗㄨ|ㄗ */
-			}
-			break;
+	for ( i = 0; i < (int) ARRAY_SIZE( SPECIAL_PINYIN ); i++ ) {
+		if ( ( SPECIAL_PINYIN[ i ].kbtype == -1 ||
+		       SPECIAL_PINYIN[ i ].kbtype == kbtype ) &&
+		     ! strcmp( pinyinKeySeq, SPECIAL_PINYIN[ i ].pinyin ) ) {
+			seq = SPECIAL_PINYIN[ i ].seq;
+		}
 	}
 	if ( seq != NULL ) {
 		 char s[ ZUIN_SIZE * 2 + 1 ];
@@ -368,3 +336,384 @@ int PinyinToZuin( ChewingData *pgdata, char *pinyinKeySeq,
 	strcpy( zuinKeySeqAlt, zuinKeySeq );
         return 0;
 }
+
+static unsigned int HashPinyin( const char *pinyin )
+{
+	unsigned int hash = 2166136261u;
+
+	for ( ; *pinyin; ++pinyin ) {
+		hash ^= (unsigned char) *pinyin;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/*
+ * Return the slot of pinyin in the table, which is either the entry of
+ * pinyin or an empty slot.
+ */
+static PinyinEntry *FindPinyinSlot( const ChewingStaticData *static_data, const char *pinyin )
+{
+	unsigned int mask = static_data->pinyin_table_size - 1;
+	unsigned int i = HashPinyin( pinyin ) & mask;
+
+	while ( static_data->pinyin_table[ i ].pinyin[ 0 ] &&
+		strcmp( static_data->pinyin_table[ i ].pinyin, pinyin ) ) {
+		i = ( i + 1 ) & mask;
+	}
+	return &static_data->pinyin_table[ i ];
+}
+
+static uint16_t PhoneFromZuinKeySeq( const KeyTable *table, const char *seq )
+{
+	int pho_inx[ ZUIN_SIZE ] = { 0 };
+	int type, inx;
+
+	for ( ; *seq; ++seq ) {
+		inx = PhoneFromKeyTable( table, *seq, 1, &type );
+		if ( ! inx )
+			return 0;
+		pho_inx[ type ] = inx;
+	}
+	return UintFromPhoneInx( pho_inx );
+}
+
+static void AddPinyinEntry( ChewingData *pgdata, const char *pinyin )
+{
+	PinyinEntry *entry;
+	char zuinKeySeq[ ZUIN_SIZE * 2 + 1 ];
+	char zuinKeySeqAlt[ ZUIN_SIZE * 2 + 1 ];
+	int kbtype;
+
+	if ( strlen( pinyin ) >= PINYIN_SIZE )
+		return;
+
+	entry = FindPinyinSlot( &pgdata->static_data, pinyin );
+	if ( entry->pinyin[ 0 ] )
+		return;
+
+	for ( kbtype = KB_HANYU_PINYIN; kbtype <= KB_MPS2_PINYIN; kbtype++ ) {
+		if ( PinyinToZuinByKbType( pgdata, kbtype, pinyin,
+			zuinKeySeq, zuinKeySeqAlt ) )
+			return;
+		entry->phone[ kbtype - KB_HANYU_PINYIN ] = PhoneFromZuinKeySeq(
+			&pgdata->static_data.key_table[ kbtype ], zuinKeySeq );
+		entry->phoneAlt[ kbtype - KB_HANYU_PINYIN ] = PhoneFromZuinKeySeq(
+			&pgdata->static_data.key_table[ kbtype ], zuinKeySeqAlt );
+	}
+	strcpy( entry->pinyin, pinyin );
+}
+
+/*
+ * Every spelling accepted by PinyinToZuin is either a special one or an
+ * initial followed by a final, so compile all of them into a hash table.
+ */
+static int CompilePinyinTable( ChewingData *pgdata )
+{
+	ChewingStaticData *static_data = &pgdata->static_data;
+	char pinyin[ sizeof( static_data->hanyuInitialsMap[ 0 ].pinyin ) +
+		sizeof( static_data->hanyuFinalsMap[ 0 ].pinyin ) ];
+	unsigned int count;
+	unsigned int size;
+	int i, j;
+
+	count = static_data->HANYU_INITIALS * static_data->HANYU_FINALS +
+		ARRAY_SIZE( SPECIAL_PINYIN );
+	for ( size = 1; size < count * 2; size <<= 1 )
+		;
+
+	static_data->pinyin_table = ALC( PinyinEntry, size );
+	if ( ! static_data->pinyin_table )
+		return -1;
+	static_data->pinyin_table_size = size;
+
+	for ( i = 0; i < (int) ARRAY_SIZE( SPECIAL_PINYIN ); i++ )
+		AddPinyinEntry( pgdata, SPECIAL_PINYIN[ i ].pinyin );
+
+	for ( i = 0; i < static_data->HANYU_INITIALS; i++ ) {
+		for ( j = 0; j < static_data->HANYU_FINALS; j++ ) {
+			snprintf( pinyin, sizeof( pinyin ), "%s%s",
+				static_data->hanyuInitialsMap[ i ].pinyin,
+				static_data->hanyuFinalsMap[ j ].pinyin );
+			if ( pinyin[ 0 ] )
+				AddPinyinEntry( pgdata, pinyin );
+		}
+	}
+	return 0;
+}
+
+/**
+ * Look up phone and alternative phone of a pinyin spelling for current
+ * keyboard type.
+ *
+ * @retval 0 Success
+ * @retval -1 pinyin is not a valid spelling
+ */
+int PinyinToPhone( ChewingData *pgdata, const char *pinyin,
+                   uint16_t *phone, uint16_t *phoneAlt )
+{
+	const PinyinEntry *entry;
+	int kbtype = pgdata->zuinData.kbtype;
+
+	LoadPinyin( pgdata );
+
+	if ( ! pgdata->static_data.pinyin_table ||
+		kbtype < KB_HANYU_PINYIN || kbtype > KB_MPS2_PINYIN )
+		return -1;
+
+	entry = FindPinyinSlot( &pgdata->static_data, pinyin );
+	if ( ! entry->pinyin[ 0 ] || ! entry->phone[ kbtype - KB_HANYU_PINYIN ] )
+		return -1;
+
+	*phone = entry->phone[ kbtype - KB_HANYU_PINYIN ];
+	*phoneAlt = entry->phoneAlt[ kbtype - KB_HANYU_PINYIN ];
+	return 0;
+}
+
+/*
+ * Cost of a segmentation is its number of phrases, and then its number of
+ * syllables, so that the fewest and then the shortest phrases are preferred.
+ * Segmentations of the same cost are compared by frequency.
+ */
+#define PINYIN_PHRASE_COST ( PINYIN_CONTINUOUS_SIZE + 1 )
+
+static int IsPinyinLetter( int key )
+{
+	return 'a' <= key && key <= 'z';
+}
+
+static int IsPinyinToneKey( int key )
+{
+	return '1' <= key && key <= '5';
+}
+
+/* Tone of phone for pinyin tone key 1 ~ 5. The first tone has no mark. */
+static int ToneFromPinyinKey( int key )
+{
+	static const int TONE[] = { 0, 2, 3, 4, 1 };
+
+	return TONE[ key - '1' ];
+}
+
+static int GetPhraseFreq( ChewingData *pgdata, int phrase_id )
+{
+	PhraseIterator iter;
+	Phrase phrase;
+
+	if ( GetDictPhraseFirst( pgdata->static_data.sys_dict, &iter, &phrase, phrase_id ) )
+		return phrase.freq;
+	return 0;
+}
+
+static void AddWalk( ChewingData *pgdata, PinYinLattice *lattice, int to,
+                     const PinYinWalk *walk )
+{
+	PinYinLatticeNode *node = &lattice->node[ to ];
+	const PinYinLatticeNode *begin = &lattice->node[ (int) walk->begin ];
+	int phrase_id = pgdata->static_data.sys_dict->tree[ walk->tree_p ].phrase_id;
+	int cost, freq;
+
+	if ( node->nWalk >= PINYIN_MAX_WALK )
+		return;
+	node->walk[ node->nWalk++ ] = *walk;
+
+	if ( phrase_id == -1 )
+		return;
+	cost = begin->cost + PINYIN_PHRASE_COST + walk->len;
+	freq = begin->freq + GetPhraseFreq( pgdata, phrase_id );
+	if ( node->cost == -1 || cost < node->cost ||
+	     ( cost == node->cost && freq > node->freq ) ) {
+		node->cost = cost;
+		node->freq = freq;
+		node->best = node->nWalk - 1;
+	}
+}
+
+/*
+ * Extend walk `prev' at node `from' by a syllable ending at node `to', or
+ * start a phrase at node `from' if prev is -1. Tone -1 matches any tone.
+ */
+static void ExtendWalk( ChewingData *pgdata, PinYinLattice *lattice,
+                        int from, int to, int prev, uint16_t phone, int tone )
+{
+	const TreeType *tree = pgdata->static_data.sys_dict->tree;
+	const PinYinWalk *last = NULL;
+	PinYinWalk walk;
+	int tree_p = 0;
+	int child;
+
+	if ( prev != -1 ) {
+		last = &lattice->node[ from ].walk[ prev ];
+		tree_p = last->tree_p;
+	}
+
+	for (
+		child = tree[ tree_p ].child_begin;
+		child != -1 && child <= tree[ tree_p ].child_end;
+		child++ ) {
+		if ( ( tree[ child ].phone_id & ~7 ) != phone )
+			continue;
+		if ( tone != -1 && ( tree[ child ].phone_id & 7 ) != tone )
+			continue;
+
+		walk.tree_p = child;
+		walk.phone = tree[ child ].phone_id;
+		walk.from = from;
+		walk.prev = prev;
+		walk.begin = last ? last->begin : from;
+		walk.len = last ? last->len + 1 : 1;
+		AddWalk( pgdata, lattice, to, &walk );
+	}
+}
+
+static void AddSyllable( ChewingData *pgdata, PinYinLattice *lattice,
+                         int from, int to, uint16_t phone, int tone )
+{
+	const PinYinLatticeNode *node = &lattice->node[ from ];
+	int i;
+
+	for ( i = 0; i < node->nWalk; i++ ) {
+		if ( node->walk[ i ].len < MAX_PHRASE_LEN )
+			ExtendWalk( pgdata, lattice, from, to, i, phone, tone );
+	}
+	if ( node->cost != -1 )
+		ExtendWalk( pgdata, lattice, from, to, -1, phone, tone );
+}
+
+/**
+ * Append a key to continuous pinyin input. Only syllables ending at the new
+ * key are looked up, so the cost does not depend on the length of input.
+ *
+ * The key is a letter, a tone key 1 ~ 5 ending a syllable, or ' separating
+ * two syllables.
+ *
+ * @retval 0 Success
+ * @retval -1 key is not acceptable here
+ */
+int PinyinLatticeAppend( ChewingData *pgdata, PinYinLattice *lattice, int key )
+{
+	PinYinLatticeNode *node;
+	char pinyin[ PINYIN_SIZE ];
+	uint16_t phone, phoneAlt;
+	int from, to, end;
+	int tone = -1;
+
+	if ( lattice->len >= PINYIN_CONTINUOUS_SIZE )
+		return -1;
+
+	if ( IsPinyinToneKey( key ) || key == '\'' ) {
+		/* Tone and separator shall follow a letter. */
+		if ( lattice->len == 0 ||
+		     ! IsPinyinLetter( lattice->keySeq[ lattice->len - 1 ] ) )
+			return -1;
+		if ( key != '\'' )
+			tone = ToneFromPinyinKey( key );
+	}
+	else if ( ! IsPinyinLetter( key ) ) {
+		return -1;
+	}
+
+	if ( lattice->len == 0 ) {
+		node = &lattice->node[ 0 ];
+		node->nWalk = 0;
+		node->cost = 0;
+		node->freq = 0;
+		node->best = -1;
+	}
+
+	end = lattice->len;
+	lattice->keySeq[ lattice->len++ ] = key;
+	lattice->keySeq[ lattice->len ] = '\0';
+	to = lattice->len;
+
+	node = &lattice->node[ to ];
+	node->nWalk = 0;
+	node->cost = -1;
+	node->freq = 0;
+	node->best = -1;
+
+	if ( key == '\'' ) {
+		node->cost = lattice->node[ end ].cost;
+		node->freq = lattice->node[ end ].freq;
+		return 0;
+	}
+	if ( IsPinyinLetter( key ) )
+		end = to;
+
+	for (
+		from = end - 1;
+		from >= 0 && end - from < PINYIN_SIZE &&
+		IsPinyinLetter( lattice->keySeq[ from ] );
+		from-- ) {
+		memcpy( pinyin, &lattice->keySeq[ from ], end - from );
+		pinyin[ end - from ] = '\0';
+		if ( PinyinToPhone( pgdata, pinyin, &phone, &phoneAlt ) )
+			continue;
+		AddSyllable( pgdata, lattice, from, to, phone, tone );
+		if ( phoneAlt != phone )
+			AddSyllable( pgdata, lattice, from, to, phoneAlt, tone );
+	}
+	return 0;
+}
+
+void PinyinLatticeRemoveLast( PinYinLattice *lattice )
+{
+	if ( lattice->len > 0 )
+		lattice->keySeq[ --lattice->len ] = '\0';
+}
+
+/**
+ * Get syllables of the best segmentation of keySeq[ 0 .. end ).
+ *
+ * @param phoneSeq receives the syllables.
+ * @param bCnnct receives whether each syllable is in the same phrase as the
+ * previous one.
+ * @param lastPhraseBegin if not NULL, receives the node where the last
+ * phrase begins.
+ *
+ * @return number of syllables, or -1 if there is no segmentation.
+ */
+int PinyinLatticeSegment( const PinYinLattice *lattice, int end,
+                          uint16_t phoneSeq[], int bCnnct[], int *lastPhraseBegin )
+{
+	const PinYinWalk *walk;
+	int to = end;
+	int n = 0;
+	int i, tmp;
+
+	if ( lattice->node[ end ].cost == -1 )
+		return -1;
+
+	if ( lastPhraseBegin )
+		*lastPhraseBegin = 0;
+
+	/* Collect syllables backward, then reverse them. */
+	while ( to > 0 ) {
+		if ( lattice->node[ to ].best == -1 ) {
+			to--;
+			continue;
+		}
+		walk = &lattice->node[ to ].walk[ lattice->node[ to ].best ];
+		if ( lastPhraseBegin && n == 0 )
+			*lastPhraseBegin = walk->begin;
+		to = walk->begin;
+		for ( ; ; ) {
+			phoneSeq[ n ] = walk->phone;
+			bCnnct[ n ] = ( walk->prev != -1 );
+			n++;
+			if ( walk->prev == -1 )
+				break;
+			walk = &lattice->node[ (int) walk->from ].walk[ (int) walk->prev ];
+		}
+	}
+
+	for ( i = 0; i < n / 2; i++ ) {
+		tmp = phoneSeq[ i ];
+		phoneSeq[ i ] = phoneSeq[ n - 1 - i ];
+		phoneSeq[ n - 1 - i ] = tmp;
+		tmp = bCnnct[ i ];
+		bCnnct[ i ] = bCnnct[ n - 1 - i ];
+		bCnnct[ n - 1 - i ] = tmp;
+	}
+	return n;
+}
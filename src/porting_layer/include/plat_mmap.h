@@ -21,6 +21,18 @@ extern "C"
 /* flags */
 #define FLAG_ATTRIBUTE_READ	0x00000001
 #define FLAG_ATTRIBUTE_WRITE	0x00000002
+/* fault in the whole view when it is mapped */
+#define FLAG_ATTRIBUTE_POPULATE	0x00000004
+/* fault in the whole view and lock it in memory, if the limit allows */
+#define FLAG_ATTRIBUTE_LOCK	0x00000008
+/* align a view of a huge page or more to a huge page, and allow huge pages */
+#define FLAG_ATTRIBUTE_HUGEPAGE	0x00000010
+
+/* access hints of plat_mmap_advise */
+#define ADVICE_NORMAL		0
+#define ADVICE_RANDOM		1
+#define ADVICE_SEQUENTIAL	2
+#define ADVICE_WILLNEED		3
 
 /* Set the mmap handle to be invalid */
 void plat_mmap_set_invalid( plat_mmap *handle );
@@ -34,6 +46,12 @@ size_t plat_mmap_create( plat_mmap *handle, const char *file, int fileAttr );
 /* Obtain a view of the mapped file, return the page aligned offset & size */
 void *plat_mmap_set_view( plat_mmap *handle, size_t *offset, size_t *size );
 
+/*
+ * Hint how bytes [ offset, offset + size ) of the view will be accessed,
+ * return 0 if the hint is taken
+ */
+int plat_mmap_advise( plat_mmap *handle, size_t offset, size_t size, int advice );
+
 /* Delete the mmap handle */
 void plat_mmap_close( plat_mmap *handle );
 
@@ -27,13 +27,30 @@
 #error please define SEARCH_PATH_SEP
 #endif
 
+/*
+ * Identity of a directory, which changes when an entry is added to, removed
+ * from or renamed in the directory.
+ */
+typedef struct {
+	int exist;
+	unsigned long long dev;
+	unsigned long long ino;
+	long long mtime;
+	long mtime_nsec;
+} plat_dir_stamp;
+
 int get_search_path( char * path, size_t path_len );
+void get_dir_stamp( const char *path, plat_dir_stamp *stamp );
 int find_path_by_files(
 	const char *search_path,
 	const char * const *files,
 	char *output,
 	size_t output_len );
 
+#ifndef HAVE_STRTOK_R
+char *strtok_r( char *s, const char *delim, char **save_ptr );
+#endif
+
 #ifndef HAVE_ASPRINTF
 int asprintf( char **strp, const char *fmt, ... );
 #endif
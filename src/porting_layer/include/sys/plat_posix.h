@@ -18,6 +18,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <pthread.h>
 
 #include <sys/types.h>
 
@@ -30,6 +31,32 @@
 #define PLAT_UNLINK(path) \
 	unlink(path)
 
+typedef pthread_mutex_t plat_mutex;
+#define PLAT_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define PLAT_MUTEX_LOCK(mutex) \
+	pthread_mutex_lock(mutex)
+#define PLAT_MUTEX_UNLOCK(mutex) \
+	pthread_mutex_unlock(mutex)
+
+/* int flags read without the mutex which guards their writes */
+#define PLAT_ATOMIC_LOAD(ptr) \
+	__atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define PLAT_ATOMIC_STORE(ptr, value) \
+	__atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+
+typedef pthread_t plat_thread;
+typedef void *(*plat_thread_routine)(void *);
+#define PLAT_THREAD_ROUTINE(routine, arg) \
+	void *routine(void *arg)
+#define PLAT_THREAD_RETURN \
+	return NULL
+#define PLAT_THREAD_CREATE(thread, routine, arg) \
+	pthread_create(thread, NULL, routine, arg)
+#define PLAT_THREAD_JOIN(thread) \
+	pthread_join(thread, NULL)
+#define PLAT_CPU_NUM() \
+	((int) sysconf(_SC_NPROCESSORS_ONLN))
+
 /* GNU Hurd doesn't define PATH_MAX */
 #ifndef PATH_MAX
 #define PATH_MAX 4096
@@ -41,6 +41,32 @@
 #define PLAT_UNLINK(path) \
 	_unlink(path)
 
+typedef SRWLOCK plat_mutex;
+#define PLAT_MUTEX_INITIALIZER SRWLOCK_INIT
+#define PLAT_MUTEX_LOCK(mutex) \
+	AcquireSRWLockExclusive(mutex)
+#define PLAT_MUTEX_UNLOCK(mutex) \
+	ReleaseSRWLockExclusive(mutex)
+
+/* int flags read without the mutex which guards their writes */
+#define PLAT_ATOMIC_LOAD(ptr) \
+	((int) InterlockedCompareExchange((LONG volatile *) (ptr), 0, 0))
+#define PLAT_ATOMIC_STORE(ptr, value) \
+	InterlockedExchange((LONG volatile *) (ptr), (value))
+
+typedef HANDLE plat_thread;
+typedef LPTHREAD_START_ROUTINE plat_thread_routine;
+#define PLAT_THREAD_ROUTINE(routine, arg) \
+	DWORD WINAPI routine(LPVOID arg)
+#define PLAT_THREAD_RETURN \
+	return 0
+#define PLAT_THREAD_CREATE(thread, routine, arg) \
+	((*(thread) = CreateThread(NULL, 0, routine, arg, 0, NULL)) == NULL)
+#define PLAT_THREAD_JOIN(thread) \
+	(WaitForSingleObject(thread, INFINITE), CloseHandle(thread))
+#define PLAT_CPU_NUM() \
+	((int) GetActiveProcessorCount(ALL_PROCESSOR_GROUPS))
+
 /* strtok_s is simply the Windows version of strtok_r which is standard
    everywhere else.
    FIXME: use strtok_s instead of our own implementation.
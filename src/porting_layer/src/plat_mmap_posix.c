@@ -17,10 +17,14 @@
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include "plat_mmap.h"
 
+/* the smallest huge page of common hosts, which larger ones are multiples of */
+#define HUGE_PAGE_SIZE ( 2 * 1024 * 1024 )
+
 /* set the mmap handle an invalid value */
 void plat_mmap_set_invalid( plat_mmap *handle )
 {
@@ -63,17 +67,65 @@ size_t plat_mmap_create( plat_mmap *handle, const char *file, int fileAccessAttr
 	if ( handle->fd == -1 )
 		return 0;
 
+	handle->fAccessAttr = fileAccessAttr;
 	sizet = lseek( handle->fd, 0, SEEK_END );
 	lseek( handle->fd, 0, SEEK_SET );
 
 	return sizet;
 }
 
+#ifdef MAP_ANONYMOUS
+/*
+ * Map the view at a multiple of HUGE_PAGE_SIZE, from an anonymous mapping
+ * reserving enough room, so that huge pages can back it.
+ */
+static void *mmap_huge_aligned( size_t size, int fd, size_t offset )
+{
+	size_t pagesize = getpagesize();
+	size_t map_size = ( size + pagesize - 1 ) / pagesize * pagesize;
+	size_t reserve_size = map_size + HUGE_PAGE_SIZE;
+	char *reserve;
+	char *aligned;
+
+	reserve = mmap( 0, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	if ( reserve == MAP_FAILED )
+		return MAP_FAILED;
+	aligned = (char *) ( ( (uintptr_t) reserve + HUGE_PAGE_SIZE - 1 ) &
+		~(uintptr_t) ( HUGE_PAGE_SIZE - 1 ) );
+	if ( mmap( aligned, size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, offset ) == MAP_FAILED ) {
+		munmap( reserve, reserve_size );
+		return MAP_FAILED;
+	}
+
+	if ( aligned > reserve )
+		munmap( reserve, aligned - reserve );
+	if ( aligned + map_size < reserve + reserve_size )
+		munmap( aligned + map_size, reserve + reserve_size - ( aligned + map_size ) );
+	return aligned;
+}
+#endif
+
+/* fault in every page of the view */
+static void populate( plat_mmap *handle )
+{
+	size_t pagesize = getpagesize();
+	const volatile char *p = handle->address;
+	size_t i;
+
+#ifdef MADV_POPULATE_READ
+	if ( madvise( handle->address, handle->sizet, MADV_POPULATE_READ ) == 0 )
+		return;
+#endif
+	for ( i = 0; i < handle->sizet; i += pagesize )
+		(void) p[ i ];
+}
+
 /* obtain a view of the mapped file, return the adjusted offset & size */
 void *plat_mmap_set_view( plat_mmap *handle, size_t *offset, size_t *sizet )
 {
 	size_t pagesize = getpagesize();
 	size_t edge;
+	void *address = MAP_FAILED;
 
 	/* check error(s) */
 	if ( ! handle )
@@ -85,17 +137,73 @@ void *plat_mmap_set_view( plat_mmap *handle, size_t *offset, size_t *sizet )
 	edge = (*sizet) + (*offset);
 	(*offset) = ((size_t)((*offset) / pagesize)) * pagesize;
 	handle->sizet = (*sizet) = edge - (*offset);
-	handle->address = mmap(
+
+#ifdef MAP_ANONYMOUS
+	if ( ( FLAG_ATTRIBUTE_HUGEPAGE & handle->fAccessAttr ) &&
+		*sizet >= HUGE_PAGE_SIZE && *offset % HUGE_PAGE_SIZE == 0 )
+		address = mmap_huge_aligned( *sizet, handle->fd, *offset );
+#endif
+	if ( address == MAP_FAILED )
+		address = mmap(
 			0,
 			*sizet,
 			PROT_READ,
 			MAP_SHARED,
 			handle->fd,
 			*offset );
+	if ( address == MAP_FAILED ) {
+		handle->address = NULL;
+		return NULL;
+	}
+	handle->address = address;
+
+#ifdef MADV_HUGEPAGE
+	if ( FLAG_ATTRIBUTE_HUGEPAGE & handle->fAccessAttr )
+		madvise( handle->address, handle->sizet, MADV_HUGEPAGE );
+#endif
+	if ( FLAG_ATTRIBUTE_LOCK & handle->fAccessAttr ) {
+		/* Locking is best effort, as it is limited by RLIMIT_MEMLOCK. */
+		if ( mlock( handle->address, handle->sizet ) != 0 )
+			populate( handle );
+	} else if ( FLAG_ATTRIBUTE_POPULATE & handle->fAccessAttr ) {
+		populate( handle );
+	}
 
 	return handle->address;
 }
 
+int plat_mmap_advise( plat_mmap *handle, size_t offset, size_t size, int advice )
+{
+	size_t pagesize = getpagesize();
+	size_t begin;
+	int flag;
+
+	/* check error(s) */
+	if ( ! handle || ! handle->address || offset >= handle->sizet )
+		return -1;
+
+	switch ( advice ) {
+		case ADVICE_RANDOM:
+			flag = MADV_RANDOM;
+			break;
+		case ADVICE_SEQUENTIAL:
+			flag = MADV_SEQUENTIAL;
+			break;
+		case ADVICE_WILLNEED:
+			flag = MADV_WILLNEED;
+			break;
+		default:
+			flag = MADV_NORMAL;
+			break;
+	}
+
+	/* madvise takes whole pages. */
+	begin = offset / pagesize * pagesize;
+	if ( size > handle->sizet - offset )
+		size = handle->sizet - offset;
+	return madvise( (char *) handle->address + begin, size + offset - begin, flag ) == 0 ? 0 : -1;
+}
+
 /* close the mmap */
 void plat_mmap_close( plat_mmap *handle )
 {
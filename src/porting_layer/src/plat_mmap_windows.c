@@ -192,9 +192,28 @@ void *plat_mmap_set_view( plat_mmap *handle, size_t *offset, size_t *sizet )
 				t_sizet.LowPart );
 	}
 
+	if ( handle->address &&
+		( ( FLAG_ATTRIBUTE_POPULATE | FLAG_ATTRIBUTE_LOCK ) & handle->fAccessAttr ) ) {
+		/* Locking is best effort, as it is limited by the working set. */
+		if ( ! ( ( FLAG_ATTRIBUTE_LOCK & handle->fAccessAttr ) &&
+			VirtualLock( handle->address, *sizet ) ) ) {
+			const volatile char *p = handle->address;
+			size_t i;
+
+			for ( i = 0; i < *sizet; i += info.dwPageSize )
+				(void) p[ i ];
+		}
+	}
+
 	return handle->address;
 }
 
+/* Views are opened for random access, and take no other hint. */
+int plat_mmap_advise( plat_mmap *handle, size_t offset, size_t size, int advice )
+{
+	return -1;
+}
+
 /* close the mmap */
 void plat_mmap_close( plat_mmap *handle )
 {
@@ -20,6 +20,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "plat_types.h"
 
@@ -72,6 +73,29 @@ int get_search_path( char * path, size_t path_len )
 #error please implement get_search_path
 #endif
 
+/* stamp of a missing directory only has exist 0 */
+void get_dir_stamp( const char *path, plat_dir_stamp *stamp )
+{
+	struct stat st;
+
+	assert( path );
+	assert( stamp );
+
+	memset( stamp, 0, sizeof( *stamp ) );
+	if ( stat( path, &st ) != 0 )
+		return;
+
+	stamp->exist = 1;
+	stamp->dev = st.st_dev;
+	stamp->ino = st.st_ino;
+	stamp->mtime = st.st_mtime;
+#if defined(__APPLE__)
+	stamp->mtime_nsec = st.st_mtimespec.tv_nsec;
+#elif defined(UNDER_POSIX)
+	stamp->mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+}
+
 #ifndef HAVE_STRTOK_R
 char * strtok_r (char *s, const char *delim, char **save_ptr)
 {
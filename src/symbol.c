@@ -0,0 +1,262 @@
+/**
+ * symbol.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+/*
+ * Symbol tables are compiled from text in two passes: the first one counts
+ * entries, symbols and bytes of strings, so that the second one fills a
+ * single allocation without any limit on the length of lines.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chewing-private.h"
+#include "chewing-utf8-util.h"
+#include "symbol-private.h"
+#include "private.h"
+
+#define TABLE_AT( table, offset ) ( (char *) ( table ) + ( offset ) )
+#define TABLE_ENTRY( table ) ( (SymbolEntry *) TABLE_AT( table, ( table )->entry_offset ) )
+#define TABLE_SYMBOL( table ) ( (int *) TABLE_AT( table, ( table )->symbol_offset ) )
+#define TABLE_HASH( table ) ( (SymbolSlot *) TABLE_AT( table, ( table )->hash_offset ) )
+#define TABLE_POOL( table ) TABLE_AT( table, ( table )->pool_offset )
+
+typedef struct {
+	const char *category;
+	int category_len;
+	const char *symbols;
+	int symbols_len;
+} SymbolLine;
+
+static unsigned int HashSymbol( const char *symbol )
+{
+	unsigned int hash = 2166136261u;
+
+	for ( ; *symbol; ++symbol ) {
+		hash ^= (unsigned char) *symbol;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/* Return bytes of the character at p, which is cut by end. */
+static int SymbolBytes( const char *p, const char *end )
+{
+	int bytes = ueBytesFromChar( *p );
+
+	return bytes < end - p ? bytes : end - p;
+}
+
+/*
+ * Split the next non-empty line of text[ *pos .. len ), and return 0 if
+ * there is none. A category is cut to MAX_PHRASE_LEN characters, so that it
+ * fits a candidate.
+ */
+static int NextLine( const char *text, size_t len, size_t *pos, char separator, SymbolLine *line )
+{
+	const char *begin, *end, *sep, *p;
+	int i;
+
+	do {
+		if ( *pos >= len )
+			return 0;
+		begin = text + *pos;
+		end = memchr( begin, '\n', len - *pos );
+		if ( ! end )
+			end = text + len;
+		*pos = end - text + 1;
+		if ( end > begin && end[ -1 ] == '\r' )
+			--end;
+	} while ( end == begin );
+
+	sep = memchr( begin, separator, end - begin );
+	if ( ! sep )
+		sep = end;
+	line->category = begin;
+	line->symbols = sep < end ? sep + 1 : end;
+	line->symbols_len = end - line->symbols;
+
+	for ( i = 0, p = begin; i < MAX_PHRASE_LEN && p < sep; i++ )
+		p += SymbolBytes( p, sep );
+	line->category_len = p - begin;
+	return 1;
+}
+
+static int AddString( SymbolTable *table, int *pool_len, const char *str, int len )
+{
+	int offset = *pool_len;
+
+	memcpy( TABLE_POOL( table ) + offset, str, len );
+	TABLE_POOL( table )[ offset + len ] = '\0';
+	*pool_len += len + 1;
+	return offset;
+}
+
+static void AddHash( SymbolTable *table, int symbol, int entry )
+{
+	SymbolSlot *hash = TABLE_HASH( table );
+	const char *str = TABLE_POOL( table ) + symbol;
+	unsigned int mask = table->hash_size - 1;
+	unsigned int i = HashSymbol( str ) & mask;
+
+	/* The first entry of a symbol wins. */
+	while ( hash[ i ].symbol != -1 ) {
+		if ( ! strcmp( TABLE_POOL( table ) + hash[ i ].symbol, str ) )
+			return;
+		i = ( i + 1 ) & mask;
+	}
+	hash[ i ].symbol = symbol;
+	hash[ i ].entry = entry;
+}
+
+SymbolTable *SymbolTableFromText( const char *text, size_t len, char separator,
+	int max_key_symbols )
+{
+	SymbolTable *table;
+	SymbolEntry *entry;
+	SymbolLine line;
+	const char *p, *end;
+	size_t pos;
+	int n_entry = 0, n_symbol = 0, pool_len = 0;
+	int hash_size, bytes, i;
+	size_t size;
+
+	/* pass 1: count */
+	for ( pos = 0; NextLine( text, len, &pos, separator, &line ); ) {
+		++n_entry;
+		pool_len += line.category_len + 1;
+		end = line.symbols + line.symbols_len;
+		for ( p = line.symbols; p < end; p += bytes ) {
+			bytes = SymbolBytes( p, end );
+			++n_symbol;
+			pool_len += bytes + 1;
+		}
+	}
+	for ( hash_size = 1; hash_size < n_symbol * 2; hash_size <<= 1 )
+		;
+
+	size = sizeof( SymbolTable ) +
+		sizeof( SymbolEntry ) * n_entry +
+		sizeof( int ) * n_symbol +
+		sizeof( SymbolSlot ) * hash_size +
+		pool_len;
+	table = (SymbolTable *) ALC( char, size );
+	if ( ! table )
+		return NULL;
+
+	table->hash_size = hash_size;
+	table->entry_offset = sizeof( SymbolTable );
+	table->symbol_offset = table->entry_offset + sizeof( SymbolEntry ) * n_entry;
+	table->hash_offset = table->symbol_offset + sizeof( int ) * n_symbol;
+	table->pool_offset = table->hash_offset + sizeof( SymbolSlot ) * hash_size;
+	table->size = size;
+	for ( i = 0; i < SYMBOL_KEY_NUM; i++ )
+		table->key_index[ i ] = -1;
+	for ( i = 0; i < hash_size; i++ )
+		TABLE_HASH( table )[ i ].symbol = -1;
+
+	/* pass 2: fill */
+	entry = TABLE_ENTRY( table );
+	pool_len = 0;
+	for ( pos = 0; NextLine( text, len, &pos, separator, &line ); ) {
+		entry->category = AddString( table, &pool_len, line.category, line.category_len );
+		entry->symbol_begin = table->n_symbol;
+		end = line.symbols + line.symbols_len;
+		for ( p = line.symbols; p < end; p += bytes ) {
+			bytes = SymbolBytes( p, end );
+			TABLE_SYMBOL( table )[ table->n_symbol ] = AddString( table, &pool_len, p, bytes );
+			AddHash( table, TABLE_SYMBOL( table )[ table->n_symbol ], table->n_entry );
+			++table->n_symbol;
+		}
+		entry->symbol_end = table->n_symbol;
+
+		if ( line.category_len == 1 &&
+			(unsigned char) line.category[ 0 ] < SYMBOL_KEY_NUM &&
+			entry->symbol_end > entry->symbol_begin &&
+			( max_key_symbols == 0 ||
+			  entry->symbol_end - entry->symbol_begin <= max_key_symbols ) )
+			table->key_index[ (unsigned char) line.category[ 0 ] ] = table->n_entry;
+
+		++entry;
+		++table->n_entry;
+	}
+	return table;
+}
+
+SymbolTable *SymbolTableFromFile( const char *filename, char separator,
+	int max_key_symbols )
+{
+	SymbolTable *table = NULL;
+	FILE *file;
+	char *text = NULL;
+	long len;
+
+	file = fopen( filename, "r" );
+	if ( ! file )
+		return NULL;
+
+	if ( fseek( file, 0, SEEK_END ) || ( len = ftell( file ) ) < 0 ||
+		fseek( file, 0, SEEK_SET ) )
+		goto end;
+
+	text = ALC( char, len + 1 );
+	if ( ! text )
+		goto end;
+	len = fread( text, 1, len, file );
+
+	table = SymbolTableFromText( text, len, separator, max_key_symbols );
+end:
+	free( text );
+	fclose( file );
+	return table;
+}
+
+const char *SymbolCategory( const SymbolTable *table, int entry )
+{
+	return TABLE_POOL( table ) + TABLE_ENTRY( table )[ entry ].category;
+}
+
+/* Return number of symbols in entry. */
+int SymbolNum( const SymbolTable *table, int entry )
+{
+	return TABLE_ENTRY( table )[ entry ].symbol_end -
+		TABLE_ENTRY( table )[ entry ].symbol_begin;
+}
+
+/* Return the i-th symbol of entry. */
+const char *SymbolString( const SymbolTable *table, int entry, int i )
+{
+	return TABLE_POOL( table ) +
+		TABLE_SYMBOL( table )[ TABLE_ENTRY( table )[ entry ].symbol_begin + i ];
+}
+
+/* Return the entry of key, or -1. */
+int SymbolFindKey( const SymbolTable *table, int key )
+{
+	if ( key < 0 || key >= SYMBOL_KEY_NUM )
+		return -1;
+	return table->key_index[ key ];
+}
+
+/* Return the first entry having symbol, or -1. */
+int SymbolFindEntry( const SymbolTable *table, const char *symbol )
+{
+	const SymbolSlot *hash = TABLE_HASH( table );
+	unsigned int mask = table->hash_size - 1;
+	unsigned int i = HashSymbol( symbol ) & mask;
+
+	while ( hash[ i ].symbol != -1 ) {
+		if ( ! strcmp( TABLE_POOL( table ) + hash[ i ].symbol, symbol ) )
+			return hash[ i ].entry;
+		i = ( i + 1 ) & mask;
+	}
+	return -1;
+}
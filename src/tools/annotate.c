@@ -0,0 +1,348 @@
+/**
+ * annotate.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+/*
+ * Annotate Chinese text with bopomofo, phone ids, or keystrokes of the
+ * default layout in the format of materials.txt. Input is read in chunks of
+ * whole lines, and the chunks of one round are annotated in parallel, each by
+ * its own thread and context. Output keeps the order of input.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "chewing.h"
+#include "chewing-private.h"
+#include "chewing-utf8-util.h"
+#include "key2pho-private.h"
+
+#define CHUNK_SIZE	( 1 << 20 )
+#define MAX_THREAD_NUM	64
+#define DEFAULT_THREAD_NUM	4
+
+/* Keys of the default layout, in the order of zhuin_tab in key2pho.c */
+static const char *DEFAULT_KEY[] = {
+	"1qaz2wsxedcrfv5tgbyhn",	/* ㄅㄆㄇㄈㄉㄊㄋㄌㄍㄎㄏㄐㄑㄒㄓㄔㄕㄖㄗㄘㄙ */
+	"ujm",				/* ㄧㄨㄩ */
+	"8ik,9ol.0p;/-",		/* ㄚㄛㄜㄝㄞㄟㄠㄡㄢㄣㄤㄥㄦ */
+	"7634",				/* ˙ˊˇˋ */
+};
+
+static const char USAGE[] =
+	"usage: %s [-f bopomofo|phone|keystroke] [-t threads] [-d datadir] [file]\n"
+	"Annotate text from file, or standard input, with readings in the dictionary\n"
+	"in datadir, or else in CHEWING_PATH.\n"
+	"  bopomofo   bopomofo of each character (default)\n"
+	"  phone      phone id of each character, 0 if it has no reading\n"
+	"  keystroke  keystrokes of the default layout and the text, as materials.txt.\n"
+	"             Lines with a character without reading are skipped.\n"
+	"Throughput is reported to standard error.\n";
+
+typedef enum {
+	FORMAT_BOPOMOFO,
+	FORMAT_PHONE,
+	FORMAT_KEYSTROKE,
+} Format;
+
+typedef struct {
+	char *data;
+	size_t len;
+	size_t max;
+} Buffer;
+
+typedef struct {
+	pthread_t thread;
+	ChewingContext *ctx;
+	Format format;
+	Buffer input;
+	Buffer output;
+	unsigned short *phone;
+	int phone_max;
+	long skipped;
+	int error;
+} Worker;
+
+static int reserve( Buffer *buf, size_t len )
+{
+	char *data;
+	size_t max;
+
+	if ( buf->len + len + 1 <= buf->max )
+		return 0;
+
+	for ( max = buf->max ? buf->max : 4096; max < buf->len + len + 1; max *= 2 )
+		;
+	data = realloc( buf->data, max );
+	if ( !data )
+		return -1;
+	buf->data = data;
+	buf->max = max;
+	return 0;
+}
+
+static int append( Buffer *buf, const char *str, size_t len )
+{
+	if ( reserve( buf, len ) )
+		return -1;
+	memcpy( buf->data + buf->len, str, len );
+	buf->len += len;
+	buf->data[ buf->len ] = '\0';
+	return 0;
+}
+
+/* Read whole lines of at least CHUNK_SIZE bytes, unless input ends. */
+static int read_chunk( FILE *input, Buffer *buf )
+{
+	char line[ 4096 ];
+
+	buf->len = 0;
+	while ( buf->len < CHUNK_SIZE ||
+		( buf->len > 0 && buf->data[ buf->len - 1 ] != '\n' ) ) {
+		if ( !fgets( line, sizeof( line ), input ) )
+			break;
+		if ( append( buf, line, strlen( line ) ) )
+			return -1;
+	}
+	return buf->len > 0;
+}
+
+static int append_keystroke( Buffer *buf, unsigned short phone )
+{
+	int inx[ ZUIN_SIZE ];
+	char key[ ZUIN_SIZE ];
+	int len = 0;
+	int i;
+
+	PhoneInxFromUint( inx, phone );
+	for ( i = 0; i < ZUIN_SIZE - 1; i++ ) {
+		if ( inx[ i ] )
+			key[ len++ ] = DEFAULT_KEY[ i ][ inx[ i ] - 1 ];
+	}
+	/* The first tone is typed by space */
+	key[ len++ ] = inx[ ZUIN_SIZE - 1 ] ? DEFAULT_KEY[ ZUIN_SIZE - 1 ][ inx[ ZUIN_SIZE - 1 ] - 1 ] : ' ';
+	return append( buf, key, len );
+}
+
+/* Bytes of the character at p, in the same way as chewing_annotate_Phone */
+static int char_bytes( const char *p )
+{
+	int bytes = ueBytesFromChar( *p );
+	int i;
+
+	for ( i = 1; i < bytes && p[ i ]; i++ )
+		;
+	return i;
+}
+
+static int annotate_line( Worker *worker, const char *line )
+{
+	char buf[ MAX_UTF8_SIZE * ZUIN_SIZE + 1 ];
+	const char *p;
+	int len;
+	int bytes;
+	int i;
+	int ret = 0;
+
+	len = strlen( line ) + 1;
+	if ( len > worker->phone_max ) {
+		free( worker->phone );
+		worker->phone = calloc( len, sizeof( unsigned short ) );
+		worker->phone_max = worker->phone ? len : 0;
+		if ( !worker->phone )
+			return -1;
+	}
+
+	len = chewing_annotate_Phone( worker->ctx, line, worker->phone, worker->phone_max );
+	if ( len < 0 )
+		return -1;
+
+	switch ( worker->format ) {
+	case FORMAT_BOPOMOFO:
+		for ( i = 0, p = line; i < len; i++, p += bytes ) {
+			bytes = char_bytes( p );
+			if ( i > 0 )
+				ret |= append( &worker->output, " ", 1 );
+			if ( worker->phone[ i ] ) {
+				PhoneFromUint( buf, sizeof( buf ), worker->phone[ i ] );
+				ret |= append( &worker->output, buf, strlen( buf ) );
+			}
+			else {
+				ret |= append( &worker->output, p, bytes );
+			}
+		}
+		break;
+	case FORMAT_PHONE:
+		for ( i = 0; i < len; i++ ) {
+			snprintf( buf, sizeof( buf ), i > 0 ? " %hu" : "%hu", worker->phone[ i ] );
+			ret |= append( &worker->output, buf, strlen( buf ) );
+		}
+		break;
+	case FORMAT_KEYSTROKE:
+		for ( i = 0; i < len; i++ ) {
+			if ( !worker->phone[ i ] )
+				break;
+		}
+		if ( len == 0 || i < len ) {
+			++worker->skipped;
+			return 0;
+		}
+		for ( i = 0; i < len; i++ )
+			ret |= append_keystroke( &worker->output, worker->phone[ i ] );
+		ret |= append( &worker->output, "<E>\t", 4 );
+		ret |= append( &worker->output, line, strlen( line ) );
+		break;
+	}
+	ret |= append( &worker->output, "\n", 1 );
+	return ret;
+}
+
+static void *annotate_chunk( void *arg )
+{
+	Worker *worker = (Worker *) arg;
+	char *line;
+	char *end;
+
+	worker->output.len = 0;
+	for ( line = worker->input.data; line < worker->input.data + worker->input.len; line = end + 1 ) {
+		end = strchr( line, '\n' );
+		if ( !end )
+			end = line + strlen( line );
+		*end = '\0';
+		if ( end > line && end[ -1 ] == '\r' )
+			end[ -1 ] = '\0';
+
+		if ( annotate_line( worker, line ) ) {
+			worker->error = 1;
+			break;
+		}
+	}
+	return NULL;
+}
+
+static double now()
+{
+	struct timeval tv;
+
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main( int argc, char *argv[] )
+{
+	Worker worker[ MAX_THREAD_NUM ];
+	Format format = FORMAT_BOPOMOFO;
+	int thread_num = DEFAULT_THREAD_NUM;
+	FILE *input = stdin;
+	double start, elapsed;
+	double total = 0;
+	long skipped = 0;
+	int num;
+	int ret = 0;
+	int i;
+
+	for ( i = 1; i < argc; i++ ) {
+		if ( !strcmp( argv[ i ], "-f" ) && i + 1 < argc ) {
+			++i;
+			if ( !strcmp( argv[ i ], "bopomofo" ) )
+				format = FORMAT_BOPOMOFO;
+			else if ( !strcmp( argv[ i ], "phone" ) )
+				format = FORMAT_PHONE;
+			else if ( !strcmp( argv[ i ], "keystroke" ) )
+				format = FORMAT_KEYSTROKE;
+			else
+				goto usage;
+		}
+		else if ( !strcmp( argv[ i ], "-d" ) && i + 1 < argc ) {
+			if ( setenv( "CHEWING_PATH", argv[ ++i ], 1 ) ) {
+				fprintf( stderr, "Cannot set CHEWING_PATH\n" );
+				return 1;
+			}
+		}
+		else if ( !strcmp( argv[ i ], "-t" ) && i + 1 < argc ) {
+			thread_num = atoi( argv[ ++i ] );
+			if ( thread_num < 1 || thread_num > MAX_THREAD_NUM )
+				goto usage;
+		}
+		else if ( argv[ i ][ 0 ] == '-' || input != stdin ) {
+			goto usage;
+		}
+		else {
+			input = fopen( argv[ i ], "r" );
+			if ( !input ) {
+				fprintf( stderr, "Cannot open %s\n", argv[ i ] );
+				return 1;
+			}
+		}
+	}
+
+	memset( worker, 0, sizeof( worker ) );
+	for ( i = 0; i < thread_num; i++ ) {
+		worker[ i ].ctx = chewing_new();
+		if ( !worker[ i ].ctx ) {
+			fprintf( stderr, "Cannot load dictionary, use -d or CHEWING_PATH\n" );
+			return 1;
+		}
+		worker[ i ].format = format;
+	}
+
+	start = now();
+	do {
+		for ( num = 0; num < thread_num; num++ ) {
+			ret = read_chunk( input, &worker[ num ].input );
+			if ( ret <= 0 )
+				break;
+			total += worker[ num ].input.len;
+			if ( pthread_create( &worker[ num ].thread, NULL, annotate_chunk, &worker[ num ] ) ) {
+				fprintf( stderr, "pthread_create failed\n" );
+				return 1;
+			}
+		}
+
+		for ( i = 0; i < num; i++ ) {
+			pthread_join( worker[ i ].thread, NULL );
+			if ( worker[ i ].error )
+				ret = -1;
+			else
+				fwrite( worker[ i ].output.data, 1, worker[ i ].output.len, stdout );
+		}
+	} while ( ret > 0 );
+	elapsed = now() - start;
+
+	for ( i = 0; i < thread_num; i++ ) {
+		skipped += worker[ i ].skipped;
+		chewing_delete( worker[ i ].ctx );
+		free( worker[ i ].input.data );
+		free( worker[ i ].output.data );
+		free( worker[ i ].phone );
+	}
+	if ( input != stdin )
+		fclose( input );
+
+	if ( ret < 0 ) {
+		fprintf( stderr, "Out of memory\n" );
+		return 1;
+	}
+	if ( format == FORMAT_KEYSTROKE )
+		fprintf( stderr, "%ld lines skipped\n", skipped );
+	fprintf( stderr, "%.0f bytes in %.3f s with %d threads, %.2f MB/s\n",
+		total, elapsed, thread_num, elapsed > 0 ? total / elapsed / 1e6 : 0 );
+	return 0;
+
+usage:
+	fprintf( stderr, USAGE, argv[ 0 ] );
+	return 1;
+}
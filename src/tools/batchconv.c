@@ -0,0 +1,512 @@
+/**
+ * batchconv.c
+ *
+ * Copyright (c) 2012
+ *      libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+/*
+ * Convert a large file of bopomofo (or phone id) lines to Chinese text with
+ * several worker threads.
+ *
+ * All workers share one read-only instance of the system dictionary and phone
+ * tree. Input lines are split into small tasks which are dealt to per-worker
+ * deques; an idle worker steals from the head of another worker's deque, so
+ * that a few very long lines cannot leave the other cores idle. Converted text
+ * is kept in a per-worker arena and written in input order after all workers
+ * finish.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chewing-private.h"
+#include "global-private.h"
+#include "dict-private.h"
+#include "tree-private.h"
+#include "key2pho-private.h"
+#include "plat_mmap.h"
+#include "plat_path.h"
+
+#define TASK_LINES		(16)
+#define ARENA_BLOCK_SIZE	(1024 * 1024)
+#define MAX_TOKEN_LEN		(64)
+
+const char USAGE[] =
+	"usage: %s [-j threads] [-d datadir] <input> [output]\n"
+	"Convert each line of <input> to Chinese text.\n"
+	"Every line is a sequence of bopomofo syllables or phone ids separated\n"
+	"by spaces. The converted text is written to [output] or stdout, and\n"
+	"throughput and per-line latency are reported to stderr.\n"
+;
+
+static const char * const DATA_FILES[] = {
+#ifdef USE_BINARY_DATA
+	DICTIONARY_FILE,
+#else
+	CHAR_FILE,
+	CHAR_INDEX_FILE,
+	DICT_FILE,
+	PH_INDEX_FILE,
+	PHONE_TREE_FILE,
+#endif
+	NULL,
+};
+
+struct Line {
+	const char *begin;
+	size_t len;
+	char *out;
+	size_t out_len;
+	double latency;
+};
+
+struct Task {
+	int begin;
+	int end;
+};
+
+struct Deque {
+	pthread_mutex_t lock;
+	struct Task *task;
+	int head;
+	int tail;
+};
+
+struct ArenaBlock {
+	struct ArenaBlock *next;
+	size_t used;
+	char buf[];
+};
+
+struct Worker {
+	pthread_t thread;
+	int id;
+	ChewingData *data;
+	struct Deque deque;
+	struct ArenaBlock *arena;
+	int num_line;
+	int num_stolen;
+};
+
+static struct Line *line;
+static int num_line;
+static struct Worker *worker;
+static int num_worker;
+static const char *data_path;
+
+static double now()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *arena_alloc(struct Worker *w, size_t size)
+{
+	struct ArenaBlock *block;
+	size_t block_size;
+
+	if (!w->arena || w->arena->used + size > ARENA_BLOCK_SIZE) {
+		block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+		block = malloc(sizeof(*block) + block_size);
+		if (!block) {
+			fprintf(stderr, "Out of memory\n");
+			exit(-1);
+		}
+		block->next = w->arena;
+		block->used = 0;
+		w->arena = block;
+	}
+
+	w->arena->used += size;
+	return w->arena->buf + w->arena->used - size;
+}
+
+static void arena_free(struct Worker *w)
+{
+	struct ArenaBlock *block;
+
+	while (w->arena) {
+		block = w->arena;
+		w->arena = block->next;
+		free(block);
+	}
+}
+
+static int deque_pop_tail(struct Deque *d, struct Task *task)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&d->lock);
+	if (d->head < d->tail) {
+		*task = d->task[--d->tail];
+		ret = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return ret;
+}
+
+/* Return -1 when the deque is locked by someone else. */
+static int deque_steal_head(struct Deque *d, struct Task *task)
+{
+	int ret = 0;
+
+	if (pthread_mutex_trylock(&d->lock))
+		return -1;
+	if (d->head < d->tail) {
+		*task = d->task[d->head++];
+		ret = 1;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return ret;
+}
+
+static int get_task(struct Worker *w, struct Task *task)
+{
+	int i;
+	int ret;
+	int busy;
+
+	if (deque_pop_tail(&w->deque, task))
+		return 1;
+
+	/* Retry as long as a victim was locked, it may still have tasks. */
+	do {
+		busy = 0;
+		for (i = 1; i < num_worker; ++i) {
+			ret = deque_steal_head(&worker[(w->id + i) % num_worker].deque, task);
+			if (ret > 0) {
+				++w->num_stolen;
+				return 1;
+			}
+			if (ret < 0)
+				busy = 1;
+		}
+	} while (busy);
+
+	return 0;
+}
+
+static uint16_t token_to_phone(const char *token)
+{
+	char *end;
+	long val;
+
+	if (token[0] >= '0' && token[0] <= '9') {
+		errno = 0;
+		val = strtol(token, &end, 10);
+		if (errno || *end || val <= 0 || val > UINT16_MAX)
+			return 0;
+		return (uint16_t) val;
+	}
+	return UintFromPhone(token);
+}
+
+/* Convert phoneSeq in pgdata and append the result to buf. */
+static size_t flush_phone_seq(ChewingData *pgdata, char *buf, size_t pos)
+{
+	size_t len;
+
+	if (pgdata->nPhoneSeq == 0)
+		return pos;
+
+	pgdata->phrOut.nNumCut = 0;
+	Phrasing(pgdata);
+
+	len = strlen(pgdata->phrOut.chiBuf);
+	memcpy(buf + pos, pgdata->phrOut.chiBuf, len);
+	pgdata->nPhoneSeq = 0;
+
+	return pos + len;
+}
+
+static void convert_line(struct Worker *w, struct Line *l)
+{
+	ChewingData *pgdata = w->data;
+	char token[MAX_TOKEN_LEN];
+	char *buf;
+	size_t pos = 0;
+	size_t i = 0;
+	size_t len;
+	uint16_t phone;
+
+	/*
+	 * Every syllable (at least 1 byte plus a separator) produces at most
+	 * one character, so this bounds the output of the line.
+	 */
+	buf = arena_alloc(w, (l->len + 1) * MAX_UTF8_SIZE + 1);
+
+	while (i < l->len) {
+		while (i < l->len && (l->begin[i] == ' ' || l->begin[i] == '\t'))
+			++i;
+		for (len = 0; i < l->len && l->begin[i] != ' ' && l->begin[i] != '\t'; ++i) {
+			if (len < sizeof(token) - 1)
+				token[len++] = l->begin[i];
+		}
+		if (len == 0)
+			break;
+		token[len] = '\0';
+
+		phone = token_to_phone(token);
+		if (phone == 0) {
+			/* An unknown syllable breaks the sentence. */
+			pos = flush_phone_seq(pgdata, buf, pos);
+			buf[pos++] = '?';
+			continue;
+		}
+
+		pgdata->phoneSeq[pgdata->nPhoneSeq++] = phone;
+		if (pgdata->nPhoneSeq == MAX_PHONE_SEQ_LEN - 1)
+			pos = flush_phone_seq(pgdata, buf, pos);
+	}
+	pos = flush_phone_seq(pgdata, buf, pos);
+
+	l->out = buf;
+	l->out_len = pos;
+}
+
+static void *worker_main(void *arg)
+{
+	struct Worker *w = (struct Worker *) arg;
+	struct Task task;
+	double start;
+	int i;
+
+	while (get_task(w, &task)) {
+		for (i = task.begin; i < task.end; ++i) {
+			start = now();
+			convert_line(w, &line[i]);
+			line[i].latency = now() - start;
+			++w->num_line;
+		}
+	}
+
+	return NULL;
+}
+
+static void read_lines(const char *filename, plat_mmap *m)
+{
+	size_t size;
+	size_t offset = 0;
+	const char *buf;
+	const char *p;
+	const char *end;
+	int capacity = 1024;
+
+	plat_mmap_set_invalid(m);
+	size = plat_mmap_create(m, filename, FLAG_ATTRIBUTE_READ);
+	if (!plat_mmap_is_valid(m)) {
+		fprintf(stderr, "Error opening the file %s\n", filename);
+		exit(-1);
+	}
+
+	line = calloc(capacity, sizeof(*line));
+	if (!line) {
+		fprintf(stderr, "Out of memory\n");
+		exit(-1);
+	}
+	if (size == 0)
+		return;
+
+	buf = plat_mmap_set_view(m, &offset, &size);
+	if (!buf) {
+		fprintf(stderr, "Cannot map the file %s\n", filename);
+		exit(-1);
+	}
+
+	for (p = buf; p < buf + size; p = end + 1) {
+		end = memchr(p, '\n', buf + size - p);
+		if (!end)
+			end = buf + size;
+
+		if (num_line == capacity) {
+			capacity *= 2;
+			line = realloc(line, capacity * sizeof(*line));
+			if (!line) {
+				fprintf(stderr, "Out of memory\n");
+				exit(-1);
+			}
+		}
+		memset(&line[num_line], 0, sizeof(line[0]));
+		line[num_line].begin = p;
+		line[num_line].len = end - p;
+		if (line[num_line].len && p[line[num_line].len - 1] == '\r')
+			--line[num_line].len;
+		++num_line;
+	}
+}
+
+static void deal_tasks()
+{
+	int num_task;
+	int i;
+	struct Deque *d;
+
+	num_task = (num_line + TASK_LINES - 1) / TASK_LINES;
+	for (i = 0; i < num_worker; ++i) {
+		d = &worker[i].deque;
+		pthread_mutex_init(&d->lock, NULL);
+		d->task = calloc(num_task / num_worker + 1, sizeof(*d->task));
+		if (!d->task) {
+			fprintf(stderr, "Out of memory\n");
+			exit(-1);
+		}
+	}
+
+	/* Deal consecutive tasks round robin, so each deque gets a fair mix. */
+	for (i = 0; i < num_task; ++i) {
+		d = &worker[i % num_worker].deque;
+		d->task[d->tail].begin = i * TASK_LINES;
+		d->task[d->tail].end = (i + 1) * TASK_LINES < num_line ? (i + 1) * TASK_LINES : num_line;
+		++d->tail;
+	}
+}
+
+static int compare_latency(const void *x, const void *y)
+{
+	double a = *(const double *) x;
+	double b = *(const double *) y;
+
+	return (a > b) - (a < b);
+}
+
+static void report(double elapsed)
+{
+	double *latency;
+	int i;
+
+	fprintf(stderr, "%d lines, %d threads, %.3f s, %.0f lines/s\n",
+		num_line, num_worker, elapsed, elapsed > 0 ? num_line / elapsed : 0);
+
+	if (num_line == 0)
+		return;
+
+	latency = calloc(num_line, sizeof(*latency));
+	if (!latency)
+		return;
+	for (i = 0; i < num_line; ++i)
+		latency[i] = line[i].latency;
+	qsort(latency, num_line, sizeof(latency[0]), compare_latency);
+
+	fprintf(stderr, "latency per line: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+		latency[num_line / 2] * 1e6,
+		latency[(int) (num_line * 0.99)] * 1e6,
+		latency[num_line - 1] * 1e6);
+	for (i = 0; i < num_worker; ++i) {
+		fprintf(stderr, "thread %d: %d lines, %d tasks stolen\n",
+			i, worker[i].num_line, worker[i].num_stolen);
+	}
+	free(latency);
+}
+
+int main(int argc, char *argv[])
+{
+	char search_path[PATH_MAX];
+	char path[PATH_MAX];
+	plat_mmap input_mmap;
+	FILE *output = stdout;
+	double start;
+	double elapsed;
+	int opt;
+	int i;
+
+	num_worker = sysconf(_SC_NPROCESSORS_ONLN);
+	while ((opt = getopt(argc, argv, "j:d:h")) != -1) {
+		switch (opt) {
+		case 'j':
+			num_worker = atoi(optarg);
+			break;
+		case 'd':
+			data_path = optarg;
+			break;
+		default:
+			printf(USAGE, argv[0]);
+			return -1;
+		}
+	}
+	if (optind >= argc || argc - optind > 2 || num_worker <= 0) {
+		printf(USAGE, argv[0]);
+		return -1;
+	}
+
+	if (!data_path) {
+		if (get_search_path(search_path, sizeof(search_path)) ||
+			find_path_by_files(search_path, DATA_FILES, path, sizeof(path))) {
+			fprintf(stderr, "Cannot find dictionary, use -d or CHEWING_PATH\n");
+			return -1;
+		}
+		data_path = path;
+	}
+
+	if (argc - optind == 2) {
+		output = fopen(argv[optind + 1], "w");
+		if (!output) {
+			fprintf(stderr, "Cannot open output file.\n");
+			return -1;
+		}
+	}
+
+	read_lines(argv[optind], &input_mmap);
+
+	worker = calloc(num_worker, sizeof(*worker));
+	if (!worker) {
+		fprintf(stderr, "Out of memory\n");
+		return -1;
+	}
+	for (i = 0; i < num_worker; ++i) {
+		worker[i].id = i;
+		worker[i].data = calloc(1, sizeof(ChewingData));
+		if (!worker[i].data) {
+			fprintf(stderr, "Out of memory\n");
+			return -1;
+		}
+		worker[i].data->static_data.sys_dict = AcquireSystemDict(data_path);
+		if (!worker[i].data->static_data.sys_dict) {
+			fprintf(stderr, "Cannot load dictionary from %s\n", data_path);
+			return -1;
+		}
+	}
+	deal_tasks();
+
+	start = now();
+	for (i = 0; i < num_worker; ++i) {
+		if (pthread_create(&worker[i].thread, NULL, worker_main, &worker[i])) {
+			fprintf(stderr, "Cannot create thread\n");
+			return -1;
+		}
+	}
+	for (i = 0; i < num_worker; ++i)
+		pthread_join(worker[i].thread, NULL);
+	elapsed = now() - start;
+
+	for (i = 0; i < num_line; ++i) {
+		fwrite(line[i].out, 1, line[i].out_len, output);
+		fputc('\n', output);
+	}
+	if (output != stdout)
+		fclose(output);
+
+	report(elapsed);
+
+	for (i = 0; i < num_worker; ++i) {
+		ReleaseSystemDict(worker[i].data->static_data.sys_dict);
+		free(worker[i].data);
+		free(worker[i].deque.task);
+		pthread_mutex_destroy(&worker[i].deque.lock);
+		arena_free(&worker[i]);
+	}
+	free(worker);
+	free(line);
+	plat_mmap_close(&input_mmap);
+
+	return 0;
+}
@@ -17,198 +17,309 @@
  *
  * @brief Phone phrase tree generator.\n
  *
- *	  This program reads in a dictionary with phone phrases(in uint16_t form).\n
+ *	  MakeTree() takes the phrases of sort, in uint16_t form.\n
  *	  Output a database file which indicates a phone phrase tree.\n
  *	  Each node represents a single phone.\n
  *	  The output file was a random access file, a record was defined:\n\code
- *	  { 
+ *	  {
  *		 uint16_t key; the phone data
- *		 int32 phraseno; 
+ *		 int32 phraseno;
  *		 int32 begin,end; //the children of this node(-1,-1 indicate a leaf node)
  *	  }\endcode
+ *
+ *	  It also outputs an abbreviation tree keyed on the initial of each
+ *	  phone only, so that phrases can be found by their initials without
+ *	  scanning the phone phrase tree. A record of the tree is:\n\code
+ *	  {
+ *		 uint16_t key; the initial
+ *		 int32 begin,end; //the posting list of this node
+ *		 int32 begin,end; //the children of this node(-1,-1 indicate a leaf node)
+ *	  }\endcode
+ *	  The posting lists are stored in another file, as phrase numbers
+ *	  in the phrase index file.\n
+ *
+ *	  For prediction, it also outputs the PREDICT_TOP_K most frequent
+ *	  phrases below each node of the phone phrase tree, as offsets in the
+ *	  phrase file. The phrases of node n are
+ *	  predict[ begin[ n ] .. begin[ n + 1 ] ), where begin is stored in
+ *	  another file with one more entry than the tree.\n
+ *
+ *	  Both trees are built level by level from sorted keys, in one pass.
+ *	  The nodes of a level are in level-order, which is the order of
+ *	  their paths from the root, so a node only differs from the previous
+ *	  key after their common prefix. Nodes are kept in an array for each
+ *	  level, and the trees are written level by level.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <assert.h>
+#include <string.h>
 #include "global.h"
 #include "global-private.h"
 #include "chewing-private.h"
 #include "config.h"
+#include "maketree.h"
 
 /*
-	defines
-*/
-#define MAX_PH_NODE	6400000
-#define IN_FILE		"phoneid.dic"
-
-/* 
-	typedefs 
+	typedefs
 */
 typedef int int32;
 
-/* Forward declaration */
-struct _tLISTNODE;
+typedef struct {
+	int32 pos, freq;
+} PREDICTION;
 
-typedef struct _tNODE {
-	struct _tLISTNODE *childList;
+typedef struct {
 	uint16_t key;
-	int32 phraseno,nodeno;
+	/* phrase number, or -1 */
+	int32 phraseno;
+	/* the keys which end at this node */
+	int32 begin, end;
+	/* the children of this node in the next level, or -1 */
+	int32 child_begin, child_end;
+	/* most frequent phrases below this node, in predict */
+	int32 predict_begin;
+	int nPredict;
 } NODE;
 
-typedef struct _tLISTNODE {
-	struct _tNODE *pNode;
-	struct _tLISTNODE *next;
-} LISTNODE;
+typedef struct {
+	NODE *node;
+	int num, max;
+} LEVEL;
+
+/* initials of a phrase, for the abbreviation tree */
+typedef struct {
+	uint16_t key[ MAX_PHRASE_LEN ];
+	int len;
+	int32 phraseno;
+} ABBRKEY;
+
+/* Return the length of the key of entry, which is stored to *key. */
+typedef int (*KEYFUNC)( const void *entry, const uint16_t **key );
 
 /*
 	global data
  */
-NODE *root;
-int32 ph_count;
+LEVEL tree_level[ MAX_PHRASE_LEN + 1 ];
+int tree_depth;
+int node_count;
 
-NODE *queue[ MAX_PH_NODE ];
-int head, tail;
+PREDICTION *predict;
+int predict_count, max_predict;
 
-int node_count;
-int tree_size;
+ABBRKEY *abbr_key;
+LEVEL abbr_level[ MAX_PHRASE_LEN + 1 ];
+int abbr_depth;
+int abbr_node_count;
 
-void QueuePut( NODE *pN )
+void *Grow( void *data, int *max, int num, size_t size )
 {
-	queue[ head++ ] = pN;
-	if ( head == MAX_PH_NODE ) {
-		fprintf( stderr, "Queue size is not enough!\n" );
+	if ( num < *max )
+		return data;
+
+	*max = *max ? *max * 2 : 1024;
+	data = realloc( data, size * *max );
+	if ( ! data ) {
+		fprintf( stderr, "Out of memory\n" );
 		exit( 1 );
 	}
+	return data;
 }
 
-NODE* QueueGet()
+int NewNode( LEVEL *level, uint16_t key )
 {
-	assert( head != tail );
-	return queue[ tail++ ];
-}
-
-int QueueEmpty()
-{
-	return ( head == tail );
-}
+	NODE *pnew;
 
-NODE *NewNode( uint16_t key )
-{
-	NODE *pnew = (NODE *) malloc( sizeof( NODE ) );
+	level->node = (NODE *) Grow( level->node, &level->max, level->num, sizeof( NODE ) );
+	pnew = &level->node[ level->num ];
 	pnew->key = key;
-	pnew->childList = NULL;
 	pnew->phraseno = -1;
-	pnew->nodeno = -1;
-	return pnew;
+	pnew->begin = pnew->end = 0;
+	pnew->child_begin = pnew->child_end = -1;
+	pnew->predict_begin = 0;
+	pnew->nPredict = 0;
+	return level->num++;
 }
 
-void InitConstruct()
+/*
+ * Add the keys of num entries to levels, whose nodes shall be empty. The keys
+ * shall be sorted, and entries with the same key shall be next to each other.
+ * Each different key is numbered as phraseno of its node. Return the number
+ * of different keys, and the depth of the tree in *depth.
+ */
+int Construct( const void *entry, size_t size, int num, KEYFUNC KeyOf, LEVEL level[], int *depth )
 {
+	const uint16_t *key, *prev_key = NULL;
+	int path[ MAX_PHRASE_LEN + 1 ];
+	int len, prev_len = 0;
+	int key_count = 0;
+	int common;
+	int i, d;
+	NODE *parent, *pNode;
+
 	/* root has special key value 0 */
-	root = NewNode( 0 );
-}
+	path[ 0 ] = NewNode( &level[ 0 ], 0 );
+	*depth = 0;
+
+	for ( i = 0; i < num; i++, prev_key = key, prev_len = len ) {
+		len = KeyOf( (const char *) entry + i * size, &key );
+		if ( len < 1 || len > MAX_PHRASE_LEN ) {
+			fprintf( stderr, "phrase length %d is not in 1 .. %d\n", len, MAX_PHRASE_LEN );
+			exit( 1 );
+		}
 
-NODE* FindKey( NODE *pN, uint16_t key )
-{
-	LISTNODE *p;
+		for ( common = 0; common < len && common < prev_len &&
+			key[ common ] == prev_key[ common ]; common++ )
+			;
+		if ( common == len && common == prev_len ) {
+			/* the same key as the previous entry */
+			level[ len ].node[ path[ len ] ].end = i + 1;
+			continue;
+		}
+		if ( i > 0 && ( common == len || ( common < prev_len && key[ common ] < prev_key[ common ] ) ) ) {
+			fprintf( stderr, "phrases are not sorted by phone\n" );
+			exit( 1 );
+		}
 
-	for ( p = pN->childList; p; p = p->next ) {
-		if ( p->pNode->key == key )
-			return p->pNode;
+		for ( d = common + 1; d <= len; d++ ) {
+			path[ d ] = NewNode( &level[ d ], key[ d - 1 ] );
+			parent = &level[ d - 1 ].node[ path[ d - 1 ] ];
+			if ( parent->child_begin == -1 )
+				parent->child_begin = path[ d ];
+			parent->child_end = path[ d ];
+		}
+		pNode = &level[ len ].node[ path[ len ] ];
+		pNode->phraseno = key_count++;
+		pNode->begin = i;
+		pNode->end = i + 1;
+		if ( len > *depth )
+			*depth = len;
 	}
-	return NULL;
+	return key_count;
 }
 
-NODE* Insert( NODE *pN, uint16_t key )
+/* Return the number of the first node of each level in level-order. */
+int NumberLevels( LEVEL level[], int depth, int32 offset[] )
 {
-	LISTNODE *prev, *p;
-	LISTNODE *pnew = (LISTNODE *) malloc( sizeof( LISTNODE ) );
-	NODE *pnode = NewNode( key );
-	
-	pnew->pNode = pnode;
-	pnew->next  = NULL;
-
-	prev = pN->childList;
-	if ( ! prev ) {
-		pN->childList = pnew;
-	}
-	else {
-		for ( 
-			p = prev->next;
-			(p) && (p->pNode->key < key);
-			prev = p, p = p->next )
-			;
-		prev->next = pnew;
-		pnew->next = p;
-	}
-	return pnode;
+	int d;
+
+	offset[ 0 ] = 0;
+	for ( d = 0; d <= depth; d++ )
+		offset[ d + 1 ] = offset[ d ] + level[ d ].num;
+	return offset[ depth + 1 ];
 }
 
-void Construct()
+void FreeLevels( LEVEL level[], int depth )
 {
-	FILE *input = fopen( IN_FILE, "r" );
-	NODE *pointer, *tp;
-	uint16_t key;
-	int ret;
+	int d;
 
-	if ( ! input ) {
-		fprintf( stderr, "Error opening " IN_FILE "\n" );
-		exit( 1 );
+	for ( d = 0; d <= depth; d++ ) {
+		free( level[ d ].node );
+		memset( &level[ d ], 0, sizeof( LEVEL ) );
 	}
-	InitConstruct();
+}
 
-	
-	while ( 1 ) {	
-		ret = fscanf( input, "%hu", &key );
-		if ( ret != 1 || feof( input ) )
-			break;
+int PhraseKey( const void *entry, const uint16_t **key )
+{
+	const TreePhrase *phrase = (const TreePhrase *) entry;
+	int len;
 
-		pointer = root;
+	*key = phrase->phone;
+	for ( len = 0; len <= MAX_PHRASE_LEN && phrase->phone[ len ]; len++ )
+		;
+	return len;
+}
 
-		while ( key != 0 ) {
-			if ( ( tp = FindKey( pointer, key ) ) ) {
-				pointer = tp;
-			}
-			else {
-				tp = Insert( pointer, key );
-				pointer = tp;
-			}
+int AbbrKey( const void *entry, const uint16_t **key )
+{
+	const ABBRKEY *abbr = (const ABBRKEY *) entry;
 
-			ret = fscanf( input, "%hu", &key );
-			if ( ret != 1 ) {
-				fprintf( stderr, "phrase does not end with 0 in " IN_FILE );
-				exit ( 1 );
-			}
-		}
+	*key = abbr->key;
+	return abbr->len;
+}
+
+int CompareAbbrKey( const void *x, const void *y )
+{
+	const ABBRKEY *a = (const ABBRKEY *) x;
+	const ABBRKEY *b = (const ABBRKEY *) y;
+	int i;
 
-		pointer->phraseno = ph_count++;
+	for ( i = 0; i < a->len && i < b->len; i++ ) {
+		if ( a->key[ i ] != b->key[ i ] )
+			return a->key[ i ] - b->key[ i ];
 	}
+	if ( a->len != b->len )
+		return a->len - b->len;
 
-	fclose( input );
+	/* keep posting lists in ascending order of phrase number */
+	return a->phraseno - b->phraseno;
 }
-/* Give the level-order travel number to each node */
-void BFS1()
+
+/* Keep the max most frequent phrases in list, in descending order of frequency. */
+void AddPrediction( PREDICTION list[], int *num, int max, PREDICTION pred )
 {
-	NODE *pNode;
-	LISTNODE *pList;
+	int i;
 
-	QueuePut(root);
-	while ( ! QueueEmpty() ) {
-		pNode = QueueGet();
-		pNode->nodeno = node_count++;
+	for ( i = *num; i > 0; i-- ) {
+		if ( list[ i - 1 ].freq > pred.freq ||
+			( list[ i - 1 ].freq == pred.freq && list[ i - 1 ].pos < pred.pos ) )
+			break;
+		if ( i < max )
+			list[ i ] = list[ i - 1 ];
+	}
+	if ( i < max ) {
+		list[ i ] = pred;
+		if ( *num < max )
+			++*num;
+	}
+}
 
-		for ( pList = pNode->childList; pList; pList = pList->next ) {
-			QueuePut( pList->pNode );
+/*
+ * Collect the most frequent phrases below each node, from its children. The
+ * deepest level is done first, so children are done before their parent.
+ */
+void CollectPrediction( const TreePhrase *phrase )
+{
+	PREDICTION list[ PREDICT_TOP_K ], pred;
+	NODE *pNode, *pChild;
+	int num;
+	int d, i, j, k;
+
+	for ( d = tree_depth - 1; d >= 0; d-- ) {
+		for ( i = 0; i < tree_level[ d ].num; i++ ) {
+			pNode = &tree_level[ d ].node[ i ];
+			if ( pNode->child_begin == -1 )
+				continue;
+
+			num = 0;
+			for ( j = pNode->child_begin; j <= pNode->child_end; j++ ) {
+				pChild = &tree_level[ d + 1 ].node[ j ];
+				for ( k = pChild->begin; k < pChild->end; k++ ) {
+					pred.pos = phrase[ k ].pos;
+					pred.freq = phrase[ k ].freq;
+					AddPrediction( list, &num, PREDICT_TOP_K, pred );
+				}
+				for ( k = 0; k < pChild->nPredict; k++ )
+					AddPrediction( list, &num, PREDICT_TOP_K,
+						predict[ pChild->predict_begin + k ] );
+			}
+
+			predict = (PREDICTION *) Grow( predict, &max_predict,
+				predict_count + PREDICT_TOP_K, sizeof( PREDICTION ) );
+			memcpy( &predict[ predict_count ], list, sizeof( PREDICTION ) * num );
+			pNode->predict_begin = predict_count;
+			pNode->nPredict = num;
+			predict_count += num;
 		}
 	}
 }
 
-void BFS2()
+void WriteTree()
 {
 	NODE *pNode;
-	LISTNODE *pList;
-	TreeType tree = {0, 0, 0, 0};
+	TreeType tree;
+	int32 offset[ MAX_PHRASE_LEN + 2 ];
+	int d, i;
 #ifdef USE_BINARY_DATA
 	FILE *output = fopen( PHONE_TREE_FILE, "wb" );
 #else
@@ -226,49 +337,200 @@ void BFS2()
 		exit( 1 );
 	}
 
-	QueuePut( root );
-	tree_size = 0;
-	while ( ! QueueEmpty() ) {
-		pNode = QueueGet();
-		
-		tree.phone_id = pNode->key;
-		tree.phrase_id = pNode->phraseno;
-
-		/* compute the begin and end index */
-		pList = pNode->childList;
-		if( pList ) {
-			tree.child_begin = pList->pNode->nodeno;
-
-			for ( ; pList->next; pList = pList->next ) {
-				QueuePut( pList->pNode );
+	node_count = NumberLevels( tree_level, tree_depth, offset );
+	memset( &tree, 0, sizeof( tree ) );
+	for ( d = 0; d <= tree_depth; d++ ) {
+		for ( i = 0; i < tree_level[ d ].num; i++ ) {
+			pNode = &tree_level[ d ].node[ i ];
+
+			tree.phone_id = pNode->key;
+			tree.phrase_id = pNode->phraseno;
+			if ( pNode->child_begin != -1 ) {
+				tree.child_begin = offset[ d + 1 ] + pNode->child_begin;
+				tree.child_end = offset[ d + 1 ] + pNode->child_end;
 			}
-			QueuePut( pList->pNode );
-			tree.child_end = pList->pNode->nodeno;
-		}
-		else {
-			tree.child_begin = -1;
-			tree.child_end = -1;
+			else {
+				tree.child_begin = -1;
+				tree.child_end = -1;
+			}
+#ifdef USE_BINARY_DATA
+			fwrite( &tree, sizeof(TreeType), 1, output );
+#else
+			fprintf( output, "%hu %d %d %d\n",
+					tree.phone_id, tree.phrase_id,
+					tree.child_begin, tree.child_end );
+#endif
 		}
+	}
+	fprintf( config, "#define TREE_SIZE (%d)\n", node_count );
+	fclose( output );
+	fclose( config );
+}
+
+void WritePrediction()
+{
+	NODE *pNode;
+	int32 begin = 0;
+	int d, i, j;
 #ifdef USE_BINARY_DATA
-		fwrite( &tree, sizeof(TreeType), 1, output );
+	FILE *index = fopen( PREDICT_INDEX_FILE, "wb" );
+	FILE *output = fopen( PREDICT_FILE, "wb" );
 #else
-		fprintf( output, "%hu %d %d %d\n",
-				tree.phone_id, tree.phrase_id,
-				tree.child_begin, tree.child_end );
+	FILE *index = fopen( PREDICT_INDEX_FILE, "w" );
+	FILE *output = fopen( PREDICT_FILE, "w" );
 #endif
-		tree_size++;
+	FILE *config = fopen( CHEWING_DEFINITION_FILE, "a" );
+
+	if ( ! index || ! output || ! config ) {
+		fprintf( stderr, "Error opening file " PREDICT_INDEX_FILE ", "
+			PREDICT_FILE " or " CHEWING_DEFINITION_FILE " for output.\n" );
+		exit( 1 );
 	}
-	fprintf( config, "#define TREE_SIZE (%d)\n", tree_size );
+
+	/* in the same order as the phone phrase tree */
+	for ( d = 0; d <= tree_depth; d++ ) {
+		for ( i = 0; i < tree_level[ d ].num; i++ ) {
+#ifdef USE_BINARY_DATA
+			fwrite( &begin, sizeof(int32), 1, index );
+#else
+			fprintf( index, "%d\n", begin );
+#endif
+			pNode = &tree_level[ d ].node[ i ];
+			for ( j = 0; j < pNode->nPredict; j++ ) {
+#ifdef USE_BINARY_DATA
+				fwrite( &predict[ pNode->predict_begin + j ].pos, sizeof(int32), 1, output );
+#else
+				fprintf( output, "%d\n", predict[ pNode->predict_begin + j ].pos );
+#endif
+			}
+			begin += pNode->nPredict;
+		}
+	}
+#ifdef USE_BINARY_DATA
+	fwrite( &begin, sizeof(int32), 1, index );
+#else
+	fprintf( index, "%d\n", begin );
+#endif
+
+	fprintf( config, "#define PREDICT_SIZE (%d)\n", begin );
+	fclose( index );
 	fclose( output );
 	fclose( config );
 }
 
-int main()
+/* Sort the initials of each phrase number, which are the keys of the abbreviation tree. */
+void ConstructAbbr( const TreePhrase *phrase, int ph_count )
+{
+	const uint16_t *key;
+	NODE *pNode;
+	ABBRKEY *abbr;
+	int len;
+	int i, j;
+
+	abbr_key = (ABBRKEY *) calloc( ph_count ? ph_count : 1, sizeof( ABBRKEY ) );
+	if ( ! abbr_key ) {
+		fprintf( stderr, "Out of memory\n" );
+		exit( 1 );
+	}
+
+	for ( i = 0; i <= tree_depth; i++ ) {
+		for ( j = 0; j < tree_level[ i ].num; j++ ) {
+			pNode = &tree_level[ i ].node[ j ];
+			if ( pNode->phraseno == -1 )
+				continue;
+			abbr = &abbr_key[ pNode->phraseno ];
+			len = PhraseKey( &phrase[ pNode->begin ], &key );
+			for ( abbr->len = 0; abbr->len < len; abbr->len++ )
+				abbr->key[ abbr->len ] = INITIAL_FROM_PHONE( key[ abbr->len ] );
+			abbr->phraseno = pNode->phraseno;
+		}
+	}
+	qsort( abbr_key, ph_count, sizeof( ABBRKEY ), CompareAbbrKey );
+
+	/* entries with the same initials are one node, whose postings they are. */
+	Construct( abbr_key, sizeof( ABBRKEY ), ph_count, AbbrKey, abbr_level, &abbr_depth );
+}
+
+void WriteAbbr()
 {
-	Construct();
-	BFS1();		
-	BFS2();
+	NODE *pNode;
+	AbbrTreeType tree;
+	int32 offset[ MAX_PHRASE_LEN + 2 ];
+	int32 posting_count = 0;
+	int d, i, j;
+#ifdef USE_BINARY_DATA
+	FILE *output = fopen( ABBR_TREE_FILE, "wb" );
+	FILE *posting = fopen( ABBR_POSTING_FILE, "wb" );
+#else
+	FILE *output = fopen( ABBR_TREE_FILE, "w" );
+	FILE *posting = fopen( ABBR_POSTING_FILE, "w" );
+#endif
+	FILE *config = fopen( CHEWING_DEFINITION_FILE, "a" );
+
+	if ( ! output || ! posting || ! config ) {
+		fprintf( stderr, "Error opening file " ABBR_TREE_FILE ", "
+			ABBR_POSTING_FILE " or " CHEWING_DEFINITION_FILE " for output.\n" );
+		exit( 1 );
+	}
+
+	abbr_node_count = NumberLevels( abbr_level, abbr_depth, offset );
+	memset( &tree, 0, sizeof( tree ) );
+	for ( d = 0; d <= abbr_depth; d++ ) {
+		for ( i = 0; i < abbr_level[ d ].num; i++ ) {
+			pNode = &abbr_level[ d ].node[ i ];
 
-	return 0;
+			tree.initial = pNode->key;
+			tree.posting_begin = posting_count;
+			tree.posting_end = posting_count + pNode->end - pNode->begin;
+			posting_count = tree.posting_end;
+
+			if ( pNode->child_begin != -1 ) {
+				tree.child_begin = offset[ d + 1 ] + pNode->child_begin;
+				tree.child_end = offset[ d + 1 ] + pNode->child_end;
+			}
+			else {
+				tree.child_begin = -1;
+				tree.child_end = -1;
+			}
+#ifdef USE_BINARY_DATA
+			fwrite( &tree, sizeof(AbbrTreeType), 1, output );
+#else
+			fprintf( output, "%hu %d %d %d %d\n",
+					tree.initial, tree.posting_begin, tree.posting_end,
+					tree.child_begin, tree.child_end );
+#endif
+			for ( j = pNode->begin; j < pNode->end; j++ ) {
+#ifdef USE_BINARY_DATA
+				fwrite( &abbr_key[ j ].phraseno, sizeof(int32), 1, posting );
+#else
+				fprintf( posting, "%d\n", abbr_key[ j ].phraseno );
+#endif
+			}
+		}
+	}
+	fprintf( config, "#define ABBR_TREE_SIZE (%d)\n", abbr_node_count );
+	fprintf( config, "#define ABBR_POSTING_SIZE (%d)\n", posting_count );
+	fclose( output );
+	fclose( posting );
+	fclose( config );
 }
 
+void MakeTree( const TreePhrase *phrase, int num )
+{
+	int ph_count;
+
+	ph_count = Construct( phrase, sizeof( TreePhrase ), num, PhraseKey, tree_level, &tree_depth );
+	WriteTree();
+	CollectPrediction( phrase );
+	WritePrediction();
+	ConstructAbbr( phrase, ph_count );
+	WriteAbbr();
+
+	FreeLevels( tree_level, tree_depth );
+	FreeLevels( abbr_level, abbr_depth );
+	free( predict );
+	free( abbr_key );
+	predict = NULL;
+	abbr_key = NULL;
+	predict_count = max_predict = 0;
+}
@@ -0,0 +1,32 @@
+/**
+ * maketree.h
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifndef _CHEWING_MAKETREE_H
+#define _CHEWING_MAKETREE_H
+
+#include "chewing-private.h"
+
+typedef struct {
+	/* phones of the phrase, terminated by 0 */
+	const uint16_t *phone;
+	/* offset of the phrase in DICT_FILE */
+	int pos;
+	int freq;
+} TreePhrase;
+
+/*
+ * Write the phone phrase tree, the prediction table and the abbreviation tree
+ * of num phrases, which are sorted by phone, then in descending order of
+ * frequency, as the phrase file. Phrases with the same phones are one phrase
+ * number of the phrase index file.
+ */
+void MakeTree( const TreePhrase *phrase, int num );
+
+#endif
@@ -0,0 +1,429 @@
+/**
+ * packdata.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+/**
+ * @file packdata.c
+ *
+ * @brief Pack the binary files written by sort in the current
+ *	  directory into one container, DICTIONARY_FILE. See
+ *	  container-private.h for its layout. Optional sections are skipped
+ *	  if their files do not exist.
+ *
+ *	  With -c, phrases are front-coded in each bucket of the phrase
+ *	  index, and their characters are replaced by 2-byte indexes.
+ *
+ *	  With -b, DICTIONARY_FILE is also written as a C array in
+ *	  BUILTIN_DICT_SOURCE, which is linked into the library when it is
+ *	  built with ENABLE_BUILTIN_DICT.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chewing-utf8-util.h"
+#include "global-private.h"
+#include "container-private.h"
+
+const char USAGE[] =
+	"usage: %s [-c] [-b]\n"
+	"This program packs the files of sort into " DICTIONARY_FILE ".\n"
+	"-c\tcompress phrases of " DICT_FILE "\n"
+	"-b\talso write " DICTIONARY_FILE " as C source, " BUILTIN_DICT_SOURCE "\n"
+;
+
+typedef struct {
+	const ContainerLayout *layout;
+	char *data;
+	size_t size;
+	size_t offset;
+} Section;
+
+static size_t Align( size_t offset )
+{
+	return ( offset + CONTAINER_ALIGN - 1 ) / CONTAINER_ALIGN * CONTAINER_ALIGN;
+}
+
+/* Return 0 if the file is read, 1 if it does not exist, or -1 on error. */
+static int ReadSection( Section *section )
+{
+	FILE *file;
+	long len;
+	int ret = -1;
+
+	file = fopen( section->layout->file, "rb" );
+	if ( ! file )
+		return 1;
+
+	if ( fseek( file, 0, SEEK_END ) || ( len = ftell( file ) ) < 0 ||
+		fseek( file, 0, SEEK_SET ) )
+		goto end;
+
+	section->size = len;
+	section->data = malloc( len ? len : 1 );
+	if ( ! section->data )
+		goto end;
+	if ( fread( section->data, 1, len, file ) != (size_t) len )
+		goto end;
+	if ( section->size % section->layout->element_size ) {
+		fprintf( stderr, "%s: size %lu is not a multiple of %lu\n", section->layout->file,
+			(unsigned long) section->size, (unsigned long) section->layout->element_size );
+		goto end;
+	}
+	ret = 0;
+end:
+	fclose( file );
+	return ret;
+}
+
+static Section *FindSection( Section section[], int num, int id )
+{
+	int i;
+
+	for ( i = 0; i < num; i++ ) {
+		if ( section[ i ].layout->id == id )
+			return &section[ i ];
+	}
+	return NULL;
+}
+
+/* Return index of the character at p in charset, adding it if it is new. */
+static int CharIndex( char *charset, int *charset_num, int hash[], const unsigned char *p, int len )
+{
+	char ch[ DICT_CHAR_SIZE ] = { 0 };
+	unsigned int h = 2166136261u;
+	int i;
+
+	memcpy( ch, p, len );
+	for ( i = 0; i < DICT_CHAR_SIZE; i++ ) {
+		h ^= (unsigned char) ch[ i ];
+		h *= 16777619u;
+	}
+	for ( h %= DICT_CHARSET_MAX * 2; hash[ h ] != -1; h = ( h + 1 ) % ( DICT_CHARSET_MAX * 2 ) ) {
+		if ( !memcmp( charset + hash[ h ] * DICT_CHAR_SIZE, ch, DICT_CHAR_SIZE ) )
+			return hash[ h ];
+	}
+	if ( *charset_num == DICT_CHARSET_MAX )
+		return -1;
+	memcpy( charset + *charset_num * DICT_CHAR_SIZE, ch, DICT_CHAR_SIZE );
+	hash[ h ] = *charset_num;
+	return ( *charset_num )++;
+}
+
+/* Move offsets of the phrase file with map, where -1 is not a phrase. */
+static int MapOffset( const int map[], size_t map_size, int *offset )
+{
+	if ( *offset < 0 || (size_t) *offset >= map_size || map[ *offset ] == -1 )
+		return -1;
+	*offset = map[ *offset ];
+	return 0;
+}
+
+/*
+ * Replace the phrases of SECTION_DICT with SECTION_DICT_FRONT_CODED and
+ * SECTION_DICT_CHARSET, and move offsets in other sections to the new
+ * phrases. Sections are still in host order.
+ */
+static int CompressDict( Section section[], int *num )
+{
+	Section *dict = FindSection( section, *num, SECTION_DICT );
+	Section *begin = FindSection( section, *num, SECTION_DICT_BEGIN );
+	Section *predict = FindSection( section, *num, SECTION_PREDICT );
+	Section *reverse_index = FindSection( section, *num, SECTION_REVERSE_INDEX );
+	const unsigned char *p, *end, *head = NULL;
+	int *dict_begin = (int *) begin->data;
+	size_t begin_num = begin->size / sizeof( int );
+	unsigned char *out = NULL, *q;
+	char *charset = NULL;
+	int *hash = NULL, *map = NULL;
+	int charset_num = 0;
+	int head_len = 0;
+	int bytes[ MAX_PHRASE_LEN ];
+	int chars, shared, len, code;
+	unsigned int freq;
+	size_t i, j;
+	int ret = -1;
+
+	if ( begin_num == 0 || dict_begin[ 0 ] != 0 ||
+		(size_t) dict_begin[ begin_num - 1 ] != dict->size )
+		return -1;
+
+	/* A record grows at most from a 1-byte character to its 2-byte index. */
+	out = malloc( dict->size * 2 + 1 );
+	charset = malloc( DICT_CHARSET_MAX * DICT_CHAR_SIZE );
+	hash = malloc( sizeof( int ) * DICT_CHARSET_MAX * 2 );
+	map = malloc( sizeof( int ) * ( dict->size + 1 ) );
+	if ( !out || !charset || !hash || !map )
+		goto end;
+	memset( hash, -1, sizeof( int ) * DICT_CHARSET_MAX * 2 );
+	memset( map, -1, sizeof( int ) * ( dict->size + 1 ) );
+
+	q = out;
+	for ( i = 0; i + 1 < begin_num; i++ ) {
+		p = (const unsigned char *) dict->data + dict_begin[ i ];
+		end = (const unsigned char *) dict->data + dict_begin[ i + 1 ];
+		head = NULL;
+		while ( p < end ) {
+			map[ p - (const unsigned char *) dict->data ] = q - out;
+			len = *p++;
+			if ( p + len + sizeof( int ) > end )
+				goto end;
+
+			for ( chars = 0, j = 0; j < (size_t) len; j += bytes[ chars++ ] ) {
+				if ( chars == MAX_PHRASE_LEN )
+					goto end;
+				bytes[ chars ] = ueBytesFromChar( p[ j ] );
+				if ( bytes[ chars ] == 0 || bytes[ chars ] > DICT_CHAR_SIZE ||
+					j + bytes[ chars ] > (size_t) len )
+					goto end;
+			}
+
+			/* the shared characters are whole ones of both phrases */
+			for ( shared = 0, j = 0; head && shared < chars &&
+				(int) j + bytes[ shared ] <= head_len &&
+				!memcmp( p + j, head + j, bytes[ shared ] ); j += bytes[ shared++ ] )
+				;
+			*q++ = ( shared << 4 ) | ( chars - shared );
+			for ( ; shared < chars; j += bytes[ shared++ ] ) {
+				code = CharIndex( charset, &charset_num, hash, p + j, bytes[ shared ] );
+				if ( code == -1 ) {
+					fprintf( stderr, "More than %d characters in " DICT_FILE "\n", DICT_CHARSET_MAX );
+					goto end;
+				}
+				*q++ = code & 0xff;
+				*q++ = code >> 8;
+			}
+
+			memcpy( &freq, p + len, sizeof( freq ) );
+			do {
+				*q++ = ( freq & 0x7f ) | ( freq > 0x7f ? 0x80 : 0 );
+				freq >>= 7;
+			} while ( freq );
+
+			if ( !head ) {
+				head = p;
+				head_len = len;
+			}
+			p += len + sizeof( int );
+		}
+	}
+	map[ dict->size ] = q - out;
+
+	for ( i = 0; i < begin_num; i++ ) {
+		if ( MapOffset( map, dict->size + 1, &dict_begin[ i ] ) )
+			goto end;
+	}
+	for ( i = 0; predict && i < predict->size / sizeof( int ); i++ ) {
+		if ( MapOffset( map, dict->size + 1, &( (int *) predict->data )[ i ] ) )
+			goto end;
+	}
+	for ( i = 0; reverse_index && i < reverse_index->size / sizeof( ReverseIndexType ); i++ ) {
+		if ( MapOffset( map, dict->size + 1,
+			&( (ReverseIndexType *) reverse_index->data )[ i ].dict_offset ) )
+			goto end;
+	}
+
+	printf( DICT_FILE ": %lu bytes, front-coded: %lu bytes and %d characters\n",
+		(unsigned long) dict->size, (unsigned long) ( q - out ), charset_num );
+
+	free( dict->data );
+	dict->layout = GetContainerLayout( SECTION_DICT_FRONT_CODED );
+	dict->data = (char *) out;
+	dict->size = q - out;
+	out = NULL;
+
+	section[ *num ].layout = GetContainerLayout( SECTION_DICT_CHARSET );
+	section[ *num ].data = charset;
+	section[ *num ].size = charset_num * DICT_CHAR_SIZE;
+	++*num;
+	charset = NULL;
+	ret = 0;
+end:
+	if ( ret )
+		fprintf( stderr, "Cannot compress " DICT_FILE "\n" );
+	free( out );
+	free( charset );
+	free( hash );
+	free( map );
+	return ret;
+}
+
+static int WritePadding( FILE *output, size_t *pos, size_t offset )
+{
+	for ( ; *pos < offset; ++*pos ) {
+		if ( fputc( 0, output ) == EOF )
+			return -1;
+	}
+	return 0;
+}
+
+/* Write DICTIONARY_FILE as an array in BUILTIN_DICT_SOURCE. */
+static int WriteBuiltinDict()
+{
+	FILE *input;
+	FILE *output = NULL;
+	long size;
+	long i;
+	int c;
+	int ret = -1;
+
+	input = fopen( DICTIONARY_FILE, "rb" );
+	if ( ! input ) {
+		fprintf( stderr, "Cannot open %s\n", DICTIONARY_FILE );
+		return -1;
+	}
+	if ( fseek( input, 0, SEEK_END ) || ( size = ftell( input ) ) < 0 ||
+		fseek( input, 0, SEEK_SET ) )
+		goto end;
+
+	output = fopen( BUILTIN_DICT_SOURCE, "w" );
+	if ( ! output ) {
+		fprintf( stderr, "Cannot open %s\n", BUILTIN_DICT_SOURCE );
+		goto end;
+	}
+
+	fprintf( output,
+		"/* Generated by packdata from " DICTIONARY_FILE ". Do not edit. */\n"
+		"#include \"dict-private.h\"\n"
+		"\n"
+		"static const union {\n"
+		"\tunsigned char data[ %ld ];\n"
+		"\t/* aligns the sections for the types read from them */\n"
+		"\tuint64_t align;\n"
+		"} BUILTIN_DICT_DATA = { {", size );
+	for ( i = 0; i < size; i++ ) {
+		c = fgetc( input );
+		if ( c == EOF )
+			goto end;
+		fprintf( output, i % 16 ? " 0x%02x," : "\n\t0x%02x,", c );
+	}
+	fprintf( output,
+		"\n} };\n"
+		"\n"
+		"const void * const BUILTIN_DICT = &BUILTIN_DICT_DATA;\n"
+		"const size_t BUILTIN_DICT_SIZE = sizeof( BUILTIN_DICT_DATA.data );\n" );
+	ret = 0;
+
+end:
+	if ( output && fclose( output ) )
+		ret = -1;
+	if ( ret )
+		fprintf( stderr, "Cannot write %s\n", BUILTIN_DICT_SOURCE );
+	fclose( input );
+	return ret;
+}
+
+int main( int argc, char *argv[] )
+{
+	Section section[ SECTION_ID_END ];
+	ContainerHeader header;
+	ContainerSection entry[ SECTION_ID_END ];
+	const ContainerLayout *layout;
+	FILE *output;
+	size_t pos, offset;
+	int compress = 0;
+	int builtin = 0;
+	int num = 0;
+	int ret = 1;
+	int i;
+
+	for ( i = 1; i < argc; i++ ) {
+		if ( !strcmp( argv[ i ], "-c" ) ) {
+			compress = 1;
+		} else if ( !strcmp( argv[ i ], "-b" ) ) {
+			builtin = 1;
+		} else {
+			printf( USAGE, argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	memset( section, 0, sizeof( section ) );
+	for ( layout = CONTAINER_LAYOUT; layout->id; layout++ ) {
+		if ( !layout->file )
+			continue;
+		section[ num ].layout = layout;
+		switch ( ReadSection( &section[ num ] ) ) {
+			case 0:
+				++num;
+				break;
+			case 1:
+				if ( layout->optional )
+					break;
+				fprintf( stderr, "Cannot open %s\n", layout->file );
+				goto end;
+			default:
+				fprintf( stderr, "Cannot read %s\n", layout->file );
+				goto end;
+		}
+	}
+
+	if ( compress && CompressDict( section, &num ) )
+		goto end;
+	for ( i = 0; i < num; i++ )
+		ContainerSwapSection( section[ i ].layout, section[ i ].data, section[ i ].size );
+
+	offset = Align( sizeof( ContainerHeader ) + sizeof( ContainerSection ) * num );
+	for ( i = 0; i < num; i++ ) {
+		section[ i ].offset = offset;
+		offset = Align( offset + section[ i ].size );
+	}
+
+	output = fopen( DICTIONARY_FILE, "wb" );
+	if ( ! output ) {
+		fprintf( stderr, "Cannot open %s\n", DICTIONARY_FILE );
+		goto end;
+	}
+
+	memset( entry, 0, sizeof( entry ) );
+	for ( i = 0; i < num; i++ ) {
+		entry[ i ].id = ContainerUint32( section[ i ].layout->id );
+		entry[ i ].element_size = ContainerUint32( section[ i ].layout->element_size );
+		entry[ i ].offset = ContainerUint64( section[ i ].offset );
+		entry[ i ].size = ContainerUint64( section[ i ].size );
+		entry[ i ].checksum = ContainerUint32(
+			ContainerChecksum( section[ i ].data, section[ i ].size ) );
+	}
+
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, CONTAINER_MAGIC, CONTAINER_MAGIC_SIZE );
+	header.version = ContainerUint32( CONTAINER_VERSION );
+	header.header_size = ContainerUint32( sizeof( ContainerHeader ) );
+	header.section_num = ContainerUint32( num );
+	header.section_offset = ContainerUint32( sizeof( ContainerHeader ) );
+	header.checksum = ContainerUint32( ContainerChecksum( entry, sizeof( entry[ 0 ] ) * num ) );
+	if ( fwrite( &header, sizeof( header ), 1, output ) != 1 ||
+		fwrite( entry, sizeof( entry[ 0 ] ), num, output ) != (size_t) num )
+		goto error;
+
+	pos = sizeof( ContainerHeader ) + sizeof( ContainerSection ) * num;
+	for ( i = 0; i < num; i++ ) {
+		if ( WritePadding( output, &pos, section[ i ].offset ) ||
+			fwrite( section[ i ].data, 1, section[ i ].size, output ) != section[ i ].size )
+			goto error;
+		pos += section[ i ].size;
+	}
+	if ( WritePadding( output, &pos, offset ) )
+		goto error;
+
+	if ( fclose( output ) == 0 )
+		ret = builtin ? WriteBuiltinDict() : 0;
+	else
+		fprintf( stderr, "Cannot write %s\n", DICTIONARY_FILE );
+	goto end;
+
+error:
+	fprintf( stderr, "Cannot write %s\n", DICTIONARY_FILE );
+	fclose( output );
+end:
+	for ( i = 0; i < SECTION_ID_END; i++ )
+		free( section[ i ].data );
+	return ret;
+}
@@ -7,6 +7,15 @@
  * See the file "COPYING" for information on usage and redistribution
  * of this file.
  */
+
+/*
+ * Inputs are mapped, and tsi.src is split into chunks of lines, which are
+ * parsed by threads into one array sized by counting lines first. Arrays are
+ * sorted by threads too. Every comparison is a total order, with the order
+ * in the input as the last key, so the output does not depend on the number
+ * of threads.
+ */
+
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,19 +26,16 @@
 #include "global-private.h"
 #include "key2pho-private.h"
 #include "zuin-private.h"
+#include "plat_mmap.h"
+#include "maketree.h"
 
 #define CHARDEF_BEGIN		"%chardef  begin"
 #define CHARDEF_END		"%chardef  end"
-#define MAX_LINE_LEN		(1024)
-#define MAX_WORD_DATA		(60000)
-#define MAX_PHONE		(12000)
-#define MAX_PHRASE_BUF_LEN	(149)
-#define MAX_FILE_NAME		(256)
-#define MAX_PHRASE_DATA		(420000)
-#define PHONEID_FILE		"phoneid.dic"
+#define MAX_PHRASE_BUF_LEN	(MAX_PHRASE_LEN * MAX_UTF8_SIZE)
+#define MAX_THREADS		(64)
 
 const char USAGE[] =
-	"usage: %s <phone.cin> <tsi.src>\n"
+	"usage: %s [-j <threads>] <phone.cin> <tsi.src>\n"
 	"This program creates the following new files:\n"
 #ifdef USE_BINARY_DATA
 	"* " CHAR_INDEX_PHONE_FILE "\n\tindex of word file (phone -> index)\n"
@@ -40,141 +46,362 @@ const char USAGE[] =
 	"* " CHAR_FILE "\n\tmain word file\n"
 	"* " PH_INDEX_FILE "\n\tindex of phrase file\n"
 	"* " DICT_FILE "\n\tmain phrase file\n"
-	"* " PHONEID_FILE "\n\tintermediate file for make_tree\n"
+	"* " REVERSE_INDEX_FILE "\n\tindex of phrase file (phrase -> phone)\n"
+	"* " PHONE_TREE_FILE "\n\tphone phrase tree\n"
+	"* " PREDICT_INDEX_FILE ", " PREDICT_FILE "\n\tprediction of each node of the tree\n"
+	"* " ABBR_TREE_FILE ", " ABBR_POSTING_FILE "\n\tabbreviation tree (initials -> phrase index)\n"
+	"-j sets the number of threads, which is the number of processors by default.\n"
 ;
 
 struct WordData {
 	uint16_t phone;
-	char word[MAX_UTF8_SIZE];
+	char word[MAX_UTF8_SIZE + 1];
+	int order;
 };
 
 struct PhraseData {
-	char phrase[MAX_PHRASE_BUF_LEN];
+	/* in the mapped tsi.src, not terminated */
+	const char *phrase;
 	int freq;
 	uint16_t phone[MAX_PHRASE_LEN + 1];
+	unsigned char len;
+	/* set if a word of the phrase is not in phone.cin */
+	unsigned char missing_word;
+	int pos;
+	int phrase_id;
+	int order;
+};
+
+struct ExceptionPhrase {
+	const char *phrase;
+	uint16_t phone[MAX_PHRASE_LEN + 1];
 };
 
-struct WordData word_data[MAX_WORD_DATA];
+/* lines of tsi.src in [begin, end), parsed into phrase_data[first ..) */
+struct Chunk {
+	const char *begin;
+	const char *end;
+	int first;
+	int num;
+	/* the first line which cannot be parsed, and why */
+	const char *error_line;
+	const char *error;
+};
+
+struct SortTask {
+	char *base;
+	char *tmp;
+	size_t begin;
+	size_t mid;
+	size_t end;
+	size_t size;
+	int (*compare)(const void *, const void *);
+};
+
+struct WordData *word_data = NULL;
 int num_word_data = 0;
+int max_word_data = 0;
+
+/* (word, phone) of word_data, -1 if empty */
+int *word_hash = NULL;
+unsigned int word_hash_mask = 0;
 
-struct PhraseData phrase_data[MAX_PHRASE_DATA];
+struct PhraseData *phrase_data = NULL;
 int num_phrase_data = 0;
 
-const struct PhraseData EXCEPTION_PHRASE[] = {
-	{ "\xE5\xA5\xBD\xE8\x90\x8A\xE5\xA1\xA2" /* 好萊塢 */ , 0, { 5691, 4138, 256 } /* ㄏㄠˇ ㄌㄞˊ ㄨ */ },
-	{ "\xE6\x88\x90\xE6\x97\xA5\xE5\xAE\xB6" /* 成日家 */ , 0, { 8290, 9220, 6281 } /* ㄔㄥˊ ㄖˋ ㄐㄧㄚ˙ */ },
-	{ "\xE7\xB5\x90\xE5\xB7\xB4" /* 結巴 */ , 0, { 6304, 521 } /*  ㄐㄧㄝ ㄅㄚ˙ */ },
+/* phrase_data in the order of reverse index */
+int *reverse_order = NULL;
+
+int num_threads = 1;
+
+const struct ExceptionPhrase EXCEPTION_PHRASE[] = {
+	{ "\xE5\xA5\xBD\xE8\x90\x8A\xE5\xA1\xA2" /* 好萊塢 */ , { 5691, 4138, 256 } /* ㄏㄠˇ ㄌㄞˊ ㄨ */ },
+	{ "\xE6\x88\x90\xE6\x97\xA5\xE5\xAE\xB6" /* 成日家 */ , { 8290, 9220, 6281 } /* ㄔㄥˊ ㄖˋ ㄐㄧㄚ˙ */ },
+	{ "\xE7\xB5\x90\xE5\xB7\xB4" /* 結巴 */ , { 6304, 521 } /*  ㄐㄧㄝ ㄅㄚ˙ */ },
 };
 
-int store_word(const char *line)
+void *grow(void *data, int *max, int num, size_t size)
 {
-	char phone_buf[MAX_UTF8_SIZE * ZUIN_SIZE + 1];
-	char key_buf[ZUIN_SIZE + 1];
+	if (num < *max)
+		return data;
 
-	if (num_word_data >= MAX_WORD_DATA) {
-		fprintf(stderr, "Need to increase MAX_WORD_DATA to process\n");
+	*max = *max ? *max * 2 : 1024;
+	data = realloc(data, *max * size);
+	if (!data) {
+		fprintf(stderr, "Out of memory\n");
 		exit(-1);
 	}
+	return data;
+}
 
-	/* FIXME: Hope the buffers are sufficient. */
-	sscanf(line, "%s %s", key_buf, word_data[num_word_data].word);
+const char *map_file(plat_mmap *mmap, const char *filename, size_t *len)
+{
+	const char *text = "";
+	size_t offset = 0;
+
+	plat_mmap_set_invalid(mmap);
+	*len = plat_mmap_create(mmap, filename, FLAG_ATTRIBUTE_READ);
+	if (*len > 0)
+		text = plat_mmap_set_view(mmap, &offset, len);
+	else if (!plat_mmap_is_valid(mmap))
+		text = NULL;
+	if (!text) {
+		fprintf(stderr, "Error opening the file %s\n", filename);
+		exit(-1);
+	}
+	return text;
+}
 
-	if (strlen(key_buf) > ZUIN_SIZE)
-		return -1;
-	PhoneFromKey(phone_buf, key_buf, KB_DEFAULT, 1);
-	word_data[num_word_data].phone = UintFromPhone(phone_buf);
-	++num_word_data;
+/* Return the end of the line at p, before its newline. */
+const char *line_end(const char *p, const char *end)
+{
+	const char *eol = memchr(p, '\n', end - p);
 
-	return 0;
+	return eol ? eol : end;
 }
 
-int compare_word_by_phone(const void *x, const void *y)
+/* Return the next token of the line at *p, which is moved past it, or NULL. */
+const char *next_token(const char **p, const char *end, size_t *len)
 {
-	const struct WordData *a = (struct WordData *)x;
-	const struct WordData *b = (struct WordData *)y;
+	const char *token;
+
+	while (*p < end && (**p == ' ' || **p == '\t' || **p == '\r'))
+		++*p;
+	if (*p == end)
+		return NULL;
+	token = *p;
+	while (*p < end && **p != ' ' && **p != '\t' && **p != '\r')
+		++*p;
+	*len = *p - token;
+	return token;
+}
 
-	if (a->phone != b->phone)
-		return a->phone - b->phone;
+void run_threads(plat_thread_routine routine, void *arg, size_t arg_size, int num)
+{
+	plat_thread thread[MAX_THREADS];
+	int i;
 
-	/* Compare address for stable sort */
-	if (a < b)
-		return -1;
-	if (a > b)
-		return 1;
-	return 0;
+	if (num == 1) {
+		routine(arg);
+		return;
+	}
+	for (i = 0; i < num; ++i) {
+		if (PLAT_THREAD_CREATE(&thread[i], routine, (char *) arg + i * arg_size)) {
+			fprintf(stderr, "Cannot create thread\n");
+			exit(-1);
+		}
+	}
+	for (i = 0; i < num; ++i)
+		PLAT_THREAD_JOIN(thread[i]);
 }
 
-int compare_word(const void *x, const void *y)
+PLAT_THREAD_ROUTINE(sort_run, arg)
 {
-	const struct WordData *a = (const struct WordData *)x;
-	const struct WordData *b = (const struct WordData *)y;
-	int ret;
+	struct SortTask *task = (struct SortTask *) arg;
 
-	ret = strcmp(a->word, b->word);
-	if (ret != 0)
-		return ret;
-
-	if (a->phone != b->phone)
-		return a->phone - b->phone;
+	qsort(task->base + task->begin * task->size, task->end - task->begin, task->size, task->compare);
+	PLAT_THREAD_RETURN;
+}
 
-	return 0;
+PLAT_THREAD_ROUTINE(merge_runs, arg)
+{
+	struct SortTask *task = (struct SortTask *) arg;
+	char *a = task->base + task->begin * task->size;
+	char *a_end = task->base + task->mid * task->size;
+	char *b = a_end;
+	char *b_end = task->base + task->end * task->size;
+	char *out = task->tmp + task->begin * task->size;
+
+	while (a < a_end && b < b_end) {
+		if (task->compare(b, a) < 0) {
+			memcpy(out, b, task->size);
+			b += task->size;
+		} else {
+			memcpy(out, a, task->size);
+			a += task->size;
+		}
+		out += task->size;
+	}
+	memcpy(out, a, a_end - a);
+	out += a_end - a;
+	memcpy(out, b, b_end - b);
+	PLAT_THREAD_RETURN;
 }
 
-int compare_word_no_duplicated(const void *x, const void *y)
+/*
+ * Sort num_threads runs of base by threads, and merge them in pairs by
+ * threads. compare shall be a total order, so that the result is the same
+ * as the one of qsort.
+ */
+void parallel_sort(void *data, size_t num, size_t size, int (*compare)(const void *, const void *))
 {
-	int ret;
+	struct SortTask task[MAX_THREADS];
+	char *base = data;
+	size_t bound[MAX_THREADS + 1];
+	int runs = num_threads;
+	char *tmp;
+	char *swap;
+	int i;
 
-	ret = compare_word(x, y);
-	if (!ret) {
-		const struct WordData *a = (const struct WordData *)x;
-		fprintf(stderr, "Duplicated word found (`%s', %d).\n", a->word, a->phone);
+	if (runs == 1 || num < (size_t) runs * 1024) {
+		qsort(data, num, size, compare);
+		return;
+	}
+
+	tmp = malloc(num * size);
+	if (!tmp) {
+		fprintf(stderr, "Out of memory\n");
 		exit(-1);
 	}
 
-	return ret;
+	for (i = 0; i <= runs; ++i)
+		bound[i] = num * i / runs;
+	for (i = 0; i < runs; ++i) {
+		task[i].base = base;
+		task[i].begin = bound[i];
+		task[i].end = bound[i + 1];
+		task[i].size = size;
+		task[i].compare = compare;
+	}
+	run_threads(sort_run, task, sizeof(task[0]), runs);
+
+	while (runs > 1) {
+		for (i = 0; i < runs / 2; ++i) {
+			task[i].base = base;
+			task[i].tmp = tmp;
+			task[i].begin = bound[2 * i];
+			task[i].mid = bound[2 * i + 1];
+			task[i].end = bound[2 * i + 2];
+			task[i].size = size;
+			task[i].compare = compare;
+		}
+		run_threads(merge_runs, task, sizeof(task[0]), runs / 2);
+		/* an odd run is moved as it is */
+		if (runs % 2)
+			memcpy(tmp + bound[runs - 1] * size, base + bound[runs - 1] * size,
+				(bound[runs] - bound[runs - 1]) * size);
+
+		for (i = 0; i <= runs / 2; ++i)
+			bound[i] = bound[2 * i];
+		if (runs % 2)
+			bound[runs / 2 + 1] = bound[runs];
+		runs = (runs + 1) / 2;
+
+		swap = base;
+		base = tmp;
+		tmp = swap;
+	}
+
+	/* base is the buffer with the result now */
+	if (base != data) {
+		memcpy(data, base, num * size);
+		tmp = base;
+	}
+	free(tmp);
 }
 
-void read_phone_cin(const char *filename)
+unsigned int hash_word(const char *word, size_t len, uint16_t phone)
 {
-	FILE *phone_cin;
-	char buf[MAX_LINE_LEN];
-	char *ret;
+	unsigned int hash = 2166136261u;
+	size_t i;
 
-	phone_cin = fopen(filename, "r");
-	if (!phone_cin) {
-		fprintf(stderr, "Error opening the file %s\n", filename);
+	for (i = 0; i < len; ++i) {
+		hash ^= (unsigned char) word[i];
+		hash *= 16777619u;
+	}
+	hash ^= phone;
+	hash *= 16777619u;
+	return hash;
+}
+
+/* Return the index of (word, phone) in word_data, or -1. */
+int find_word(const char *word, size_t len, uint16_t phone)
+{
+	unsigned int i;
+	int j;
+
+	for (i = hash_word(word, len, phone) & word_hash_mask; (j = word_hash[i]) != -1;
+		i = (i + 1) & word_hash_mask) {
+		if (word_data[j].phone == phone && strlen(word_data[j].word) == len &&
+			!memcmp(word_data[j].word, word, len))
+			return j;
+	}
+	return -1;
+}
+
+void store_word(const char *line, const char *end)
+{
+	char phone_buf[MAX_UTF8_SIZE * ZUIN_SIZE + 1];
+	char key_buf[ZUIN_SIZE + 1];
+	const char *key;
+	const char *word;
+	size_t key_len;
+	size_t word_len;
+
+	word_data = grow(word_data, &max_word_data, num_word_data, sizeof(word_data[0]));
+
+	key = next_token(&line, end, &key_len);
+	word = next_token(&line, end, &word_len);
+	if (!key || !word || key_len > ZUIN_SIZE || word_len > MAX_UTF8_SIZE) {
+		fprintf(stderr,"The line `%.*s' in phone.cin is corrupted!\n", (int) (end - line), line);
 		exit(-1);
 	}
 
+	memcpy(key_buf, key, key_len);
+	key_buf[key_len] = '\0';
+	memcpy(word_data[num_word_data].word, word, word_len);
+	word_data[num_word_data].word[word_len] = '\0';
+
+	PhoneFromKey(phone_buf, key_buf, KB_DEFAULT, 1);
+	word_data[num_word_data].phone = UintFromPhone(phone_buf);
+	word_data[num_word_data].order = num_word_data;
+	++num_word_data;
+}
+
+int compare_word_by_phone(const void *x, const void *y)
+{
+	const struct WordData *a = (struct WordData *)x;
+	const struct WordData *b = (struct WordData *)y;
+
+	if (a->phone != b->phone)
+		return a->phone - b->phone;
+
+	/* keep the order of phone.cin */
+	return a->order - b->order;
+}
+
+void read_phone_cin(const char *filename)
+{
+	plat_mmap mmap;
+	const char *text;
+	const char *p;
+	const char *end;
+	const char *eol;
+	size_t len;
+
+	text = map_file(&mmap, filename, &len);
+	end = text + len;
+
 	/* Find `%chardef  begin' */
-	for (;;) {
-		ret = fgets(buf, sizeof(buf), phone_cin);
-		if (!ret) {
+	for (p = text; ; p = eol + 1) {
+		if (p >= end) {
 			fprintf(stderr, "Cannot find %s\n", CHARDEF_BEGIN);
 			exit(-1);
 		}
-
-		if (strncmp(buf, CHARDEF_BEGIN, strlen(CHARDEF_BEGIN)) == 0) {
+		eol = line_end(p, end);
+		if ((size_t) (eol - p) >= strlen(CHARDEF_BEGIN) &&
+			strncmp(p, CHARDEF_BEGIN, strlen(CHARDEF_BEGIN)) == 0)
 			break;
-		}
 	}
 
 	/* read all words into word_data. */
-	for (;;) {
-		ret = fgets(buf, sizeof(buf), phone_cin);
-		if (!ret || buf[0] == '%')
-			break;
-
-		if (store_word(buf) != 0) {
-			fprintf(stderr,"The line `%s' in `%s' is corrupted!\n", buf, filename);
-			exit(-1);
-		}
+	for (p = eol + 1; p < end && *p != '%'; p = eol + 1) {
+		eol = line_end(p, end);
+		store_word(p, eol);
 	}
-	fclose(phone_cin);
-
-	qsort(word_data, num_word_data, sizeof(word_data[0]), compare_word_by_phone);
+	plat_mmap_close(&mmap);
 
-	return;
+	parallel_sort(word_data, num_word_data, sizeof(word_data[0]), compare_word_by_phone);
 }
 
 void write_word_data()
@@ -256,16 +483,41 @@ void write_word_data()
 	fclose(chewing_file);
 }
 
-void sort_word_for_dictionary()
+/* Hash words for checking phrases, and reject a duplicated one. */
+void hash_word_for_dictionary()
 {
-	qsort(word_data, num_word_data, sizeof(word_data[0]), compare_word_no_duplicated);
+	unsigned int size;
+	unsigned int i;
+	int j;
+
+	for (size = 1024; size < (unsigned int) num_word_data * 2; size <<= 1)
+		;
+	word_hash = malloc(sizeof(word_hash[0]) * size);
+	if (!word_hash) {
+		fprintf(stderr, "Out of memory\n");
+		exit(-1);
+	}
+	memset(word_hash, -1, sizeof(word_hash[0]) * size);
+	word_hash_mask = size - 1;
+
+	for (j = 0; j < num_word_data; ++j) {
+		if (find_word(word_data[j].word, strlen(word_data[j].word), word_data[j].phone) != -1) {
+			fprintf(stderr, "Duplicated word found (`%s', %d).\n", word_data[j].word, word_data[j].phone);
+			exit(-1);
+		}
+		for (i = hash_word(word_data[j].word, strlen(word_data[j].word), word_data[j].phone) & word_hash_mask;
+			word_hash[i] != -1; i = (i + 1) & word_hash_mask)
+			;
+		word_hash[i] = j;
+	}
 }
 
-int is_exception_phrase(struct PhraseData *phrase) {
+int is_exception_phrase(const struct PhraseData *phrase) {
 	int i;
 
 	for (i = 0; i < sizeof(EXCEPTION_PHRASE) / sizeof(EXCEPTION_PHRASE[0]); ++i) {
-		if (strcmp(phrase->phrase, EXCEPTION_PHRASE[i].phrase) == 0 &&
+		if (strlen(EXCEPTION_PHRASE[i].phrase) == phrase->len &&
+			memcmp(phrase->phrase, EXCEPTION_PHRASE[i].phrase, phrase->len) == 0 &&
 			memcmp(phrase->phone, EXCEPTION_PHRASE[i].phone, sizeof(phrase->phone)) == 0) {
 			return 1;
 		}
@@ -274,92 +526,126 @@ int is_exception_phrase(struct PhraseData *phrase) {
 	return 0;
 }
 
-void store_phrase(const char *line)
+/* Return NULL if the line is parsed into phrase, or why it is not. */
+const char *store_phrase(const char *line, const char *end, struct PhraseData *phrase)
 {
-	const char DELIM[] = " \t\n";
-	char buf[MAX_LINE_LEN];
-	char *phrase;
-	char *freq;
-	char *bopomofo;
+	char bopomofo_buf[MAX_UTF8_SIZE * ZUIN_SIZE + 1];
+	char freq_buf[32];
+	char *freq_end;
+	const char *token;
+	const char *p;
+	size_t len;
 	int phrase_len;
+	int bytes;
 	int i;
-	int j;
-	struct WordData word;
-	char bopomofo_buf[MAX_UTF8_SIZE * ZUIN_SIZE + 1];
 
-	if (num_phrase_data >= MAX_PHRASE_DATA) {
-		fprintf(stderr, "Need to increase MAX_PHRASE_DATA to process\n");
-		exit(-1);
-	}
-
-	strncpy(buf, line, sizeof(buf));
+	memset(phrase, 0, sizeof(*phrase));
 
 	/* read phrase */
-	phrase = strtok(buf, DELIM);
-	if (!phrase) {
-		fprintf(stderr, "Error reading line `%s'\n", line);
-		exit(-1);
-	}
-	strncpy(phrase_data[num_phrase_data].phrase, phrase, sizeof(phrase_data[0].phrase));
+	token = next_token(&line, end, &len);
+	if (!token)
+		return "Error reading line";
+	if (len > MAX_PHRASE_BUF_LEN)
+		return "Phrase too long";
+	phrase->phrase = token;
+	phrase->len = len;
 
 	/* read frequency */
-	freq = strtok(NULL, DELIM);
-	if (!freq) {
-		fprintf(stderr, "Error reading line `%s'\n", line);
-		exit(-1);
-	}
-
+	token = next_token(&line, end, &len);
+	if (!token || len >= sizeof(freq_buf))
+		return "Error reading line";
+	memcpy(freq_buf, token, len);
+	freq_buf[len] = '\0';
 	errno = 0;
-	phrase_data[num_phrase_data].freq = strtol(freq, 0, 0);
-	if (errno) {
-		fprintf(stderr, "Error reading frequency `%s' in `%s'\n", freq, line);
-		exit(-1);
-	}
+	phrase->freq = strtol(freq_buf, &freq_end, 0);
+	if (errno)
+		return "Error reading frequency";
 
 	/* read bopomofo */
-	for (bopomofo = strtok(NULL, DELIM), phrase_len = 0;
-		bopomofo && phrase_len < MAX_PHRASE_LEN;
-		bopomofo = strtok(NULL, DELIM), ++phrase_len) {
-
-		phrase_data[num_phrase_data].phone[phrase_len] = UintFromPhone(bopomofo);
-		if (phrase_data[num_phrase_data].phone[phrase_len] == 0) {
-			fprintf(stderr, "Error reading bopomofo `%s' in `%s'\n", bopomofo, line);
-			exit(-1);
-		}
-	}
-	if (bopomofo) {
-		fprintf(stderr, "Phrase `%s' too long\n", phrase);
+	for (phrase_len = 0; (token = next_token(&line, end, &len)); ++phrase_len) {
+		if (phrase_len == MAX_PHRASE_LEN)
+			return "Phrase too long";
+		if (len >= sizeof(bopomofo_buf))
+			return "Error reading bopomofo";
+		memcpy(bopomofo_buf, token, len);
+		bopomofo_buf[len] = '\0';
+		phrase->phone[phrase_len] = UintFromPhone(bopomofo_buf);
+		if (phrase->phone[phrase_len] == 0)
+			return "Error reading bopomofo";
 	}
 
-	/* check phrase length & bopomofo length */
-	if (ueStrLen(phrase_data[num_phrase_data].phrase) != phrase_len) {
-		fprintf(stderr, "Phrase length and bopomofo length mismatch in `%s'\n", line);
-		exit(-1);
+	/* check phrase length & bopomofo length, and each word in phrase */
+	for (i = 0, p = phrase->phrase; p < phrase->phrase + phrase->len; ++i, p += bytes) {
+		bytes = ueBytesFromChar(*p);
+		if (i == phrase_len || bytes == 0 || p + bytes > phrase->phrase + phrase->len)
+			return "Phrase length and bopomofo length mismatch";
+		if (find_word(p, bytes, phrase->phone[i]) == -1)
+			phrase->missing_word = 1;
 	}
+	if (i != phrase_len)
+		return "Phrase length and bopomofo length mismatch";
+	if (phrase->missing_word && is_exception_phrase(phrase))
+		phrase->missing_word = 0;
 
-	/* check each word in phrase */
-	for (i = 0; i < phrase_len; ++i) {
-		ueStrNCpy(word.word, ueStrSeek(phrase_data[num_phrase_data].phrase, i), 1, 1);
-		word.phone = phrase_data[num_phrase_data].phone[i];
+	return NULL;
+}
 
-		if (bsearch(&word, word_data, num_word_data, sizeof(word), compare_word) == NULL &&
-			!is_exception_phrase(&phrase_data[num_phrase_data])) {
+PLAT_THREAD_ROUTINE(count_lines, arg)
+{
+	struct Chunk *chunk = (struct Chunk *) arg;
+	const char *p;
 
-			PhoneFromUint(bopomofo_buf, sizeof(bopomofo_buf), word.phone);
+	chunk->num = 0;
+	for (p = chunk->begin; p < chunk->end; p = line_end(p, chunk->end) + 1)
+		++chunk->num;
+	PLAT_THREAD_RETURN;
+}
 
-			fprintf(stderr, "Error in phrase `%s' ", phrase_data[num_phrase_data].phrase);
-			fprintf(stderr, "{%d", phrase_data[num_phrase_data].phone[0]);
-			for (j = 1; j < phrase_len; ++j) {
-				fprintf(stderr, ", %d", phrase_data[num_phrase_data].phone[j]);
-			}
-			fprintf(stderr, "}. ");
-			fprintf(stderr, "Word `%s' has no phone %d (%s).\n", word.word, word.phone, bopomofo_buf);
-			/* FIXME: shall exit(-1) when tsi.src is fixed */
-			//exit(-1);
+PLAT_THREAD_ROUTINE(parse_lines, arg)
+{
+	struct Chunk *chunk = (struct Chunk *) arg;
+	struct PhraseData *phrase = &phrase_data[chunk->first];
+	const char *p;
+	const char *eol;
+	int i;
+
+	for (i = 0, p = chunk->begin; p < chunk->end; ++i, p = eol + 1) {
+		eol = line_end(p, chunk->end);
+		chunk->error = store_phrase(p, eol, &phrase[i]);
+		if (chunk->error) {
+			chunk->error_line = p;
+			break;
 		}
+		phrase[i].order = chunk->first + i;
 	}
+	PLAT_THREAD_RETURN;
+}
+
+/* Report phrases having a word without such phone in phone.cin. */
+void report_missing_word(const struct PhraseData *phrase)
+{
+	char bopomofo_buf[MAX_UTF8_SIZE * ZUIN_SIZE + 1];
+	const char *p;
+	int bytes;
+	int i;
+	int j;
 
-	++num_phrase_data;
+	for (i = 0, p = phrase->phrase; p < phrase->phrase + phrase->len; ++i, p += bytes) {
+		bytes = ueBytesFromChar(*p);
+		if (find_word(p, bytes, phrase->phone[i]) != -1)
+			continue;
+
+		PhoneFromUint(bopomofo_buf, sizeof(bopomofo_buf), phrase->phone[i]);
+
+		fprintf(stderr, "Error in phrase `%.*s' ", phrase->len, phrase->phrase);
+		fprintf(stderr, "{%d", phrase->phone[0]);
+		for (j = 1; phrase->phone[j]; ++j) {
+			fprintf(stderr, ", %d", phrase->phone[j]);
+		}
+		fprintf(stderr, "}. ");
+		fprintf(stderr, "Word `%.*s' has no phone %d (%s).\n", bytes, p, phrase->phone[i], bopomofo_buf);
+		/* FIXME: shall exit(-1) when tsi.src is fixed */
+	}
 }
 
 int compare_phrase(const void *x, const void *y)
@@ -367,44 +653,86 @@ int compare_phrase(const void *x, const void *y)
 	const struct PhraseData *a = (const struct PhraseData *) x;
 	const struct PhraseData *b = (const struct PhraseData *) y;
 	int cmp;
-	int i;
 
-	for (i = 0; i < sizeof(a->phone) / sizeof(a->phone[0]); ++i) {
-		cmp = a->phone[i] - b->phone[i];
-		if (cmp)
-			return cmp;
-	}
+	cmp = memcmp(a->phone, b->phone, sizeof(a->phone));
+	if (cmp) {
+		int i;
 
-	if (!strcmp(a->phrase, b->phrase)) {
-		fprintf(stderr, "Duplicated phrase `%s' found.\n", a->phrase);
-		exit(-1);
+		for (i = 0; a->phone[i] == b->phone[i]; ++i)
+			;
+		return a->phone[i] - b->phone[i];
 	}
 
-	if (a->freq == b->freq) {
-		fprintf(stderr, "Phrase `%s' and `%s' have the same phone and frequency (%d).\n", a->phrase, b->phrase, a->freq);
-		/* FIXME: shall exit(-1) when tsi.src is fixed */
-		//exit(-1);
-	}
+	if (a->freq != b->freq)
+		return b->freq - a->freq;
 
-	return b->freq - a->freq;
+	return a->order - b->order;
 }
 
 void read_tsi_src(const char *filename)
 {
-	FILE *tsi_src;
-	char buf[MAX_LINE_LEN];
+	struct Chunk chunk[MAX_THREADS];
+	plat_mmap mmap;
+	const char *text;
+	const char *p;
+	size_t len;
+	int i;
 
-	tsi_src = fopen(filename, "r");
-	if (!tsi_src) {
-		fprintf(stderr, "Error opening the file %s\n", filename);
+	text = map_file(&mmap, filename, &len);
+
+	/* Split tsi.src into a chunk of lines for each thread. */
+	p = text;
+	for (i = 0; i < num_threads; ++i) {
+		chunk[i].begin = p;
+		p = text + len * (i + 1) / num_threads;
+		if (p < chunk[i].begin)
+			p = chunk[i].begin;
+		if (p > text && p < text + len && p[-1] != '\n')
+			p = line_end(p, text + len) + 1;
+		if (p > text + len)
+			p = text + len;
+		chunk[i].end = p;
+		chunk[i].error = NULL;
+	}
+	run_threads(count_lines, chunk, sizeof(chunk[0]), num_threads);
+
+	for (i = 0; i < num_threads; ++i) {
+		chunk[i].first = num_phrase_data;
+		num_phrase_data += chunk[i].num;
+	}
+	phrase_data = calloc(num_phrase_data ? num_phrase_data : 1, sizeof(phrase_data[0]));
+	if (!phrase_data) {
+		fprintf(stderr, "Out of memory\n");
 		exit(-1);
 	}
+	run_threads(parse_lines, chunk, sizeof(chunk[0]), num_threads);
+
+	for (i = 0; i < num_threads; ++i) {
+		if (chunk[i].error) {
+			fprintf(stderr, "%s in `%.*s'\n", chunk[i].error,
+				(int) (line_end(chunk[i].error_line, chunk[i].end) - chunk[i].error_line),
+				chunk[i].error_line);
+			exit(-1);
+		}
+	}
+	for (i = 0; i < num_phrase_data; ++i) {
+		if (phrase_data[i].missing_word)
+			report_missing_word(&phrase_data[i]);
+	}
 
-	while (fgets(buf, sizeof(buf), tsi_src)) {
-		store_phrase(buf);
+	parallel_sort(phrase_data, num_phrase_data, sizeof(phrase_data[0]), compare_phrase);
+
+	for (i = 1; i < num_phrase_data; ++i) {
+		if (phrase_data[i - 1].freq == phrase_data[i].freq &&
+			!memcmp(phrase_data[i - 1].phone, phrase_data[i].phone, sizeof(phrase_data[0].phone))) {
+			fprintf(stderr, "Phrase `%.*s' and `%.*s' have the same phone and frequency (%d).\n",
+				phrase_data[i - 1].len, phrase_data[i - 1].phrase,
+				phrase_data[i].len, phrase_data[i].phrase, phrase_data[i].freq);
+			/* FIXME: shall exit(-1) when tsi.src is fixed */
+		}
 	}
 
-	qsort(phrase_data, num_phrase_data, sizeof(phrase_data[0]), compare_phrase);
+	/* phrase_data points into the mapped file, which is kept to the end. */
 }
 
 int compare_phone_in_phrase(int x, int y)
@@ -416,10 +744,9 @@ void write_phrase_data()
 {
 	FILE *dict_file;
 	FILE *ph_index_file;
-	FILE *phoneid_file;
 	int i;
-	int j;
-	int pos;
+	int pos = 0;
+	int phrase_id = -1;
 #ifdef USE_BINARY_DATA
 	unsigned char size;
 #endif
@@ -431,77 +758,188 @@ void write_phrase_data()
 	dict_file = fopen(DICT_FILE, "w");
 	ph_index_file = fopen(PH_INDEX_FILE, "w");
 #endif
-	phoneid_file = fopen(PHONEID_FILE, "w");
 
-	if (!(dict_file && ph_index_file && phoneid_file)) {
+	if (!(dict_file && ph_index_file)) {
 		fprintf(stderr, "Cannot open output file.\n");
 		exit(-1);
 	}
 
-	for (i = 0; i < num_phrase_data - 1; ++i) {
+	for (i = 0; i < num_phrase_data; ++i) {
+#ifndef USE_BINARY_DATA
+		pos = ftell(dict_file);
+#endif
+		phrase_data[i].pos = pos;
 		if (i == 0 || compare_phone_in_phrase(i - 1, i)) {
-			pos = ftell(dict_file);
+			++phrase_id;
 #ifdef USE_BINARY_DATA
 			fwrite(&pos, sizeof(pos), 1, ph_index_file);
 #else
 			fprintf(ph_index_file, "%d\n", pos);
 #endif
 		}
+		phrase_data[i].phrase_id = phrase_id;
 #ifdef USE_BINARY_DATA
-		size = strlen(phrase_data[i].phrase);
+		size = phrase_data[i].len;
 		fwrite(&size, sizeof(size), 1, dict_file);
 		fwrite(phrase_data[i].phrase, size, 1, dict_file);
 		fwrite(&phrase_data[i].freq, sizeof(phrase_data[0].freq), 1, dict_file);
+		pos += sizeof(size) + size + sizeof(phrase_data[0].freq);
 #else
-		fprintf(dict_file, "%s %d\t", phrase_data[i].phrase, phrase_data[i].freq);
+		fprintf(dict_file, "%.*s %d%s", phrase_data[i].len, phrase_data[i].phrase,
+			phrase_data[i].freq, i + 1 < num_phrase_data ? "\t" : "");
 #endif
 	}
 
-	pos = ftell(dict_file);
 #ifdef USE_BINARY_DATA
 	fwrite(&pos, sizeof(pos), 1, ph_index_file);
-	size = strlen(phrase_data[i].phrase);
-	fwrite(&size, sizeof(size), 1, dict_file);
-	fwrite(phrase_data[i].phrase, size, 1, dict_file);
-	fwrite(&phrase_data[i].freq, sizeof(phrase_data[0].freq), 1, dict_file);
-	pos = ftell(dict_file);
-	fwrite(&pos, sizeof(pos), 1, ph_index_file);
 #else
-	fprintf(ph_index_file, "%d\n", pos);
-	fprintf(dict_file, "%s %d", phrase_data[i].phrase, phrase_data[i].freq);
 	pos = ftell(dict_file);
 	fprintf(ph_index_file, "%d\n", pos);
 #endif
 
-	for (i = 0; i < num_phrase_data; ++i) {
-		if (i > 0 && !compare_phone_in_phrase(i - 1, i))
-			continue;
+	fclose(ph_index_file);
+	fclose(dict_file);
+}
+
+int compare_reverse_index(const void *x, const void *y)
+{
+	const struct PhraseData *a = &phrase_data[*(const int *) x];
+	const struct PhraseData *b = &phrase_data[*(const int *) y];
+	int cmp;
+	int i;
+
+	/* in the order of strcmp */
+	cmp = memcmp(a->phrase, b->phrase, a->len < b->len ? a->len : b->len);
+	if (cmp)
+		return cmp;
+	if (a->len != b->len)
+		return a->len - b->len;
+
+	for (i = 0; i < sizeof(a->phone) / sizeof(a->phone[0]); ++i) {
+		cmp = a->phone[i] - b->phone[i];
+		if (cmp)
+			return cmp;
+	}
+	return *(const int *) x - *(const int *) y;
+}
+
+/* Sort phrase_data in the order of reverse index, and reject duplicated phrases. */
+void sort_reverse_index()
+{
+	const struct PhraseData *a;
+	const struct PhraseData *b;
+	int i;
 
-		for (j = 0; phrase_data[i].phone[j]; ++j) {
-			fprintf(phoneid_file, "%hu ", phrase_data[i].phone[j]);
+	reverse_order = malloc(sizeof(reverse_order[0]) * (num_phrase_data ? num_phrase_data : 1));
+	if (!reverse_order) {
+		fprintf(stderr, "Out of memory\n");
+		exit(-1);
+	}
+	for (i = 0; i < num_phrase_data; ++i)
+		reverse_order[i] = i;
+	parallel_sort(reverse_order, num_phrase_data, sizeof(reverse_order[0]), compare_reverse_index);
+
+	for (i = 1; i < num_phrase_data; ++i) {
+		a = &phrase_data[reverse_order[i - 1]];
+		b = &phrase_data[reverse_order[i]];
+		if (a->len == b->len && !memcmp(a->phrase, b->phrase, a->len) &&
+			!memcmp(a->phone, b->phone, sizeof(a->phone))) {
+			fprintf(stderr, "Duplicated phrase `%.*s' found.\n", a->len, a->phrase);
+			exit(-1);
 		}
-		fprintf(phoneid_file, "0\n");
+	}
+}
 
+void write_reverse_index()
+{
+	FILE *reverse_index_file;
+	FILE *chewing_file;
+	const struct PhraseData *phrase;
+	int i;
+#ifdef USE_BINARY_DATA
+	ReverseIndexType entry;
+#else
+	int j;
+#endif
+
+#ifdef USE_BINARY_DATA
+	reverse_index_file = fopen(REVERSE_INDEX_FILE, "wb");
+#else
+	reverse_index_file = fopen(REVERSE_INDEX_FILE, "w");
+#endif
+	chewing_file = fopen(CHEWING_DEFINITION_FILE, "a");
+
+	if (!(reverse_index_file && chewing_file)) {
+		fprintf(stderr, "Cannot open output file.\n");
+		exit(-1);
 	}
 
-	fclose(phoneid_file);
-	fclose(ph_index_file);
-	fclose(dict_file);
+	for (i = 0; i < num_phrase_data; ++i) {
+		phrase = &phrase_data[reverse_order[i]];
+#ifdef USE_BINARY_DATA
+		memset(&entry, 0, sizeof(entry));
+		entry.dict_offset = phrase->pos;
+		entry.phrase_id = phrase->phrase_id;
+		memcpy(entry.phone, phrase->phone, sizeof(entry.phone));
+		fwrite(&entry, sizeof(entry), 1, reverse_index_file);
+#else
+		fprintf(reverse_index_file, "%d %d", phrase->pos, phrase->phrase_id);
+		for (j = 0; phrase->phone[j]; ++j)
+			fprintf(reverse_index_file, " %hu", phrase->phone[j]);
+		fprintf(reverse_index_file, " 0\n");
+#endif
+	}
+	fprintf(chewing_file, "#define REVERSE_INDEX_SIZE (%d)\n", num_phrase_data);
+
+	fclose(chewing_file);
+	fclose(reverse_index_file);
+}
+
+void make_tree()
+{
+	TreePhrase *phrase;
+	int i;
+
+	phrase = malloc(sizeof(phrase[0]) * (num_phrase_data ? num_phrase_data : 1));
+	if (!phrase) {
+		fprintf(stderr, "Out of memory\n");
+		exit(-1);
+	}
+	for (i = 0; i < num_phrase_data; ++i) {
+		phrase[i].phone = phrase_data[i].phone;
+		phrase[i].pos = phrase_data[i].pos;
+		phrase[i].freq = phrase_data[i].freq;
+	}
+	MakeTree(phrase, num_phrase_data);
+	free(phrase);
 }
 
 int main(int argc, char *argv[])
 {
-	if (argc != 3) {
+	int arg = 1;
+
+	num_threads = PLAT_CPU_NUM();
+	if (argc == 5 && !strcmp(argv[1], "-j")) {
+		num_threads = atoi(argv[2]);
+		arg = 3;
+	} else if (argc != 3) {
 		printf(USAGE, argv[0]);
 		return -1;
 	}
+	if (num_threads < 1)
+		num_threads = 1;
+	if (num_threads > MAX_THREADS)
+		num_threads = MAX_THREADS;
 
-	read_phone_cin(argv[1]);
+	read_phone_cin(argv[arg]);
 	write_word_data();
 
-	sort_word_for_dictionary();
+	hash_word_for_dictionary();
 
-	read_tsi_src(argv[2]);
+	read_tsi_src(argv[arg + 1]);
+	sort_reverse_index();
 	write_phrase_data();
+	write_reverse_index();
+	make_tree();
 	return 0;
 }
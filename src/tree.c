@@ -31,7 +31,7 @@
 #include "char-private.h"
 #include "tree-private.h"
 #include "private.h"
-#include "plat_mmap.h"
+#include "container-private.h"
 
 #define INTERVAL_SIZE ( ( MAX_PHONE_SEQ_LEN + 1 ) * MAX_PHONE_SEQ_LEN / 2 )
 
@@ -88,39 +88,294 @@ static int GetIntersection( IntervalType in1, IntervalType in2, IntervalType *in
 }
 #endif
 
-void TerminateTree( ChewingData *pgdata )
+void TerminateTree( SystemDictData *sys_dict )
 {
 #ifdef USE_BINARY_DATA
-		pgdata->static_data.tree = NULL;
-		plat_mmap_close( &pgdata->static_data.tree_mmap );
+		sys_dict->tree = NULL;
+		sys_dict->abbr_tree = NULL;
+		sys_dict->abbr_posting = NULL;
+		sys_dict->predict_begin = NULL;
+		sys_dict->predict = NULL;
+		sys_dict->reverse_index = NULL;
 #else
-		free( pgdata->static_data.tree );
-		pgdata->static_data.tree = NULL;
+		free( sys_dict->tree );
+		sys_dict->tree = NULL;
+		free( sys_dict->abbr_tree );
+		sys_dict->abbr_tree = NULL;
+		free( sys_dict->abbr_posting );
+		sys_dict->abbr_posting = NULL;
+		free( sys_dict->predict_begin );
+		sys_dict->predict_begin = NULL;
+		free( sys_dict->predict );
+		sys_dict->predict = NULL;
+		free( sys_dict->reverse_index );
+		sys_dict->reverse_index = NULL;
 #endif
 }
 
+#ifdef USE_BINARY_DATA
+/* Return 1 if children and phrases of every node of the tree exist. */
+static int IsTreeValid( const SystemDictData *sys_dict )
+{
+	const TreeType *tree = sys_dict->tree;
+	int num = sys_dict->tree_size / sizeof( TreeType );
+	int phrase_num = sys_dict->dict_begin_size - 1;
+	int bad = 0;
+	int i;
+
+	for ( i = 0; i < num; i++ ) {
+		bad |= ( tree[ i ].child_begin != -1 ) &
+			( ( tree[ i ].child_begin < 0 ) | ( tree[ i ].child_end >= num ) );
+		bad |= ( tree[ i ].phrase_id < -1 ) | ( tree[ i ].phrase_id >= phrase_num );
+	}
+	return !bad;
+}
 
-int InitTree( ChewingData *pgdata, const char * prefix )
+/* Return 1 if children and postings of every node of the tree exist. */
+static int IsAbbrTreeValid( const SystemDictData *sys_dict )
+{
+	const AbbrTreeType *tree = sys_dict->abbr_tree;
+	int num = sys_dict->abbr_tree_size;
+	int posting_num = sys_dict->abbr_posting_size;
+	int bad = 0;
+	int i;
+
+	for ( i = 0; i < num; i++ ) {
+		bad |= ( tree[ i ].child_begin != -1 ) &
+			( ( tree[ i ].child_begin < 0 ) | ( tree[ i ].child_end >= num ) );
+		bad |= ( tree[ i ].posting_begin < 0 ) |
+			( tree[ i ].posting_begin > tree[ i ].posting_end ) |
+			( tree[ i ].posting_end > posting_num );
+	}
+	return !bad && IsDictValueValid( sys_dict->abbr_posting,
+		sys_dict->abbr_posting_size, sys_dict->dict_begin_size - 1 );
+}
+
+/* Return 1 if every entry of the reverse index refers to a phrase record. */
+static int IsReverseIndexValid( const SystemDictData *sys_dict )
+{
+	const ReverseIndexType *entry = sys_dict->reverse_index;
+	int phrase_num = sys_dict->dict_begin_size - 1;
+	int bad = 0;
+	size_t i;
+
+	for ( i = 0; i < sys_dict->reverse_index_size; i++ )
+		bad |= ( entry[ i ].phrase_id < 0 ) | ( entry[ i ].phrase_id >= phrase_num );
+	return !bad && IsDictOffsetValid( sys_dict, &entry[ 0 ].dict_offset,
+		sys_dict->reverse_index_size, sizeof( ReverseIndexType ) );
+}
+#endif
+
+/*
+ * The abbreviation tree is optional, so that an older data directory without
+ * it still works, only without abbreviated lookup.
+ */
+static void InitAbbrTree( SystemDictData *sys_dict, const char *prefix )
 {
 #ifdef USE_BINARY_DATA
+	sys_dict->abbr_tree = (AbbrTreeType *) GetDictSection( sys_dict,
+		SECTION_ABBR_TREE, sizeof( AbbrTreeType ), &sys_dict->abbr_tree_size );
+	sys_dict->abbr_posting = (int *) GetDictSection( sys_dict,
+		SECTION_ABBR_POSTING, sizeof( int ), &sys_dict->abbr_posting_size );
+	if ( !sys_dict->abbr_tree || !sys_dict->abbr_posting ||
+		! IsAbbrTreeValid( sys_dict ) ) {
+		sys_dict->abbr_tree = NULL;
+		sys_dict->abbr_posting = NULL;
+	}
+#else
 	char filename[ PATH_MAX ];
-	size_t len;
-	size_t offset;
+	int len;
+	FILE *infile = NULL;
+	size_t i;
 
-	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, PHONE_TREE_FILE );
+	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, ABBR_TREE_FILE );
 	if ( len + 1 > sizeof( filename ) )
-		return -1;
+		return;
+	infile = fopen( filename, "r" );
+	if ( !infile )
+		return;
 
-	plat_mmap_set_invalid( &pgdata->static_data.tree_mmap );
-	pgdata->static_data.tree_size = plat_mmap_create( &pgdata->static_data.tree_mmap, filename, FLAG_ATTRIBUTE_READ );
-	if ( pgdata->static_data.tree_size <= 0 )
-		return -1;
+	sys_dict->abbr_tree = ALC( AbbrTreeType, ABBR_TREE_SIZE );
+	sys_dict->abbr_posting = ALC( int, ABBR_POSTING_SIZE );
+	if ( !sys_dict->abbr_tree || !sys_dict->abbr_posting )
+		goto error;
+
+	for ( i = 0; i < ABBR_TREE_SIZE; i++ ) {
+		if ( fscanf( infile, "%hu%d%d%d%d",
+					&sys_dict->abbr_tree[ i ].initial,
+					&sys_dict->abbr_tree[ i ].posting_begin,
+					&sys_dict->abbr_tree[ i ].posting_end,
+					&sys_dict->abbr_tree[ i ].child_begin,
+					&sys_dict->abbr_tree[ i ].child_end ) != 5 )
+			goto error;
+	}
+	sys_dict->abbr_tree_size = ABBR_TREE_SIZE;
+	fclose( infile );
+
+	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, ABBR_POSTING_FILE );
+	if ( len + 1 > sizeof( filename ) )
+		goto error_no_file;
+	infile = fopen( filename, "r" );
+	if ( !infile )
+		goto error_no_file;
+	for ( i = 0; i < ABBR_POSTING_SIZE; i++ ) {
+		if ( fscanf( infile, "%d", &sys_dict->abbr_posting[ i ] ) != 1 )
+			goto error;
+	}
+	sys_dict->abbr_posting_size = ABBR_POSTING_SIZE;
+	fclose( infile );
+	return;
+
+error:
+	fclose( infile );
+error_no_file:
+	free( sys_dict->abbr_tree );
+	sys_dict->abbr_tree = NULL;
+	free( sys_dict->abbr_posting );
+	sys_dict->abbr_posting = NULL;
+#endif
+}
+
+/*
+ * The prediction table is optional as well. It is indexed by node of the
+ * phone tree, so it is dropped if it does not match the tree.
+ */
+static void InitPredict( SystemDictData *sys_dict, const char *prefix )
+{
+#ifdef USE_BINARY_DATA
+	size_t begin_size;
+
+	sys_dict->predict_begin = (int *) GetDictSection( sys_dict,
+		SECTION_PREDICT_BEGIN, sizeof( int ), &begin_size );
+	sys_dict->predict = (int *) GetDictSection( sys_dict,
+		SECTION_PREDICT, sizeof( int ), &sys_dict->predict_size );
+	if ( !sys_dict->predict_begin || !sys_dict->predict ||
+		begin_size != sys_dict->tree_size / sizeof( TreeType ) + 1 ||
+		sys_dict->predict_begin[ begin_size - 1 ] != (int) sys_dict->predict_size ||
+		! IsDictIndexValid( sys_dict->predict_begin, begin_size, sys_dict->predict_size ) ||
+		! IsDictOffsetValid( sys_dict, sys_dict->predict, sys_dict->predict_size, sizeof( int ) ) ) {
+		sys_dict->predict_begin = NULL;
+		sys_dict->predict = NULL;
+	}
+#else
+	char filename[ PATH_MAX ];
+	int len;
+	FILE *infile = NULL;
+	size_t i;
+
+	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, PREDICT_INDEX_FILE );
+	if ( len + 1 > sizeof( filename ) )
+		return;
+	infile = fopen( filename, "r" );
+	if ( !infile )
+		return;
+
+	sys_dict->predict_begin = ALC( int, TREE_SIZE + 1 );
+	sys_dict->predict = ALC( int, PREDICT_SIZE );
+	if ( !sys_dict->predict_begin || !sys_dict->predict )
+		goto error;
 
-	offset = 0;
-	pgdata->static_data.tree = (TreeType *) plat_mmap_set_view( &pgdata->static_data.tree_mmap, &offset, &pgdata->static_data.tree_size );
-	if ( !pgdata->static_data.tree )
+	for ( i = 0; i < TREE_SIZE + 1; i++ ) {
+		if ( fscanf( infile, "%d", &sys_dict->predict_begin[ i ] ) != 1 )
+			goto error;
+	}
+	fclose( infile );
+	if ( sys_dict->predict_begin[ TREE_SIZE ] != PREDICT_SIZE )
+		goto error_no_file;
+
+	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, PREDICT_FILE );
+	if ( len + 1 > sizeof( filename ) )
+		goto error_no_file;
+	infile = fopen( filename, "r" );
+	if ( !infile )
+		goto error_no_file;
+	for ( i = 0; i < PREDICT_SIZE; i++ ) {
+		if ( fscanf( infile, "%d", &sys_dict->predict[ i ] ) != 1 )
+			goto error;
+	}
+	sys_dict->predict_size = PREDICT_SIZE;
+	fclose( infile );
+	return;
+
+error:
+	fclose( infile );
+error_no_file:
+	free( sys_dict->predict_begin );
+	sys_dict->predict_begin = NULL;
+	free( sys_dict->predict );
+	sys_dict->predict = NULL;
+#endif
+}
+
+/* The reverse index is optional as well. */
+static void InitReverseIndex( SystemDictData *sys_dict, const char *prefix )
+{
+#ifdef USE_BINARY_DATA
+	sys_dict->reverse_index = (ReverseIndexType *) GetDictSection( sys_dict,
+		SECTION_REVERSE_INDEX, sizeof( ReverseIndexType ), &sys_dict->reverse_index_size );
+	if ( sys_dict->reverse_index && ! IsReverseIndexValid( sys_dict ) )
+		sys_dict->reverse_index = NULL;
+#else
+	char filename[ PATH_MAX ];
+	int len;
+	FILE *infile = NULL;
+	ReverseIndexType *entry;
+	uint16_t phone;
+	size_t i;
+	int j;
+
+	len = snprintf( filename, sizeof( filename ), "%s" PLAT_SEPARATOR "%s", prefix, REVERSE_INDEX_FILE );
+	if ( len + 1 > sizeof( filename ) )
+		return;
+	infile = fopen( filename, "r" );
+	if ( !infile )
+		return;
+
+	sys_dict->reverse_index = ALC( ReverseIndexType, REVERSE_INDEX_SIZE );
+	if ( !sys_dict->reverse_index )
+		goto error;
+
+	for ( i = 0; i < REVERSE_INDEX_SIZE; i++ ) {
+		entry = &sys_dict->reverse_index[ i ];
+		if ( fscanf( infile, "%d%d", &entry->dict_offset, &entry->phrase_id ) != 2 )
+			goto error;
+		for ( j = 0; j <= MAX_PHRASE_LEN; j++ ) {
+			if ( fscanf( infile, "%hu", &phone ) != 1 )
+				goto error;
+			if ( phone == 0 )
+				break;
+			if ( j == MAX_PHRASE_LEN )
+				goto error;
+			entry->phone[ j ] = phone;
+		}
+	}
+	sys_dict->reverse_index_size = REVERSE_INDEX_SIZE;
+	fclose( infile );
+	return;
+
+error:
+	fclose( infile );
+	free( sys_dict->reverse_index );
+	sys_dict->reverse_index = NULL;
+#endif
+}
+
+int InitTree( SystemDictData *sys_dict, const char * prefix )
+{
+#ifdef USE_BINARY_DATA
+	size_t num;
+
+	sys_dict->tree = (TreeType *) GetDictSection( sys_dict,
+		SECTION_TREE, sizeof( TreeType ), &num );
+	if ( !sys_dict->tree )
+		return -1;
+	sys_dict->tree_size = num * sizeof( TreeType );
+	if ( ! IsTreeValid( sys_dict ) )
 		return -1;
 
+	InitAbbrTree( sys_dict, prefix );
+	InitPredict( sys_dict, prefix );
+	InitReverseIndex( sys_dict, prefix );
 	return 0;
 #else
 	char filename[ PATH_MAX ];
@@ -136,8 +391,8 @@ int InitTree( ChewingData *pgdata, const char * prefix )
 	if ( !infile )
 		return -1;
 
-	pgdata->static_data.tree = ALC( TreeType, TREE_SIZE );
-	if ( !pgdata->static_data.tree ) {
+	sys_dict->tree = ALC( TreeType, TREE_SIZE );
+	if ( !sys_dict->tree ) {
 		fclose( infile );
 		return -1;
 	}
@@ -145,14 +400,17 @@ int InitTree( ChewingData *pgdata, const char * prefix )
 	/* XXX: What happen if infile contains more than TREE_SIZE data? */
 	for ( i = 0; i < TREE_SIZE; i++ ) {
 		if ( fscanf( infile, "%hu%d%d%d",
-					&pgdata->static_data.tree[ i ].phone_id,
-					&pgdata->static_data.tree[ i ].phrase_id,
-					&pgdata->static_data.tree[ i ].child_begin,
-					&pgdata->static_data.tree[ i ].child_end ) != 4 )
+					&sys_dict->tree[ i ].phone_id,
+					&sys_dict->tree[ i ].phrase_id,
+					&sys_dict->tree[ i ].child_begin,
+					&sys_dict->tree[ i ].child_end ) != 4 )
 			break;
 	}
 
 	fclose( infile );
+	InitAbbrTree( sys_dict, prefix );
+	InitPredict( sys_dict, prefix );
+	InitReverseIndex( sys_dict, prefix );
 	return 0;
 #endif
 }
@@ -166,6 +424,23 @@ static int CheckBreakpoint( int from, int to, int bArrBrkpt[] )
 	return 1;
 }
 
+/*
+ * Return 1 if characters [ c.from, c.to ) of a phrase starting at from are
+ * selectStr. offset is the byte offset of num characters of the phrase.
+ */
+static int IsSelectedText(
+		const char *phrase, const int offset[], int num,
+		int from, IntervalType c, const char *selectStr )
+{
+	int bytes;
+
+	if ( c.to - from > num )
+		return 0;
+	bytes = offset[ c.to - from ] - offset[ c.from - from ];
+	return bytes == (int) strlen( selectStr ) &&
+		! memcmp( phrase + offset[ c.from - from ], selectStr, bytes );
+}
+
 static int CheckUserChoose( 
 		ChewingData *pgdata,
 		uint16_t *new_phoneSeq, int from , int to,
@@ -174,8 +449,10 @@ static int CheckUserChoose(
 		IntervalType selectInterval[], int nSelect )
 {
 	IntervalType inte, c;
-	int chno, len;
+	int chno, num;
+	int offset[ MAX_PHONE_SEQ_LEN + 1 ];
 	int user_alloc;
+	UserPhraseIterator user_iter;
 	UserPhraseData *pUserPhraseData;
 	Phrase *p_phr = ALC( Phrase, 1 );
 
@@ -200,9 +477,10 @@ static int CheckUserChoose(
 	 * if there exist one phrase satisfied all selectStr then return 1, else return 0.
 	 * also store the phrase with highest freq
 	 */
-	pUserPhraseData = UserGetPhraseFirst( pgdata, new_phoneSeq );
+	pUserPhraseData = UserGetPhraseFirst( pgdata, &user_iter, new_phoneSeq );
 	p_phr->freq = -1;
 	do {
+		num = ueStrOffset( pUserPhraseData->wordSeq, offset, to - from );
 		for ( chno = 0; chno < nSelect; chno++ ) {
 			c = selectInterval[ chno ];
 
@@ -211,11 +489,8 @@ static int CheckUserChoose(
 				 * find a phrase of ph_id where the text contains 
 				 * 'selectStr[chno]' test if not ok then return 0, 
 				 * if ok then continue to test. */
-				len = c.to - c.from;
-				if ( memcmp(
-					ueStrSeek( pUserPhraseData->wordSeq, c.from - from ),
-					selectStr[ chno ],
-					ueStrNBytes( selectStr[ chno ], len ) ) )
+				if ( ! IsSelectedText( pUserPhraseData->wordSeq, offset, num,
+					from, c, selectStr[ chno ] ) )
 					break;
 			}
 
@@ -232,7 +507,7 @@ static int CheckUserChoose(
 				*pp_phr = p_phr;
 			}
 		}
-	} while ( ( pUserPhraseData = UserGetPhraseNext( pgdata, new_phoneSeq ) ) != NULL );
+	} while ( ( pUserPhraseData = UserGetPhraseNext( pgdata, &user_iter, new_phoneSeq ) ) != NULL );
 
 	if ( p_phr->freq != -1 ) 
 		return 1;
@@ -246,12 +521,14 @@ static int CheckUserChoose(
  * their intersections are the same */
 static int CheckChoose(
 		ChewingData *pgdata,
-		int ph_id, int from, int to, Phrase **pp_phr, 
+		const uint16_t phoneSeq[], int from, int to, Phrase **pp_phr, 
 		char selectStr[][ MAX_PHONE_SEQ_LEN * MAX_UTF8_SIZE + 1 ], 
 		IntervalType selectInterval[], int nSelect )
 {
 	IntervalType inte, c;
-	int chno, len;
+	int chno, num;
+	int offset[ MAX_PHONE_SEQ_LEN + 1 ];
+	PhraseIterator iter;
 	Phrase *phrase = ALC( Phrase, 1 );
 
 	assert( phrase );
@@ -260,21 +537,19 @@ static int CheckChoose(
 	*pp_phr = NULL;
 
 	/* if there exist one phrase satisfied all selectStr then return 1, else return 0. */
-	GetPhraseFirst( pgdata, phrase, ph_id );
+	GetPhraseFirst( pgdata, &iter, phrase, phoneSeq );
 	do {
+		num = ueStrOffset( phrase->phrase, offset, to - from );
 		for ( chno = 0; chno < nSelect; chno++ ) {
 			c = selectInterval[ chno ];
 
 			if ( IsContain( inte, c ) ) {
-				/* find a phrase of ph_id where the text contains 
+				/* find a phrase of phoneSeq where the text contains 
 				 * 'selectStr[chno]' test if not ok then return 0, if ok 
 				 * then continue to test
 				 */
-				len = c.to - c.from;
-				if ( memcmp(
-					ueStrSeek( phrase->phrase, c.from - from ),
-					selectStr[ chno ],
-					ueStrNBytes( selectStr[ chno ], len ) ) )
+				if ( ! IsSelectedText( phrase->phrase, offset, num,
+					from, c, selectStr[ chno ] ) )
 					break;
 			}
 			else if ( IsIntersect( inte, selectInterval[ chno ] ) ) {
@@ -286,39 +561,335 @@ static int CheckChoose(
 			*pp_phr = phrase;
 			return 1;
 		}
-	} while ( GetPhraseNext( pgdata, phrase ) );
+	} while ( GetPhraseNext( pgdata, &iter, phrase ) );
 	free( phrase );
 	return 0;
 }
 
-/** @brief search for the phrases have the same pronunciation.*/
-/* if phoneSeq[a] ~ phoneSeq[b] is a phrase, then add an interval
- * from (a) to (b+1) */
-int TreeFindPhrase( ChewingData *pgdata, int begin, int end, const uint16_t *phoneSeq )
+/* Return the node of phoneSeq[ begin .. end ] in the phone tree, or -1. */
+static int TreeFindNode( const SystemDictData *sys_dict, int begin, int end, const uint16_t *phoneSeq )
 {
 	int child, tree_p, i;
 
 	tree_p = 0;
 	for ( i = begin; i <= end; i++ ) {
 		for ( 
-			child = pgdata->static_data.tree[ tree_p ].child_begin;
-			child != -1 && child <= pgdata->static_data.tree[ tree_p ].child_end;
+			child = sys_dict->tree[ tree_p ].child_begin;
+			child != -1 && child <= sys_dict->tree[ tree_p ].child_end;
 			child++ ) {
-
-#ifdef USE_BINARY_DATA
-			assert(0 <= child && child * sizeof(TreeType) < pgdata->static_data.tree_size);
-#endif
-			if ( pgdata->static_data.tree[ child ].phone_id == phoneSeq[ i ] )
+			if ( sys_dict->tree[ child ].phone_id == phoneSeq[ i ] )
 				break;
 		}
 		/* if not found any word then fail. */
-		if ( child == -1 || child > pgdata->static_data.tree[ tree_p ].child_end )
+		if ( child == -1 || child > sys_dict->tree[ tree_p ].child_end )
 			return -1;
 		else {
 			tree_p = child;
 		}
 	}
-	return pgdata->static_data.tree[ tree_p ].phrase_id;
+	return tree_p;
+}
+
+/* Return the phrase id of phoneSeq[ begin .. end ] in sys_dict, or -1. */
+int TreeFindDictPhrase( const SystemDictData *sys_dict, int begin, int end, const uint16_t *phoneSeq )
+{
+	int tree_p;
+
+	tree_p = TreeFindNode( sys_dict, begin, end, phoneSeq );
+	if ( tree_p == -1 )
+		return -1;
+	return sys_dict->tree[ tree_p ].phrase_id;
+}
+
+/** @brief search for the phrases have the same pronunciation.*/
+/* if phoneSeq[a] ~ phoneSeq[b] is a phrase, then add an interval
+ * from (a) to (b+1)
+ *
+ * Return the phrase id in the first dictionary layer having the phrases, or
+ * -1. Use GetPhraseFirst to read the phrases of all layers. */
+int TreeFindPhrase( ChewingData *pgdata, int begin, int end, const uint16_t *phoneSeq )
+{
+	const ChewingStaticData *static_data = &pgdata->static_data;
+	int phrase_id;
+	int i;
+
+	for ( i = 0; i < static_data->dict_layer_num; i++ ) {
+		phrase_id = TreeFindDictPhrase( static_data->dict_layer[ i ], begin, end, phoneSeq );
+		if ( phrase_id != -1 )
+			return phrase_id;
+	}
+	return -1;
+}
+
+/**
+ * @brief find the most frequent phrases which start with phoneSeq.
+ *
+ * The phrases are longer than phoneSeq, and in descending order of frequency.
+ *
+ * @param offset receives offsets in the phrase file, which can be used with
+ * GetPhraseByOffset.
+ *
+ * @return number of offsets, up to PREDICT_TOP_K, or 0 if none.
+ */
+int TreePredictPhrase( ChewingData *pgdata, const uint16_t phoneSeq[], int len, const int **offset )
+{
+	const SystemDictData *sys_dict = pgdata->static_data.sys_dict;
+	int tree_p;
+
+	*offset = NULL;
+	if ( !sys_dict->predict_begin || len < 0 || len > MAX_PHRASE_LEN )
+		return 0;
+
+	tree_p = TreeFindNode( sys_dict, 0, len - 1, phoneSeq );
+	if ( tree_p == -1 )
+		return 0;
+
+	*offset = &sys_dict->predict[ sys_dict->predict_begin[ tree_p ] ];
+	return sys_dict->predict_begin[ tree_p + 1 ] - sys_dict->predict_begin[ tree_p ];
+}
+
+/**
+ * @brief find phrases by their initials only.
+ *
+ * @param initial initials of the phrase, see INITIAL_FROM_PHONE.
+ * @param posting receives phrase ids, which can be used with GetDictPhraseFirst
+ *                on the system dictionary.
+ *
+ * @return number of phrase ids, or 0 if none.
+ */
+int AbbrFindPhrase( ChewingData *pgdata, const uint16_t initial[], int len, const int **posting )
+{
+	const SystemDictData *sys_dict = pgdata->static_data.sys_dict;
+	const AbbrTreeType *tree = sys_dict->abbr_tree;
+	int node = 0;
+	int low, high, mid = 0;
+	int i;
+
+	*posting = NULL;
+	if ( !tree || len <= 0 )
+		return 0;
+
+	for ( i = 0; i < len; i++ ) {
+		/* children are in ascending order of initial */
+		low = tree[ node ].child_begin;
+		high = tree[ node ].child_end;
+		if ( low == -1 )
+			return 0;
+		while ( low <= high ) {
+			mid = ( low + high ) / 2;
+			if ( tree[ mid ].initial < initial[ i ] )
+				low = mid + 1;
+			else if ( tree[ mid ].initial > initial[ i ] )
+				high = mid - 1;
+			else
+				break;
+		}
+		if ( low > high )
+			return 0;
+		node = mid;
+	}
+
+	*posting = &sys_dict->abbr_posting[ tree[ node ].posting_begin ];
+	return tree[ node ].posting_end - tree[ node ].posting_begin;
+}
+
+/*
+ * Compare the phrase of entry with the len bytes of phrase, in the order of
+ * strcmp. If prefix is set, an entry which begins with phrase is equal to it.
+ */
+static int CompReverseIndex( ChewingData *pgdata, const ReverseIndexType *entry,
+	const char *phrase, size_t len, int prefix )
+{
+	int cmp;
+	Phrase dict_phrase;
+	const char *text = dict_phrase.phrase;
+	size_t size;
+#ifdef USE_BINARY_DATA
+	const unsigned char *dict = (const unsigned char *) pgdata->static_data.sys_dict->dict;
+
+	/* A plain record is compared in place. */
+	if ( !pgdata->static_data.sys_dict->dict_charset ) {
+		text = (const char *) dict + entry->dict_offset + 1;
+		size = dict[ entry->dict_offset ];
+	} else
+#endif
+	{
+		GetPhraseByOffset( pgdata, entry->dict_offset, &dict_phrase );
+		size = strlen( text );
+	}
+
+	cmp = memcmp( text, phrase, size < len ? size : len );
+	if ( cmp )
+		return cmp;
+	if ( size < len )
+		return -1;
+	if ( size > len )
+		return prefix ? 0 : 1;
+	return 0;
+}
+
+/*
+ * Find the entries of the len bytes of phrase. If has_longer is not NULL, it
+ * receives whether a longer phrase begins with phrase.
+ */
+static int ReverseFindRange( ChewingData *pgdata, const char *phrase, size_t len,
+	const ReverseIndexType **entry, int *has_longer )
+{
+	const SystemDictData *sys_dict = pgdata->static_data.sys_dict;
+	const ReverseIndexType *index = sys_dict->reverse_index;
+	size_t low, high, mid;
+	size_t end;
+
+	/* find the first entry not less than phrase */
+	low = 0;
+	high = sys_dict->reverse_index_size;
+	while ( low < high ) {
+		mid = ( low + high ) / 2;
+		if ( CompReverseIndex( pgdata, &index[ mid ], phrase, len, 0 ) < 0 )
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	for ( end = low;
+		end < sys_dict->reverse_index_size &&
+		CompReverseIndex( pgdata, &index[ end ], phrase, len, 0 ) == 0;
+		end++ )
+		;
+
+	/* phrases which begin with phrase follow it */
+	if ( has_longer )
+		*has_longer = end < sys_dict->reverse_index_size &&
+			CompReverseIndex( pgdata, &index[ end ], phrase, len, 1 ) == 0;
+
+	*entry = &index[ low ];
+	return end - low;
+}
+
+/**
+ * @brief find the phone sequences of a phrase in the system dictionary.
+ *
+ * @param entry receives the entries of phrase, in ascending order of phone.
+ *
+ * @return number of entries, or 0 if none.
+ */
+int ReverseFindPhrase( ChewingData *pgdata, const char *phrase, const ReverseIndexType **entry )
+{
+	*entry = NULL;
+	if ( !pgdata->static_data.sys_dict->reverse_index || !phrase )
+		return 0;
+	return ReverseFindRange( pgdata, phrase, strlen( phrase ), entry, NULL );
+}
+
+typedef struct {
+	/* number of phrases, where a character without reading counts 2 */
+	int cost;
+	/* sum of frequency of phrases */
+	long long freq;
+	int from;
+	/* NULL if text from .. here has no reading */
+	const ReverseIndexType *reading;
+} AnnotateNode;
+
+/* Bytes of the character at text, where a broken character is cut at the end of text */
+static int CharBytes( const char *text )
+{
+	int bytes = ueBytesFromChar( text[ 0 ] );
+	int i;
+
+	for ( i = 1; i < bytes && text[ i ]; i++ )
+		;
+	return i;
+}
+
+static void RelaxAnnotateNode( AnnotateNode *node, int from, int cost, long long freq,
+	const ReverseIndexType *reading )
+{
+	if ( node->cost == -1 || cost < node->cost ||
+		( cost == node->cost && freq > node->freq ) ) {
+		node->cost = cost;
+		node->freq = freq;
+		node->from = from;
+		node->reading = reading;
+	}
+}
+
+/**
+ * @brief annotate text with phones of the system dictionary.
+ *
+ * Text is segmented into the fewest phrases, then the most frequent ones, so
+ * that a polyphonic character gets the reading of the phrase it is in.
+ *
+ * @param phoneSeq receives one phone per character, 0 for a character
+ * without reading.
+ * @param len size of phoneSeq. Characters after it are not annotated.
+ *
+ * @return number of characters annotated, or -1 if no memory.
+ */
+int AnnotatePhone( ChewingData *pgdata, const char *text, uint16_t phoneSeq[], int len )
+{
+	AnnotateNode *node = NULL;
+	int *offset = NULL;
+	const ReverseIndexType *entry;
+	const ReverseIndexType *reading;
+	Phrase phrase;
+	int num, has_longer;
+	int n, i, j, k;
+	int freq;
+
+	for ( n = 0, i = 0; n < len && text[ i ]; n++ )
+		i += CharBytes( text + i );
+
+	offset = ALC( int, n + 1 );
+	node = ALC( AnnotateNode, n + 1 );
+	if ( !offset || !node ) {
+		free( offset );
+		free( node );
+		return -1;
+	}
+
+	for ( i = 0; i < n; i++ )
+		offset[ i + 1 ] = offset[ i ] + CharBytes( text + offset[ i ] );
+
+	node[ 0 ].cost = 0;
+	for ( i = 1; i <= n; i++ )
+		node[ i ].cost = -1;
+
+	for ( i = 0; i < n; i++ ) {
+		RelaxAnnotateNode( &node[ i + 1 ], i, node[ i ].cost + 2, node[ i ].freq, NULL );
+		if ( !pgdata->static_data.sys_dict->reverse_index )
+			continue;
+
+		for ( j = i + 1; j <= n && j - i <= MAX_PHRASE_LEN; j++ ) {
+			num = ReverseFindRange( pgdata, text + offset[ i ], offset[ j ] - offset[ i ],
+				&entry, &has_longer );
+			/* the most frequent reading of a polyphonic phrase */
+			reading = NULL;
+			freq = 0;
+			for ( k = 0; k < num; k++ ) {
+				GetPhraseByOffset( pgdata, entry[ k ].dict_offset, &phrase );
+				if ( !reading || phrase.freq > freq ) {
+					reading = &entry[ k ];
+					freq = phrase.freq;
+				}
+			}
+			if ( reading )
+				RelaxAnnotateNode( &node[ j ], i, node[ i ].cost + 1,
+					node[ i ].freq + freq, reading );
+			if ( !has_longer )
+				break;
+		}
+	}
+
+	for ( j = n; j > 0; j = i ) {
+		i = node[ j ].from;
+		for ( k = i; k < j; k++ )
+			phoneSeq[ k ] = node[ j ].reading ? node[ j ].reading->phone[ k - i ] : 0;
+	}
+
+	free( offset );
+	free( node );
+	return n;
 }
 
 static void AddInterval(
@@ -364,6 +935,7 @@ static void internal_release_Phrase( UsedPhraseMode mode, Phrase *pUser, Phrase
 static void FindInterval( ChewingData *pgdata, TreeDataType *ptd )
 {
 	int end, begin, pho_id;
+	UserPhraseIterator user_iter;
 	Phrase *p_phrase, *puserphrase, *pdictphrase;
 	UsedPhraseMode i_used_phrase;
 	uint16_t new_phoneSeq[ MAX_PHONE_SEQ_LEN ];
@@ -383,7 +955,7 @@ static void FindInterval( ChewingData *pgdata, TreeDataType *ptd )
 			i_used_phrase = USED_PHRASE_NONE;
 
 			/* check user phrase */
-			if ( UserGetPhraseFirst( pgdata, new_phoneSeq ) &&
+			if ( UserGetPhraseFirst( pgdata, &user_iter, new_phoneSeq ) &&
 					CheckUserChoose( pgdata, new_phoneSeq, begin, end + 1,
 					&p_phrase, pgdata->selectStr, pgdata->selectInterval, pgdata->nSelect ) ) {
 				puserphrase = p_phrase;
@@ -395,7 +967,7 @@ static void FindInterval( ChewingData *pgdata, TreeDataType *ptd )
 				( pho_id != -1 ) && 
 				CheckChoose( 
 					pgdata,
-					pho_id, begin, end + 1, 
+					new_phoneSeq, begin, end + 1, 
 					&p_phrase, pgdata->selectStr,
 					pgdata->selectInterval, pgdata->nSelect ) ) {
 				pdictphrase = p_phrase;
@@ -611,47 +1183,71 @@ static void Discard2( TreeDataType *ptd )
 	ptd->nInterval = nInterval2;
 }
 
-static void LoadChar( ChewingData *pgdata, char *buf, int buf_len, uint16_t phoneSeq[], int nPhoneSeq )
+static void LoadChar( ChewingData *pgdata, char word[][ MAX_UTF8_SIZE + 1 ], uint16_t phoneSeq[], int nPhoneSeq )
 {
 	int i;
-	Word word;
+	Word w;
+	CharIterator iter;
 
-	memset(buf, 0, buf_len);
 	for ( i = 0; i < nPhoneSeq; i++ ) {
-		GetCharFirst( pgdata, &word, phoneSeq[ i ] );
-		strncat(buf, word.word, buf_len - strlen(buf) - 1);
+		if ( GetCharFirst( pgdata, &iter, &w, phoneSeq[ i ] ) )
+			ueStrNCpy( word[ i ], w.word, 1, STRNCPY_CLOSE );
+		else
+			word[ i ][ 0 ] = '\0';
 	}
-	buf[ buf_len - 1 ] = '\0';
 }
 
-/* kpchen said, record is the index array of interval */
+/* Copy characters of str to word[ 0 .. len ) */
+static void LoadWord( char word[][ MAX_UTF8_SIZE + 1 ], const char *str, int len )
+{
+	int i;
+
+	for ( i = 0; i < len && *str != '\0'; i++ )
+		str += ueStrNCpy( word[ i ], str, 1, STRNCPY_CLOSE );
+}
+
+/*
+ * kpchen said, record is the index array of interval
+ *
+ * Characters are collected one per phone first, so that each phrase is copied
+ * once, and then joined to out_buf with the byte offset of each of them.
+ */
 static void OutputRecordStr(
 		ChewingData *pgdata,
-		char *out_buf, int out_buf_len,
+		char *out_buf, int out_buf_len, int *out_offset,
 		int *record, int nRecord, 
 		uint16_t phoneSeq[], int nPhoneSeq,
 		char selectStr[][ MAX_PHONE_SEQ_LEN * MAX_UTF8_SIZE + 1 ], 
 		IntervalType selectInterval[],
 		int nSelect, TreeDataType *ptd )
 {
+	char word[ MAX_PHONE_SEQ_LEN ][ MAX_UTF8_SIZE + 1 ];
 	PhraseIntervalType inter;
-	int i;
+	int i, len, pos = 0;
 
-	LoadChar( pgdata, out_buf, out_buf_len, phoneSeq, nPhoneSeq );
+	LoadChar( pgdata, word, phoneSeq, nPhoneSeq );
 	for ( i = 0; i < nRecord; i++ ) {
 		inter = ptd->interval[ record[ i ] ];
-		ueStrNCpy(
-				ueStrSeek( out_buf, inter.from ),
-				( inter.p_phr )->phrase,
-				( inter.to - inter.from ), -1);
+		LoadWord( &word[ inter.from ], ( inter.p_phr )->phrase,
+			inter.to - inter.from );
 	}
 	for ( i = 0; i < nSelect; i++ ) {
-		inter.from = selectInterval[ i ].from;
-		inter.to = selectInterval[ i ].to ;
-		ueStrNCpy(
-				ueStrSeek( out_buf, inter.from ),
-				selectStr[ i ], ( inter.to - inter.from ), -1);
+		LoadWord( &word[ selectInterval[ i ].from ], selectStr[ i ],
+			selectInterval[ i ].to - selectInterval[ i ].from );
+	}
+
+	for ( i = 0; i < nPhoneSeq; i++ ) {
+		out_offset[ i ] = pos;
+		len = strlen( word[ i ] );
+		if ( pos + len >= out_buf_len )
+			len = 0;
+		memcpy( out_buf + pos, word[ i ], len );
+		pos += len;
 	}
+	/* characters after the end are empty */
+	for ( ; i <= MAX_PHONE_SEQ_LEN; i++ )
+		out_offset[ i ] = pos;
+	out_buf[ pos ] = '\0';
 }
 
 static int rule_largest_sum( int *record, int nRecord, TreeDataType *ptd )
@@ -994,6 +1590,7 @@ int Phrasing( ChewingData *pgdata )
 	OutputRecordStr(
 		pgdata,
 		pgdata->phrOut.chiBuf, sizeof(pgdata->phrOut.chiBuf),
+		pgdata->phrOut.chiOffset,
 		( treeData.phList )->arrIndex, 
 		( treeData.phList )->nInter, 
 		pgdata->phoneSeq,
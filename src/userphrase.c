@@ -42,15 +42,13 @@ static int DeltaFreq( int recentTime )
 #endif
 
 /* load the orginal frequency from the static dict */
-static int LoadOriginalFreq( ChewingData *pgdata, const uint16_t phoneSeq[], const char wordSeq[], int len )
+static int LoadOriginalFreq( ChewingData *pgdata, const uint16_t phoneSeq[], const char wordSeq[] )
 {
-	int pho_id;
 	int retval;
+	PhraseIterator iter;
 	Phrase *phrase = ALC( Phrase, 1 );
 
-	pho_id = TreeFindPhrase( pgdata, 0, len - 1, phoneSeq );
-	if ( pho_id != -1 ) {
-		GetPhraseFirst( pgdata, phrase, pho_id );
+	if ( GetPhraseFirst( pgdata, &iter, phrase, phoneSeq ) ) {
 		do {
 			/* find the same phrase */
 			if ( ! strcmp(
@@ -60,7 +58,7 @@ static int LoadOriginalFreq( ChewingData *pgdata, const uint16_t phoneSeq[], con
 				free( phrase );
 				return retval;
 			}
-		} while ( GetPhraseNext( pgdata, phrase ) );
+		} while ( GetPhraseNext( pgdata, &iter, phrase ) );
 	}
 
 	free( phrase );
@@ -68,28 +66,27 @@ static int LoadOriginalFreq( ChewingData *pgdata, const uint16_t phoneSeq[], con
 }
 
 /* find the maximum frequency of the same phrase */
-static int LoadMaxFreq( ChewingData *pgdata, const uint16_t phoneSeq[], int len )
+static int LoadMaxFreq( ChewingData *pgdata, const uint16_t phoneSeq[] )
 {
-	int pho_id;
+	PhraseIterator iter;
+	UserPhraseIterator user_iter;
 	Phrase *phrase = ALC( Phrase, 1 );
 	int maxFreq = FREQ_INIT_VALUE;
 	UserPhraseData *uphrase;
 
-	pho_id = TreeFindPhrase( pgdata, 0, len - 1, phoneSeq );
-	if ( pho_id != -1 ) {
-		GetPhraseFirst( pgdata, phrase, pho_id );
+	if ( GetPhraseFirst( pgdata, &iter, phrase, phoneSeq ) ) {
 		do {
 			if ( phrase->freq > maxFreq )
 				maxFreq = phrase->freq;
-		} while( GetPhraseNext( pgdata, phrase ) );
+		} while( GetPhraseNext( pgdata, &iter, phrase ) );
 	}
 	free( phrase );
 
-	uphrase = UserGetPhraseFirst( pgdata, phoneSeq );
+	uphrase = UserGetPhraseFirst( pgdata, &user_iter, phoneSeq );
 	while ( uphrase ) {
 		if ( uphrase->userfreq > maxFreq )
 			maxFreq = uphrase->userfreq;
-		uphrase = UserGetPhraseNext( pgdata, phoneSeq );
+		uphrase = UserGetPhraseNext( pgdata, &user_iter, phoneSeq );
 	}	  
 
 	return maxFreq;
@@ -147,8 +144,8 @@ int UserUpdatePhrase( ChewingData *pgdata, const uint16_t phoneSeq[], const char
 		strcpy( data.wordSeq, wordSeq );
 
 		/* load initial freq */
-		data.origfreq = LoadOriginalFreq( pgdata, phoneSeq, wordSeq, len );
-		data.maxfreq = LoadMaxFreq( pgdata, phoneSeq, len );
+		data.origfreq = LoadOriginalFreq( pgdata, phoneSeq, wordSeq );
+		data.maxfreq = LoadMaxFreq( pgdata, phoneSeq );
 
 		data.userfreq = data.origfreq;
 		data.recentTime = pgdata->static_data.chewing_lifetime;
@@ -157,7 +154,7 @@ int UserUpdatePhrase( ChewingData *pgdata, const uint16_t phoneSeq[], const char
 		return USER_UPDATE_INSERT;
 	}
 	else {
-		pItem->data.maxfreq = LoadMaxFreq( pgdata, phoneSeq, len );
+		pItem->data.maxfreq = LoadMaxFreq( pgdata, phoneSeq );
 		pItem->data.userfreq = UpdateFreq( 
 			pItem->data.userfreq, 
 			pItem->data.maxfreq, 
@@ -169,19 +166,19 @@ int UserUpdatePhrase( ChewingData *pgdata, const uint16_t phoneSeq[], const char
 	}
 }
 
-UserPhraseData *UserGetPhraseFirst( ChewingData *pgdata, const uint16_t phoneSeq[] )
+UserPhraseData *UserGetPhraseFirst( ChewingData *pgdata, UserPhraseIterator *iter, const uint16_t phoneSeq[] )
 {
-	pgdata->prev_userphrase = HashFindPhonePhrase( pgdata, phoneSeq, NULL );
-	if ( ! pgdata->prev_userphrase )
+	iter->item = HashFindPhonePhrase( pgdata, phoneSeq, NULL );
+	if ( ! iter->item )
 		return NULL;
-	return &( pgdata->prev_userphrase->data );
+	return &( iter->item->data );
 }
 
-UserPhraseData *UserGetPhraseNext( ChewingData *pgdata, const uint16_t phoneSeq[] )
+UserPhraseData *UserGetPhraseNext( ChewingData *pgdata, UserPhraseIterator *iter, const uint16_t phoneSeq[] )
 {
-	pgdata->prev_userphrase = HashFindPhonePhrase( pgdata, phoneSeq, pgdata->prev_userphrase );
-	if ( ! pgdata->prev_userphrase )
+	iter->item = HashFindPhonePhrase( pgdata, phoneSeq, iter->item );
+	if ( ! iter->item )
 		return NULL;
-	return &( pgdata->prev_userphrase->data );
+	return &( iter->item->data );
 }
 
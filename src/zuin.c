@@ -93,9 +93,14 @@ static int IsDACHENCP26PhoEndKey( int pho_inx[], int key )
 	}
 }
 
-static int IsDefPhoEndKey( int key, int kbtype )
+static const KeyTable *GetKeyTable( ChewingData *pgdata, ZuinData *pZuin )
 {
-	if ( PhoneInxFromKey( key, 3, kbtype, 1 )  )
+	return &pgdata->static_data.key_table[ pZuin->kbtype ];
+}
+
+static int IsDefPhoEndKey( const KeyTable *table, int key )
+{
+	if ( PhoneInxFromKeyTable( table, key, 3, 1 )  )
 		return 1;
 	
 	if ( key == ' ' )
@@ -103,11 +108,12 @@ static int IsDefPhoEndKey( int key, int kbtype )
 	return 0;
 }
 
-static int EndKeyProcess( ChewingData *pgdata, ZuinData *pZuin, int key, int searchTimes )
+/* Commit the phone in pZuin with tone, which is the tone of key. */
+static int EndKeyProcess( ChewingData *pgdata, ZuinData *pZuin, int key, int tone )
 {
 	uint16_t u16Pho, u16PhoAlt;
 	Word tempword;
-	int pho_inx;
+	CharIterator iter;
 
 	if ( 
 		pZuin->pho_inx[ 0 ] == 0 && 
@@ -123,19 +129,18 @@ static int EndKeyProcess( ChewingData *pgdata, ZuinData *pZuin, int key, int sea
 		return (key == ' ') ? ZUIN_KEY_ERROR : ZUIN_NO_WORD;
 	}
 
-	pho_inx = PhoneInxFromKey( key, 3, pZuin->kbtype, searchTimes );
 	if ( pZuin->pho_inx[ 3 ] == 0 ) {
-		pZuin->pho_inx[ 3 ] = pho_inx;
-		pZuin->pho_inx_alt[ 3 ] = pho_inx;
+		pZuin->pho_inx[ 3 ] = tone;
+		pZuin->pho_inx_alt[ 3 ] = tone;
 	}
 	else if ( key != ' ' ) {
-		pZuin->pho_inx[ 3 ] = pho_inx;
-		pZuin->pho_inx_alt[ 3 ] = pho_inx;
+		pZuin->pho_inx[ 3 ] = tone;
+		pZuin->pho_inx_alt[ 3 ] = tone;
 		return ZUIN_NO_WORD;
 	}
 
 	u16Pho = UintFromPhoneInx( pZuin->pho_inx );
-	if ( GetCharFirst( pgdata, &tempword, u16Pho ) == 0 ) {
+	if ( GetCharFirst( pgdata, &iter, &tempword, u16Pho ) == 0 ) {
 		ZuinRemoveAll( pZuin );
 		return ZUIN_NO_WORD;
 	}
@@ -158,103 +163,100 @@ static int EndKeyProcess( ChewingData *pgdata, ZuinData *pZuin, int key, int sea
 	return ZUIN_COMMIT;
 }
 
-static int DefPhoInput( ChewingData *pgdata, ZuinData *pZuin, int key )
-	/* FIXME: Remove pZuin parameter */
+static int DefTransition( const KeyTable *table, int pho_inx[], int key, int *tone )
 {
 	int type = 0, inx = 0;
 	int i;
 
-	if ( IsDefPhoEndKey( key, pZuin->kbtype ) ) {
+	if ( IsDefPhoEndKey( table, key ) ) {
 		for ( i = 0; i < ZUIN_SIZE; ++i )
-			if ( pZuin->pho_inx[ i ] != 0 )
+			if ( pho_inx[ i ] != 0 )
 				break;
-		if ( i < ZUIN_SIZE )
-			return EndKeyProcess( pgdata, pZuin, key, 1 );
+		if ( i < ZUIN_SIZE ) {
+			*tone = PhoneInxFromKeyTable( table, key, 3, 1 );
+			return ZUIN_ACTION_END;
+		}
 	}
 	else {
-		pZuin->pho_inx[ 3 ] = 0;
+		pho_inx[ 3 ] = 0;
 	}
 
 	/* decide if the key is a phone */
-	for ( type = 0; type <= 3; type++ ) {
-		inx = PhoneInxFromKey( key, type, pZuin->kbtype, 1 );
-		if ( inx )
-			break;
-	}
+	inx = PhoneFromKeyTable( table, key, 1, &type );
 	
 	/* the key is NOT a phone */
-	if ( type > 3 ) {
-		return ZUIN_KEY_ERROR;
+	if ( ! inx ) {
+		return ZUIN_ACTION_KEY_ERROR;
 	}
 
 	/* fill the key into the phone buffer */
-	pZuin->pho_inx[ type ] = inx;
-	return ZUIN_ABSORB;
+	pho_inx[ type ] = inx;
+	return ZUIN_ACTION_ABSORB;
 }
 
-static int HsuPhoInput( ChewingData *pgdata, ZuinData *pZuin, int key )
-	/* FIXME: Remove pZuin parameter */
+static int HsuTransition( const KeyTable *table, int pho_inx[], int key, int *tone )
 {
 	int type = 0, searchTimes = 0, inx = 0;
 
 	/* Dvorak Hsu key has already converted to Hsu */
-	if ( IsHsuPhoEndKey( pZuin->pho_inx, key ) ) {
-		if ( pZuin->pho_inx[ 1 ] == 0 && pZuin->pho_inx[ 2 ] == 0 ) {
+	if ( IsHsuPhoEndKey( pho_inx, key ) ) {
+		if ( pho_inx[ 1 ] == 0 && pho_inx[ 2 ] == 0 ) {
 			/* convert "ㄐㄑㄒ" to "ㄓㄔㄕ" */
-			if ( 12 <= pZuin->pho_inx[ 0 ] && pZuin->pho_inx[ 0 ] <= 14 ) {
-				pZuin->pho_inx[ 0 ] += 3 ;
+			if ( 12 <= pho_inx[ 0 ] && pho_inx[ 0 ] <= 14 ) {
+				pho_inx[ 0 ] += 3 ;
 			}
 			/* convert "ㄏ" to "ㄛ" */
-			else if ( pZuin->pho_inx[ 0 ] == 11 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 2;
+			else if ( pho_inx[ 0 ] == 11 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 2;
 			}
 			/* convert "ㄍ" to "ㄜ" */
-			else if ( pZuin->pho_inx[ 0 ] == 9 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 3;
+			else if ( pho_inx[ 0 ] == 9 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 3;
 			}
 			/* convert "ㄇ" to "ㄢ" */
-			else if ( pZuin->pho_inx[ 0 ] == 3 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 9;
+			else if ( pho_inx[ 0 ] == 3 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 9;
 			}
 			/* convert "ㄋ" to "ㄣ" */
-			else if ( pZuin->pho_inx[ 0 ] == 7 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 10;
+			else if ( pho_inx[ 0 ] == 7 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 10;
 			}
 			/* convert "ㄎ" to "ㄤ" */
-			else if ( pZuin->pho_inx[ 0 ] == 10 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 11;
+			else if ( pho_inx[ 0 ] == 10 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 11;
 			}
 			/* convert "ㄌ" to "ㄦ" */
-			else if ( pZuin->pho_inx[ 0 ] == 8 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 13;
+			else if ( pho_inx[ 0 ] == 8 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 13;
 			}
 		}
 
 		if (
-			( pZuin->pho_inx[ 0 ] == 9 ) && 
-			( ( pZuin->pho_inx[ 1 ] == 1 ) || 
-				( pZuin->pho_inx[ 1 ] == 3 ) ) ) {
-			pZuin->pho_inx[ 0 ] = 12;
+			( pho_inx[ 0 ] == 9 ) && 
+			( ( pho_inx[ 1 ] == 1 ) || 
+				( pho_inx[ 1 ] == 3 ) ) ) {
+			pho_inx[ 0 ] = 12;
 		}
 
 		searchTimes = ( key == 'j' ) ? 3 : 2;
 
-		return EndKeyProcess( pgdata, pZuin, key, searchTimes );
+		*tone = PhoneInxFromKeyTable( table, key, 3, searchTimes );
+		return ZUIN_ACTION_END;
 	}
 	else {
 		/* decide if the key is a phone */
 		for ( type = 0, searchTimes = 1; type < 3; type++ ) {
-			inx = PhoneInxFromKey( key, type, pZuin->kbtype, searchTimes );
+			inx = PhoneInxFromKeyTable( table, key, type, searchTimes );
 			if ( ! inx )
 				continue; /* if inx == 0, next type */
 			else if ( type == 0 ) {
-				if ( pZuin->pho_inx[ 0 ] || pZuin->pho_inx[ 1 ] ) {
+				if ( pho_inx[ 0 ] || pho_inx[ 1 ] ) {
 					/* if inx !=0 */
 					searchTimes = 2 ; /* possible infinite loop here */
 				}
@@ -262,7 +264,7 @@ static int HsuPhoInput( ChewingData *pgdata, ZuinData *pZuin, int key )
 					break;
 			}
 			else if ( type == 1 && inx == 1 ) { /* handle i and e*/
-				if ( pZuin->pho_inx[ 1 ] ) {
+				if ( pho_inx[ 1 ] ) {
 					searchTimes = 2;
 				}
 				else 
@@ -275,92 +277,92 @@ static int HsuPhoInput( ChewingData *pgdata, ZuinData *pZuin, int key )
 		if ( 
 			type == 1 && 
 			inx == 2 && 
-			12 <= pZuin->pho_inx[ 0 ] && 
-			pZuin->pho_inx[ 0 ] <= 14 ) {
-			pZuin->pho_inx[ 0 ] += 3;
+			12 <= pho_inx[ 0 ] && 
+			pho_inx[ 0 ] <= 14 ) {
+			pho_inx[ 0 ] += 3;
 		}
 
 		/* Fuzzy "g e" to "j e" */
 		if (
-			( pZuin->pho_inx[ 0 ] == 9 ) && 
-			( ( pZuin->pho_inx[ 1 ] == 1 ) || ( pZuin->pho_inx[ 1 ] == 3 ) ) ) {
-			pZuin->pho_inx[ 0 ] = 12;
+			( pho_inx[ 0 ] == 9 ) && 
+			( ( pho_inx[ 1 ] == 1 ) || ( pho_inx[ 1 ] == 3 ) ) ) {
+			pho_inx[ 0 ] = 12;
 		}
 
 		/* ㄐㄑㄒ must follow ㄧㄩ */
 		if (
 			type == 2 && 
-			pZuin->pho_inx[ 1 ] == 0 && 
-			12 <= pZuin->pho_inx[ 0 ] && 
-			pZuin->pho_inx[ 0 ] <= 14 ) {
-			pZuin->pho_inx[ 0 ] += 3;
+			pho_inx[ 1 ] == 0 && 
+			12 <= pho_inx[ 0 ] && 
+			pho_inx[ 0 ] <= 14 ) {
+			pho_inx[ 0 ] += 3;
 		}
 
 		if ( type == 3 ) { /* the key is NOT a phone */
 			if ( isalpha( key ) )
-				return ZUIN_NO_WORD;
-			return ZUIN_KEY_ERROR;
+				return ZUIN_ACTION_NO_WORD;
+			return ZUIN_ACTION_KEY_ERROR;
 		}
 		/* fill the key into the phone buffer */
-		pZuin->pho_inx[ type ] = inx;
-		return ZUIN_ABSORB;
+		pho_inx[ type ] = inx;
+		return ZUIN_ACTION_ABSORB;
 	}
 }
 
 /* copy the idea from hsu */
-static int ET26PhoInput( ChewingData *pgdata, ZuinData *pZuin, int key )
-	/* FIXME: Remove pZuin parameter */
+static int ET26Transition( const KeyTable *table, int pho_inx[], int key, int *tone )
 {
 	int type = 0, searchTimes = 0, inx = 0;
 
-	if ( IsET26PhoEndKey( pZuin->pho_inx, key ) ) {
-		if ( pZuin->pho_inx[ 1 ] == 0 && pZuin->pho_inx[ 2 ] == 0 ) {
+	if ( IsET26PhoEndKey( pho_inx, key ) ) {
+		if ( pho_inx[ 1 ] == 0 && pho_inx[ 2 ] == 0 ) {
 			/* convert "ㄐㄒ" to "ㄓㄕ" */
-			if ( pZuin->pho_inx[ 0 ] == 12 || pZuin->pho_inx[ 0 ] == 14 ) {
-				pZuin->pho_inx[ 0 ] += 3;
+			if ( pho_inx[ 0 ] == 12 || pho_inx[ 0 ] == 14 ) {
+				pho_inx[ 0 ] += 3;
 			}
 			/* convert "ㄆ" to "ㄡ" */
-			else if ( pZuin->pho_inx[ 0 ] == 2 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 8;
+			else if ( pho_inx[ 0 ] == 2 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 8;
 			}
 			/* convert "ㄇ" to "ㄢ" */
-			else if ( pZuin->pho_inx[ 0 ] == 3 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 9;
+			else if ( pho_inx[ 0 ] == 3 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 9;
 			}
 			/* convert "ㄋ" to "ㄣ" */
-			else if ( pZuin->pho_inx[ 0 ] == 7) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 10;
+			else if ( pho_inx[ 0 ] == 7) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 10;
 			}
 			/* convert "ㄊ" to "ㄤ" */
-			else if ( pZuin->pho_inx[ 0 ] == 6 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 11;
+			else if ( pho_inx[ 0 ] == 6 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 11;
 			}
 			/* convert "ㄌ" to "ㄥ" */
-			else if ( pZuin->pho_inx[ 0 ] == 8 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 12;
+			else if ( pho_inx[ 0 ] == 8 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 12;
 			}
 			/* convert "ㄏ" to "ㄦ" */
-			else if ( pZuin->pho_inx[ 0 ] == 11 ) {
-				pZuin->pho_inx[ 0 ] = 0;
-				pZuin->pho_inx[ 2 ] = 13;
+			else if ( pho_inx[ 0 ] == 11 ) {
+				pho_inx[ 0 ] = 0;
+				pho_inx[ 2 ] = 13;
 			}
 		}
 		searchTimes = 2;
-		return EndKeyProcess( pgdata, pZuin, key, searchTimes );
+		*tone = PhoneInxFromKeyTable( table, key, 3, searchTimes );
+		return ZUIN_ACTION_END;
 	}
 	else {
 		/* decide if the key is a phone */
 		for ( type = 0, searchTimes = 1; type < 3; type++ ) {
-			inx = PhoneInxFromKey( key, type, pZuin->kbtype, searchTimes );
+			inx = PhoneInxFromKeyTable( table, key, type, searchTimes );
 			if ( ! inx ) 
 				continue; /* if inx == 0, next type */
 			else if ( type == 0 ) {
-				if ( pZuin->pho_inx[ 0 ] || pZuin->pho_inx[ 1 ] ) {
+				if ( pho_inx[ 0 ] || pho_inx[ 1 ] ) {
 					/* if inx !=0 */
 					searchTimes = 2 ; /* possible infinite loop here */
 				}
@@ -374,55 +376,55 @@ static int ET26PhoInput( ChewingData *pgdata, ZuinData *pZuin, int key )
 		if ( type == 1 ) {
 			if ( inx == 2 ) {
 				if ( 
-					pZuin->pho_inx[ 0 ] == 12 || 
-					pZuin->pho_inx[ 0 ] == 14 ) {
-					pZuin->pho_inx[ 0 ] += 3;
+					pho_inx[ 0 ] == 12 || 
+					pho_inx[ 0 ] == 14 ) {
+					pho_inx[ 0 ] += 3;
 				}
 			}
 			else {
 				/* convert "ㄍ" to "ㄑ" */
-				if ( pZuin->pho_inx[ 0 ] == 9 ) {
-					pZuin->pho_inx[ 0 ] = 13;	
+				if ( pho_inx[ 0 ] == 9 ) {
+					pho_inx[ 0 ] = 13;	
 				}
 			}
 		}
 
 		if ( 
 			type == 2 && 
-			pZuin->pho_inx[ 1 ] == 0 && 
-			(pZuin->pho_inx[ 0 ] == 12 || pZuin->pho_inx[ 0 ] == 14 ) ) {
-			pZuin->pho_inx[ 0 ] += 3;
+			pho_inx[ 1 ] == 0 && 
+			(pho_inx[ 0 ] == 12 || pho_inx[ 0 ] == 14 ) ) {
+			pho_inx[ 0 ] += 3;
 		}
 
 		if ( type == 3 ) { /* the key is NOT a phone */
 			if ( isalpha( key ) )
-				return ZUIN_NO_WORD;
-			return ZUIN_KEY_ERROR;
+				return ZUIN_ACTION_NO_WORD;
+			return ZUIN_ACTION_KEY_ERROR;
 		}
 		/* fill the key into the phone buffer */
-		pZuin->pho_inx[ type ] = inx;
-		return ZUIN_ABSORB;
+		pho_inx[ type ] = inx;
+		return ZUIN_ACTION_ABSORB;
 	}
 }
 
-static int DACHENCP26PhoInput( ChewingData *pgdata, ZuinData *pZuin, int key )
-	/* FIXME: Remove pZuin parameter */
+static int DACHENCP26Transition( const KeyTable *table, int pho_inx[], int key, int *tone )
 {
 	int type = 0, searchTimes = 0, inx = 0;
 
-	if ( IsDACHENCP26PhoEndKey( pZuin->pho_inx, key ) ) {
+	if ( IsDACHENCP26PhoEndKey( pho_inx, key ) ) {
 		searchTimes = 2;
-		return EndKeyProcess( pgdata, pZuin, key, searchTimes );
+		*tone = PhoneInxFromKeyTable( table, key, 3, searchTimes );
+		return ZUIN_ACTION_END;
 	}
 	else {
 		/* decide if the key is a phone */
 		for ( type = 0, searchTimes = 1; type < 3; type++ ) {
-			inx = PhoneInxFromKey( key, type, pZuin->kbtype, searchTimes );
+			inx = PhoneInxFromKeyTable( table, key, type, searchTimes );
 			if ( ! inx ) 
 				continue; /* if inx == 0, next type */
 			else if ( type == 0 ) {
 				break;
-				if ( pZuin->pho_inx[ 0 ] || pZuin->pho_inx[ 1 ] ) {
+				if ( pho_inx[ 0 ] || pho_inx[ 1 ] ) {
 					/* if inx !=0 */
 					searchTimes = 2 ; /* possible infinite loop here */
 				}
@@ -434,134 +436,427 @@ static int DACHENCP26PhoInput( ChewingData *pgdata, ZuinData *pZuin, int key )
 		}
 		/* switching between "ㄅ" and "ㄆ" */
 		if ( key == 'q' ) {
-			if ( pZuin->pho_inx[ 0 ] == 1  ) {
-			 	pZuin->pho_inx[ 0 ] = 2;
-				return ZUIN_ABSORB;
-			} else if ( pZuin->pho_inx[0] == 2) {
-				pZuin->pho_inx[ 0 ] = 1;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 0 ] == 1  ) {
+			 	pho_inx[ 0 ] = 2;
+				return ZUIN_ACTION_ABSORB;
+			} else if ( pho_inx[0] == 2) {
+				pho_inx[ 0 ] = 1;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		/* switching between "ㄉ" and "ㄊ" */
 		else if ( key == 'w' ) {
-			if ( pZuin->pho_inx[ 0 ] == 5  ) {
-			 	pZuin->pho_inx[ 0 ] = 6;
-				return ZUIN_ABSORB;
-			} else if ( pZuin->pho_inx[0] == 6) {
-				pZuin->pho_inx[ 0 ] = 5;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 0 ] == 5  ) {
+			 	pho_inx[ 0 ] = 6;
+				return ZUIN_ACTION_ABSORB;
+			} else if ( pho_inx[0] == 6) {
+				pho_inx[ 0 ] = 5;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		/* switching between "ㄓ" and "ㄔ" */
 		else if ( key == 't' ) {
-			if ( pZuin->pho_inx[ 0 ] == 15  ) {
-			 	pZuin->pho_inx[ 0 ] = 16;
-				return ZUIN_ABSORB;
-			} else if ( pZuin->pho_inx[0] == 16) {
-				pZuin->pho_inx[ 0 ] = 15;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 0 ] == 15  ) {
+			 	pho_inx[ 0 ] = 16;
+				return ZUIN_ACTION_ABSORB;
+			} else if ( pho_inx[0] == 16) {
+				pho_inx[ 0 ] = 15;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		/* converting "ㄖ" to "ㄝ" */
 		else if ( key == 'b' ) {
-			if ( pZuin->pho_inx[ 0 ] != 0 || pZuin->pho_inx[1] != 0 ) {
-			pZuin->pho_inx[ 2 ] = 4;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 0 ] != 0 || pho_inx[1] != 0 ) {
+			pho_inx[ 2 ] = 4;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		/* converting "ㄙ" to "ㄣ" */
 		else if ( key == 'n' ) {
-			if ( pZuin->pho_inx[ 0 ] != 0 || pZuin->pho_inx[1] != 0 ) {
-				pZuin->pho_inx[ 2 ] = 12;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 0 ] != 0 || pho_inx[1] != 0 ) {
+				pho_inx[ 2 ] = 12;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		/* switching between "ㄧ", "ㄚ", and "ㄧㄚ" */
 		else if ( key == 'u' ) {
-			if ( pZuin->pho_inx[ 1 ] == 1 && pZuin->pho_inx[ 2 ] != 1 ) {
-				pZuin->pho_inx[1] = 0;
-				pZuin->pho_inx[2] = 1;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 1 ] == 1 && pho_inx[ 2 ] != 1 ) {
+				pho_inx[1] = 0;
+				pho_inx[2] = 1;
+				return ZUIN_ACTION_ABSORB;
 			}
-			else if (pZuin->pho_inx[ 1 ] != 1 && pZuin->pho_inx[2] == 1) {
-				pZuin->pho_inx[1] = 1;
-				return ZUIN_ABSORB;
+			else if (pho_inx[ 1 ] != 1 && pho_inx[2] == 1) {
+				pho_inx[1] = 1;
+				return ZUIN_ACTION_ABSORB;
 			}
-			else if (pZuin->pho_inx[1] == 1 && pZuin->pho_inx[2]==1) {
-				pZuin->pho_inx[1]=0;
-				pZuin->pho_inx[2]=0;
-				return ZUIN_ABSORB;
+			else if (pho_inx[1] == 1 && pho_inx[2]==1) {
+				pho_inx[1]=0;
+				pho_inx[2]=0;
+				return ZUIN_ACTION_ABSORB;
 			}
-			else if (pZuin->pho_inx[1] != 0) {
-				pZuin->pho_inx[2] = 1;
-				return ZUIN_ABSORB;
+			else if (pho_inx[1] != 0) {
+				pho_inx[2] = 1;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		/* switching between "ㄩ" and "ㄡ" */
 		else if ( key == 'm' ) {
-			if ( pZuin->pho_inx[ 1 ] == 3 && pZuin->pho_inx[ 2 ] != 8 ) {
-				pZuin->pho_inx[1] = 0;
-				pZuin->pho_inx[2] = 8;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 1 ] == 3 && pho_inx[ 2 ] != 8 ) {
+				pho_inx[1] = 0;
+				pho_inx[2] = 8;
+				return ZUIN_ACTION_ABSORB;
 			}
-			else if (pZuin->pho_inx[ 1 ] != 3 && pZuin->pho_inx[2] == 8) {
-				pZuin->pho_inx[1] = 3;
-				pZuin->pho_inx[2] = 0;
-				return ZUIN_ABSORB;
+			else if (pho_inx[ 1 ] != 3 && pho_inx[2] == 8) {
+				pho_inx[1] = 3;
+				pho_inx[2] = 0;
+				return ZUIN_ACTION_ABSORB;
 			}
-			else if (pZuin->pho_inx[ 1 ] != 0) {
-				pZuin->pho_inx[2] = 8;
-				return ZUIN_ABSORB;
+			else if (pho_inx[ 1 ] != 0) {
+				pho_inx[2] = 8;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		/* switching between "ㄛ" and "ㄞ" */
 		else if ( key == 'i' ) {
-			if ( pZuin->pho_inx[ 2 ] == 2  ) {
-			 	pZuin->pho_inx[ 2 ] = 5;
-				return ZUIN_ABSORB;
-			} else if ( pZuin->pho_inx[2] == 5) {
-				pZuin->pho_inx[ 2 ] = 2;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 2 ] == 2  ) {
+			 	pho_inx[ 2 ] = 5;
+				return ZUIN_ACTION_ABSORB;
+			} else if ( pho_inx[2] == 5) {
+				pho_inx[ 2 ] = 2;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		/* switching between "ㄟ" and "ㄢ" */
 		else if ( key == 'o' ) {
-			if ( pZuin->pho_inx[ 2 ] == 6  ) {
-			 	pZuin->pho_inx[ 2 ] = 9;
-				return ZUIN_ABSORB;
-			} else if ( pZuin->pho_inx[2] == 9) {
-				pZuin->pho_inx[ 2 ] = 6;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 2 ] == 6  ) {
+			 	pho_inx[ 2 ] = 9;
+				return ZUIN_ACTION_ABSORB;
+			} else if ( pho_inx[2] == 9) {
+				pho_inx[ 2 ] = 6;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		/* switching between "ㄠ" and "ㄤ" */
 		else if ( key == 'l' ) {
-			if ( pZuin->pho_inx[ 2 ] == 7  ) {
-			 	pZuin->pho_inx[ 2 ] = 11;
-				return ZUIN_ABSORB;
-			} else if ( pZuin->pho_inx[2] == 11) {
-				pZuin->pho_inx[ 2 ] = 7;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 2 ] == 7  ) {
+			 	pho_inx[ 2 ] = 11;
+				return ZUIN_ACTION_ABSORB;
+			} else if ( pho_inx[2] == 11) {
+				pho_inx[ 2 ] = 7;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		/* switching between "ㄣ" and "ㄦ" */
 		else if ( key == 'p' ) {
-			if ( pZuin->pho_inx[ 2 ] == 10  ) {
-			 	pZuin->pho_inx[ 2 ] = 13;
-				return ZUIN_ABSORB;
-			} else if ( pZuin->pho_inx[2] == 13) {
-				pZuin->pho_inx[ 2 ] = 10;
-				return ZUIN_ABSORB;
+			if ( pho_inx[ 2 ] == 10  ) {
+			 	pho_inx[ 2 ] = 13;
+				return ZUIN_ACTION_ABSORB;
+			} else if ( pho_inx[2] == 13) {
+				pho_inx[ 2 ] = 10;
+				return ZUIN_ACTION_ABSORB;
 			}
 		}
 		if ( type == 3 ) { /* the key is NOT a phone */
 			if ( isalpha( key ) )
-				return ZUIN_NO_WORD;
-			return ZUIN_KEY_ERROR;
+				return ZUIN_ACTION_NO_WORD;
+			return ZUIN_ACTION_KEY_ERROR;
 		}
 		/* fill the key into the phone buffer */
-		pZuin->pho_inx[ type ] = inx;
-		return ZUIN_ABSORB;
+		pho_inx[ type ] = inx;
+		return ZUIN_ACTION_ABSORB;
+	}
+}
+
+/*
+ * Run one transition of the layout kbtype, from pho_inx to new_inx, which may
+ * be the same array. Return ZUIN_ACTION_*. On ZUIN_ACTION_END, tone is the
+ * tone of key, and the phone shall be committed by EndKeyProcess.
+ */
+int ZuinTransition( const KeyTable *table, int kbtype, const int pho_inx[], int key,
+	int new_inx[], int *tone )
+{
+	memmove( new_inx, pho_inx, sizeof( int ) * ZUIN_SIZE );
+	*tone = 0;
+
+	switch ( kbtype ) {
+		case KB_HSU:
+		case KB_DVORAK_HSU:
+			return HsuTransition( table, new_inx, key, tone );
+		case KB_ET26:
+			return ET26Transition( table, new_inx, key, tone );
+		case KB_DACHEN_CP26:
+			return DACHENCP26Transition( table, new_inx, key, tone );
+		default:
+			return DefTransition( table, new_inx, key, tone );
+	}
+}
+
+/*
+ * A zhuyin layout is compiled into a table of transitions, so that each key
+ * costs three lookups, whatever the layout is.
+ *
+ * The state is pho_inx[ 0 .. 2 ] and whether there is a tone. Keys, and then
+ * states, with the same transitions share a class. Each entry of a
+ * ( state class, key class ) is the action, the components of pho_inx to
+ * set with their new values, and the tone of the key for ZUIN_ACTION_END.
+ */
+#define ZUIN_STATE_NUM ( 22 * 4 * 14 * 2 )
+
+#define ENTRY_ACTION( entry ) ( ( entry ) & 0x3 )
+#define ENTRY_SET( entry, i ) ( ( ( entry ) >> ( 2 + ( i ) ) ) & 0x1 )
+#define ENTRY_INX( entry, i ) ( ( ( entry ) >> entry_shift[ i ] ) & 0x1F )
+#define ENTRY_TONE( entry ) ( ( ( entry ) >> 26 ) & 0x7 )
+
+static const int inx_num[ ZUIN_SIZE ] = { 22, 4, 14, 5 };
+static const int entry_shift[ ZUIN_SIZE ] = { 6, 11, 16, 21 };
+
+struct tag_ZuinTable {
+	int kbtype;
+	int ref_count;
+	int n_key_class;
+	int n_state_class;
+	unsigned char key_class[ KEY_TABLE_KEY_NUM ];
+	uint16_t state_class[ ZUIN_STATE_NUM ];
+	/* entry[ state_class * n_key_class + key_class ] */
+	uint32_t *entry;
+};
+
+static int StateFromPhoneInx( const int pho_inx[] )
+{
+	return ( ( pho_inx[ 0 ] * 4 + pho_inx[ 1 ] ) * 14 + pho_inx[ 2 ] ) * 2 +
+		( pho_inx[ 3 ] != 0 );
+}
+
+/* Any tone stands for all tones, the transitions do not depend on its value. */
+static void PhoneInxFromState( int pho_inx[], int state )
+{
+	pho_inx[ 3 ] = state % 2;
+	state /= 2;
+	pho_inx[ 2 ] = state % 14;
+	state /= 14;
+	pho_inx[ 1 ] = state % 4;
+	pho_inx[ 0 ] = state / 4;
+}
+
+static uint32_t EncodeTransition( const KeyTable *table, int kbtype, int state, int key )
+{
+	int pho_inx[ ZUIN_SIZE ], new_inx[ ZUIN_SIZE ];
+	int action, tone, i;
+	uint32_t entry;
+
+	PhoneInxFromState( pho_inx, state );
+	action = ZuinTransition( table, kbtype, pho_inx, key, new_inx, &tone );
+
+	entry = action | ( (uint32_t) tone << 26 );
+	for ( i = 0; i < ZUIN_SIZE; i++ ) {
+		if ( new_inx[ i ] != pho_inx[ i ] )
+			entry |= ( 1u << ( 2 + i ) ) | ( (uint32_t) new_inx[ i ] << entry_shift[ i ] );
+	}
+	return entry;
+}
+
+static unsigned int HashRow( const uint32_t *row, int len )
+{
+	unsigned int hash = 2166136261u;
+	int i;
+
+	for ( i = 0; i < len; i++ ) {
+		hash ^= row[ i ];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+ZuinTable *ZuinTableNew( const KeyTable *table, int kbtype )
+{
+	ZuinTable *zuin_table;
+	uint32_t *column = NULL;	/* column[ key * ZUIN_STATE_NUM + state ] */
+	uint32_t *row = NULL;		/* row[ state * n_key_class + key_class ] */
+	int *hash = NULL;
+	int class_key[ KEY_TABLE_KEY_NUM ];
+	int hash_size = 4096;
+	uint32_t *cur;
+	int key, state, c;
+	unsigned int h;
+
+	if ( kbtype >= KB_HANYU_PINYIN )
+		return NULL;
+
+	zuin_table = ALC( ZuinTable, 1 );
+	column = ALC( uint32_t, KEY_TABLE_KEY_NUM * ZUIN_STATE_NUM );
+	if ( ! zuin_table || ! column )
+		goto error;
+	zuin_table->kbtype = kbtype;
+	zuin_table->ref_count = 1;
+
+	/* keys with the same column share a class */
+	for ( key = 0; key < KEY_TABLE_KEY_NUM; key++ ) {
+		for ( state = 0; state < ZUIN_STATE_NUM; state++ )
+			column[ key * ZUIN_STATE_NUM + state ] = EncodeTransition( table, kbtype, state, key );
+		for ( c = 0; c < zuin_table->n_key_class; c++ ) {
+			if ( ! memcmp( &column[ class_key[ c ] * ZUIN_STATE_NUM ], &column[ key * ZUIN_STATE_NUM ],
+				sizeof( uint32_t ) * ZUIN_STATE_NUM ) )
+				break;
+		}
+		if ( c == zuin_table->n_key_class )
+			class_key[ zuin_table->n_key_class++ ] = key;
+		zuin_table->key_class[ key ] = c;
+	}
+
+	row = ALC( uint32_t, ZUIN_STATE_NUM * zuin_table->n_key_class );
+	hash = ALC( int, hash_size );
+	if ( ! row || ! hash )
+		goto error;
+	for ( h = 0; h < (unsigned int) hash_size; h++ )
+		hash[ h ] = -1;
+
+	/*
+	 * states with the same row share a class, and rows of the classes are
+	 * moved to the front of row.
+	 */
+	for ( state = 0; state < ZUIN_STATE_NUM; state++ ) {
+		cur = &row[ zuin_table->n_state_class * zuin_table->n_key_class ];
+		for ( c = 0; c < zuin_table->n_key_class; c++ )
+			cur[ c ] = column[ class_key[ c ] * ZUIN_STATE_NUM + state ];
+
+		for ( h = HashRow( cur, zuin_table->n_key_class ) & ( hash_size - 1 );
+			hash[ h ] != -1;
+			h = ( h + 1 ) & ( hash_size - 1 ) ) {
+			if ( ! memcmp( &row[ hash[ h ] * zuin_table->n_key_class ], cur,
+				sizeof( uint32_t ) * zuin_table->n_key_class ) )
+				break;
+		}
+		if ( hash[ h ] == -1 )
+			hash[ h ] = zuin_table->n_state_class++;
+		zuin_table->state_class[ state ] = hash[ h ];
+	}
+
+	zuin_table->entry = realloc( row, sizeof( uint32_t ) *
+		zuin_table->n_state_class * zuin_table->n_key_class );
+	if ( ! zuin_table->entry )
+		zuin_table->entry = row;
+	free( column );
+	free( hash );
+	return zuin_table;
+
+error:
+	free( zuin_table );
+	free( column );
+	free( row );
+	free( hash );
+	return NULL;
+}
+
+void ZuinTableDelete( ZuinTable *zuin_table )
+{
+	if ( zuin_table ) {
+		free( zuin_table->entry );
+		free( zuin_table );
+	}
+}
+
+/* Same as ZuinTransition of the layout of zuin_table, by the table. */
+int ZuinTableLookup( const ZuinTable *zuin_table, const KeyTable *table, const int pho_inx[],
+	int key, int new_inx[], int *tone )
+{
+	uint32_t entry;
+	int i;
+
+	if ( (unsigned int) key >= KEY_TABLE_KEY_NUM )
+		return ZuinTransition( table, zuin_table->kbtype, pho_inx, key, new_inx, tone );
+	for ( i = 0; i < ZUIN_SIZE; i++ ) {
+		if ( (unsigned int) pho_inx[ i ] >= (unsigned int) inx_num[ i ] )
+			return ZuinTransition( table, zuin_table->kbtype, pho_inx, key, new_inx, tone );
+	}
+
+	entry = zuin_table->entry[
+		zuin_table->state_class[ StateFromPhoneInx( pho_inx ) ] * zuin_table->n_key_class +
+		zuin_table->key_class[ key ] ];
+
+	for ( i = 0; i < ZUIN_SIZE; i++ )
+		new_inx[ i ] = ENTRY_SET( entry, i ) ? ENTRY_INX( entry, i ) : pho_inx[ i ];
+	*tone = ENTRY_TONE( entry );
+	return ENTRY_ACTION( entry );
+}
+
+/*
+ * Transition tables compiled by this process. Key tables only depend on
+ * kbtype, so each table is compiled once and shared by all contexts.
+ */
+static ZuinTable *zuin_table_list[ KB_HANYU_PINYIN ];
+static plat_mutex zuin_table_lock = PLAT_MUTEX_INITIALIZER;
+
+static ZuinTable *AcquireZuinTable( const KeyTable *table, int kbtype )
+{
+	ZuinTable *zuin_table;
+
+	if ( kbtype < 0 || kbtype >= KB_HANYU_PINYIN )
+		return NULL;
+
+	PLAT_MUTEX_LOCK( &zuin_table_lock );
+
+	zuin_table = zuin_table_list[ kbtype ];
+	if ( zuin_table )
+		++zuin_table->ref_count;
+	else
+		zuin_table = zuin_table_list[ kbtype ] = ZuinTableNew( table, kbtype );
+
+	PLAT_MUTEX_UNLOCK( &zuin_table_lock );
+	return zuin_table;
+}
+
+static void ReleaseZuinTable( ZuinTable *zuin_table )
+{
+	PLAT_MUTEX_LOCK( &zuin_table_lock );
+
+	if ( --zuin_table->ref_count == 0 ) {
+		zuin_table_list[ zuin_table->kbtype ] = NULL;
+		ZuinTableDelete( zuin_table );
+	}
+
+	PLAT_MUTEX_UNLOCK( &zuin_table_lock );
+}
+
+static const ZuinTable *GetZuinTable( ChewingData *pgdata, ZuinData *pZuin )
+{
+	ZuinTable **zuin_table = &pgdata->static_data.zuin_table[ pZuin->kbtype ];
+
+	if ( ! *zuin_table )
+		*zuin_table = AcquireZuinTable( GetKeyTable( pgdata, pZuin ), pZuin->kbtype );
+	return *zuin_table;
+}
+
+static int ZuinTableInput( ChewingData *pgdata, ZuinData *pZuin, int key )
+{
+	const ZuinTable *zuin_table = GetZuinTable( pgdata, pZuin );
+	const KeyTable *table = GetKeyTable( pgdata, pZuin );
+	int action, tone;
+
+	if ( zuin_table )
+		action = ZuinTableLookup( zuin_table, table, pZuin->pho_inx, key, pZuin->pho_inx, &tone );
+	else
+		action = ZuinTransition( table, pZuin->kbtype, pZuin->pho_inx, key, pZuin->pho_inx, &tone );
+
+	switch ( action ) {
+		case ZUIN_ACTION_ABSORB:
+			return ZUIN_ABSORB;
+		case ZUIN_ACTION_END:
+			return EndKeyProcess( pgdata, pZuin, key, tone );
+		case ZUIN_ACTION_NO_WORD:
+			return ZUIN_NO_WORD;
+		default:
+			return ZUIN_KEY_ERROR;
+	}
+}
+
+void TerminateZuin( ChewingData *pgdata )
+{
+	int i;
+
+	for ( i = 0; i < MAX_KBTYPE; i++ ) {
+		if ( pgdata->static_data.zuin_table[ i ] )
+			ReleaseZuinTable( pgdata->static_data.zuin_table[ i ] );
+		pgdata->static_data.zuin_table[ i ] = NULL;
 	}
 }
 
@@ -587,8 +882,8 @@ static int PinYinInput( ChewingData *pgdata, ZuinData *pZuin, int key )
 	/* FIXME: Remove pZuin parameter */
 {
 	int err = 0;
-	unsigned int i;
-	char zuinKeySeq[ 5 ], zuinKeySeqAlt[ 5 ], buf[ 2 ];
+	uint16_t phone, phoneAlt;
+	char buf[ 2 ];
 
 	DEBUG_CHECKPOINT();
 
@@ -597,51 +892,18 @@ static int PinYinInput( ChewingData *pgdata, ZuinData *pZuin, int key )
 	}
 
 	if ( IsPinYinEndKey( key ) ) {
-		err = PinyinToZuin( pgdata, pZuin->pinYinData.keySeq,
-		                    zuinKeySeq, zuinKeySeqAlt );
+		err = PinyinToPhone( pgdata, pZuin->pinYinData.keySeq,
+		                     &phone, &phoneAlt );
 		if ( err ) {
 			pZuin->pinYinData.keySeq[ 0 ] = '\0';
 			return ZUIN_ABSORB;
 		}
 
-		DEBUG_OUT( "zuinKeySeq: %s\n", zuinKeySeq );
-		DEBUG_OUT( "zuinKeySeqAlt: %s\n", zuinKeySeqAlt );
-
-		for ( i = 0; i < strlen( zuinKeySeq ); i++ ) {
-			int type = 0, inx = 0;
-			for ( type = 0; type <= 3; type++ ) {
-				inx = PhoneInxFromKey( zuinKeySeq[ i ],
-				                       type, pZuin->kbtype, 1 );
-				if ( inx )
-					break;
-			}
+		DEBUG_OUT( "phone: %d\n", phone );
+		DEBUG_OUT( "phoneAlt: %d\n", phoneAlt );
 
-			/* the key is NOT a phone */
-			if ( type > 3 ) {
-				return ZUIN_KEY_ERROR;
-			}
-
-			pZuin->pho_inx[ type ] = inx;
-
-		}
-
-		for ( i = 0; i < strlen( zuinKeySeqAlt ); i++ ) {
-			int type = 0, inx = 0;
-			for ( type = 0; type <= 3; type++ ) {
-				inx = PhoneInxFromKey( zuinKeySeqAlt[ i ],
-				                       type, pZuin->kbtype, 1 );
-				if ( inx )
-					break;
-			}
-
-			/* the key is NOT a phone */
-			if ( type > 3 ) {
-				return ZUIN_KEY_ERROR;
-			}
-
-			pZuin->pho_inx_alt[ type ] = inx;
-
-		}
+		PhoneInxFromUint( pZuin->pho_inx, phone );
+		PhoneInxFromUint( pZuin->pho_inx_alt, phoneAlt );
 
 		switch ( key ) {
 			case '1':
@@ -654,8 +916,11 @@ static int PinYinInput( ChewingData *pgdata, ZuinData *pZuin, int key )
 				key = '7';
 		}
 		pZuin->pinYinData.keySeq[ 0 ] = '\0';
-		return EndKeyProcess( pgdata, pZuin, key, 1 );
+		return EndKeyProcess( pgdata, pZuin, key,
+			PhoneInxFromKeyTable( GetKeyTable( pgdata, pZuin ), key, 3, 1 ) );
 	}
+	if ( strlen( pZuin->pinYinData.keySeq ) + 1 >= PINYIN_SIZE )
+		return ZUIN_ABSORB;
 	buf[ 0 ] = key; buf[ 1 ] = '\0';
 	strcat( pZuin->pinYinData.keySeq, buf );
 	
@@ -664,28 +929,78 @@ static int PinYinInput( ChewingData *pgdata, ZuinData *pZuin, int key )
 	return ZUIN_ABSORB;
 }
 
+/*
+ * Continuous pinyin input keeps letters in the syllable lattice until space
+ * is pressed, or until the lattice is full, in which case all but the last
+ * phrase are segmented to make room.
+ */
+static int PinYinContinuousInput( ChewingData *pgdata, ZuinData *pZuin, int key )
+{
+	PinYinData *pinYinData = &pZuin->pinYinData;
+	PinYinLattice *lattice = &pinYinData->lattice;
+	char rest[ PINYIN_CONTINUOUS_SIZE + 1 ];
+	int begin, n, i;
+
+	DEBUG_CHECKPOINT();
+
+	if ( lattice->len == 0 && IsSymbolKey( key ) ) {
+		return ZUIN_KEY_ERROR;
+	}
+
+	if ( key != ' ' && lattice->len < PINYIN_CONTINUOUS_SIZE ) {
+		if ( PinyinLatticeAppend( pgdata, lattice, key ) )
+			return ZUIN_NO_WORD;
+		DEBUG_OUT( "PinYin Lattice: %s\n", lattice->keySeq );
+		return ZUIN_ABSORB;
+	}
+
+	n = PinyinLatticeSegment( lattice, lattice->len,
+	                          pinYinData->phoneSeq, pinYinData->bCnnct, &begin );
+	if ( n <= 0 )
+		return ZUIN_NO_WORD;
+
+	if ( key == ' ' ) {
+		begin = lattice->len;
+	}
+	else {
+		/* keep the last phrase if it is not the only one */
+		for ( i = n - 1; i > 0 && pinYinData->bCnnct[ i ]; i-- )
+			;
+		if ( i > 0 )
+			n = i;
+		else
+			begin = lattice->len;
+	}
+
+	if ( pgdata->chiSymbolBufLen + n > MAX_PHONE_SEQ_LEN )
+		return ZUIN_NO_WORD;
+
+	strcpy( rest, &lattice->keySeq[ begin ] );
+	lattice->len = 0;
+	lattice->keySeq[ 0 ] = '\0';
+	for ( i = 0; rest[ i ]; i++ )
+		PinyinLatticeAppend( pgdata, lattice, rest[ i ] );
+	if ( key != ' ' )
+		PinyinLatticeAppend( pgdata, lattice, key );
+
+	pinYinData->nPhoneSeq = n;
+	return ZUIN_COMMIT;
+}
+
 /* key: ascii code of input, including space */
 int ZuinPhoInput( ChewingData *pgdata, ZuinData *pZuin, int key )
 	/* FIXME: Remove pZuin parameter */
 {
 	switch ( pZuin->kbtype ) {
-		case KB_HSU:
-		case KB_DVORAK_HSU:
-			return HsuPhoInput( pgdata, pZuin,key );
-			break;
-		case KB_ET26:
-			return ET26PhoInput( pgdata, pZuin, key );
-			break;
-		case KB_DACHEN_CP26:
-			return DACHENCP26PhoInput( pgdata, pZuin, key );
-			break;
 		case KB_HANYU_PINYIN:
 		case KB_THL_PINYIN:
 		case KB_MPS2_PINYIN:
+			if ( pgdata->bContinuousPinyin )
+				return PinYinContinuousInput( pgdata, pZuin, key );
 			return PinYinInput( pgdata, pZuin, key );
 			break;
 		default:
-			return DefPhoInput( pgdata, pZuin, key );
+			return ZuinTableInput( pgdata, pZuin, key );
 	}	
 	return ZUIN_ERROR;
 }
@@ -694,7 +1009,9 @@ int ZuinPhoInput( ChewingData *pgdata, ZuinData *pZuin, int key )
 int ZuinRemoveLast( ZuinData *pZuin )
 {
 	int i;
-	if ( pZuin->kbtype >= KB_HANYU_PINYIN ) {
+	if ( pZuin->pinYinData.lattice.len ) {
+		PinyinLatticeRemoveLast( &pZuin->pinYinData.lattice );
+	} else if ( pZuin->kbtype >= KB_HANYU_PINYIN ) {
 		i = strlen( pZuin->pinYinData.keySeq );
 		pZuin->pinYinData.keySeq[ i - 1 ] = '\0';
 	} else {
@@ -713,6 +1030,8 @@ int ZuinRemoveAll( ZuinData *pZuin )
 {
 	memset( pZuin->pho_inx, 0, sizeof( pZuin->pho_inx ) );
 	memset( pZuin->pinYinData.keySeq, 0, sizeof( pZuin->pinYinData.keySeq ) );
+	pZuin->pinYinData.lattice.len = 0;
+	pZuin->pinYinData.lattice.keySeq[ 0 ] = '\0';
 	return 0;
 }
 
@@ -720,7 +1039,7 @@ int ZuinIsEntering( ZuinData *pZuin )
 {
 	int i;
         if ( pZuin->kbtype >= KB_HANYU_PINYIN ) {
-	    if ( pZuin->pinYinData.keySeq[0] )
+	    if ( pZuin->pinYinData.keySeq[0] || pZuin->pinYinData.lattice.len )
 		return 1;
 	} else {
 	    for ( i = 0; i < ZUIN_SIZE; i++ )
@@ -0,0 +1,116 @@
+/**
+ * startuptime.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+/*
+ * Report how long chewing_new() takes, and how long the first use of each
+ * lazily loaded table takes. The latter is the time chewing_new() saves for
+ * sessions which never use that table.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "chewing.h"
+#include "testhelper.h"
+
+#define ROUND_NUM 100
+
+static double elapsed_ms( clock_t start )
+{
+	return (double) ( clock() - start ) * 1000 / CLOCKS_PER_SEC;
+}
+
+typedef void (*first_use_func)( ChewingContext *ctx );
+
+static void open_symbol_table( ChewingContext *ctx )
+{
+	type_keystroke_by_string( ctx, "`" );
+}
+
+static void type_easy_symbol( ChewingContext *ctx )
+{
+	chewing_set_easySymbolInput( ctx, 1 );
+	type_keystroke_by_string( ctx, "A" );
+}
+
+static void type_pinyin( ChewingContext *ctx )
+{
+	chewing_set_KBType( ctx, chewing_KBStr2Num( "KB_HANYU_PINYIN" ) );
+	type_keystroke_by_string( ctx, "ma3 " );
+}
+
+static double time_first_use( first_use_func func )
+{
+	ChewingContext *ctx;
+	clock_t start;
+	double total = 0;
+	int i;
+
+	for ( i = 0; i < ROUND_NUM; i++ ) {
+		ctx = chewing_new();
+		if ( !ctx ) {
+			fprintf( stderr, "chewing_new failed\n" );
+			exit( 1 );
+		}
+		start = clock();
+		func( ctx );
+		total += elapsed_ms( start );
+		chewing_delete( ctx );
+	}
+	return total / ROUND_NUM;
+}
+
+int main()
+{
+	ChewingContext *ctx;
+	clock_t start;
+	double new_ms = 0;
+	double delete_ms = 0;
+	double symbol_ms, easy_symbol_ms, pinyin_ms;
+	int i;
+
+	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
+	putenv( "CHEWING_USER_PATH=" TEST_HASH_DIR );
+
+	for ( i = 0; i < ROUND_NUM; i++ ) {
+		start = clock();
+		ctx = chewing_new();
+		new_ms += elapsed_ms( start );
+		if ( !ctx ) {
+			fprintf( stderr, "chewing_new failed\n" );
+			return 1;
+		}
+		start = clock();
+		chewing_delete( ctx );
+		delete_ms += elapsed_ms( start );
+	}
+	new_ms /= ROUND_NUM;
+	delete_ms /= ROUND_NUM;
+
+	symbol_ms = time_first_use( open_symbol_table );
+	easy_symbol_ms = time_first_use( type_easy_symbol );
+	pinyin_ms = time_first_use( type_pinyin );
+
+	printf( "average of %d rounds (ms)\n", ROUND_NUM );
+	printf( "chewing_new             %8.3f\n", new_ms );
+	printf( "chewing_delete          %8.3f\n", delete_ms );
+	printf( "first symbol table use  %8.3f\n", symbol_ms );
+	printf( "first easy symbol use   %8.3f\n", easy_symbol_ms );
+	printf( "first pinyin use        %8.3f\n", pinyin_ms );
+	printf( "deferred from startup   %8.3f\n",
+		symbol_ms + easy_symbol_ms + pinyin_ms );
+
+	return 0;
+}
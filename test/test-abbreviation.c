@@ -0,0 +1,203 @@
+/**
+ * test-abbreviation.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chewing.h"
+#include "chewing-private.h"
+#include "tree-private.h"
+#include "testhelper.h"
+
+#define BENCHMARK_ROUND 1000
+
+static int comp_int( const void *a, const void *b )
+{
+	return *(const int *) a - *(const int *) b;
+}
+
+typedef struct {
+	int phrase_num;
+	int missing;
+} CheckResult;
+
+/* Every phrase in the phone tree shall be found by its initials. */
+static void check_node( ChewingData *pgdata, int node, uint16_t initial[], int len,
+	CheckResult *result )
+{
+	const TreeType *tree = pgdata->static_data.sys_dict->tree;
+	const int *posting;
+	int num;
+	int child;
+
+	if ( len > 0 && tree[ node ].phrase_id != -1 ) {
+		++result->phrase_num;
+		num = AbbrFindPhrase( pgdata, initial, len, &posting );
+		if ( !bsearch( &tree[ node ].phrase_id, posting, num, sizeof( int ), comp_int ) )
+			++result->missing;
+	}
+
+	if ( len == MAX_PHRASE_LEN )
+		return;
+	for (
+		child = tree[ node ].child_begin;
+		child != -1 && child <= tree[ node ].child_end;
+		child++ ) {
+		initial[ len ] = INITIAL_FROM_PHONE( tree[ child ].phone_id );
+		check_node( pgdata, child, initial, len + 1, result );
+	}
+}
+
+void test_every_phrase()
+{
+	ChewingContext *ctx;
+	uint16_t initial[ MAX_PHRASE_LEN ];
+	CheckResult result = { 0, 0 };
+
+	ctx = chewing_new();
+
+	ok( ctx->data->static_data.sys_dict->abbr_tree != NULL,
+		"abbreviation tree shall be loaded" );
+
+	check_node( ctx->data, 0, initial, 0, &result );
+	ok( result.phrase_num > 0, "phone tree shall have phrases" );
+	ok( result.missing == 0, "all `%d' phrases shall be found by initials, got `%d' missing",
+		result.phrase_num, result.missing );
+	ok( (int) ctx->data->static_data.sys_dict->abbr_posting_size == result.phrase_num,
+		"posting lists shall have `%d' phrases, got `%d'", result.phrase_num,
+		(int) ctx->data->static_data.sys_dict->abbr_posting_size );
+
+	chewing_delete( ctx );
+}
+
+void test_not_found()
+{
+	ChewingContext *ctx;
+	/* No initial can be 31, see zhuin_tab in key2pho.c */
+	const uint16_t INITIAL[] = { 31 };
+	const int *posting;
+	int num;
+
+	ctx = chewing_new();
+
+	num = AbbrFindPhrase( ctx->data, INITIAL, ARRAY_SIZE( INITIAL ), &posting );
+	ok( num == 0, "unknown initials shall have no phrase, got `%d'", num );
+
+	num = AbbrFindPhrase( ctx->data, INITIAL, 0, &posting );
+	ok( num == 0, "empty initials shall have no phrase, got `%d'", num );
+
+	chewing_delete( ctx );
+}
+
+typedef struct {
+	uint16_t initial[ MAX_PHRASE_LEN ];
+	int len;
+	int fanout;
+} WorstCase;
+
+/* Find the initials with the largest posting list. */
+static void find_worst( const AbbrTreeType *tree, int node, uint16_t initial[], int len,
+	WorstCase *worst )
+{
+	int child;
+
+	if ( len > 0 && tree[ node ].posting_end - tree[ node ].posting_begin > worst->fanout ) {
+		worst->fanout = tree[ node ].posting_end - tree[ node ].posting_begin;
+		worst->len = len;
+		memcpy( worst->initial, initial, sizeof( uint16_t ) * len );
+	}
+
+	if ( len == MAX_PHRASE_LEN )
+		return;
+	for (
+		child = tree[ node ].child_begin;
+		child != -1 && child <= tree[ node ].child_end;
+		child++ ) {
+		initial[ len ] = tree[ child ].initial;
+		find_worst( tree, child, initial, len + 1, worst );
+	}
+}
+
+/* What abbreviated lookup costs without the index: a wildcard walk of the phone tree. */
+static int scan_phone_tree( const TreeType *tree, int node, const uint16_t initial[], int len )
+{
+	int child;
+	int num = 0;
+
+	if ( len == 0 )
+		return tree[ node ].phrase_id != -1;
+
+	for (
+		child = tree[ node ].child_begin;
+		child != -1 && child <= tree[ node ].child_end;
+		child++ ) {
+		if ( INITIAL_FROM_PHONE( tree[ child ].phone_id ) == initial[ 0 ] )
+			num += scan_phone_tree( tree, child, initial + 1, len - 1 );
+	}
+	return num;
+}
+
+void benchmark()
+{
+	ChewingContext *ctx;
+	const SystemDictData *sys_dict;
+	uint16_t initial[ MAX_PHRASE_LEN ];
+	WorstCase worst = { { 0 }, 0, 0 };
+	const int *posting;
+	clock_t start;
+	double index_us, scan_us;
+	int num = 0;
+	int scan_num = 0;
+	int i;
+
+	ctx = chewing_new();
+	sys_dict = ctx->data->static_data.sys_dict;
+	if ( !sys_dict->abbr_tree ) {
+		chewing_delete( ctx );
+		return;
+	}
+
+	find_worst( sys_dict->abbr_tree, 0, initial, 0, &worst );
+
+	start = clock();
+	for ( i = 0; i < BENCHMARK_ROUND; ++i )
+		num = AbbrFindPhrase( ctx->data, worst.initial, worst.len, &posting );
+	index_us = (double) ( clock() - start ) * 1e6 / CLOCKS_PER_SEC / BENCHMARK_ROUND;
+
+	start = clock();
+	for ( i = 0; i < BENCHMARK_ROUND; ++i )
+		scan_num = scan_phone_tree( sys_dict->tree, 0, worst.initial, worst.len );
+	scan_us = (double) ( clock() - start ) * 1e6 / CLOCKS_PER_SEC / BENCHMARK_ROUND;
+
+	ok( num == scan_num, "index and scan shall find the same `%d' phrases, got `%d'",
+		scan_num, num );
+	printf( "# worst-case fan-out: %d phrases for %d initials\n", worst.fanout, worst.len );
+	printf( "# lookup cost: index %.3f us, phone tree scan %.3f us\n", index_us, scan_us );
+
+	chewing_delete( ctx );
+}
+
+int main()
+{
+	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
+	putenv( "CHEWING_USER_PATH=" TEST_HASH_DIR );
+
+	test_every_phrase();
+	test_not_found();
+	benchmark();
+
+	return exit_status();
+}
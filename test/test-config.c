@@ -74,6 +74,9 @@ void test_default_value()
 	ok( chewing_get_phraseChoiceRearward( ctx ) == 0,
 		"phraseChoiceRearward shall be 0" );
 
+	ok( chewing_get_continuousPinyin( ctx ) == 0,
+		"continuousPinyin shall be 0" );
+
 	ok( chewing_get_ChiEngMode( ctx ) == CHINESE_MODE,
 		"ChiEngMode shall be CHINESE_MODE" );
 
@@ -362,6 +365,37 @@ void test_set_phraseChoiceRearward()
 	chewing_Terminate();
 }
 
+void test_set_continuousPinyin()
+{
+	ChewingContext *ctx;
+	int value;
+	int mode;
+
+	chewing_Init( 0, 0 );
+
+	ctx = chewing_new();
+
+	for ( value = 0; value < 2; ++value ) {
+		chewing_set_continuousPinyin( ctx, value );
+		mode = chewing_get_continuousPinyin( ctx );
+		ok(  mode == value,
+			"continuousPinyin `%d' shall be `%d'", mode, value );
+
+		chewing_set_continuousPinyin( ctx, -1 );
+		mode = chewing_get_continuousPinyin( ctx );
+		ok(  mode == value,
+			"continuousPinyin `%d' shall be `%d'", mode, value );
+
+		chewing_set_continuousPinyin( ctx, 2 );
+		mode = chewing_get_continuousPinyin( ctx );
+		ok(  mode == value,
+			"continuousPinyin `%d' shall be `%d'", mode, value );
+	}
+
+	chewing_delete( ctx );
+	chewing_Terminate();
+}
+
 void test_set_ChiEngMode()
 {
 	const int VALUE[] = {
@@ -472,6 +506,7 @@ int main()
 	test_set_autoShiftCur();
 	test_set_easySymbolInput();
 	test_set_phraseChoiceRearward();
+	test_set_continuousPinyin();
 	test_set_ChiEngMode();
 	test_set_ShapeMode();
 
@@ -0,0 +1,348 @@
+/**
+ * test-container.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chewing.h"
+#include "chewing-private.h"
+#include "container-private.h"
+#include "dict-private.h"
+#include "global-private.h"
+#include "plat_types.h"
+#include "testhelper.h"
+
+#define TEST_SECTION_SIZE (24)
+#define DAMAGED_DIR TEST_HASH_DIR "/damaged"
+
+typedef struct {
+	ContainerHeader header;
+	ContainerSection section;
+	char padding[ CONTAINER_ALIGN * 2 - sizeof( ContainerHeader ) - sizeof( ContainerSection ) ];
+	char data[ CONTAINER_ALIGN ];
+} TestContainer;
+
+static void make_container( TestContainer *container )
+{
+	memset( container, 0, sizeof( *container ) );
+	memcpy( container->header.magic, CONTAINER_MAGIC, CONTAINER_MAGIC_SIZE );
+	container->header.version = ContainerUint32( CONTAINER_VERSION );
+	container->header.header_size = ContainerUint32( sizeof( ContainerHeader ) );
+	container->header.section_num = ContainerUint32( 1 );
+	container->header.section_offset = ContainerUint32( sizeof( ContainerHeader ) );
+	container->section.id = ContainerUint32( SECTION_DICT_BEGIN );
+	container->section.element_size = ContainerUint32( sizeof( int ) );
+	container->section.offset = ContainerUint64( offsetof( TestContainer, data ) );
+	container->section.size = ContainerUint64( TEST_SECTION_SIZE );
+}
+
+/* Fill in the checksums, as packdata does. */
+static void seal_container( TestContainer *container )
+{
+	container->section.checksum = ContainerUint32(
+		ContainerChecksum( container->data, TEST_SECTION_SIZE ) );
+	container->header.checksum = ContainerUint32(
+		ContainerChecksum( &container->section, sizeof( ContainerSection ) ) );
+}
+
+void test_little_endian()
+{
+	const unsigned char le32[] = { 0x78, 0x56, 0x34, 0x12 };
+	const unsigned char le64[] = { 0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01 };
+	uint32_t value32;
+	uint64_t value64;
+
+	memcpy( &value32, le32, sizeof( value32 ) );
+	ok( ContainerUint32( value32 ) == 0x12345678, "uint32 shall be little-endian" );
+	memcpy( &value64, le64, sizeof( value64 ) );
+	ok( ContainerUint64( value64 ) == 0x0102030405060708ull, "uint64 shall be little-endian" );
+}
+
+void test_sections()
+{
+	TestContainer container;
+	const ContainerSection *section;
+	int num = 0;
+
+	make_container( &container );
+	section = ContainerSections( &container, sizeof( container ), &num );
+	ok( section == &container.section, "section table shall follow header" );
+	ok( num == 1, "section_num `%d' shall be 1", num );
+
+	make_container( &container );
+	container.header.magic[ 0 ] = 'X';
+	ok( ContainerSections( &container, sizeof( container ), &num ) == NULL,
+		"bad magic shall be rejected" );
+
+	make_container( &container );
+	container.header.version = ContainerUint32( CONTAINER_VERSION + 1 );
+	ok( ContainerSections( &container, sizeof( container ), &num ) == NULL,
+		"other version shall be rejected" );
+
+	make_container( &container );
+	container.header.section_num = ContainerUint32( 1000 );
+	ok( ContainerSections( &container, sizeof( container ), &num ) == NULL,
+		"section table out of file shall be rejected" );
+
+	make_container( &container );
+	container.section.offset = ContainerUint64( offsetof( TestContainer, data ) + 4 );
+	ok( ContainerSections( &container, sizeof( container ), &num ) == NULL,
+		"unaligned section shall be rejected" );
+
+	make_container( &container );
+	container.section.size = ContainerUint64( sizeof( container.data ) + 1 );
+	ok( ContainerSections( &container, sizeof( container ), &num ) == NULL,
+		"section out of file shall be rejected" );
+
+	make_container( &container );
+	container.section.size = ContainerUint64( TEST_SECTION_SIZE - 1 );
+	ok( ContainerSections( &container, sizeof( container ), &num ) == NULL,
+		"partial element shall be rejected" );
+
+	ok( ContainerSections( &container, sizeof( ContainerHeader ) - 1, &num ) == NULL,
+		"truncated header shall be rejected" );
+}
+
+void test_checksum()
+{
+	TestContainer container;
+	const ContainerSection *section;
+	unsigned char buf[ 100 ];
+	uint32_t checksum;
+	size_t i;
+	int num = 0;
+
+	for ( i = 0; i < sizeof( buf ); i++ )
+		buf[ i ] = i;
+	checksum = ContainerChecksum( buf, sizeof( buf ) );
+	ok( ContainerChecksum( buf, sizeof( buf ) - 1 ) != checksum,
+		"checksum shall cover the tail" );
+	buf[ 50 ] ^= 1;
+	ok( ContainerChecksum( buf, sizeof( buf ) ) != checksum,
+		"checksum shall change with a bit" );
+	buf[ 50 ] ^= 1;
+	memcpy( buf, buf + 32, 4 );
+	memcpy( buf + 32, "\0\1\2\3", 4 );
+	ok( ContainerChecksum( buf, sizeof( buf ) ) != checksum,
+		"checksum shall change with the order of words" );
+
+	make_container( &container );
+	memset( container.data, 0x5a, sizeof( container.data ) );
+	seal_container( &container );
+	section = ContainerSections( &container, sizeof( container ), &num );
+	ok( section && ContainerVerify( &container, section, num ) == 0,
+		"sealed container shall be verified" );
+
+	container.data[ TEST_SECTION_SIZE - 1 ] ^= 1;
+	ok( section && ContainerVerify( &container, section, num ) == -1,
+		"damaged section shall be rejected" );
+
+	container.data[ TEST_SECTION_SIZE - 1 ] ^= 1;
+	container.section.reserved ^= 1;
+	ok( section && ContainerVerify( &container, section, num ) == -1,
+		"damaged section table shall be rejected" );
+}
+
+void test_layout()
+{
+	const ContainerLayout *layout;
+	int id;
+
+	for ( id = 1; id < SECTION_ID_END; id++ ) {
+		layout = GetContainerLayout( id );
+		ok( layout && layout->id == id, "section %d shall have a layout", id );
+		if ( layout && layout->fields )
+			ok( strspn( layout->fields, "1248" ) == strlen( layout->fields ),
+				"fields `%s' shall be widths", layout->fields );
+	}
+	ok( GetContainerLayout( SECTION_ID_END ) == NULL, "unknown section shall have no layout" );
+}
+
+void test_load()
+{
+#ifdef USE_BINARY_DATA
+	ChewingContext *ctx;
+	const SystemDictData *sys_dict;
+	const ContainerLayout *layout;
+	size_t num;
+
+	ctx = chewing_new();
+	ok( ctx != NULL, "chewing_new shall load " DICTIONARY_FILE );
+	if ( !ctx )
+		return;
+
+	sys_dict = ctx->data->static_data.sys_dict;
+	for ( layout = CONTAINER_LAYOUT; layout->id; layout++ ) {
+		/* packdata -c replaces the phrases with front-coded ones. */
+		if ( layout->optional || ( layout->id == SECTION_DICT && sys_dict->dict_charset ) )
+			continue;
+		ok( GetDictSection( sys_dict, layout->id, layout->element_size, &num ) != NULL,
+			"section %d shall be loaded", layout->id );
+		ok( GetDictSection( sys_dict, layout->id, layout->element_size + 1, &num ) == NULL,
+			"section %d shall not be loaded with other element size", layout->id );
+	}
+	ok( !sys_dict->dict_charset ||
+		GetDictSection( sys_dict, SECTION_DICT_FRONT_CODED, 1, &num ) == sys_dict->dict,
+		"front-coded phrases shall be loaded with their characters" );
+	ok( GetDictSection( sys_dict, SECTION_ID_END, 1, &num ) == NULL,
+		"unknown section shall not be loaded" );
+	ok( ( (char *) sys_dict->tree - sys_dict->container ) % CONTAINER_ALIGN == 0,
+		"tree shall be aligned in the container" );
+
+	chewing_delete( ctx );
+#endif
+}
+
+#ifdef USE_BINARY_DATA
+/*
+ * Write DICTIONARY_FILE to DAMAGED_DIR with the byte at offset of section id
+ * xor-ed by mask, and if reseal is set, with checksums matching the damage.
+ */
+static int write_damaged( int id, size_t offset, int mask, int reseal )
+{
+	FILE *file;
+	char *data = NULL;
+	long size;
+	ContainerHeader *header;
+	ContainerSection *section;
+	int num = 0;
+	int ret = -1;
+	int i;
+
+	file = fopen( CHEWING_DATA_PREFIX "/" DICTIONARY_FILE, "rb" );
+	if ( !file )
+		return -1;
+	if ( fseek( file, 0, SEEK_END ) == 0 && ( size = ftell( file ) ) > 0 &&
+		fseek( file, 0, SEEK_SET ) == 0 && ( data = malloc( size ) ) &&
+		fread( data, size, 1, file ) == 1 )
+		ret = 0;
+	fclose( file );
+	if ( ret )
+		goto end;
+
+	ret = -1;
+	header = (ContainerHeader *) data;
+	section = (ContainerSection *) ContainerSections( data, size, &num );
+	for ( i = 0; section && i < num; i++ ) {
+		if ( (int) ContainerUint32( section[ i ].id ) != id ||
+			offset >= ContainerUint64( section[ i ].size ) )
+			continue;
+		data[ ContainerUint64( section[ i ].offset ) + offset ] ^= mask;
+		if ( reseal ) {
+			section[ i ].checksum = ContainerUint32( ContainerChecksum(
+				data + ContainerUint64( section[ i ].offset ),
+				ContainerUint64( section[ i ].size ) ) );
+			header->checksum = ContainerUint32(
+				ContainerChecksum( section, sizeof( ContainerSection ) * num ) );
+		}
+		ret = 0;
+	}
+	if ( ret )
+		goto end;
+
+	PLAT_MKDIR( DAMAGED_DIR );
+	file = fopen( DAMAGED_DIR "/" DICTIONARY_FILE, "wb" );
+	if ( !file || fwrite( data, size, 1, file ) != 1 )
+		ret = -1;
+	if ( file && fclose( file ) )
+		ret = -1;
+end:
+	free( data );
+	return ret;
+}
+#endif
+
+void test_load_damaged()
+{
+#ifdef USE_BINARY_DATA
+	ChewingContext *ctx;
+	/* the high byte of child_end of the root, which is the last field */
+	const size_t child_end = sizeof( TreeType ) - 1;
+
+	ctx = chewing_new();
+
+	ok( write_damaged( SECTION_DICT_BEGIN, 0, 0x10, 0 ) == 0, "damaged dictionary shall be written" );
+	ok( chewing_dict_Add( ctx, DAMAGED_DIR ) == -1,
+		"dictionary not matching its checksum shall not be loaded" );
+
+	ok( write_damaged( SECTION_TREE, child_end, 0x40, 1 ) == 0, "damaged dictionary shall be written" );
+	ok( chewing_dict_Add( ctx, DAMAGED_DIR ) == -1,
+		"tree with children out of it shall not be loaded" );
+
+	ok( write_damaged( SECTION_TREE, 0, 0, 1 ) == 0, "dictionary shall be written" );
+	ok( chewing_dict_Add( ctx, DAMAGED_DIR ) == 0, "undamaged copy shall be loaded" );
+
+	chewing_delete( ctx );
+#endif
+}
+
+/*
+ * Records shall be validated as well, as checksums of a damaged file can be
+ * computed again, as write_damaged does.
+ */
+void test_load_damaged_record()
+{
+#ifdef USE_BINARY_DATA
+	ChewingContext *ctx;
+	const SystemDictData *sys_dict;
+
+	ctx = chewing_new();
+
+	/* the length byte of the first word, or of the first phrase */
+	ok( write_damaged( SECTION_CHAR, 0, 0x80, 1 ) == 0, "damaged dictionary shall be written" );
+	ok( chewing_dict_Add( ctx, DAMAGED_DIR ) == -1,
+		"word longer than a Word shall not be loaded" );
+
+	ok( write_damaged( SECTION_DICT, 0, 0x80, 1 ) == 0 ||
+		write_damaged( SECTION_DICT_FRONT_CODED, 0, 0x80, 1 ) == 0,
+		"damaged dictionary shall be written" );
+	ok( chewing_dict_Add( ctx, DAMAGED_DIR ) == -1,
+		"phrase longer than a Phrase shall not be loaded" );
+
+	/* Optional tables are dropped when they refer into a record. */
+	ok( write_damaged( SECTION_PREDICT, 0, 0x01, 1 ) == 0, "damaged dictionary shall be written" );
+	ok( chewing_dict_Add( ctx, DAMAGED_DIR ) == 0, "dictionary shall be loaded" );
+	sys_dict = ctx->data->static_data.dict_layer[ ctx->data->static_data.dict_layer_num - 1 ];
+	ok( sys_dict->predict == NULL, "prediction not at a phrase shall be dropped" );
+	ok( sys_dict->reverse_index != NULL, "reverse index shall be kept" );
+	chewing_dict_Remove( ctx, DAMAGED_DIR );
+
+	ok( write_damaged( SECTION_REVERSE_INDEX, offsetof( ReverseIndexType, dict_offset ), 0x01, 1 ) == 0,
+		"damaged dictionary shall be written" );
+	ok( chewing_dict_Add( ctx, DAMAGED_DIR ) == 0, "dictionary shall be loaded" );
+	sys_dict = ctx->data->static_data.dict_layer[ ctx->data->static_data.dict_layer_num - 1 ];
+	ok( sys_dict->reverse_index == NULL, "reverse index not at a phrase shall be dropped" );
+	ok( sys_dict->predict != NULL, "prediction shall be kept" );
+	chewing_dict_Remove( ctx, DAMAGED_DIR );
+
+	chewing_delete( ctx );
+#endif
+}
+
+int main()
+{
+	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
+	putenv( "CHEWING_USER_PATH=" TEST_HASH_DIR );
+
+	test_little_endian();
+	test_sections();
+	test_checksum();
+	test_layout();
+	test_load();
+	test_load_damaged();
+	test_load_damaged_record();
+
+	return exit_status();
+}
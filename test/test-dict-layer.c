@@ -0,0 +1,175 @@
+/**
+ * test-dict-layer.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chewing.h"
+#include "chewing-private.h"
+#include "dict-private.h"
+#include "tree-private.h"
+#include "testhelper.h"
+
+/* built from dict-layer-tsi.src */
+#define DICT_LAYER_DIR TEST_HASH_DIR "/dict-layer"
+#define LAYER_PHRASE "\xE7\xAD\x96\xE8\xA9\xA6" /* 策試 */
+/* in both the layer and the system dictionary */
+#define SHARED_PHRASE "\xE6\xB8\xAC\xE8\xA9\xA6" /* 測試 */
+#define LAYER_PHRASE_NUM (2)
+
+/* ㄘㄜˋ ㄕˋ */
+static const uint16_t PHONE[] = { 10268, 8708, 0 };
+
+/* Join the phrase candidates of ㄘㄜˋ ㄕˋ, each followed by a space. */
+static void get_candidates( ChewingContext *ctx, char *buf, size_t size )
+{
+	char *cand;
+
+	strcpy( buf, " " );
+	chewing_Reset( ctx );
+	type_keystroke_by_string( ctx, "hk4g4<H><D>" );
+	chewing_cand_Enumerate( ctx );
+	while ( chewing_cand_hasNext( ctx ) ) {
+		cand = chewing_cand_String( ctx );
+		if ( strlen( buf ) + strlen( cand ) + 2 <= size ) {
+			strcat( buf, cand );
+			strcat( buf, " " );
+		}
+		chewing_free( cand );
+	}
+}
+
+static int count_candidate( const char *buf, const char *cand )
+{
+	char word[ MAX_PHRASE_LEN * MAX_UTF8_SIZE + 3 ];
+	int num = 0;
+
+	snprintf( word, sizeof( word ), " %s ", cand );
+	for ( buf = strstr( buf, word ); buf; buf = strstr( buf + 1, word ) )
+		++num;
+	return num;
+}
+
+static int count_phrases( ChewingData *pgdata, int *first_freq, int *descending )
+{
+	PhraseIterator iter;
+	Phrase phrase;
+	int num = 0;
+	int freq = 0;
+
+	*descending = 1;
+	if ( !GetPhraseFirst( pgdata, &iter, &phrase, PHONE ) )
+		return 0;
+	*first_freq = phrase.freq;
+	do {
+		if ( num > 0 && phrase.freq > freq )
+			*descending = 0;
+		freq = phrase.freq;
+		++num;
+	} while ( GetPhraseNext( pgdata, &iter, &phrase ) );
+	return num;
+}
+
+void test_merge()
+{
+	ChewingContext *ctx;
+	int base_num, num, freq, descending;
+
+	ctx = chewing_new();
+	base_num = count_phrases( ctx->data, &freq, &descending );
+
+	ok( chewing_dict_Add( ctx, DICT_LAYER_DIR ) == 0, "dictionary shall be added" );
+	ok( TreeFindPhrase( ctx->data, 0, 1, PHONE ) != -1, "phrase of a layer shall be found" );
+	num = count_phrases( ctx->data, &freq, &descending );
+	ok( num == base_num + LAYER_PHRASE_NUM, "phrase number `%d' shall be `%d'",
+		num, base_num + LAYER_PHRASE_NUM );
+	ok( freq == 99999999, "the most frequent phrase shall be first" );
+	ok( descending, "phrases shall be in descending order of frequency" );
+
+	ok( chewing_dict_Remove( ctx, DICT_LAYER_DIR ) == 0, "dictionary shall be removed" );
+	num = count_phrases( ctx->data, &freq, &descending );
+	ok( num == base_num, "phrase number `%d' shall be `%d'", num, base_num );
+
+	chewing_delete( ctx );
+}
+
+void test_candidate()
+{
+	ChewingContext *ctx;
+	char base[ 1024 ];
+	char cand[ 1024 ];
+
+	ctx = chewing_new();
+	chewing_set_maxChiSymbolLen( ctx, 16 );
+	get_candidates( ctx, base, sizeof( base ) );
+
+	chewing_dict_Add( ctx, DICT_LAYER_DIR );
+	get_candidates( ctx, cand, sizeof( cand ) );
+	ok( !strncmp( cand, " " LAYER_PHRASE " ", strlen( " " LAYER_PHRASE " " ) ),
+		"candidates `%s' shall start with " LAYER_PHRASE, cand );
+	ok( count_candidate( cand, SHARED_PHRASE ) == 1,
+		"candidate " SHARED_PHRASE " shall not repeat" );
+
+	chewing_dict_Remove( ctx, DICT_LAYER_DIR );
+	get_candidates( ctx, cand, sizeof( cand ) );
+	ok( !strcmp( cand, base ), "candidates `%s' shall be `%s'", cand, base );
+
+	chewing_delete( ctx );
+}
+
+void test_add_remove()
+{
+	ChewingContext *ctx;
+	ChewingContext *ctx2;
+
+	ctx = chewing_new();
+	ctx2 = chewing_new();
+
+	ok( chewing_dict_Add( ctx, TEST_HASH_DIR "/no-such-dir" ) == -1,
+		"missing dictionary shall not be added" );
+	ok( chewing_dict_Add( ctx, ctx->data->static_data.sys_dict->prefix ) == -1,
+		"system dictionary shall not be added again" );
+	ok( chewing_dict_Add( ctx, DICT_LAYER_DIR ) == 0, "dictionary shall be added" );
+	ok( chewing_dict_Add( ctx, DICT_LAYER_DIR ) == -1, "dictionary shall not be added twice" );
+	ok( ctx->data->static_data.dict_layer_num == 2, "context shall have 2 layers" );
+	ok( ctx2->data->static_data.dict_layer_num == 1, "other context shall have 1 layer" );
+
+#ifdef USE_BINARY_DATA
+	chewing_dict_Add( ctx2, DICT_LAYER_DIR );
+	ok( ctx->data->static_data.dict_layer[ 1 ] == ctx2->data->static_data.dict_layer[ 1 ],
+		"contexts shall share a dictionary" );
+#endif
+
+	ok( chewing_dict_Remove( ctx, ctx->data->static_data.sys_dict->prefix ) == -1,
+		"system dictionary shall not be removed" );
+	ok( chewing_dict_Remove( ctx, DICT_LAYER_DIR ) == 0, "dictionary shall be removed" );
+	ok( chewing_dict_Remove( ctx, DICT_LAYER_DIR ) == -1, "dictionary shall not be removed twice" );
+
+	/* ctx2 still has the layer, which chewing_delete releases. */
+	chewing_delete( ctx2 );
+	chewing_delete( ctx );
+}
+
+int main()
+{
+	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
+	putenv( "CHEWING_USER_PATH=" TEST_HASH_DIR );
+
+	test_merge();
+	test_candidate();
+	test_add_remove();
+
+	return exit_status();
+}
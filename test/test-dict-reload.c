@@ -0,0 +1,173 @@
+/**
+ * test-dict-reload.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "chewing.h"
+#include "chewing-private.h"
+#include "testhelper.h"
+
+#ifndef ENABLE_BUILTIN_DICT
+static void get_buffer( ChewingContext *ctx, char *buf, size_t size )
+{
+	char *str;
+
+	chewing_Reset( ctx );
+	type_keystroke_by_string( ctx, "hk4g4" );
+	str = chewing_buffer_String( ctx );
+	strncpy( buf, str, size - 1 );
+	buf[ size - 1 ] = '\0';
+	chewing_free( str );
+	type_keystroke_by_string( ctx, "<E>" );
+}
+
+void test_reload()
+{
+	ChewingContext *ctx;
+	SystemDictData *old;
+	char base[ 256 ];
+	char buf[ 256 ];
+
+	ctx = chewing_new();
+	chewing_set_maxChiSymbolLen( ctx, 16 );
+	get_buffer( ctx, base, sizeof( base ) );
+	old = ctx->data->static_data.sys_dict;
+
+	ok( chewing_dict_Reload( ctx ) == 0, "dictionary shall be reloaded" );
+	ok( ctx->data->static_data.sys_dict != old,
+		"context without input shall switch at once" );
+	ok( ctx->data->static_data.dict_layer[ 0 ] == ctx->data->static_data.sys_dict,
+		"first layer shall be the new dictionary" );
+	ok( ctx->data->static_data.sys_dict_next == NULL, "nothing shall be left to switch" );
+
+	get_buffer( ctx, buf, sizeof( buf ) );
+	ok( !strcmp( buf, base ), "buffer `%s' shall be `%s'", buf, base );
+
+	chewing_delete( ctx );
+}
+
+void test_reload_while_entering()
+{
+	ChewingContext *ctx;
+	ChewingContext *ctx2;
+	SystemDictData *old;
+	SystemDictData *old2;
+	char base[ 256 ];
+	char buf[ 256 ];
+
+	ctx = chewing_new();
+	ctx2 = chewing_new();
+	chewing_set_maxChiSymbolLen( ctx, 16 );
+	chewing_set_maxChiSymbolLen( ctx2, 16 );
+	get_buffer( ctx2, base, sizeof( base ) );
+	old = ctx->data->static_data.sys_dict;
+	old2 = ctx2->data->static_data.sys_dict;
+
+	type_keystroke_by_string( ctx, "hk4" );
+	type_keystroke_by_string( ctx2, "hk4" );
+	ok( chewing_dict_Reload( ctx ) == 0, "dictionary shall be reloaded" );
+	ok( ctx->data->static_data.sys_dict == old,
+		"context with input shall keep its dictionary" );
+	ok( ctx->data->static_data.sys_dict_next != NULL,
+		"context with input shall hold the new dictionary" );
+	ok( ctx2->data->static_data.sys_dict == old2,
+		"other context shall keep its dictionary" );
+
+	type_keystroke_by_string( ctx, "g4" );
+	type_keystroke_by_string( ctx2, "g4" );
+	ok( ctx->data->static_data.sys_dict == old,
+		"context shall not switch before input ends" );
+
+	type_keystroke_by_string( ctx, "<E>" );
+	type_keystroke_by_string( ctx2, "<E>" );
+	get_buffer( ctx, buf, sizeof( buf ) );
+	ok( ctx->data->static_data.sys_dict != old,
+		"context shall switch at the next input" );
+	ok( !strcmp( buf, base ), "buffer `%s' shall be `%s'", buf, base );
+
+	get_buffer( ctx2, buf, sizeof( buf ) );
+	ok( ctx2->data->static_data.sys_dict != old2,
+		"other context shall switch at its next input" );
+#ifdef USE_BINARY_DATA
+	ok( ctx2->data->static_data.sys_dict == ctx->data->static_data.sys_dict,
+		"contexts shall share the new dictionary" );
+#endif
+
+	chewing_delete( ctx2 );
+	chewing_delete( ctx );
+}
+
+void test_reload_while_enumerating()
+{
+	ChewingContext *ctx;
+	char *phrase;
+	char *s;
+	int num;
+	int ret;
+
+	ctx = chewing_new();
+
+	num = chewing_predict_Enumerate( ctx, NULL, 0 );
+	ok( num > 0, "empty phone sequence shall have predictions" );
+	phrase = chewing_predict_String( ctx );
+	num = chewing_reading_Enumerate( ctx, phrase );
+	ok( num > 0, "`%s' shall have a reading", phrase );
+	chewing_free( phrase );
+
+	/* The lists point into the old dictionary, which is unloaded here. */
+	ok( chewing_dict_Reload( ctx ) == 0, "dictionary shall be reloaded" );
+	ok( !chewing_predict_hasNext( ctx ), "prediction shall end after reload" );
+	s = chewing_predict_String( ctx );
+	ok( !strcmp( s, "" ), "prediction after reload shall be empty, got `%s'", s );
+	chewing_free( s );
+	ok( !chewing_reading_hasNext( ctx ), "reading shall end after reload" );
+	ret = chewing_reading_Get( ctx, NULL, NULL );
+	ok( ret == 0, "chewing_reading_Get shall return 0 after reload, got `%d'", ret );
+
+	num = chewing_predict_Enumerate( ctx, NULL, 0 );
+	ok( num > 0, "prediction shall be enumerated again in the new dictionary" );
+	s = chewing_predict_String( ctx );
+	ok( strcmp( s, "" ), "prediction of the new dictionary shall not be empty" );
+	chewing_free( s );
+
+	chewing_delete( ctx );
+}
+#else
+void test_reload_builtin()
+{
+	ChewingContext *ctx;
+
+	ctx = chewing_new();
+	ok( chewing_dict_Reload( ctx ) == -1,
+		"dictionary linked into the library shall not be reloaded" );
+	chewing_delete( ctx );
+}
+#endif
+
+int main()
+{
+	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
+	putenv( "CHEWING_USER_PATH=" TEST_HASH_DIR );
+
+#ifndef ENABLE_BUILTIN_DICT
+	test_reload();
+	test_reload_while_entering();
+	test_reload_while_enumerating();
+#else
+	test_reload_builtin();
+#endif
+
+	return exit_status();
+}
@@ -15,6 +15,50 @@
 #include "global.h"
 #include "chewing-utf8-util.h"
 #include "key2pho-private.h"
+#include "zuin-private.h"
+
+static const int SHIFT[] = { 9, 7, 3, 0 };
+static const int SB[] = { 31, 3, 15, 7 };
+
+void test_key_table()
+{
+	KeyTable table;
+	char key[ 2 ] = { 0 };
+	char rt[ 10 ];
+	int kbtype, ch, searchTimes, type;
+	int inx, expect_type, expect_inx;
+	uint16_t phone;
+	int mismatch = 0;
+
+	for ( kbtype = 0; kbtype < KB_TYPE_NUM; ++kbtype ) {
+		InitKeyTable( &table, kbtype );
+		for ( ch = 1; ch < KEY_TABLE_KEY_NUM; ++ch ) {
+			key[ 0 ] = ch;
+			for ( searchTimes = 1; searchTimes <= 3; ++searchTimes ) {
+				expect_type = 0;
+				expect_inx = 0;
+				if ( PhoneFromKey( rt, key, kbtype, searchTimes ) ) {
+					phone = UintFromPhone( rt );
+					for ( type = 0; type < 4; ++type ) {
+						expect_inx = ( phone >> SHIFT[ type ] ) & SB[ type ];
+						if ( expect_inx ) {
+							expect_type = type;
+							break;
+						}
+					}
+				}
+
+				inx = PhoneFromKeyTable( &table, ch, searchTimes, &type );
+				if ( inx != expect_inx || ( inx && type != expect_type ) )
+					++mismatch;
+				if ( expect_inx && PhoneInxFromKeyTable( &table, ch,
+					expect_type, searchTimes ) != expect_inx )
+					++mismatch;
+			}
+		}
+	}
+	ok( mismatch == 0, "key table shall match PhoneFromKey, got `%d' mismatch", mismatch );
+}
 
 int main (int argc, char *argv[])
 {
@@ -74,5 +118,7 @@ int main (int argc, char *argv[])
 	PhoneFromKey( rt, "dj7", 0, 1 );
 	ok (!strcmp(rt, "\xE3\x84\x8E\xE3\x84\xA8\xCB\x99" /* ㄎㄨ˙ */ ), "dj7");
 
+	test_key_table();
+
 	return exit_status();
 }
@@ -12,12 +12,18 @@
 #include <config.h>
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "chewing.h"
+#include "chewing-private.h"
+#include "zuin-private.h"
 #include "testhelper.h"
 
+#define ZUIN_STATE_NUM ( 22 * 4 * 14 * 5 )
+
 static char *KEYBOARD_STRING[] = {
 	"KB_DEFAULT",
 	"KB_HSU",
@@ -127,6 +133,162 @@ void test_enumerate_keyboard_type()
 	chewing_Terminate();
 }
 
+static void phone_inx_from_state( int pho_inx[], int state )
+{
+	pho_inx[ 3 ] = state % 5;
+	state /= 5;
+	pho_inx[ 2 ] = state % 14;
+	state /= 14;
+	pho_inx[ 1 ] = state % 4;
+	pho_inx[ 0 ] = state / 4;
+}
+
+/* Transition tables shall agree with the layouts on every key in every state. */
+void test_transition_table()
+{
+	ChewingContext *ctx;
+	const KeyTable *table;
+	ZuinTable *zuin_table;
+	int pho_inx[ ZUIN_SIZE ], expect[ ZUIN_SIZE ], actual[ ZUIN_SIZE ];
+	int expect_action, actual_action, expect_tone, actual_tone;
+	int kbtype, state, key;
+	int mismatch;
+
+	ctx = chewing_new();
+
+	for ( kbtype = 0; kbtype < KB_HANYU_PINYIN; kbtype++ ) {
+		table = &ctx->data->static_data.key_table[ kbtype ];
+		zuin_table = ZuinTableNew( table, kbtype );
+		ok( zuin_table != NULL, "transition table of `%s' shall be compiled",
+			KEYBOARD_STRING[ kbtype ] );
+		if ( !zuin_table )
+			continue;
+
+		mismatch = 0;
+		for ( state = 0; state < ZUIN_STATE_NUM; state++ ) {
+			phone_inx_from_state( pho_inx, state );
+			/* keys out of the table are included */
+			for ( key = -1; key <= KEY_TABLE_KEY_NUM; key++ ) {
+				expect_action = ZuinTransition( table, kbtype, pho_inx, key, expect, &expect_tone );
+				actual_action = ZuinTableLookup( zuin_table, table, pho_inx, key, actual, &actual_tone );
+				if ( expect_action != actual_action || expect_tone != actual_tone ||
+					memcmp( expect, actual, sizeof( expect ) ) ) {
+					if ( !mismatch )
+						ok( 0, "`%s' differs at key `%d', state `%d %d %d %d'",
+							KEYBOARD_STRING[ kbtype ], key,
+							pho_inx[ 0 ], pho_inx[ 1 ], pho_inx[ 2 ], pho_inx[ 3 ] );
+					++mismatch;
+				}
+			}
+		}
+		ok( mismatch == 0, "`%s' shall have no different transition, got `%d'",
+			KEYBOARD_STRING[ kbtype ], mismatch );
+
+		ZuinTableDelete( zuin_table );
+	}
+
+	chewing_delete( ctx );
+}
+
+void test_transition_table_input()
+{
+	ChewingContext *ctx;
+	ChewingContext *ctx2;
+
+	ctx = chewing_new();
+
+	/* ㄐ followed by ㄨ is ㄓ in Hsu */
+	chewing_set_KBType( ctx, KB_HSU );
+	type_keystroke_by_string( ctx, "jx" );
+	ok_zuin_buffer( ctx, "\xE3\x84\x93\xE3\x84\xA8" /* ㄓㄨ */ );
+	type_keystroke_by_string( ctx, "<EE>" );
+
+	/* switching between ㄅ and ㄆ in DaChen CP26 */
+	chewing_set_KBType( ctx, KB_DACHEN_CP26 );
+	type_keystroke_by_string( ctx, "qq" );
+	ok_zuin_buffer( ctx, "\xE3\x84\x86" /* ㄆ */ );
+
+	ok( ctx->data->static_data.zuin_table[ KB_HSU ] != NULL &&
+		ctx->data->static_data.zuin_table[ KB_DACHEN_CP26 ] != NULL,
+		"transition tables shall be compiled on first use" );
+	ok( ctx->data->static_data.zuin_table[ KB_ET26 ] == NULL,
+		"transition table of an unused layout shall not be compiled" );
+
+	/* another context shall use the same table, rather than compile its own */
+	ctx2 = chewing_new();
+	chewing_set_KBType( ctx2, KB_HSU );
+	type_keystroke_by_string( ctx2, "j" );
+	ok( ctx2->data->static_data.zuin_table[ KB_HSU ] == ctx->data->static_data.zuin_table[ KB_HSU ],
+		"transition table shall be shared by contexts" );
+
+	chewing_delete( ctx );
+
+	type_keystroke_by_string( ctx2, "x" );
+	ok_zuin_buffer( ctx2, "\xE3\x84\x93\xE3\x84\xA8" /* ㄓㄨ */ );
+
+	chewing_delete( ctx2 );
+}
+
+#define BENCHMARK_INPUT_NUM ( 1 << 20 )
+
+void benchmark()
+{
+	ChewingContext *ctx;
+	const KeyTable *table;
+	ZuinTable *zuin_table;
+	int pho_inx[ ZUIN_SIZE ], new_inx[ ZUIN_SIZE ];
+	int *input;
+	unsigned int seed = 1;
+	clock_t start;
+	double table_ns, function_ns;
+	int i, tone;
+	int sum = 0;
+
+	ctx = chewing_new();
+	table = &ctx->data->static_data.key_table[ KB_HSU ];
+
+	start = clock();
+	zuin_table = ZuinTableNew( table, KB_HSU );
+	printf( "# compiling the table of KB_HSU: %.3f ms\n",
+		(double) ( clock() - start ) * 1e3 / CLOCKS_PER_SEC );
+	input = calloc( BENCHMARK_INPUT_NUM, sizeof( int ) );
+	if ( !zuin_table || !input ) {
+		ZuinTableDelete( zuin_table );
+		free( input );
+		chewing_delete( ctx );
+		return;
+	}
+
+	/* states and keys in random order, as typing does not follow any order */
+	for ( i = 0; i < BENCHMARK_INPUT_NUM; i++ ) {
+		seed = seed * 1103515245 + 12345;
+		input[ i ] = ( seed >> 8 ) % ( ZUIN_STATE_NUM * KEY_TABLE_KEY_NUM );
+	}
+
+	start = clock();
+	for ( i = 0; i < BENCHMARK_INPUT_NUM; i++ ) {
+		phone_inx_from_state( pho_inx, input[ i ] / KEY_TABLE_KEY_NUM );
+		sum += ZuinTableLookup( zuin_table, table, pho_inx, input[ i ] % KEY_TABLE_KEY_NUM,
+			new_inx, &tone );
+	}
+	table_ns = (double) ( clock() - start ) * 1e9 / CLOCKS_PER_SEC / BENCHMARK_INPUT_NUM;
+
+	start = clock();
+	for ( i = 0; i < BENCHMARK_INPUT_NUM; i++ ) {
+		phone_inx_from_state( pho_inx, input[ i ] / KEY_TABLE_KEY_NUM );
+		sum -= ZuinTransition( table, KB_HSU, pho_inx, input[ i ] % KEY_TABLE_KEY_NUM,
+			new_inx, &tone );
+	}
+	function_ns = (double) ( clock() - start ) * 1e9 / CLOCKS_PER_SEC / BENCHMARK_INPUT_NUM;
+
+	ok( sum == 0, "table and functions shall have the same actions" );
+	printf( "# transition cost of KB_HSU: table %.3f ns, functions %.3f ns\n", table_ns, function_ns );
+
+	free( input );
+	ZuinTableDelete( zuin_table );
+	chewing_delete( ctx );
+}
+
 int main()
 {
 	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
@@ -135,6 +297,9 @@ int main()
 	test_set_keyboard_type();
 	test_KBStr2Num();
 	test_enumerate_keyboard_type();
+	test_transition_table();
+	test_transition_table_input();
+	benchmark();
 
 	return exit_status();
 }
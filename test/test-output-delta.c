@@ -0,0 +1,151 @@
+/**
+ * test-output-delta.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "chewing.h"
+#include "testhelper.h"
+
+/*
+ * Keep a copy of preedit string on the client side, and apply every delta
+ * reported to it. The copy shall always be the same as the preedit string.
+ */
+typedef struct {
+	char buf[ 1024 ];
+	int len;
+} Client;
+
+static void apply_delta( Client *client, const ChewingOutputDelta *delta )
+{
+	memmove( client->buf + delta->preeditFrom + delta->preeditTextLen,
+		client->buf + delta->preeditTo,
+		client->len - delta->preeditTo );
+	memcpy( client->buf + delta->preeditFrom,
+		delta->preeditText, delta->preeditTextLen );
+	client->len += delta->preeditTextLen - ( delta->preeditTo - delta->preeditFrom );
+	client->buf[ client->len ] = '\0';
+}
+
+static void type_and_check( ChewingContext *ctx, Client *client, const char *key[], size_t key_len )
+{
+	ChewingOutputDelta delta;
+	size_t i;
+
+	for ( i = 0; i < key_len; i++ ) {
+		type_keystroke_by_string( ctx, (char *) key[ i ] );
+		chewing_output_Delta( ctx, &delta );
+
+		ok( 0 <= delta.preeditFrom && delta.preeditFrom <= delta.preeditTo &&
+			delta.preeditTo <= client->len,
+			"replaced range [%d, %d) shall be in [0, %d)",
+			delta.preeditFrom, delta.preeditTo, client->len );
+		apply_delta( client, &delta );
+		ok( !strcmp( client->buf, chewing_buffer_String_static( ctx ) ),
+			"string after `%s' shall be `%s', got `%s'", key[ i ],
+			chewing_buffer_String_static( ctx ), client->buf );
+		ok( delta.cursor == chewing_cursor_Current( ctx ),
+			"cursor shall be `%d', got `%d'",
+			chewing_cursor_Current( ctx ), delta.cursor );
+	}
+}
+
+void test_delta_follows_preedit()
+{
+	static const char *KEY[] = {
+		"h", "k", "4", "g", "4", "<L>", "<L>", "x", "<R>", "<B>",
+		"5", "j", "/", " ", "<H>", "<DC>", "<EN>", "<E>",
+	};
+	ChewingContext *ctx;
+	Client client = { "", 0 };
+
+	ctx = chewing_new();
+	chewing_set_maxChiSymbolLen( ctx, 16 );
+
+	type_and_check( ctx, &client, KEY, ARRAY_SIZE( KEY ) );
+
+	chewing_delete( ctx );
+}
+
+void test_no_change()
+{
+	ChewingOutputDelta delta;
+	ChewingContext *ctx;
+	int ret;
+
+	ctx = chewing_new();
+	chewing_set_maxChiSymbolLen( ctx, 16 );
+
+	type_keystroke_by_string( ctx, "hk4" );
+	ret = chewing_output_Delta( ctx, &delta );
+	ok( ret == 1, "chewing_output_Delta shall return 1 after typing, got `%d'", ret );
+	ok( delta.preeditFrom == 0 && delta.preeditTo == 0,
+		"replaced range shall be [0, 0), got [%d, %d)", delta.preeditFrom, delta.preeditTo );
+	ok( delta.preeditTextLen == (int) strlen( chewing_buffer_String_static( ctx ) ),
+		"whole preedit string shall be reported" );
+
+	ret = chewing_output_Delta( ctx, &delta );
+	ok( ret == 0, "chewing_output_Delta shall return 0 without typing, got `%d'", ret );
+	ok( delta.preeditTextLen == 0, "preeditTextLen shall be 0, got `%d'", delta.preeditTextLen );
+
+	type_keystroke_by_string( ctx, "<L>" );
+	ret = chewing_output_Delta( ctx, &delta );
+	ok( delta.bCursorChanged == 1, "bCursorChanged shall be 1 after <L>" );
+	ok( delta.preeditTextLen == 0 && delta.preeditFrom == delta.preeditTo,
+		"preedit string shall not be changed by <L>" );
+
+	chewing_delete( ctx );
+}
+
+void test_delta_mid_buffer()
+{
+	ChewingOutputDelta delta;
+	ChewingContext *ctx;
+	Client client = { "", 0 };
+	int old_len;
+
+	ctx = chewing_new();
+	chewing_set_maxChiSymbolLen( ctx, 16 );
+
+	type_keystroke_by_string( ctx, "hk4g4u4hk4<L><L>" );
+	chewing_output_Delta( ctx, &delta );
+	apply_delta( &client, &delta );
+	old_len = client.len;
+
+	/* Delete the second character. The last two shall not be reported. */
+	type_keystroke_by_string( ctx, "<B>" );
+	chewing_output_Delta( ctx, &delta );
+	ok( delta.preeditTo < old_len,
+		"preeditTo shall be less than `%d', got `%d'", old_len, delta.preeditTo );
+	ok( old_len - delta.preeditTo > 0,
+		"unchanged suffix shall not be empty, got `%d'", old_len - delta.preeditTo );
+	apply_delta( &client, &delta );
+	ok( !strcmp( client.buf, chewing_buffer_String_static( ctx ) ),
+		"string after <B> shall be `%s', got `%s'",
+		chewing_buffer_String_static( ctx ), client.buf );
+
+	chewing_delete( ctx );
+}
+
+int main()
+{
+	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
+	putenv( "CHEWING_USER_PATH=" TEST_HASH_DIR );
+
+	test_delta_follows_preedit();
+	test_no_change();
+	test_delta_mid_buffer();
+
+	return exit_status();
+}
@@ -29,16 +29,15 @@ int find_path_by_files(
 	size_t output_len );
 
 static const char *FILES[] = {
-	CHAR_FILE,
 #ifdef USE_BINARY_DATA
-	CHAR_INDEX_BEGIN_FILE,
-	CHAR_INDEX_PHONE_FILE,
+	DICTIONARY_FILE,
 #else
+	CHAR_FILE,
 	CHAR_INDEX_FILE,
-#endif
 	DICT_FILE,
 	PH_INDEX_FILE,
 	PHONE_TREE_FILE,
+#endif
 	SYMBOL_TABLE_FILE,
 	SOFTKBD_TABLE_FILE,
 	PINYIN_TAB_NAME,
@@ -85,10 +84,26 @@ void test_plat_path_cannot_find()
 	ok( ret != 0, "find_path_by_files shall not return 0" );
 }
 
+void test_plat_dir_stamp()
+{
+	plat_dir_stamp stamp;
+	plat_dir_stamp stamp_again;
+
+	get_dir_stamp( CHEWING_DATA_PREFIX, &stamp );
+	get_dir_stamp( CHEWING_DATA_PREFIX, &stamp_again );
+	ok( stamp.exist, "stamp of an existing directory shall exist" );
+	ok( memcmp( &stamp, &stamp_again, sizeof( stamp ) ) == 0,
+		"stamp of an unchanged directory shall not change" );
+
+	get_dir_stamp( CHEWING_DATA_PREFIX "_no_such_path", &stamp );
+	ok( !stamp.exist, "stamp of a missing directory shall not exist" );
+}
+
 int main()
 {
 	test_plat_get_search_path();
 	test_plat_path_found();
 	test_plat_path_cannot_find();
+	test_plat_dir_stamp();
 	return exit_status();
 }
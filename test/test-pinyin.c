@@ -0,0 +1,362 @@
+/**
+ * test-pinyin.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chewing.h"
+#include "chewing-private.h"
+#include "char-private.h"
+#include "key2pho-private.h"
+#include "pinyin-private.h"
+#include "zuin-private.h"
+#include "testhelper.h"
+
+#define BENCHMARK_ROUND 200
+
+static const char *PINYIN_KBTYPE[] = {
+	"KB_HANYU_PINYIN",
+	"KB_THL_PINYIN",
+	"KB_MPS2_PINYIN",
+};
+
+/* Convert pinyin with PinyinToZuin and the default keyboard layout. */
+static int reference_phone( ChewingData *pgdata, const char *pinyin,
+	uint16_t *phone, uint16_t *phoneAlt )
+{
+	char buf[ PINYIN_SIZE ];
+	char zuin[ 16 ], zuinAlt[ 16 ];
+	char rt[ 64 ];
+
+	strcpy( buf, pinyin );
+	if ( PinyinToZuin( pgdata, buf, zuin, zuinAlt ) )
+		return -1;
+	if ( ! PhoneFromKey( rt, zuin, KB_DEFAULT, 1 ) )
+		return -1;
+	*phone = UintFromPhone( rt );
+	if ( *phone == 0 )
+		return -1;
+	if ( ! PhoneFromKey( rt, zuinAlt, KB_DEFAULT, 1 ) )
+		return -1;
+	*phoneAlt = UintFromPhone( rt );
+	return 0;
+}
+
+/* Call func with every spelling made of an initial and a final. */
+static void for_each_spelling( ChewingData *pgdata,
+	void (*func)( ChewingData *pgdata, const char *pinyin, void *param ), void *param )
+{
+	char pinyin[ 32 ];
+	int i, j;
+
+	for ( i = 0; i < pgdata->static_data.HANYU_INITIALS; i++ ) {
+		for ( j = 0; j < pgdata->static_data.HANYU_FINALS; j++ ) {
+			snprintf( pinyin, sizeof( pinyin ), "%s%s",
+				pgdata->static_data.hanyuInitialsMap[ i ].pinyin,
+				pgdata->static_data.hanyuFinalsMap[ j ].pinyin );
+			if ( pinyin[ 0 ] && strlen( pinyin ) < PINYIN_SIZE )
+				func( pgdata, pinyin, param );
+		}
+	}
+}
+
+static void compare_spelling( ChewingData *pgdata, const char *pinyin, void *param )
+{
+	int *mismatch = param;
+	uint16_t phone, phoneAlt, expect, expectAlt;
+	int ret, expect_ret;
+
+	ret = PinyinToPhone( pgdata, pinyin, &phone, &phoneAlt );
+	expect_ret = reference_phone( pgdata, pinyin, &expect, &expectAlt );
+	if ( ret != expect_ret || ( ret == 0 &&
+		( phone != expect || phoneAlt != expectAlt ) ) ) {
+		++*mismatch;
+		printf( "# `%s' got %d %d %d, expected %d %d %d\n", pinyin,
+			ret, phone, phoneAlt, expect_ret, expect, expectAlt );
+	}
+}
+
+void test_same_as_PinyinToZuin()
+{
+	ChewingContext *ctx;
+	const char *SPECIAL[] = {
+		"tzu", "ssu", "szu", "e", "ch", "sh", "c", "s", "nu", "lu",
+		"luan", "niu", "liu", "jiu", "chiu", "shiu", "ju", "juan",
+		"juen", "chi", "shi", "ci", "si", "xyz", "",
+	};
+	size_t i, j;
+	int mismatch;
+
+	ctx = chewing_new();
+
+	for ( i = 0; i < ARRAY_SIZE( PINYIN_KBTYPE ); ++i ) {
+		chewing_set_KBType( ctx, chewing_KBStr2Num( (char *) PINYIN_KBTYPE[ i ] ) );
+		LoadPinyin( ctx->data );
+
+		mismatch = 0;
+		for_each_spelling( ctx->data, compare_spelling, &mismatch );
+		for ( j = 0; j < ARRAY_SIZE( SPECIAL ); ++j )
+			compare_spelling( ctx->data, SPECIAL[ j ], &mismatch );
+		ok( mismatch == 0, "%s shall be the same as PinyinToZuin, got `%d' mismatch",
+			PINYIN_KBTYPE[ i ], mismatch );
+	}
+
+	chewing_delete( ctx );
+}
+
+typedef struct {
+	char reachable[ 1 << 16 ];
+} Reachable;
+
+static void mark_reachable( ChewingData *pgdata, const char *pinyin, void *param )
+{
+	Reachable *reachable = param;
+	uint16_t phone, phoneAlt;
+
+	if ( PinyinToPhone( pgdata, pinyin, &phone, &phoneAlt ) == 0 ) {
+		reachable->reachable[ phone ] = 1;
+		reachable->reachable[ phoneAlt ] = 1;
+	}
+}
+
+/*
+ * Syllables in the dictionary which pinyin.tab has no spelling for. They are
+ * reported but not treated as failure.
+ */
+static const char *KNOWN_GAP[] = {
+	"\xE3\x84\xA7\xE3\x84\x9E", /* ㄧㄞ */
+	"\xE3\x84\x88\xE3\x84\xA8\xE3\x84\xA5", /* ㄈㄨㄥ */
+	"\xE3\x84\x90", /* ㄐ */
+};
+
+static int is_known_gap( const char *syllable )
+{
+	size_t i;
+
+	for ( i = 0; i < ARRAY_SIZE( KNOWN_GAP ); ++i ) {
+		if ( !strcmp( syllable, KNOWN_GAP[ i ] ) )
+			return 1;
+	}
+	return 0;
+}
+
+void test_every_syllable_in_dictionary()
+{
+	ChewingContext *ctx;
+	Reachable *reachable;
+	CharIterator iter;
+	Word word;
+	char buf[ 16 ];
+	size_t i;
+	int phone, tone;
+	int total = 0;
+	int missing = 0;
+
+	ctx = chewing_new();
+	reachable = calloc( 1, sizeof( *reachable ) );
+
+	for ( i = 0; i < ARRAY_SIZE( PINYIN_KBTYPE ); ++i ) {
+		chewing_set_KBType( ctx, chewing_KBStr2Num( (char *) PINYIN_KBTYPE[ i ] ) );
+		LoadPinyin( ctx->data );
+		for_each_spelling( ctx->data, mark_reachable, reachable );
+	}
+
+	/* Tone is not part of the spelling, so only check syllables without tone. */
+	for ( phone = 8; phone < ( 1 << 16 ); phone += 8 ) {
+		for ( tone = 0; tone < 8; ++tone ) {
+			if ( GetCharFirst( ctx->data, &iter, &word, phone | tone ) )
+				break;
+		}
+		if ( tone == 8 )
+			continue;
+		++total;
+		if ( ! reachable->reachable[ phone ] ) {
+			PhoneFromUint( buf, sizeof( buf ), phone );
+			printf( "# syllable `%s' has no pinyin spelling\n", buf );
+			if ( ! is_known_gap( buf ) )
+				++missing;
+		}
+	}
+	ok( total > 0, "dictionary shall have syllables" );
+	ok( missing == 0, "all `%d' syllables shall have pinyin spelling, got `%d' unknown missing",
+		total, missing );
+
+	free( reachable );
+	chewing_delete( ctx );
+}
+
+static ChewingContext *new_continuous_context()
+{
+	ChewingContext *ctx;
+
+	ctx = chewing_new();
+	chewing_set_KBType( ctx, chewing_KBStr2Num( "KB_HANYU_PINYIN" ) );
+	chewing_set_continuousPinyin( ctx, 1 );
+	chewing_set_maxChiSymbolLen( ctx, 30 );
+	return ctx;
+}
+
+/* Check syllables typed in continuous mode, ignoring tone. */
+static void check_syllable( ChewingContext *ctx, const char *keystroke,
+	const char *syllable[], int len )
+{
+	uint16_t *phoneSeq;
+	int phoneSeqLen;
+	int i;
+
+	type_keystroke_by_string( ctx, (char *) keystroke );
+
+	phoneSeqLen = chewing_get_phoneSeqLen( ctx );
+	ok( phoneSeqLen == len, "`%s' shall have `%d' syllables, got `%d'",
+		keystroke, len, phoneSeqLen );
+
+	phoneSeq = chewing_get_phoneSeq( ctx );
+	for ( i = 0; i < len && i < phoneSeqLen; ++i ) {
+		ok( ( phoneSeq[ i ] & ~7 ) == UintFromPhone( syllable[ i ] ),
+			"syllable %d of `%s' shall be `%s'", i, keystroke, syllable[ i ] );
+	}
+	chewing_free( phoneSeq );
+}
+
+void test_continuous_segmentation()
+{
+	static const char *XIAN[] = {
+		"\xE3\x84\x92\xE3\x84\xA7\xE3\x84\xA2", /* ㄒㄧㄢ */
+	};
+	static const char *XI_AN[] = {
+		"\xE3\x84\x92\xE3\x84\xA7", /* ㄒㄧ */
+		"\xE3\x84\xA2", /* ㄢ */
+	};
+	static const char *XIAN_ZAI[] = {
+		"\xE3\x84\x92\xE3\x84\xA7\xE3\x84\xA2", /* ㄒㄧㄢ */
+		"\xE3\x84\x97\xE3\x84\x9E", /* ㄗㄞ */
+	};
+	ChewingContext *ctx;
+
+	ctx = new_continuous_context();
+	check_syllable( ctx, "xian ", XIAN, ARRAY_SIZE( XIAN ) );
+	chewing_delete( ctx );
+
+	ctx = new_continuous_context();
+	check_syllable( ctx, "xi'an ", XI_AN, ARRAY_SIZE( XI_AN ) );
+	chewing_delete( ctx );
+
+	ctx = new_continuous_context();
+	check_syllable( ctx, "xianzai ", XIAN_ZAI, ARRAY_SIZE( XIAN_ZAI ) );
+	chewing_delete( ctx );
+
+	ctx = new_continuous_context();
+	check_syllable( ctx, "xianz<B> ", XIAN, ARRAY_SIZE( XIAN ) );
+	chewing_delete( ctx );
+}
+
+void test_continuous_tone()
+{
+	ChewingContext *ctx;
+	uint16_t *phoneSeq;
+
+	ctx = new_continuous_context();
+	type_keystroke_by_string( ctx, "ma3 " );
+	ok( chewing_get_phoneSeqLen( ctx ) == 1, "`ma3 ' shall have 1 syllable" );
+	phoneSeq = chewing_get_phoneSeq( ctx );
+	ok( phoneSeq[ 0 ] == UintFromPhone( "\xE3\x84\x87\xE3\x84\x9A\xCB\x87" ),
+		"`ma3 ' shall be `\xE3\x84\x87\xE3\x84\x9A\xCB\x87'" ); /* ㄇㄚˇ */
+	chewing_free( phoneSeq );
+	chewing_delete( ctx );
+}
+
+void test_continuous_full()
+{
+	ChewingContext *ctx;
+	int len;
+
+	ctx = new_continuous_context();
+
+	/* 30 letters overflow the zuin buffer. */
+	type_keystroke_by_string( ctx, "womenwomenwomenwomenwomenwomen" );
+	len = chewing_get_phoneSeqLen( ctx );
+	ok( len > 0, "full zuin buffer shall be moved to preedit buffer" );
+	ok( chewing_zuin_Check( ctx ) == 0, "zuin buffer shall not be empty" );
+
+	type_keystroke_by_string( ctx, " " );
+	len = chewing_get_phoneSeqLen( ctx );
+	ok( len == 12, "`women' * 6 shall have `12' syllables, got `%d'", len );
+
+	chewing_delete( ctx );
+}
+
+static void lookup_table( ChewingData *pgdata, const char *pinyin, void *param )
+{
+	uint16_t phone, phoneAlt;
+	int *count = param;
+
+	PinyinToPhone( pgdata, pinyin, &phone, &phoneAlt );
+	++*count;
+}
+
+static void lookup_reference( ChewingData *pgdata, const char *pinyin, void *param )
+{
+	uint16_t phone, phoneAlt;
+	int *count = param;
+
+	reference_phone( pgdata, pinyin, &phone, &phoneAlt );
+	++*count;
+}
+
+void benchmark()
+{
+	ChewingContext *ctx;
+	clock_t start;
+	double table_ns, reference_ns;
+	int count;
+	int i;
+
+	ctx = chewing_new();
+	chewing_set_KBType( ctx, chewing_KBStr2Num( "KB_HANYU_PINYIN" ) );
+	LoadPinyin( ctx->data );
+
+	count = 0;
+	start = clock();
+	for ( i = 0; i < BENCHMARK_ROUND; ++i )
+		for_each_spelling( ctx->data, lookup_table, &count );
+	table_ns = (double) ( clock() - start ) * 1e9 / CLOCKS_PER_SEC / count;
+
+	count = 0;
+	start = clock();
+	for ( i = 0; i < BENCHMARK_ROUND; ++i )
+		for_each_spelling( ctx->data, lookup_reference, &count );
+	reference_ns = (double) ( clock() - start ) * 1e9 / CLOCKS_PER_SEC / count;
+
+	printf( "# per-syllable cost: PinyinToPhone %.1f ns, "
+		"PinyinToZuin and key mapping %.1f ns\n", table_ns, reference_ns );
+
+	chewing_delete( ctx );
+}
+
+int main()
+{
+	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
+	putenv( "CHEWING_USER_PATH=" TEST_HASH_DIR );
+
+	test_same_as_PinyinToZuin();
+	test_every_syllable_in_dictionary();
+	test_continuous_segmentation();
+	test_continuous_tone();
+	test_continuous_full();
+	benchmark();
+
+	return exit_status();
+}
@@ -0,0 +1,284 @@
+/**
+ * test-prediction.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chewing.h"
+#include "chewing-private.h"
+#include "chewing-utf8-util.h"
+#include "dict-private.h"
+#include "tree-private.h"
+#include "testhelper.h"
+
+#define BENCHMARK_ROUND 1000
+
+typedef struct {
+	int *freq;
+	int num;
+	int max;
+} FreqList;
+
+static int comp_freq_descend( const void *a, const void *b )
+{
+	return *(const int *) b - *(const int *) a;
+}
+
+static void add_freq( FreqList *list, int freq )
+{
+	if ( list->num == list->max ) {
+		list->max = list->max ? list->max * 2 : 64;
+		list->freq = realloc( list->freq, sizeof( int ) * list->max );
+	}
+	list->freq[ list->num++ ] = freq;
+}
+
+/* What prediction costs without the table: a scan of every phrase below node. */
+static void scan_subtree( ChewingData *pgdata, int node, FreqList *list )
+{
+	const TreeType *tree = pgdata->static_data.sys_dict->tree;
+	PhraseIterator iter;
+	Phrase phrase;
+	int child;
+
+	for (
+		child = tree[ node ].child_begin;
+		child != -1 && child <= tree[ node ].child_end;
+		child++ ) {
+		if ( tree[ child ].phrase_id != -1 ) {
+			GetDictPhraseFirst( pgdata->static_data.sys_dict, &iter, &phrase, tree[ child ].phrase_id );
+			do {
+				add_freq( list, phrase.freq );
+			} while ( GetPhraseNext( pgdata, &iter, &phrase ) );
+		}
+		scan_subtree( pgdata, child, list );
+	}
+}
+
+typedef struct {
+	int node_num;
+	int wrong;
+} CheckResult;
+
+/* The table of every node shall be the most frequent phrases below it. */
+static void check_node( ChewingData *pgdata, int node, uint16_t phone[], int len,
+	CheckResult *result )
+{
+	const TreeType *tree = pgdata->static_data.sys_dict->tree;
+	FreqList list = { NULL, 0, 0 };
+	const int *offset;
+	Phrase phrase;
+	int expected;
+	int num;
+	int child;
+	int i;
+
+	++result->node_num;
+	scan_subtree( pgdata, node, &list );
+	if ( list.num )
+		qsort( list.freq, list.num, sizeof( int ), comp_freq_descend );
+	expected = list.num < PREDICT_TOP_K ? list.num : PREDICT_TOP_K;
+
+	num = TreePredictPhrase( pgdata, phone, len, &offset );
+	if ( num != expected ) {
+		++result->wrong;
+	}
+	else {
+		for ( i = 0; i < num; i++ ) {
+			GetPhraseByOffset( pgdata, offset[ i ], &phrase );
+			if ( phrase.freq != list.freq[ i ] || ueStrLen( phrase.phrase ) <= len ) {
+				++result->wrong;
+				break;
+			}
+		}
+	}
+	free( list.freq );
+
+	if ( len == MAX_PHRASE_LEN )
+		return;
+	for (
+		child = tree[ node ].child_begin;
+		child != -1 && child <= tree[ node ].child_end;
+		child++ ) {
+		phone[ len ] = tree[ child ].phone_id;
+		check_node( pgdata, child, phone, len + 1, result );
+	}
+}
+
+void test_every_node()
+{
+	ChewingContext *ctx;
+	uint16_t phone[ MAX_PHRASE_LEN ];
+	CheckResult result = { 0, 0 };
+
+	ctx = chewing_new();
+
+	ok( ctx->data->static_data.sys_dict->predict_begin != NULL,
+		"prediction table shall be loaded" );
+
+	check_node( ctx->data, 0, phone, 0, &result );
+	ok( result.node_num > 1, "phone tree shall have nodes" );
+	ok( result.wrong == 0, "all `%d' nodes shall predict their most frequent phrases, got `%d' wrong",
+		result.node_num, result.wrong );
+
+	chewing_delete( ctx );
+}
+
+/* The first phone which has a longer phrase */
+static int find_predictable_phone( ChewingData *pgdata, uint16_t *phone )
+{
+	const TreeType *tree = pgdata->static_data.sys_dict->tree;
+	int child;
+
+	for (
+		child = tree[ 0 ].child_begin;
+		child != -1 && child <= tree[ 0 ].child_end;
+		child++ ) {
+		if ( tree[ child ].child_begin != -1 ) {
+			*phone = tree[ child ].phone_id;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void test_enumerate()
+{
+	ChewingContext *ctx;
+	uint16_t phone;
+	char *s;
+	int num;
+	int count = 0;
+	int short_phrase = 0;
+
+	ctx = chewing_new();
+
+	ok( find_predictable_phone( ctx->data, &phone ), "dictionary shall have a phrase longer than 1" );
+
+	num = chewing_predict_Enumerate( ctx, &phone, 1 );
+	ok( 0 < num && num <= PREDICT_TOP_K, "number of prediction shall be in (0, %d], got `%d'",
+		PREDICT_TOP_K, num );
+	while ( chewing_predict_hasNext( ctx ) ) {
+		s = chewing_predict_String( ctx );
+		if ( ueStrLen( s ) < 2 )
+			++short_phrase;
+		chewing_free( s );
+		++count;
+	}
+	ok( count == num, "`%d' phrases shall be enumerated, got `%d'", num, count );
+	ok( short_phrase == 0, "predicted phrases shall be longer than the phone sequence" );
+
+	s = chewing_predict_String( ctx );
+	ok( !strcmp( s, "" ), "string after the last prediction shall be empty, got `%s'", s );
+	chewing_free( s );
+
+	num = chewing_predict_Enumerate( ctx, NULL, 0 );
+	ok( num > 0, "empty phone sequence shall predict the most frequent phrases" );
+
+	chewing_delete( ctx );
+}
+
+void test_not_found()
+{
+	ChewingContext *ctx;
+	/* 0 is not a valid phone */
+	const uint16_t PHONE[] = { 0 };
+	int num;
+
+	ctx = chewing_new();
+
+	num = chewing_predict_Enumerate( ctx, PHONE, ARRAY_SIZE( PHONE ) );
+	ok( num == 0, "unknown phone shall have no prediction, got `%d'", num );
+	ok( !chewing_predict_hasNext( ctx ), "unknown phone shall have nothing to enumerate" );
+
+	num = chewing_predict_Enumerate( ctx, NULL, 1 );
+	ok( num == 0, "NULL phone sequence shall have no prediction, got `%d'", num );
+
+	chewing_delete( ctx );
+}
+
+void benchmark()
+{
+	ChewingContext *ctx;
+	const TreeType *tree;
+	FreqList list = { NULL, 0, 0 };
+	uint16_t phone = 0;
+	int node = -1;
+	int size = 0;
+	const int *offset;
+	clock_t start;
+	double table_us, scan_us;
+	int child;
+	int i;
+
+	ctx = chewing_new();
+	if ( !ctx->data->static_data.sys_dict->predict_begin ) {
+		chewing_delete( ctx );
+		return;
+	}
+	tree = ctx->data->static_data.sys_dict->tree;
+
+	/* The phone with most phrases below it */
+	for (
+		child = tree[ 0 ].child_begin;
+		child != -1 && child <= tree[ 0 ].child_end;
+		child++ ) {
+		list.num = 0;
+		scan_subtree( ctx->data, child, &list );
+		if ( list.num > size ) {
+			size = list.num;
+			node = child;
+			phone = tree[ child ].phone_id;
+		}
+	}
+	if ( node == -1 ) {
+		free( list.freq );
+		chewing_delete( ctx );
+		return;
+	}
+
+	start = clock();
+	for ( i = 0; i < BENCHMARK_ROUND; ++i )
+		TreePredictPhrase( ctx->data, &phone, 1, &offset );
+	table_us = (double) ( clock() - start ) * 1e6 / CLOCKS_PER_SEC / BENCHMARK_ROUND;
+
+	start = clock();
+	for ( i = 0; i < BENCHMARK_ROUND; ++i ) {
+		list.num = 0;
+		scan_subtree( ctx->data, node, &list );
+		qsort( list.freq, list.num, sizeof( int ), comp_freq_descend );
+	}
+	scan_us = (double) ( clock() - start ) * 1e6 / CLOCKS_PER_SEC / BENCHMARK_ROUND;
+
+	printf( "# worst-case subtree: %d phrases below phone %d\n", size, phone );
+	printf( "# prediction cost: table %.3f us, subtree scan %.3f us\n", table_us, scan_us );
+
+	free( list.freq );
+	chewing_delete( ctx );
+}
+
+int main()
+{
+	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
+	putenv( "CHEWING_USER_PATH=" TEST_HASH_DIR );
+
+	test_every_node();
+	test_enumerate();
+	test_not_found();
+	benchmark();
+
+	return exit_status();
+}
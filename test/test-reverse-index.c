@@ -0,0 +1,334 @@
+/**
+ * test-reverse-index.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chewing.h"
+#include "chewing-private.h"
+#include "chewing-utf8-util.h"
+#include "dict-private.h"
+#include "tree-private.h"
+#include "testhelper.h"
+
+#define BENCHMARK_ROUND 100
+
+typedef struct {
+	int phrase_num;
+	int missing;
+} CheckResult;
+
+static int has_reading( ChewingData *pgdata, const Phrase *phrase, int phrase_id,
+	const uint16_t phone[], int len )
+{
+	const ReverseIndexType *entry;
+	Phrase dict_phrase;
+	int num;
+	int i;
+
+	num = ReverseFindPhrase( pgdata, phrase->phrase, &entry );
+	for ( i = 0; i < num; i++ ) {
+		if ( entry[ i ].phrase_id != phrase_id )
+			continue;
+		if ( memcmp( entry[ i ].phone, phone, sizeof( uint16_t ) * len ) ||
+			( len < MAX_PHRASE_LEN && entry[ i ].phone[ len ] != 0 ) )
+			continue;
+		GetPhraseByOffset( pgdata, entry[ i ].dict_offset, &dict_phrase );
+		return dict_phrase.freq == phrase->freq;
+	}
+	return 0;
+}
+
+/* Every phrase in the phone tree shall be found by its text. */
+static void check_node( ChewingData *pgdata, int node, uint16_t phone[], int len,
+	CheckResult *result )
+{
+	const TreeType *tree = pgdata->static_data.sys_dict->tree;
+	PhraseIterator iter;
+	Phrase phrase;
+	int child;
+
+	if ( len > 0 && tree[ node ].phrase_id != -1 ) {
+		GetDictPhraseFirst( pgdata->static_data.sys_dict, &iter, &phrase, tree[ node ].phrase_id );
+		do {
+			++result->phrase_num;
+			if ( !has_reading( pgdata, &phrase, tree[ node ].phrase_id, phone, len ) )
+				++result->missing;
+		} while ( GetPhraseNext( pgdata, &iter, &phrase ) );
+	}
+
+	if ( len == MAX_PHRASE_LEN )
+		return;
+	for (
+		child = tree[ node ].child_begin;
+		child != -1 && child <= tree[ node ].child_end;
+		child++ ) {
+		phone[ len ] = tree[ child ].phone_id;
+		check_node( pgdata, child, phone, len + 1, result );
+	}
+}
+
+void test_every_phrase()
+{
+	ChewingContext *ctx;
+	uint16_t phone[ MAX_PHRASE_LEN ];
+	CheckResult result = { 0, 0 };
+
+	ctx = chewing_new();
+
+	ok( ctx->data->static_data.sys_dict->reverse_index != NULL,
+		"reverse index shall be loaded" );
+
+	check_node( ctx->data, 0, phone, 0, &result );
+	ok( result.phrase_num > 0, "phone tree shall have phrases" );
+	ok( result.missing == 0, "all `%d' phrases shall be found by text, got `%d' missing",
+		result.phrase_num, result.missing );
+	ok( (int) ctx->data->static_data.sys_dict->reverse_index_size == result.phrase_num,
+		"reverse index shall have `%d' phrases, got `%d'", result.phrase_num,
+		(int) ctx->data->static_data.sys_dict->reverse_index_size );
+
+	chewing_delete( ctx );
+}
+
+/* The first phrase longer than 1 in the phone tree */
+static int find_phrase( ChewingData *pgdata, int node, uint16_t phone[], int len,
+	Phrase *phrase )
+{
+	const TreeType *tree = pgdata->static_data.sys_dict->tree;
+	PhraseIterator iter;
+	int child;
+	int ret;
+
+	if ( len > 1 && tree[ node ].phrase_id != -1 ) {
+		GetDictPhraseFirst( pgdata->static_data.sys_dict, &iter, phrase, tree[ node ].phrase_id );
+		return len;
+	}
+
+	if ( len == MAX_PHRASE_LEN )
+		return 0;
+	for (
+		child = tree[ node ].child_begin;
+		child != -1 && child <= tree[ node ].child_end;
+		child++ ) {
+		phone[ len ] = tree[ child ].phone_id;
+		ret = find_phrase( pgdata, child, phone, len + 1, phrase );
+		if ( ret )
+			return ret;
+	}
+	return 0;
+}
+
+void test_enumerate()
+{
+	ChewingContext *ctx;
+	uint16_t phone[ MAX_PHRASE_LEN ];
+	uint16_t reading[ MAX_PHRASE_LEN ];
+	Phrase phrase;
+	int len;
+	int num;
+	int freq;
+	int found = 0;
+	int count = 0;
+	int ret;
+
+	ctx = chewing_new();
+
+	len = find_phrase( ctx->data, 0, phone, 0, &phrase );
+	ok( len > 1, "dictionary shall have a phrase longer than 1" );
+
+	num = chewing_reading_Enumerate( ctx, phrase.phrase );
+	ok( num > 0, "`%s' shall have a reading", phrase.phrase );
+	while ( chewing_reading_hasNext( ctx ) ) {
+		ret = chewing_reading_Get( ctx, reading, &freq );
+		ok( ret == len, "reading of `%s' shall have `%d' phones, got `%d'", phrase.phrase, len, ret );
+		if ( ret == len && !memcmp( reading, phone, sizeof( uint16_t ) * len ) ) {
+			++found;
+			ok( freq == phrase.freq, "frequency of `%s' shall be `%d', got `%d'",
+				phrase.phrase, phrase.freq, freq );
+		}
+		++count;
+	}
+	ok( count == num, "`%d' readings shall be enumerated, got `%d'", num, count );
+	ok( found == 1, "reading of `%s' in the phone tree shall be enumerated once, got `%d'",
+		phrase.phrase, found );
+
+	ret = chewing_reading_Get( ctx, reading, NULL );
+	ok( ret == 0, "chewing_reading_Get shall return 0 after the last reading, got `%d'", ret );
+
+	chewing_delete( ctx );
+}
+
+void test_not_found()
+{
+	ChewingContext *ctx;
+	const char *PHRASE[] = {
+		"",
+		"abc",
+		"\xE2\x96\xA1\xE2\x96\xA1" /* □□ */,
+	};
+	size_t i;
+	int num;
+
+	ctx = chewing_new();
+
+	for ( i = 0; i < ARRAY_SIZE( PHRASE ); i++ ) {
+		num = chewing_reading_Enumerate( ctx, PHRASE[ i ] );
+		ok( num == 0, "`%s' shall have no reading, got `%d'", PHRASE[ i ], num );
+		ok( !chewing_reading_hasNext( ctx ), "`%s' shall have nothing to enumerate", PHRASE[ i ] );
+	}
+
+	num = chewing_reading_Enumerate( ctx, NULL );
+	ok( num == 0, "NULL shall have no reading, got `%d'", num );
+
+	chewing_delete( ctx );
+}
+
+/* A phrase shall be annotated with one of its readings, instead of readings of its characters. */
+void test_annotate_phrase()
+{
+	ChewingContext *ctx;
+	uint16_t phone[ MAX_PHRASE_LEN ];
+	uint16_t annotated[ MAX_PHRASE_LEN ];
+	uint16_t reading[ MAX_PHRASE_LEN ];
+	Phrase phrase;
+	int len;
+	int ret;
+	int found = 0;
+
+	ctx = chewing_new();
+
+	len = find_phrase( ctx->data, 0, phone, 0, &phrase );
+	ret = chewing_annotate_Phone( ctx, phrase.phrase, annotated, ARRAY_SIZE( annotated ) );
+	ok( ret == len, "`%s' shall have `%d' characters annotated, got `%d'", phrase.phrase, len, ret );
+
+	chewing_reading_Enumerate( ctx, phrase.phrase );
+	while ( chewing_reading_hasNext( ctx ) ) {
+		chewing_reading_Get( ctx, reading, NULL );
+		if ( !memcmp( reading, annotated, sizeof( uint16_t ) * len ) )
+			++found;
+	}
+	ok( found == 1, "`%s' shall be annotated with one of its readings", phrase.phrase );
+
+	ret = chewing_annotate_Phone( ctx, phrase.phrase, annotated, 1 );
+	ok( ret == 1, "only `1' character shall be annotated, got `%d'", ret );
+
+	chewing_delete( ctx );
+}
+
+void test_annotate_no_reading()
+{
+	ChewingContext *ctx;
+	uint16_t annotated[ 8 ];
+	int ret;
+	int i;
+
+	ctx = chewing_new();
+
+	for ( i = 0; i < ARRAY_SIZE( annotated ); i++ )
+		annotated[ i ] = 1;
+	ret = chewing_annotate_Phone( ctx, "a\xE2\x96\xA1" /* a□ */, annotated, ARRAY_SIZE( annotated ) );
+	ok( ret == 2, "`2' characters shall be annotated, got `%d'", ret );
+	ok( annotated[ 0 ] == 0 && annotated[ 1 ] == 0, "characters without reading shall have phone 0" );
+
+	/* broken character at the end */
+	ret = chewing_annotate_Phone( ctx, "a\xE2\x96", annotated, ARRAY_SIZE( annotated ) );
+	ok( ret == 2, "broken character shall be annotated as a character, got `%d'", ret );
+
+	ret = chewing_annotate_Phone( ctx, "", annotated, ARRAY_SIZE( annotated ) );
+	ok( ret == 0, "empty text shall have no character, got `%d'", ret );
+
+	ret = chewing_annotate_Phone( ctx, NULL, annotated, ARRAY_SIZE( annotated ) );
+	ok( ret == -1, "NULL text shall be rejected, got `%d'", ret );
+
+	chewing_delete( ctx );
+}
+
+/* What reverse lookup costs without the index: a scan of every phrase. */
+static int scan_dict( ChewingData *pgdata, int node, const char *text )
+{
+	const TreeType *tree = pgdata->static_data.sys_dict->tree;
+	PhraseIterator iter;
+	Phrase phrase;
+	int child;
+	int num = 0;
+
+	if ( node != 0 && tree[ node ].phrase_id != -1 ) {
+		GetDictPhraseFirst( pgdata->static_data.sys_dict, &iter, &phrase, tree[ node ].phrase_id );
+		do {
+			if ( !strcmp( phrase.phrase, text ) )
+				++num;
+		} while ( GetPhraseNext( pgdata, &iter, &phrase ) );
+	}
+
+	for (
+		child = tree[ node ].child_begin;
+		child != -1 && child <= tree[ node ].child_end;
+		child++ ) {
+		num += scan_dict( pgdata, child, text );
+	}
+	return num;
+}
+
+void benchmark()
+{
+	ChewingContext *ctx;
+	const ReverseIndexType *entry;
+	uint16_t phone[ MAX_PHRASE_LEN ];
+	Phrase phrase;
+	clock_t start;
+	double index_us, scan_us;
+	int num = 0;
+	int scan_num = 0;
+	int i;
+
+	ctx = chewing_new();
+	if ( !ctx->data->static_data.sys_dict->reverse_index ||
+		!find_phrase( ctx->data, 0, phone, 0, &phrase ) ) {
+		chewing_delete( ctx );
+		return;
+	}
+
+	start = clock();
+	for ( i = 0; i < BENCHMARK_ROUND; ++i )
+		num = ReverseFindPhrase( ctx->data, phrase.phrase, &entry );
+	index_us = (double) ( clock() - start ) * 1e6 / CLOCKS_PER_SEC / BENCHMARK_ROUND;
+
+	start = clock();
+	for ( i = 0; i < BENCHMARK_ROUND; ++i )
+		scan_num = scan_dict( ctx->data, 0, phrase.phrase );
+	scan_us = (double) ( clock() - start ) * 1e6 / CLOCKS_PER_SEC / BENCHMARK_ROUND;
+
+	ok( num == scan_num, "index and scan shall find the same `%d' readings, got `%d'",
+		scan_num, num );
+	printf( "# lookup cost: index %.3f us, phrase file scan %.3f us\n", index_us, scan_us );
+
+	chewing_delete( ctx );
+}
+
+int main()
+{
+	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
+	putenv( "CHEWING_USER_PATH=" TEST_HASH_DIR );
+
+	test_every_phrase();
+	test_enumerate();
+	test_not_found();
+	test_annotate_phrase();
+	test_annotate_no_reading();
+	benchmark();
+
+	return exit_status();
+}
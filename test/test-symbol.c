@@ -12,12 +12,19 @@
 #include <config.h>
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "chewing.h"
+#include "chewing-private.h"
+#include "chewing-utf8-util.h"
+#include "symbol-private.h"
 #include "testhelper.h"
 
+#define BENCHMARK_ROUND 10000
+
 static const TestData SYMBOL[] = {
 	{ "`1<E>", "\xE2\x80\xA6" /* … */ },
 	{ "`2<E>", "\xE2\x80\xBB" /* ※ */ },
@@ -375,6 +382,153 @@ void test_symbol_cand_page()
 	chewing_Terminate();
 }
 
+void test_open_symbol_choice()
+{
+	static const char *OPEN_CAND[] = {
+		"\xE3\x80\x8C" /* 「 */,
+		"\xE3\x80\x8E" /* 『 */,
+		"\xE3\x80\x8A" /* 《 */,
+		"\xE3\x80\x88" /* 〈 */,
+		"\xE3\x80\x90" /* 【 */,
+		"\xE3\x80\x94" /* 〔 */,
+	};
+	ChewingContext *ctx;
+
+	ctx = chewing_new();
+
+	chewing_set_candPerPage( ctx, 10 );
+	chewing_set_maxChiSymbolLen( ctx, 16 );
+
+	type_keystroke_by_string( ctx, "[<D>" );
+	ok_candidate( ctx, OPEN_CAND, ARRAY_SIZE( OPEN_CAND ) );
+
+	/* The key of the symbol shall be kept, so that the list can be opened again. */
+	type_keystroke_by_string( ctx, "2<D>" );
+	ok_preedit_buffer( ctx, "\xE3\x80\x8E" /* 『 */ );
+	ok_candidate( ctx, OPEN_CAND, ARRAY_SIZE( OPEN_CAND ) );
+
+	chewing_delete( ctx );
+}
+
+void test_symbol_table()
+{
+	static const char SUFFIX[] = "\r\n\nA \xCE\x91\xCE\xB1" /* Αα */;
+	SymbolTable *table;
+	char text[ 2048 ];
+	int len;
+	int entry;
+	int num;
+	int i;
+
+	/* longer than any line limit, with a category cut to MAX_PHRASE_LEN */
+	strcpy( text, "\xE2\x80\xA6\n" /* … */ "0123456789abcdef=" );
+	len = strlen( text );
+	for ( i = 0; len + 3 + sizeof( SUFFIX ) <= sizeof( text ); i++ ) {
+		/* U+FF00 .. U+FF1F, U+FF40 .. U+FF5F */
+		text[ len++ ] = '\xEF';
+		text[ len++ ] = '\xBC' + ( i / 32 ) % 2;
+		text[ len++ ] = '\x80' + i % 32;
+	}
+	num = i;
+	strcpy( text + len, SUFFIX );
+	len += strlen( SUFFIX );
+
+	table = SymbolTableFromText( text, len, '=', 0 );
+	ok( table != NULL, "symbol table shall be compiled" );
+	if ( ! table )
+		return;
+
+	ok( table->n_entry == 3, "symbol table shall have `3' entries, got `%d'", table->n_entry );
+	ok( SymbolNum( table, 0 ) == 0, "a category without symbols is a symbol" );
+	ok( ueStrLen( SymbolCategory( table, 1 ) ) == MAX_PHRASE_LEN,
+		"category shall be cut to `%d' characters, got `%s'", MAX_PHRASE_LEN,
+		SymbolCategory( table, 1 ) );
+	ok( SymbolNum( table, 1 ) == num, "a long line shall keep all `%d' symbols, got `%d'",
+		num, SymbolNum( table, 1 ) );
+	ok( SymbolFindEntry( table, "\xEF\xBC\x80" ) == 1, "symbol shall be found in its entry" );
+	ok( SymbolFindEntry( table, "\xCE\x91" ) == -1, "separator is `=', so `A \xCE\x91\xCE\xB1' is a category" );
+	ok( SymbolFindKey( table, 'A' ) == -1, "a category longer than 1 byte is not a key" );
+	free( table );
+
+	table = SymbolTableFromText( text, len, ' ', 0 );
+	entry = SymbolFindKey( table, 'A' );
+	ok( entry == 2, "key `A' shall be entry `2', got `%d'", entry );
+	ok( SymbolNum( table, entry ) == 2, "key `A' shall have `2' symbols" );
+	ok( !strcmp( SymbolString( table, entry, 1 ), "\xCE\xB1" /* α */ ),
+		"second symbol of key `A' shall be `\xCE\xB1'" );
+	ok( SymbolFindEntry( table, "\xCE\xB1" ) == entry, "symbol shall be found by its key" );
+	ok( SymbolFindKey( table, 'B' ) == -1, "unknown key shall have no entry" );
+	ok( SymbolFindKey( table, 200 ) == -1, "non-ASCII key shall have no entry" );
+	free( table );
+
+	/* swkb.dat with a duplicate key, whose later line is too long */
+	strcpy( text, "A \xCE\x91\xCE\xB1\n" /* Αα */ "A 0123456789a\n" );
+	table = SymbolTableFromText( text, strlen( text ), ' ', 10 );
+	entry = SymbolFindKey( table, 'A' );
+	ok( entry == 0, "key `A' shall keep entry `0', got `%d'", entry );
+	ok( SymbolNum( table, entry ) == 2, "key `A' shall have `2' symbols, got `%d'",
+		SymbolNum( table, entry ) );
+	free( table );
+
+	table = SymbolTableFromText( text, strlen( text ), ' ', 0 );
+	entry = SymbolFindKey( table, 'A' );
+	ok( entry == 1, "without a limit, key `A' shall be the last entry `1', got `%d'", entry );
+	free( table );
+
+	table = SymbolTableFromText( "", 0, ' ', 0 );
+	ok( table && table->n_entry == 0 && SymbolFindEntry( table, "A" ) == -1,
+		"empty text shall compile an empty table" );
+	free( table );
+}
+
+/* What a lookup costs without the hash index: a scan of every symbol. */
+static int scan_symbol( const SymbolTable *table, const char *symbol )
+{
+	int entry, i;
+
+	for ( entry = 0; entry < table->n_entry; entry++ ) {
+		for ( i = 0; i < SymbolNum( table, entry ); i++ ) {
+			if ( !strcmp( SymbolString( table, entry, i ), symbol ) )
+				return entry;
+		}
+	}
+	return -1;
+}
+
+void benchmark()
+{
+	SymbolTable *table;
+	char filename[ 256 ];
+	const char *last;
+	clock_t start;
+	double hash_us, scan_us;
+	int entry = -1, scan = -1;
+	int i;
+
+	snprintf( filename, sizeof( filename ), "%s/symbols.dat", CHEWING_DATA_PREFIX );
+	table = SymbolTableFromFile( filename, '=', 0 );
+	if ( ! table || table->n_symbol == 0 ) {
+		free( table );
+		return;
+	}
+	last = SymbolString( table, table->n_entry - 1, SymbolNum( table, table->n_entry - 1 ) - 1 );
+
+	start = clock();
+	for ( i = 0; i < BENCHMARK_ROUND; ++i )
+		entry = SymbolFindEntry( table, last );
+	hash_us = (double) ( clock() - start ) * 1e6 / CLOCKS_PER_SEC / BENCHMARK_ROUND;
+
+	start = clock();
+	for ( i = 0; i < BENCHMARK_ROUND; ++i )
+		scan = scan_symbol( table, last );
+	scan_us = (double) ( clock() - start ) * 1e6 / CLOCKS_PER_SEC / BENCHMARK_ROUND;
+
+	ok( entry == scan, "hash and scan shall find the same entry `%d', got `%d'", scan, entry );
+	printf( "# %d symbols in %d bytes\n", table->n_symbol, table->size );
+	printf( "# lookup cost: hash %.3f us, scan %.3f us\n", hash_us, scan_us );
+	free( table );
+}
+
 int main ()
 {
 	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
@@ -382,6 +536,9 @@ int main ()
 
 	test_type_symbol();
 	test_symbol_cand_page();
+	test_open_symbol_choice();
+	test_symbol_table();
+	benchmark();
 
 	return exit_status();
 }
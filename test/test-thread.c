@@ -0,0 +1,139 @@
+/**
+ * test-thread.c
+ *
+ * Copyright (c) 2013
+ *	libchewing Core Team. See ChangeLog for details.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chewing.h"
+#include "chewing-private.h"
+#include "testhelper.h"
+
+#define THREAD_NUM	4
+#define ROUND_NUM	50
+
+/*
+ * The preedit buffer is checked instead of the commit buffer, so that no
+ * thread learns a user phrase and changes the result of another thread.
+ */
+static const char *KEYSTROKE[] = {
+	"hk4g4",
+	"5j/ jp6",
+	"2k7xu4",
+	"ji3vu6vu;4",
+};
+
+typedef struct {
+	const char *expected[ ARRAY_SIZE( KEYSTROKE ) ];
+	int mismatch;
+} ThreadData;
+
+static char *convert( ChewingContext *ctx, const char *keystroke )
+{
+	chewing_Reset( ctx );
+	chewing_set_KBType( ctx, chewing_KBStr2Num( "KB_DEFAULT" ) );
+	chewing_set_maxChiSymbolLen( ctx, 16 );
+	type_keystroke_by_string( ctx, (char *) keystroke );
+	return chewing_buffer_String( ctx );
+}
+
+static void *worker( void *arg )
+{
+	ThreadData *data = (ThreadData *) arg;
+	ChewingContext *ctx;
+	char *buf;
+	int round;
+	size_t i;
+
+	for ( round = 0; round < ROUND_NUM; ++round ) {
+		ctx = chewing_new();
+		if ( !ctx ) {
+			++data->mismatch;
+			continue;
+		}
+		for ( i = 0; i < ARRAY_SIZE( KEYSTROKE ); ++i ) {
+			buf = convert( ctx, KEYSTROKE[ i ] );
+			if ( strcmp( buf, data->expected[ i ] ) != 0 )
+				++data->mismatch;
+			chewing_free( buf );
+		}
+		chewing_delete( ctx );
+	}
+	return NULL;
+}
+
+void test_concurrent_context()
+{
+	ChewingContext *ctx;
+	ThreadData data[ THREAD_NUM ];
+	pthread_t thread[ THREAD_NUM ];
+	char *expected[ ARRAY_SIZE( KEYSTROKE ) ];
+	size_t i;
+	int j;
+	int ret;
+
+	ctx = chewing_new();
+	ok( ctx != NULL, "chewing_new shall not return NULL" );
+	for ( i = 0; i < ARRAY_SIZE( KEYSTROKE ); ++i )
+		expected[ i ] = convert( ctx, KEYSTROKE[ i ] );
+
+	for ( j = 0; j < THREAD_NUM; ++j ) {
+		for ( i = 0; i < ARRAY_SIZE( KEYSTROKE ); ++i )
+			data[ j ].expected[ i ] = expected[ i ];
+		data[ j ].mismatch = 0;
+		ret = pthread_create( &thread[ j ], NULL, worker, &data[ j ] );
+		ok( ret == 0, "pthread_create shall return 0, got `%d'", ret );
+	}
+
+	for ( j = 0; j < THREAD_NUM; ++j ) {
+		pthread_join( thread[ j ], NULL );
+		ok( data[ j ].mismatch == 0,
+			"thread %d shall have no mismatch, got `%d'", j, data[ j ].mismatch );
+	}
+
+	for ( i = 0; i < ARRAY_SIZE( KEYSTROKE ); ++i )
+		chewing_free( expected[ i ] );
+	chewing_delete( ctx );
+}
+
+void test_share_system_dictionary()
+{
+	ChewingContext *ctx1;
+	ChewingContext *ctx2;
+
+	ctx1 = chewing_new();
+	ctx2 = chewing_new();
+
+#ifdef USE_BINARY_DATA
+	ok( ctx1->data->static_data.sys_dict == ctx2->data->static_data.sys_dict,
+		"contexts shall share the same system dictionary" );
+#else
+	ok( ctx1->data->static_data.sys_dict != ctx2->data->static_data.sys_dict,
+		"contexts shall not share the system dictionary in text mode" );
+#endif
+
+	chewing_delete( ctx1 );
+	chewing_delete( ctx2 );
+}
+
+int main()
+{
+	putenv( "CHEWING_PATH=" CHEWING_DATA_PREFIX );
+	putenv( "CHEWING_USER_PATH=" TEST_HASH_DIR );
+
+	test_share_system_dictionary();
+	test_concurrent_context();
+
+	return exit_status();
+}
@@ -10,10 +10,96 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "testhelper.h"
 #include "chewing-utf8-util.h"
 
+#define BENCHMARK_ROUND 1000
+
+/* Character by character, as ueStrLen did before the word-at-a-time path */
+static int scan_len(const char *str)
+{
+	int length = 0;
+
+	while (*str) {
+		str += ueBytesFromChar(*str);
+		++length;
+	}
+	return length;
+}
+
+void test_check()
+{
+	/* 測試 */
+	const char CHINESE[] = "\xE6\xB8\xAC\xE8\xA9\xA6";
+	/* 0123456789測試 */
+	const char MIXED[] = "0123456789\xE6\xB8\xAC\xE8\xA9\xA6";
+
+	ok (!ueStrHasAscii(CHINESE, strlen(CHINESE)), "ueStrHasAscii");
+	ok (ueStrHasAscii(MIXED, strlen(MIXED)), "ueStrHasAscii");
+	ok (ueStrHasAscii("\xE6\xB8\xAC\xE8\xA9\xA6\xE8\xA8" "a", 9), "ueStrHasAscii");
+	ok (!ueStrHasAscii("", 0), "ueStrHasAscii");
+
+	ok (ueStrCheck(CHINESE, strlen(CHINESE)) == 2, "ueStrCheck");
+	ok (ueStrCheck(MIXED, strlen(MIXED)) == 12, "ueStrCheck");
+	ok (ueStrCheck(CHINESE, 5) == -1, "ueStrCheck shall reject a cut character");
+	ok (ueStrCheck("\xE6\xB8" "a", 3) == -1, "ueStrCheck shall reject a bad continuation byte");
+	ok (ueStrCheck("\xB8\xAC", 2) == -1, "ueStrCheck shall reject a bogus lead byte");
+	ok (ueStrCheck("", 0) == 0, "ueStrCheck");
+}
+
+void test_offset()
+{
+	/* a測試 */
+	const char *u8string = "a\xE6\xB8\xAC\xE8\xA9\xA6";
+	int offset[ 4 ];
+	int num;
+
+	num = ueStrOffset(u8string, offset, 3);
+	ok (num == 3, "ueStrOffset");
+	ok (offset[0] == 0 && offset[1] == 1 && offset[2] == 4 && offset[3] == 7, "ueStrOffset");
+
+	num = ueStrOffset(u8string, offset, 2);
+	ok (num == 2 && offset[2] == 4, "ueStrOffset shall stop at n characters");
+
+	num = ueStrOffset("", offset, 3);
+	ok (num == 0 && offset[0] == 0, "ueStrOffset");
+}
+
+void benchmark()
+{
+	/* 測試 */
+	const char *CHINESE = "\xE6\xB8\xAC\xE8\xA9\xA6";
+	char text[ 4096 ];
+	clock_t start;
+	double word_us, scan_us;
+	int len = 0;
+	int scan = 0;
+	int i;
+
+	/* ASCII runs mixed with Chinese, as in user phrases and commit strings */
+	text[ 0 ] = '\0';
+	while (strlen(text) + 32 < sizeof(text)) {
+		strcat(text, "libchewing 0.3.5 ");
+		strcat(text, CHINESE);
+	}
+
+	start = clock();
+	for (i = 0; i < BENCHMARK_ROUND; ++i)
+		len = ueStrLen(text);
+	word_us = (double) (clock() - start) * 1e6 / CLOCKS_PER_SEC / BENCHMARK_ROUND;
+
+	start = clock();
+	for (i = 0; i < BENCHMARK_ROUND; ++i)
+		scan = scan_len(text);
+	scan_us = (double) (clock() - start) * 1e6 / CLOCKS_PER_SEC / BENCHMARK_ROUND;
+
+	ok (len == scan, "ueStrLen shall be `%d', got `%d'", scan, len);
+	printf("# ueStrLen of %d bytes: word-at-a-time %.3f us, byte scan %.3f us\n",
+		(int) strlen(text), word_us, scan_us);
+}
+
 int main (int argc, char *argv[])
 {
 	char *u8string;
@@ -42,5 +128,13 @@ int main (int argc, char *argv[])
 	u8string = ueStrSeek(u8string, 0);
 	ok (!strcmp(u8string, "\xE6\xB8\xAC\xE8\xA9\xA6\xE8\xA8\x88\xE7\xAE\x97\xE9\x95\xB7\xE5\xBA\xA6" /* 測試計算長度 */ ), "ueStrSeek");
 
+	u8string = "Hello, World! \xE6\xB8\xAC\xE8\xA9\xA6 Hello, World!"; /* 測試 */
+	u8len = ueStrLen(u8string);
+	ok (u8len == 30, "ueStrLen shall be `30', got `%d'", u8len);
+
+	test_check();
+	test_offset();
+	benchmark();
+
 	return exit_status();
 }
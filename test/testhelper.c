@@ -30,6 +30,7 @@ BufferType COMMIT_BUFFER = {
 	0,
 	chewing_commit_String,
 	0,
+	chewing_commit_String_static,
 };
 
 BufferType PREEDIT_BUFFER = {
@@ -38,6 +39,7 @@ BufferType PREEDIT_BUFFER = {
 	chewing_buffer_Len,
 	chewing_buffer_String,
 	0,
+	chewing_buffer_String_static,
 };
 
 BufferType ZUIN_BUFFER = {
@@ -46,6 +48,7 @@ BufferType ZUIN_BUFFER = {
 	0,
 	0,
 	chewing_zuin_String,
+	0,
 };
 
 BufferType AUX_BUFFER = {
@@ -54,6 +57,7 @@ BufferType AUX_BUFFER = {
 	chewing_aux_Length,
 	chewing_aux_String,
 	0,
+	0,
 };
 
 int get_keystroke( get_char_func get_char, void * param )
@@ -330,6 +334,12 @@ void internal_ok_buffer( const char *file, int line, ChewingContext *ctx,
 			"string function returned `%s' shall be `%s'", buf, expected );
 		chewing_free( buf );
 	}
+
+	if ( buffer->get_string_static ) {
+		const char *static_buf = buffer->get_string_static( ctx );
+		internal_ok( file, line, !strcmp( static_buf, expected ), "!strcmp( static_buf, expected )",
+			"static string function returned `%s' shall be `%s'", static_buf, expected );
+	}
 }
 
 void internal_ok_candidate( const char *file, int line,